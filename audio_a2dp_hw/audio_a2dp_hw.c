@@ -33,16 +33,19 @@
 #include <errno.h>
 #include <pthread.h>
 #include <stdint.h>
+#include <string.h>
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/poll.h>
 #include <sys/errno.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <cutils/str_parms.h>
 #include <cutils/sockets.h>
+#include <cutils/ashmem.h>
 
 #include <system/audio.h>
 #include <hardware/audio.h>
@@ -76,6 +79,12 @@ static int number =0;
 #define CTRL_CHAN_RETRY_COUNT 3
 #define USEC_PER_SEC 1000000L
 
+/* added to the buffered audio for the stack and the a2dp link */
+#define A2DP_LINK_LATENCY_MS 200
+
+/* longest a write waits for room, as the socket send time out */
+#define A2DP_WRITE_TMO_MS 500
+
 #define CASE_RETURN_STR(const) case const: return #const;
 
 #define FNLOG()             ALOGV("%s", __FUNCTION__);
@@ -118,6 +127,9 @@ struct a2dp_stream_out {
     pthread_mutex_t         lock;
     int                     ctrl_fd;
     int                     audio_fd;
+    tA2DP_PCM_RING          *ring;      /* pcm goes here instead of audio_fd */
+    uint32_t                ring_read_pos;  /* read_pos counted in frames_rendered */
+    uint32_t                frames_rendered;
     size_t                  buffer_sz;
     a2dp_state_t            state;
     struct a2dp_config      cfg;
@@ -159,6 +171,7 @@ static const char* dump_a2dp_ctrl_event(char event)
         CASE_RETURN_STR(A2DP_CTRL_CMD_STOP)
         CASE_RETURN_STR(A2DP_CTRL_CMD_SUSPEND)
         CASE_RETURN_STR(A2DP_CTRL_CMD_CHECK_STREAM_STARTED)
+        CASE_RETURN_STR(A2DP_CTRL_CMD_OPEN_PCM_RING)
         default:
             return "UNKNOWN MSG ID";
     }
@@ -320,14 +333,36 @@ static int skt_disconnect(int fd)
 **
 *****************************************************************************/
 
-static int a2dp_command(struct a2dp_stream_out *out, char cmd)
+/* fd, if not -1, is passed to the stack along with the command byte */
+static int a2dp_command_fd(struct a2dp_stream_out *out, char cmd, int fd)
 {
     char ack;
+    struct msghdr msg;
+    struct iovec iv;
+    struct cmsghdr *cmsg;
+    char cmsg_buf[CMSG_SPACE(sizeof(int))];
 
     INFO("A2DP COMMAND %s", dump_a2dp_ctrl_event(cmd));
 
+    memset(&msg, 0, sizeof(msg));
+    iv.iov_base = &cmd;
+    iv.iov_len = 1;
+    msg.msg_iov = &iv;
+    msg.msg_iovlen = 1;
+
+    if (fd != -1)
+    {
+        msg.msg_control = cmsg_buf;
+        msg.msg_controllen = sizeof(cmsg_buf);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
     /* send command */
-    if (send(out->ctrl_fd, &cmd, 1, MSG_NOSIGNAL) == -1)
+    if (sendmsg(out->ctrl_fd, &msg, MSG_NOSIGNAL) == -1)
     {
         ERROR("cmd failed (%s)", strerror(errno));
         skt_disconnect(out->ctrl_fd);
@@ -371,6 +406,150 @@ static int a2dp_command(struct a2dp_stream_out *out, char cmd)
     return 0;
 }
 
+static int a2dp_command(struct a2dp_stream_out *out, char cmd)
+{
+    return a2dp_command_fd(out, cmd, -1);
+}
+
+/*****************************************************************************
+**
+** PCM RING
+**
+*****************************************************************************/
+
+/* offers the stack a shared ring for the pcm, the socket is used if it is
+   not taken */
+static void a2dp_ring_open(struct a2dp_stream_out *out)
+{
+    tA2DP_PCM_RING *ring;
+    int fd;
+
+    fd = ashmem_create_region("a2dp_pcm_ring", sizeof(tA2DP_PCM_RING));
+    if (fd < 0)
+    {
+        ERROR("ashmem failed (%s)", strerror(errno));
+        return;
+    }
+
+    ring = mmap(NULL, sizeof(tA2DP_PCM_RING), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED)
+    {
+        ERROR("mmap failed (%s)", strerror(errno));
+        close(fd);
+        return;
+    }
+
+    ring->magic = A2DP_PCM_RING_MAGIC;
+    ring->size = A2DP_PCM_RING_SZ;
+    ring->write_pos = 0;
+    ring->read_pos = 0;
+    out->ring_read_pos = 0;
+    out->frames_rendered = 0;
+
+    if (a2dp_command_fd(out, A2DP_CTRL_CMD_OPEN_PCM_RING, fd) < 0)
+    {
+        INFO("pcm ring not taken, write to socket");
+        munmap(ring, sizeof(tA2DP_PCM_RING));
+        close(fd);
+        return;
+    }
+
+    /* the stack has its own mapping */
+    close(fd);
+    out->ring = ring;
+}
+
+static void a2dp_ring_close(struct a2dp_stream_out *out)
+{
+    if (out->ring == NULL)
+        return;
+
+    munmap(out->ring, sizeof(tA2DP_PCM_RING));
+    out->ring = NULL;
+}
+
+static uint32_t a2dp_ring_fill(struct a2dp_stream_out *out)
+{
+    return out->ring->write_pos - out->ring->read_pos;
+}
+
+/* waits for room as long as skt_write() would, -1 once the stack went away.
+   Called with out->lock held, which is dropped while waiting for room. */
+static int a2dp_ring_write(struct a2dp_stream_out *out, const uint8_t *p, size_t len)
+{
+    tA2DP_PCM_RING *ring = out->ring;
+    struct pollfd pfd;
+    size_t done = 0;
+    uint32_t wr, room, ofs, n;
+    int waited_ms = 0;
+    int tmo_ms;
+    int ret;
+
+    while (done < len)
+    {
+        wr = ring->write_pos;
+        room = A2DP_PCM_RING_SZ - (wr - ring->read_pos);
+
+        /* the media task is done with the pcm it read before moving read_pos */
+        __sync_synchronize();
+
+        if (room == 0)
+        {
+            if (waited_ms >= A2DP_WRITE_TMO_MS)
+                break;
+
+            /* sleep until about half of the ring played out, on the socket so
+               that the stack closing it ends the wait */
+            tmo_ms = calc_audiotime(out->cfg, A2DP_PCM_RING_SZ / 2) / 1000 + 1;
+            pfd.fd = out->audio_fd;
+            pfd.events = 0;
+
+            /* do not hold off standby and the other stream calls meanwhile */
+            pthread_mutex_unlock(&out->lock);
+            ret = poll(&pfd, 1, tmo_ms);
+            pthread_mutex_lock(&out->lock);
+
+            /* only out_write opens the ring, so a different one means it was closed */
+            if (out->ring != ring)
+            {
+                INFO("pcm ring closed while waiting, dropping %d bytes", len - done);
+                return done;
+            }
+
+            if ((ret > 0) && (pfd.revents & (POLLHUP|POLLERR|POLLNVAL)))
+            {
+                ERROR("stack detached the pcm ring");
+                return -1;
+            }
+            waited_ms += tmo_ms;
+            continue;
+        }
+
+        n = len - done;
+        if (n > room)
+            n = room;
+
+        ofs = wr & (A2DP_PCM_RING_SZ - 1);
+        if (n > A2DP_PCM_RING_SZ - ofs)
+        {
+            memcpy(&ring->data[ofs], p + done, A2DP_PCM_RING_SZ - ofs);
+            memcpy(ring->data, p + done + A2DP_PCM_RING_SZ - ofs, n - (A2DP_PCM_RING_SZ - ofs));
+        }
+        else
+        {
+            memcpy(&ring->data[ofs], p + done, n);
+        }
+
+        /* the pcm is in place before the position covers it */
+        __sync_synchronize();
+        ring->write_pos = wr + n;
+
+        done += n;
+    }
+
+    return done;
+}
+
 /*****************************************************************************
 **
 ** AUDIO DATA PATH
@@ -389,6 +568,7 @@ static void a2dp_stream_out_init(struct a2dp_stream_out *out)
 
     out->ctrl_fd = AUDIO_SKT_DISCONNECTED;
     out->audio_fd = AUDIO_SKT_DISCONNECTED;
+    out->ring = NULL;
     out->state = AUDIO_A2DP_STATE_STOPPED;
 
     out->cfg.channel_flags = AUDIO_STREAM_DEFAULT_CHANNEL_FLAG;
@@ -455,6 +635,8 @@ static int start_audio_datapath(struct a2dp_stream_out *out)
             return -1;
         }
 
+        a2dp_ring_open(out);
+
         out->state = AUDIO_A2DP_STATE_STARTED;
     }
 
@@ -485,6 +667,7 @@ static int stop_audio_datapath(struct a2dp_stream_out *out)
     out->state = AUDIO_A2DP_STATE_STOPPED;
 
     /* disconnect audio path */
+    a2dp_ring_close(out);
     skt_disconnect(out->audio_fd);
     out->audio_fd = AUDIO_SKT_DISCONNECTED;
 
@@ -510,6 +693,7 @@ static int suspend_audio_datapath(struct a2dp_stream_out *out, bool standby)
         out->state = AUDIO_A2DP_STATE_SUSPENDED;
 
     /* disconnect audio path */
+    a2dp_ring_close(out);
     skt_disconnect(out->audio_fd);
 
     out->audio_fd = AUDIO_SKT_DISCONNECTED;
@@ -602,6 +786,25 @@ static ssize_t out_write(struct audio_stream_out *stream, const void* buffer,
 
     ts_error_log("a2dp_out_write", bytes, out->buffer_sz, out->cfg);
 
+    if (out->ring)
+    {
+        /* the ring is only touched with the lock held, so standby can not
+           unmap it under us */
+        sent = a2dp_ring_write(out, buffer, bytes);
+
+        if (sent == -1)
+        {
+            a2dp_ring_close(out);
+            skt_disconnect(out->audio_fd);
+            out->audio_fd = AUDIO_SKT_DISCONNECTED;
+            out->state = AUDIO_A2DP_STATE_STOPPED;
+        }
+        pthread_mutex_unlock(&out->lock);
+
+        DEBUG("wrote %d bytes out of %d bytes to ring", sent, bytes);
+        return sent;
+    }
+
     pthread_mutex_unlock(&out->lock);
 
     #ifdef BT_AUDIO_SYSTRACE_LOG
@@ -806,12 +1009,22 @@ static uint32_t out_get_latency(const struct audio_stream_out *stream)
 
     FNLOG();
 
+    pthread_mutex_lock(&out->lock);
+    if (out->ring)
+    {
+        /* what is queued in the ring, not its capacity */
+        latency_us = calc_audiotime(out->cfg, a2dp_ring_fill(out));
+        pthread_mutex_unlock(&out->lock);
+        return (latency_us / 1000) + A2DP_LINK_LATENCY_MS;
+    }
+    pthread_mutex_unlock(&out->lock);
+
     latency_us = ((out->buffer_sz * 1000 ) /
                     audio_stream_frame_size(&out->stream.common) /
                     out->cfg.rate) * 1000;
 
 
-    return (latency_us / 1000) + 200;
+    return (latency_us / 1000) + A2DP_LINK_LATENCY_MS;
 }
 
 static int out_set_volume(struct audio_stream_out *stream, float left,
@@ -829,8 +1042,28 @@ static int out_set_volume(struct audio_stream_out *stream, float left,
 static int out_get_render_position(const struct audio_stream_out *stream,
                                    uint32_t *dsp_frames)
 {
+    struct a2dp_stream_out *out = (struct a2dp_stream_out *)stream;
+    int ret = -EINVAL;
+
     FNLOG();
-    return -EINVAL;
+
+    /* only the ring tells how much the stack consumed since the stream
+       left standby */
+    pthread_mutex_lock(&out->lock);
+    if (out->ring)
+    {
+        size_t frame_sz = audio_stream_frame_size(&out->stream.common);
+        uint32_t frames = (out->ring->read_pos - out->ring_read_pos) / frame_sz;
+
+        /* read_pos wraps long before the frame count does */
+        out->ring_read_pos += frames * frame_sz;
+        out->frames_rendered += frames;
+        *dsp_frames = out->frames_rendered;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&out->lock);
+
+    return ret;
 }
 
 static int out_add_audio_effect(const struct audio_stream *stream, effect_handle_t effect)
@@ -28,6 +28,8 @@
 #ifndef AUDIO_A2DP_HW_H
 #define AUDIO_A2DP_HW_H
 
+#include <stdint.h>
+
 /*****************************************************************************
 **  Constants & Macros
 ******************************************************************************/
@@ -42,13 +44,20 @@
 #define AUDIO_STREAM_OUTPUT_BUFFER_SZ      (8*512)
 #define AUDIO_SKT_DISCONNECTED             (-1)
 
+/* PCM ring offered by audio_a2dp_hw with A2DP_CTRL_CMD_OPEN_PCM_RING once the
+   data socket is connected. The socket then only tells either side when the
+   other one goes away. */
+#define A2DP_PCM_RING_MAGIC                0x41325052      /* "A2PR" */
+#define A2DP_PCM_RING_SZ                   (16*1024)       /* power of 2 */
+
 typedef enum {
     A2DP_CTRL_CMD_NONE,
     A2DP_CTRL_CMD_CHECK_READY,
     A2DP_CTRL_CMD_CHECK_STREAM_STARTED,
     A2DP_CTRL_CMD_START,
     A2DP_CTRL_CMD_STOP,
-    A2DP_CTRL_CMD_SUSPEND
+    A2DP_CTRL_CMD_SUSPEND,
+    A2DP_CTRL_CMD_OPEN_PCM_RING     /* carries the ring fd (SCM_RIGHTS) */
 } tA2DP_CTRL_CMD;
 
 typedef enum {
@@ -58,6 +67,20 @@ typedef enum {
 } tA2DP_CTRL_ACK;
 
 
+/* Single producer (audio_a2dp_hw), single consumer (media task). The
+   positions count bytes and wrap at 2^32, each side only writes its own,
+   after (writer) or before (reader) a memory barrier around the pcm. */
+typedef struct {
+    uint32_t            magic;
+    uint32_t            size;           /* A2DP_PCM_RING_SZ */
+    uint32_t            pad0[14];
+    volatile uint32_t   write_pos;      /* bytes written by audio_a2dp_hw */
+    uint32_t            pad1[15];
+    volatile uint32_t   read_pos;       /* bytes read by the media task */
+    uint32_t            pad2[15];
+    uint8_t             data[A2DP_PCM_RING_SZ];
+} tA2DP_PCM_RING;
+
 /*****************************************************************************
 **  Type definitions for callback functions
 ******************************************************************************/
@@ -2254,10 +2254,12 @@ void bta_av_data_path (tBTA_AV_SCB *p_scb, tBTA_AV_DATA *p_data)
 
                 AVDT_WriteReqOpt(p_scb->avdt_handle, p_buf, timestamp, m_pt, opt);
                 p_scb->cong = TRUE;
+                bta_av_co_audio_tx_status(p_scb->hndl, p_scb->l2c_bufs, FALSE);
             }
             else
             {
                 /* there's a buffer, but L2CAP does not seem to be moving data */
+                bta_av_co_audio_tx_status(p_scb->hndl, p_scb->l2c_bufs, TRUE);
                 if(new_buf)
                 {
                     /* just got this buffer from co_data,
@@ -907,6 +907,8 @@ void bta_gattc_disc_cmpl(tBTA_GATTC_CLCB *p_clcb, tBTA_GATTC_DATA *p_data)
         /* clean up cache */
         if(p_clcb->p_srcb && p_clcb->p_srcb->p_srvc_cache)
         {
+            bta_gattc_clear_cache_idx(p_clcb->p_srcb);
+
             while (p_clcb->p_srcb->cache_buffer.p_first)
             {
                 GKI_freebuf (GKI_dequeue (&p_clcb->p_srcb->cache_buffer));
@@ -1497,7 +1499,6 @@ void bta_gattc_ci_load(tBTA_GATTC_CLCB *p_clcb, tBTA_GATTC_DATA *p_data)
 
     APPL_TRACE_DEBUG2("bta_gattc_ci_load conn_id=%d load status=%d" ,
                       p_clcb->bta_conn_id, p_data->ci_load.status );
-    bta_gattc_co_cache_close(p_clcb->p_srcb->server_bda, 0);
 
     if ((p_data->ci_load.status == BTA_GATT_OK ||
          p_data->ci_load.status == BTA_GATT_MORE) &&
@@ -1507,6 +1508,8 @@ void bta_gattc_ci_load(tBTA_GATTC_CLCB *p_clcb, tBTA_GATTC_DATA *p_data)
 
         if (p_data->ci_load.status == BTA_GATT_OK)
         {
+            /* keep the NV cache open until the last attribute is loaded */
+            bta_gattc_co_cache_close(p_clcb->p_srcb->server_bda, 0);
             p_clcb->p_srcb->attr_index = 0;
             bta_gattc_reset_discover_st(p_clcb->p_srcb, BTA_GATT_OK);
 
@@ -1523,6 +1526,7 @@ void bta_gattc_ci_load(tBTA_GATTC_CLCB *p_clcb, tBTA_GATTC_DATA *p_data)
     }
     else
     {
+        bta_gattc_co_cache_close(p_clcb->p_srcb->server_bda, 0);
         p_clcb->p_srcb->state = BTA_GATTC_SERV_DISC;
         p_clcb->p_srcb->attr_index = 0;
         /* cache load failure, start discovery */
@@ -1687,6 +1691,8 @@ void bta_gattc_process_api_refresh(tBTA_GATTC_CB *p_cb, tBTA_GATTC_DATA * p_msg)
 
         if (p_srvc_cb->p_srvc_cache != NULL)
         {
+            bta_gattc_clear_cache_idx(p_srvc_cb);
+
             while (p_srvc_cb->cache_buffer.p_first)
                 GKI_freebuf (GKI_dequeue (&p_srvc_cb->cache_buffer));
 
@@ -37,6 +37,7 @@
 #include "btm_api.h"
 
 static void bta_gattc_char_dscpt_disc_cmpl(UINT16 conn_id, tBTA_GATTC_SERV *p_srvc_cb);
+static void bta_gattc_incl_srvc_disc_cmpl(UINT16 conn_id, tBTA_GATTC_SERV *p_srvc_cb);
 static tBTA_GATT_STATUS bta_gattc_sdp_service_disc(UINT16 conn_id, tBTA_GATTC_SERV *p_server_cb);
 
 #define BTA_GATT_SDP_DB_SIZE 750
@@ -170,6 +171,8 @@ tBTA_GATT_STATUS bta_gattc_init_cache(tBTA_GATTC_SERV *p_srvc_cb)
 {
     tBTA_GATT_STATUS    status = BTA_GATT_OK;
 
+    bta_gattc_clear_cache_idx(p_srvc_cb);
+
     while (p_srvc_cb->cache_buffer.p_first)
         GKI_freebuf (GKI_dequeue (&p_srvc_cb->cache_buffer));
 
@@ -185,7 +188,9 @@ tBTA_GATT_STATUS bta_gattc_init_cache(tBTA_GATTC_SERV *p_srvc_cb)
         p_srvc_cb->total_srvc = 0;
         p_srvc_cb->cur_srvc_idx =
         p_srvc_cb->cur_char_idx =
-        p_srvc_cb->next_avail_idx = 0;
+        p_srvc_cb->next_avail_idx =
+        p_srvc_cb->incl_swept = 0;
+        p_srvc_cb->incl_sweep = FALSE;
 
         if (bta_gattc_alloc_cache_buf(p_srvc_cb) == NULL)
         {
@@ -299,6 +304,8 @@ static tBTA_GATT_STATUS bta_gattc_add_srvc_to_cache(tBTA_GATTC_SERV *p_srvc_cb,
     tBTA_GATTC_CACHE    *p_new_srvc = NULL;
     tBTA_GATT_STATUS    status = BTA_GATT_OK;
 
+    bta_gattc_clear_cache_idx(p_srvc_cb);
+
 #if (defined BTA_GATT_DEBUG && BTA_GATT_DEBUG == TRUE)
     APPL_TRACE_DEBUG0("Add a service into Service");
     APPL_TRACE_DEBUG2("free byte = %d,  req %d bytes.", p_srvc_cb->free_byte, sizeof(tBTA_GATTC_CACHE))
@@ -367,6 +374,8 @@ static tBTA_GATT_STATUS bta_gattc_add_attr_to_cache(tBTA_GATTC_SERV *p_srvc_cb,
         return GATT_WRONG_STATE;
     }
 
+    bta_gattc_clear_cache_idx(p_srvc_cb);
+
     if (p_srvc_cb->free_byte < len)
     {
         if (bta_gattc_alloc_cache_buf(p_srvc_cb) == NULL)
@@ -437,16 +446,19 @@ void bta_gattc_get_disc_range(tBTA_GATTC_SERV *p_srvc_cb, UINT16 *p_s_hdl, UINT1
     {
         p_rec = p_srvc_cb->p_srvc_list + p_srvc_cb->cur_srvc_idx;
         *p_s_hdl = p_rec->s_handle;
+        *p_e_hdl = p_rec->e_handle;
     }
     else
     {
+        /* descriptors of all remaining characteristics are found in one sweep,
+           from behind the current characteristic value to the last one's end */
         p_rec = p_srvc_cb->p_srvc_list + p_srvc_cb->cur_char_idx;
         *p_s_hdl = p_rec->s_handle + 1;
+        *p_e_hdl = (p_rec + p_srvc_cb->total_char - 1)->e_handle;
     }
 
-    *p_e_hdl = p_rec->e_handle;
 #if (defined BTA_GATT_DEBUG && BTA_GATT_DEBUG == TRUE)
-    APPL_TRACE_DEBUG2("discover range [%d ~ %d]",p_rec->s_handle, p_rec->e_handle);
+    APPL_TRACE_DEBUG2("discover range [%d ~ %d]", *p_s_hdl, *p_e_hdl);
 #endif
     return;
 }
@@ -517,6 +529,67 @@ tBTA_GATT_STATUS bta_gattc_start_disc_include_srvc(UINT16 conn_id, tBTA_GATTC_SE
 }
 /*******************************************************************************
 **
+** Function         bta_gattc_start_incl_srvc_sweep
+**
+** Description      Start one included service discovery over all primary
+**                  services found, so that services without any included
+**                  service do not need a procedure of their own.
+**
+** Returns          status of the operation.
+**
+*******************************************************************************/
+static tBTA_GATT_STATUS bta_gattc_start_incl_srvc_sweep(UINT16 conn_id, tBTA_GATTC_SERV *p_srvc_cb)
+{
+    tGATT_DISC_PARAM    param;
+    tBTA_GATTC_ATTR_REC *p_rec = p_srvc_cb->p_srvc_list;
+    tBTA_GATT_STATUS    status;
+    UINT8               i;
+
+    /* nothing to gain over the per service procedure */
+    if (p_srvc_cb->total_srvc < 2)
+        return BTA_GATT_ERROR;
+
+    param.s_handle = 0xFFFF;
+    param.e_handle = 0;
+
+    for (i = 0; i < p_srvc_cb->total_srvc; i ++, p_rec ++)
+    {
+        if (p_rec->s_handle < param.s_handle)
+            param.s_handle = p_rec->s_handle;
+        if (p_rec->e_handle > param.e_handle)
+            param.e_handle = p_rec->e_handle;
+    }
+
+    if ((status = GATTC_Discover (conn_id, GATT_DISC_INC_SRVC, &param)) == BTA_GATT_OK)
+    {
+        p_srvc_cb->incl_sweep = TRUE;
+        p_srvc_cb->incl_swept = p_srvc_cb->total_srvc;
+    }
+    return status;
+}
+/*******************************************************************************
+**
+** Function         bta_gattc_mark_incl_srvc
+**
+** Description      mark the service holding an included service declaration
+**                  found by the included service sweep.
+**
+** Returns          None.
+**
+*******************************************************************************/
+static void bta_gattc_mark_incl_srvc(tBTA_GATTC_SERV *p_srvc_cb, UINT16 handle)
+{
+    tBTA_GATTC_ATTR_REC *p_rec = p_srvc_cb->p_srvc_list;
+    UINT8               i;
+
+    for (i = 0; i < p_srvc_cb->incl_swept; i ++, p_rec ++)
+    {
+        if (handle > p_rec->s_handle && handle <= p_rec->e_handle)
+            p_rec->has_incl = TRUE;
+    }
+}
+/*******************************************************************************
+**
 ** Function         bta_gattc_start_disc_char
 **
 ** Description      Start discovery for characteristic
@@ -534,7 +607,8 @@ tBTA_GATT_STATUS bta_gattc_start_disc_char(UINT16 conn_id, tBTA_GATTC_SERV *p_sr
 **
 ** Function         bta_gattc_start_disc_char_dscp
 **
-** Description      Start discovery for characteristic descriptor
+** Description      Start discovery for the characteristic descriptors of the
+**                  remaining characteristics of the service in one procedure.
 **
 ** Returns          none.
 **
@@ -581,8 +655,12 @@ static void bta_gattc_explore_srvc(UINT16 conn_id, tBTA_GATTC_SERV *p_srvc_cb)
                                          p_rec->is_primary,
                                          p_rec->srvc_inst_id) == 0)
         {
+            /* the sweep found no included service here, go on with characteristics */
+            if (p_srvc_cb->cur_srvc_idx < p_srvc_cb->incl_swept && !p_rec->has_incl)
+                bta_gattc_incl_srvc_disc_cmpl(conn_id, p_srvc_cb);
             /* start discovering included services */
-            bta_gattc_start_disc_include_srvc(conn_id, p_srvc_cb);
+            else
+                bta_gattc_start_disc_include_srvc(conn_id, p_srvc_cb);
             return;
         }
     }
@@ -636,7 +714,7 @@ static void bta_gattc_char_disc_cmpl(UINT16 conn_id, tBTA_GATTC_SERV *p_srvc_cb)
                                      p_rec->property,
                                      BTA_GATTC_ATTR_TYPE_CHAR);
 
-        /* start discoverying characteristic descriptor , if failed, disc for next char*/
+        /* start discoverying descriptors of all characteristics, if failed, disc for next service */
         bta_gattc_start_disc_char_dscp(conn_id, p_srvc_cb);
     }
     else /* otherwise start with next service */
@@ -648,6 +726,58 @@ static void bta_gattc_char_disc_cmpl(UINT16 conn_id, tBTA_GATTC_SERV *p_srvc_cb)
 }
 /*******************************************************************************
 **
+** Function         bta_gattc_add_next_char_to_cache
+**
+** Description      move on to the next characteristic of the service being
+**                  explored and add it into cache.
+**
+** Returns          None.
+**
+*******************************************************************************/
+static void bta_gattc_add_next_char_to_cache(tBTA_GATTC_SERV *p_srvc_cb)
+{
+    tBTA_GATTC_ATTR_REC *p_rec = p_srvc_cb->p_srvc_list + (++ p_srvc_cb->cur_char_idx);
+
+    p_srvc_cb->total_char --;
+
+    bta_gattc_add_attr_to_cache (p_srvc_cb,
+                                 p_rec->s_handle,
+                                 &p_rec->uuid,
+                                 p_rec->property,
+                                 BTA_GATTC_ATTR_TYPE_CHAR);
+}
+/*******************************************************************************
+**
+** Function         bta_gattc_add_char_dscpt_to_cache
+**
+** Description      add a descriptor found by the descriptor sweep into cache.
+**                  Characteristics are added in handle order as the sweep goes
+**                  past them, so the cache looks as if they were discovered
+**                  one after another.
+**
+** Returns          None.
+**
+*******************************************************************************/
+static void bta_gattc_add_char_dscpt_to_cache(tBTA_GATTC_SERV *p_srvc_cb, UINT16 handle,
+                                              tBT_UUID *p_uuid)
+{
+    tBTA_GATTC_ATTR_REC *p_rec = p_srvc_cb->p_srvc_list + p_srvc_cb->cur_char_idx;
+
+    if (p_srvc_cb->total_char == 0)
+        return;
+
+    while (p_srvc_cb->total_char > 1 && handle > p_rec->e_handle)
+    {
+        bta_gattc_add_next_char_to_cache(p_srvc_cb);
+        p_rec ++;
+    }
+
+    /* the sweep also returns characteristic declarations and values, skip them */
+    if (handle > p_rec->s_handle && handle <= p_rec->e_handle)
+        bta_gattc_add_attr_to_cache(p_srvc_cb, handle, p_uuid, 0, BTA_GATTC_ATTR_TYPE_CHAR_DESCR);
+}
+/*******************************************************************************
+**
 ** Function         bta_gattc_char_dscpt_disc_cmpl
 **
 ** Description      process the char descriptor discovery complete event
@@ -657,33 +787,18 @@ static void bta_gattc_char_disc_cmpl(UINT16 conn_id, tBTA_GATTC_SERV *p_srvc_cb)
 *******************************************************************************/
 static void bta_gattc_char_dscpt_disc_cmpl(UINT16 conn_id, tBTA_GATTC_SERV *p_srvc_cb)
 {
-    tBTA_GATTC_ATTR_REC *p_rec = NULL;
+    /* add the characteristics behind the last descriptor found */
+    while (p_srvc_cb->total_char > 1)
+        bta_gattc_add_next_char_to_cache(p_srvc_cb);
 
-    if((p_srvc_cb->total_char != 0) && (-- p_srvc_cb->total_char > 0))
-    {
-        p_rec = p_srvc_cb->p_srvc_list + (++ p_srvc_cb->cur_char_idx);
-        /* add the next characteristic into cache */
-        if(p_rec != NULL)  {
-           bta_gattc_add_attr_to_cache (p_srvc_cb,
-                                     p_rec->s_handle,
-                                     &p_rec->uuid,
-                                     p_rec->property,
-                                     BTA_GATTC_ATTR_TYPE_CHAR);
+    p_srvc_cb->total_char = 0;
 
-           /* start discoverying next characteristic for char descriptor */
-           bta_gattc_start_disc_char_dscp(conn_id, p_srvc_cb);
-        }
-    }
-    else
     /* all characteristic has been explored, start with next service if any */
-    {
 #if (defined BTA_GATT_DEBUG && BTA_GATT_DEBUG == TRUE)
-        APPL_TRACE_ERROR0("all char has been explored");
+    APPL_TRACE_ERROR0("all char has been explored");
 #endif
-        p_srvc_cb->cur_srvc_idx ++;
-        bta_gattc_explore_srvc (conn_id, p_srvc_cb);
-    }
-
+    p_srvc_cb->cur_srvc_idx ++;
+    bta_gattc_explore_srvc (conn_id, p_srvc_cb);
 }
 static BOOLEAN bta_gattc_srvc_in_list(tBTA_GATTC_SERV *p_srvc_cb, UINT16 s_handle,
                                       UINT16 e_handle, tBT_UUID uuid)
@@ -742,6 +857,7 @@ static tBTA_GATT_STATUS bta_gattc_add_srvc_to_list(tBTA_GATTC_SERV *p_srvc_cb,
         p_rec->e_handle     = e_handle;
         p_rec->is_primary   = is_primary;
         p_rec->srvc_inst_id = bta_gattc_get_srvc_inst_id(p_srvc_cb, uuid);
+        p_rec->has_incl     = FALSE;
         memcpy(&p_rec->uuid, &uuid, sizeof(tBT_UUID));
 
         p_srvc_cb->next_avail_idx ++;
@@ -959,6 +1075,11 @@ void bta_gattc_disc_res_cback (UINT16 conn_id, tGATT_DISC_TYPE disc_type, tGATT_
                 break;
 
             case GATT_DISC_INC_SRVC:
+                if (p_srvc_cb->incl_sweep)
+                {
+                    bta_gattc_mark_incl_srvc(p_srvc_cb, p_data->handle);
+                    break;
+                }
                 /* add included service into service list if it's secondary or it never showed up
                    in the primary service search */
                 pri_srvc = bta_gattc_srvc_in_list(p_srvc_cb,
@@ -990,7 +1111,7 @@ void bta_gattc_disc_res_cback (UINT16 conn_id, tGATT_DISC_TYPE disc_type, tGATT_
                 break;
 
             case GATT_DISC_CHAR_DSCPT:
-                bta_gattc_add_attr_to_cache(p_srvc_cb, p_data->handle, &p_data->type, 0, BTA_GATTC_ATTR_TYPE_CHAR_DESCR);
+                bta_gattc_add_char_dscpt_to_cache(p_srvc_cb, p_data->handle, &p_data->type);
                 break;
         }
     }
@@ -1018,11 +1139,18 @@ void bta_gattc_disc_cmpl_cback (UINT16 conn_id, tGATT_DISC_TYPE disc_type, tGATT
 #if (defined BTA_GATT_DEBUG && BTA_GATT_DEBUG == TRUE)
                 bta_gattc_display_explore_record(p_srvc_cb->p_srvc_list, p_srvc_cb->next_avail_idx);
 #endif
-                bta_gattc_explore_srvc(conn_id, p_srvc_cb);
+                if (bta_gattc_start_incl_srvc_sweep(conn_id, p_srvc_cb) != BTA_GATT_OK)
+                    bta_gattc_explore_srvc(conn_id, p_srvc_cb);
                 break;
 
             case GATT_DISC_INC_SRVC:
-                bta_gattc_incl_srvc_disc_cmpl(conn_id, p_srvc_cb);
+                if (p_srvc_cb->incl_sweep)
+                {
+                    p_srvc_cb->incl_sweep = FALSE;
+                    bta_gattc_explore_srvc(conn_id, p_srvc_cb);
+                }
+                else
+                    bta_gattc_incl_srvc_disc_cmpl(conn_id, p_srvc_cb);
 
                 break;
 
@@ -1041,6 +1169,206 @@ void bta_gattc_disc_cmpl_cback (UINT16 conn_id, tGATT_DISC_TYPE disc_type, tGATT
 }
 /*******************************************************************************
 **
+** Function         bta_gattc_clear_cache_idx
+**
+** Description      release the lookup index of a server cache. Called whenever
+**                  the cache changes; the index is rebuilt on next lookup.
+**
+** Returns          None.
+**
+*******************************************************************************/
+void bta_gattc_clear_cache_idx(tBTA_GATTC_SERV *p_srvc_cb)
+{
+    if (p_srvc_cb->p_idx != NULL)
+    {
+        GKI_os_free(p_srvc_cb->p_idx);
+        p_srvc_cb->p_idx = NULL;
+    }
+}
+/*******************************************************************************
+**
+** Function         bta_gattc_uuid_key
+**
+** Description      16 bits hash key of a UUID. A 128 bits UUID yields the
+**                  bytes holding the 16 bits alias, so that both forms of a
+**                  UUID which bta_gattc_uuid_compare() matches hash alike.
+**
+** Returns          hash key.
+**
+*******************************************************************************/
+static UINT16 bta_gattc_uuid_key(tBT_UUID *p_uuid)
+{
+    if (p_uuid->len == LEN_UUID_16)
+        return p_uuid->uu.uuid16;
+    else if (p_uuid->len == LEN_UUID_128)
+        return (UINT16)(p_uuid->uu.uuid128[LEN_UUID_128 - 4] |
+                        (p_uuid->uu.uuid128[LEN_UUID_128 - 3] << 8));
+    else
+        return 0;
+}
+/*******************************************************************************
+**
+** Function         bta_gattc_id_hash
+**
+** Description      hash a GATT ID into the ID slot table of a cache index.
+**
+** Returns          slot to start probing from.
+**
+*******************************************************************************/
+static UINT16 bta_gattc_id_hash(tBTA_GATTC_IDX *p_idx, tBTA_GATT_SRVC_ID *p_srvc_id,
+                                tBT_UUID *p_char_uuid, UINT8 char_inst,
+                                tBT_UUID *p_descr_uuid, UINT8 descr_inst)
+{
+    UINT32  h = 2166136261u;
+
+    h = (h ^ bta_gattc_uuid_key(&p_srvc_id->id.uuid)) * 16777619u;
+    h = (h ^ (p_srvc_id->id.inst_id | (p_srvc_id->is_primary << 8))) * 16777619u;
+    h = (h ^ bta_gattc_uuid_key(p_char_uuid)) * 16777619u;
+    h = (h ^ char_inst) * 16777619u;
+
+    if (p_descr_uuid != NULL)
+    {
+        h = (h ^ bta_gattc_uuid_key(p_descr_uuid)) * 16777619u;
+        h = (h ^ descr_inst) * 16777619u;
+    }
+    return (UINT16)((h ^ (h >> 16)) & p_idx->mask);
+}
+/*******************************************************************************
+**
+** Function         bta_gattc_idx_insert
+**
+** Description      put an entry into the first free slot from pos on.
+**
+** Returns          None.
+**
+*******************************************************************************/
+static void bta_gattc_idx_insert(tBTA_GATTC_IDX *p_idx, UINT16 *p_slot, UINT16 pos, UINT16 ent)
+{
+    while (p_slot[pos] != 0)
+        pos = (pos + 1) & p_idx->mask;
+
+    p_slot[pos] = ent + 1;
+}
+/*******************************************************************************
+**
+** Function         bta_gattc_get_cache_idx
+**
+** Description      get the lookup index of a server cache, building it from
+**                  the cache lists if there is none. Every service and
+**                  attribute is indexed by handle, and by the GATT ID it is
+**                  looked up with: (service, attribute) for all attributes
+**                  and (service, characteristic, descriptor) for descriptors.
+**
+** Returns          the index, NULL if there is no cache or no memory.
+**
+*******************************************************************************/
+static tBTA_GATTC_IDX *bta_gattc_get_cache_idx(tBTA_GATTC_SERV *p_srvc_cb)
+{
+    tBTA_GATTC_IDX          *p_idx;
+    tBTA_GATTC_IDX_ENT      *p_ent;
+    tBTA_GATTC_CACHE        *p_cache;
+    tBTA_GATTC_CACHE_ATTR   *p_attr, *p_char;
+    tBT_UUID                attr_uuid, char_uuid;
+    UINT32                  num_ent = 0, num_slot = 4;
+    UINT16                  i = 0;
+
+    if (p_srvc_cb->p_srvc_cache == NULL)
+        return NULL;
+
+    if (p_srvc_cb->p_idx != NULL)
+        return p_srvc_cb->p_idx;
+
+    for (p_cache = p_srvc_cb->p_srvc_cache; p_cache; p_cache = p_cache->p_next)
+    {
+        for (num_ent ++, p_attr = p_cache->p_attr; p_attr; p_attr = p_attr->p_next)
+            num_ent ++;
+    }
+
+    /* keep the slot tables at most half full */
+    while (num_slot < 2 * num_ent)
+        num_slot <<= 1;
+
+    if (num_slot > 0x10000 ||
+        (p_idx = (tBTA_GATTC_IDX *)GKI_os_malloc(sizeof(tBTA_GATTC_IDX) +
+                                                 num_ent * sizeof(tBTA_GATTC_IDX_ENT) +
+                                                 2 * num_slot * sizeof(UINT16))) == NULL)
+    {
+        APPL_TRACE_ERROR1("No resources: cache index of %d entries failed.", num_ent);
+        return NULL;
+    }
+
+    p_idx->num_ent      = (UINT16)num_ent;
+    p_idx->mask         = (UINT16)(num_slot - 1);
+    p_idx->p_ent        = (tBTA_GATTC_IDX_ENT *)(p_idx + 1);
+    p_idx->p_hdl_slot   = (UINT16 *)(p_idx->p_ent + num_ent);
+    p_idx->p_id_slot    = p_idx->p_hdl_slot + num_slot;
+    memset(p_idx->p_hdl_slot, 0, 2 * num_slot * sizeof(UINT16));
+
+    p_ent = p_idx->p_ent;
+
+    for (p_cache = p_srvc_cb->p_srvc_cache; p_cache; p_cache = p_cache->p_next)
+    {
+        p_ent->p_srvc   = p_cache;
+        p_ent->p_attr   = NULL;
+        p_ent->p_char   = NULL;
+        p_ent->handle   = p_cache->s_handle;
+        bta_gattc_idx_insert(p_idx, p_idx->p_hdl_slot, p_ent->handle & p_idx->mask, i);
+        p_ent ++;
+        i ++;
+
+        for (p_char = NULL, p_attr = p_cache->p_attr; p_attr; p_attr = p_attr->p_next, p_ent ++, i ++)
+        {
+            if (p_attr->attr_type == BTA_GATTC_ATTR_TYPE_CHAR)
+                p_char = p_attr;
+
+            p_ent->p_srvc   = p_cache;
+            p_ent->p_attr   = p_attr;
+            p_ent->p_char   = (p_attr->attr_type == BTA_GATTC_ATTR_TYPE_CHAR_DESCR) ? p_char : NULL;
+            p_ent->handle   = p_attr->attr_handle;
+            bta_gattc_idx_insert(p_idx, p_idx->p_hdl_slot, p_ent->handle & p_idx->mask, i);
+
+            bta_gattc_pack_attr_uuid(p_attr, &attr_uuid);
+            bta_gattc_idx_insert(p_idx, p_idx->p_id_slot,
+                                 bta_gattc_id_hash(p_idx, &p_cache->service_uuid,
+                                                   &attr_uuid, p_attr->inst_id, NULL, 0),
+                                 i);
+
+            if (p_ent->p_char != NULL)
+            {
+                bta_gattc_pack_attr_uuid(p_char, &char_uuid);
+                bta_gattc_idx_insert(p_idx, p_idx->p_id_slot,
+                                     bta_gattc_id_hash(p_idx, &p_cache->service_uuid,
+                                                       &char_uuid, p_char->inst_id,
+                                                       &attr_uuid, p_attr->inst_id),
+                                     i);
+            }
+        }
+    }
+
+    p_srvc_cb->p_idx = p_idx;
+
+    return p_idx;
+}
+/*******************************************************************************
+**
+** Function         bta_gattc_attr_id_match
+**
+** Description      check whether a cached attribute has a given GATT ID.
+**
+** Returns          TRUE if it matches.
+**
+*******************************************************************************/
+static BOOLEAN bta_gattc_attr_id_match(tBTA_GATTC_CACHE_ATTR *p_attr, tBTA_GATT_ID *p_id)
+{
+    tBT_UUID    attr_uuid;
+
+    bta_gattc_pack_attr_uuid(p_attr, &attr_uuid);
+
+    return (p_id->inst_id == p_attr->inst_id &&
+            bta_gattc_uuid_compare(&p_id->uuid, &attr_uuid, TRUE));
+}
+/*******************************************************************************
+**
 ** Function         bta_gattc_id2handle
 **
 ** Description      map GATT ID to handle in a given cache.
@@ -1051,89 +1379,40 @@ void bta_gattc_disc_cmpl_cback (UINT16 conn_id, tGATT_DISC_TYPE disc_type, tGATT
 UINT16 bta_gattc_id2handle(tBTA_GATTC_SERV *p_srcb, tBTA_GATT_SRVC_ID *p_service_id,
                            tBTA_GATT_ID *p_char_id, tBTA_GATT_ID *p_descr_uuid)
 {
-    tBTA_GATTC_CACHE    *p_cache = p_srcb->p_srvc_cache;
-    tBTA_GATTC_CACHE_ATTR   *p_attr;
-    UINT8       j;
-    UINT16      handle = 0;
-    tBT_UUID    attr_uuid;
-    BOOLEAN     char_map = FALSE, done = FALSE;
+    tBTA_GATTC_IDX      *p_idx;
+    tBTA_GATTC_IDX_ENT  *p_ent, *p_found = NULL;
+    UINT16              pos, slot;
+    BOOLEAN             match;
+
+    if (p_service_id == NULL || p_char_id == NULL ||
+        (p_idx = bta_gattc_get_cache_idx(p_srcb)) == NULL)
+        return 0;
 
-    while (p_service_id && p_cache && !done)
+    pos = bta_gattc_id_hash(p_idx, p_service_id, &p_char_id->uuid, p_char_id->inst_id,
+                            p_descr_uuid ? &p_descr_uuid->uuid : NULL,
+                            p_descr_uuid ? p_descr_uuid->inst_id : 0);
+
+    /* walk the whole probe run, the first attribute in cache order wins */
+    for (; (slot = p_idx->p_id_slot[pos]) != 0; pos = (pos + 1) & p_idx->mask)
     {
-#if (defined BTA_GATT_DEBUG && BTA_GATT_DEBUG == TRUE)
-        APPL_TRACE_DEBUG3("Service: handle[%d] uuid[0x%04x] inst[%d]",
-                          p_cache->s_handle, p_cache->service_uuid.id.uuid.uu.uuid16,
-                          p_cache->service_uuid.id.inst_id);
-#endif
-        p_attr = p_cache->p_attr;
+        p_ent = p_idx->p_ent + slot - 1;
 
-        if (bta_gattc_srvcid_compare(p_service_id, &p_cache->service_uuid))
-        {
-            for (j = 0; p_attr; j ++)
-            {
-#if (defined BTA_GATT_DEBUG && BTA_GATT_DEBUG == TRUE)
-                APPL_TRACE_DEBUG5("\t Attr[0x%04x] handle[0x%04x] uuid[0x%04x] inst[%d] type[%d]",
-                                  j + 1, p_attr->attr_handle, p_attr->p_uuid->uuid16, p_attr->inst_id, p_attr->attr_type);
-#endif
-                bta_gattc_pack_attr_uuid(p_attr, &attr_uuid);
+        if ((p_found != NULL && p_ent > p_found) || p_ent->p_attr == NULL ||
+            !bta_gattc_srvcid_compare(p_service_id, &p_ent->p_srvc->service_uuid))
+            continue;
 
-                if (bta_gattc_uuid_compare(&p_char_id->uuid, &attr_uuid, TRUE) &&
-                    p_char_id->inst_id == p_attr->inst_id)
-                {
-                    if (p_descr_uuid == NULL)
-                    {
-                        handle = p_attr->attr_handle;
-                        done = TRUE;
-                        break;
-                    }
-                    else
-                    {
-#if (defined BTA_GATT_DEBUG && BTA_GATT_DEBUG == TRUE)
-                        APPL_TRACE_DEBUG0("found matching characteristic for the descriptor");
-#endif
-                        char_map = TRUE;
-                    }
-                }
-                else if (char_map == TRUE)
-                {
-                    if (p_attr->attr_type == BTA_GATTC_ATTR_TYPE_CHAR_DESCR)
-                    {
+        if (p_descr_uuid == NULL)
+            match = bta_gattc_attr_id_match(p_ent->p_attr, p_char_id);
+        else
+            match = (p_ent->p_char != NULL &&
+                     bta_gattc_attr_id_match(p_ent->p_attr, p_descr_uuid) &&
+                     bta_gattc_attr_id_match(p_ent->p_char, p_char_id));
 
-                        if (p_descr_uuid != NULL &&
-                            bta_gattc_uuid_compare(&p_descr_uuid->uuid, &attr_uuid, TRUE) &&
-                            p_descr_uuid->inst_id == p_attr->inst_id)
-                        {
-#if (defined BTA_GATT_DEBUG && BTA_GATT_DEBUG == TRUE)
-                            APPL_TRACE_DEBUG0("found descriptor!!");
-#endif
-                            handle = p_attr->attr_handle;
-                            done = TRUE;
-                            break;
-                        }
-                        else
-                        {
-#if (defined BTA_GATT_DEBUG && BTA_GATT_DEBUG == TRUE)
-                            APPL_TRACE_DEBUG0("descriptor UUID not matching");
-#endif
-                        }
-                    }
-                    else /* another char */
-                    {
-#if (defined BTA_GATT_DEBUG && BTA_GATT_DEBUG == TRUE)
-                        APPL_TRACE_DEBUG0("no matching descriptor found!! start of next characteristic");
-#endif
-                        char_map = FALSE;
-                        done = TRUE;
-                        break;
-                    }
-                }
-                p_attr = p_attr->p_next;
-            }
-        }
-        p_cache = p_cache->p_next;
+        if (match)
+            p_found = p_ent;
     }
 
-    return handle;
+    return (p_found != NULL) ? p_found->handle : 0;
 }
 /*******************************************************************************
 **
@@ -1148,75 +1427,57 @@ UINT16 bta_gattc_id2handle(tBTA_GATTC_SERV *p_srcb, tBTA_GATT_SRVC_ID *p_service
 BOOLEAN bta_gattc_handle2id(tBTA_GATTC_SERV *p_srcb, UINT16 handle, tBTA_GATT_SRVC_ID *p_service_id,
                             tBTA_GATT_ID *p_char_id, tBTA_GATT_ID *p_descr_type)
 {
-    tBTA_GATTC_CACHE    *p_cache = p_srcb->p_srvc_cache;
-    tBTA_GATTC_CACHE_ATTR   *p_attr, *p_char = NULL;
-    UINT8       j;
+    tBTA_GATTC_IDX      *p_idx;
+    tBTA_GATTC_IDX_ENT  *p_ent, *p_found = NULL;
+    UINT16              pos, slot;
 
     memset(p_service_id, 0, sizeof(tBTA_GATT_SRVC_ID));
     memset(p_char_id, 0, sizeof(tBTA_GATT_ID));
     memset(p_descr_type, 0, sizeof(tBTA_GATT_ID));
 
-    while (p_cache)
+    if ((p_idx = bta_gattc_get_cache_idx(p_srcb)) == NULL)
+        return FALSE;
+
+    for (pos = handle & p_idx->mask; (slot = p_idx->p_hdl_slot[pos]) != 0;
+         pos = (pos + 1) & p_idx->mask)
     {
-#if (defined BTA_GATT_DEBUG && BTA_GATT_DEBUG == TRUE)
-        APPL_TRACE_DEBUG3("Service: handle[%d] uuid[0x%04x] inst[%d]",
-                          p_cache->s_handle, p_cache->service_uuid.id.uuid.uu.uuid16,
-                          p_cache->service_uuid.id.inst_id);
-#endif
-        /* a service found */
-        if (p_cache->s_handle == handle)
-        {
-            memcpy(p_service_id, &p_cache->service_uuid, sizeof(tBTA_GATT_SRVC_ID));
+        p_ent = p_idx->p_ent + slot - 1;
 
-            return TRUE;
-        }
-        else /* start looking for attributes within the service */
-        {
-            p_attr = p_cache->p_attr;
+        if (p_ent->handle == handle && (p_found == NULL || p_ent < p_found))
+            p_found = p_ent;
+    }
 
-            for (j = 0; p_attr; j ++)
-            {
-#if (defined BTA_GATT_DEBUG && BTA_GATT_DEBUG == TRUE)
-                APPL_TRACE_DEBUG5("\t Attr[0x%04x] handle[0x%04x] uuid[0x%04x] inst[%d] type[%d]",
-                                  j + 1, p_attr->attr_handle, p_attr->p_uuid->uuid16, p_attr->inst_id, p_attr->attr_type);
-#endif
-                if (p_attr->attr_type == BTA_GATTC_ATTR_TYPE_CHAR)
-                    p_char = p_attr;
+    if (p_found == NULL)
+        return FALSE;
 
-                if (handle == p_attr->attr_handle)
-                {
-                    memcpy(p_service_id, &p_cache->service_uuid, sizeof(tBTA_GATT_SRVC_ID));
+    memcpy(p_service_id, &p_found->p_srvc->service_uuid, sizeof(tBTA_GATT_SRVC_ID));
 
-                    if (p_attr->attr_type == BTA_GATTC_ATTR_TYPE_CHAR_DESCR)
-                    {
-                        bta_gattc_pack_attr_uuid(p_attr, &p_descr_type->uuid);
-                        p_descr_type->inst_id = p_attr->inst_id;
+    /* a service found */
+    if (p_found->p_attr == NULL)
+        return TRUE;
 
-                        if (p_char != NULL)
-                        {
-                            bta_gattc_pack_attr_uuid(p_char, &p_char_id->uuid);
-                            p_char_id->inst_id = p_char->inst_id;
-                        }
-                        else
-                        {
-                            APPL_TRACE_ERROR0("descriptor does not belong to any chracteristic, error");
-                        }
-                    }
-                    else
-                    /* is a characterisitc value or included service */
-                    {
-                        bta_gattc_pack_attr_uuid(p_attr, &p_char_id->uuid);
-                        p_char_id->inst_id =p_attr->inst_id;
-                    }
-                    return TRUE;
-                }
-                p_attr = p_attr->p_next;
-            }
+    if (p_found->p_attr->attr_type == BTA_GATTC_ATTR_TYPE_CHAR_DESCR)
+    {
+        bta_gattc_pack_attr_uuid(p_found->p_attr, &p_descr_type->uuid);
+        p_descr_type->inst_id = p_found->p_attr->inst_id;
+
+        if (p_found->p_char != NULL)
+        {
+            bta_gattc_pack_attr_uuid(p_found->p_char, &p_char_id->uuid);
+            p_char_id->inst_id = p_found->p_char->inst_id;
+        }
+        else
+        {
+            APPL_TRACE_ERROR0("descriptor does not belong to any chracteristic, error");
         }
-        p_cache = p_cache->p_next;
     }
-
-    return FALSE;
+    else
+    /* is a characterisitc value or included service */
+    {
+        bta_gattc_pack_attr_uuid(p_found->p_attr, &p_char_id->uuid);
+        p_char_id->inst_id = p_found->p_attr->inst_id;
+    }
+    return TRUE;
 }
 
 /*******************************************************************************
@@ -1482,6 +1743,8 @@ void bta_gattc_rebuild_cache(tBTA_GATTC_SERV *p_srvc_cb, UINT16 num_attr,
     APPL_TRACE_ERROR0("bta_gattc_rebuild_cache");
     if (attr_index == 0)
     {
+        bta_gattc_clear_cache_idx(p_srvc_cb);
+
         while (p_srvc_cb->cache_buffer.p_first)
             GKI_freebuf (GKI_dequeue (&p_srvc_cb->cache_buffer));
 
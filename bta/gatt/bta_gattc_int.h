@@ -261,6 +261,26 @@ typedef struct gattc_svc_cache
 } __attribute__((packed)) tBTA_GATTC_CACHE;
 // btla-specific --
 
+/* one service, characteristic, descriptor or included service of a server cache */
+typedef struct
+{
+    tBTA_GATTC_CACHE        *p_srvc;
+    tBTA_GATTC_CACHE_ATTR   *p_attr;    /* NULL for the service itself */
+    tBTA_GATTC_CACHE_ATTR   *p_char;    /* characteristic a descriptor belongs to */
+    UINT16                  handle;
+} tBTA_GATTC_IDX_ENT;
+
+/* hash index over a server cache for handle <-> GATT ID mapping; the slot
+   tables hold entry index + 1 and are probed linearly */
+typedef struct
+{
+    UINT16                  num_ent;
+    UINT16                  mask;       /* number of slots - 1 */
+    tBTA_GATTC_IDX_ENT      *p_ent;
+    UINT16                  *p_hdl_slot;
+    UINT16                  *p_id_slot;
+} tBTA_GATTC_IDX;
+
 typedef struct
 {
     tBT_UUID            uuid;
@@ -269,6 +289,7 @@ typedef struct
     BOOLEAN             is_primary;
     UINT8               srvc_inst_id;
     tBTA_GATT_CHAR_PROP property;
+    BOOLEAN             has_incl;   /* service: included service seen by the sweep */
 }tBTA_GATTC_ATTR_REC;
 
 
@@ -305,6 +326,7 @@ typedef struct
     tBTA_GATTC_CACHE    *p_srvc_cache;
     tBTA_GATTC_CACHE    *p_cur_srvc;
     BUFFER_Q            cache_buffer;   /* buffer queue used for storing the cache data */
+    tBTA_GATTC_IDX      *p_idx;         /* lookup index, built on demand */
     UINT8               *p_free;        /* starting point to next available byte */
     UINT16              free_byte;      /* number of available bytes in server cache buffer */
     UINT8               update_count;   /* indication received */
@@ -317,6 +339,8 @@ typedef struct
     UINT8               next_avail_idx;
     UINT8               total_srvc;
     UINT8               total_char;
+    UINT8               incl_swept;     /* services covered by the included service sweep */
+    BOOLEAN             incl_sweep;     /* included service sweep in progress */
 
     UINT8               srvc_hdl_chg;   /* service handle change indication pending */
     UINT16              attr_index;     /* cahce NV saving/loading attribute index */
@@ -525,6 +549,7 @@ extern tBTA_GATT_STATUS bta_gattc_query_cache(UINT16 conn_id, UINT8 query_type,
 extern tBTA_GATT_STATUS bta_gattc_init_cache(tBTA_GATTC_SERV *p_srvc_cb);
 extern void bta_gattc_rebuild_cache(tBTA_GATTC_SERV *p_srcv, UINT16 num_attr, tBTA_GATTC_NV_ATTR *p_attr, UINT16 attr_index);
 extern BOOLEAN bta_gattc_cache_save(tBTA_GATTC_SERV *p_srvc_cb, UINT16 conn_id);
+extern void bta_gattc_clear_cache_idx(tBTA_GATTC_SERV *p_srvc_cb);
 
 
 extern tBTA_GATTC_CONN * bta_gattc_conn_alloc(BD_ADDR remote_bda);
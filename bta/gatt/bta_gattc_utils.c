@@ -404,6 +404,8 @@ tBTA_GATTC_SERV * bta_gattc_srcb_alloc(BD_ADDR bda)
 
     if (p_tcb != NULL)
     {
+        bta_gattc_clear_cache_idx(p_tcb);
+
         while (p_tcb->cache_buffer.p_first)
             GKI_freebuf (GKI_dequeue (&p_tcb->cache_buffer));
 
@@ -338,6 +338,21 @@ BTA_API extern void * bta_av_co_video_src_data_path(tBTA_AV_CODEC codec_type,
 *******************************************************************************/
 BTA_API extern void bta_av_co_audio_drop(tBTA_AV_HNDL hndl);
 
+/*******************************************************************************
+**
+** Function         bta_av_co_audio_tx_status
+**
+** Description      This function is called by AV each time a media packet is
+**                  given to L2CAP or held back. l2c_bufs is the number of
+**                  packets L2CAP holds for the stream, congested is TRUE when
+**                  L2CAP does not take more. The implementation may adapt the
+**                  encoder bit rate to the link.
+**
+** Returns          void
+**
+*******************************************************************************/
+BTA_API extern void bta_av_co_audio_tx_status(tBTA_AV_HNDL hndl, UINT8 l2c_bufs, BOOLEAN congested);
+
 /*******************************************************************************
 **
 ** Function         bta_av_co_video_report_conn
@@ -25,6 +25,7 @@
 #define BTA_JV_CO_H
 
 #include "bta_jv_api.h"
+#include "port_api.h"
 
 /*****************************************************************************
 **  Function Declarations
@@ -45,6 +46,7 @@
 BTA_API extern int bta_co_rfc_data_incoming(void *user_data, BT_HDR *p_buf);
 BTA_API extern int bta_co_rfc_data_outgoing_size(void *user_data, int *size);
 BTA_API extern int bta_co_rfc_data_outgoing(void *user_data, UINT8* buf, UINT16 size);
+BTA_API extern int bta_co_rfc_data_outgoing_segs(void *user_data, tPORT_DATA_SEG *p_segs, UINT16 num_segs);
 
 #if (defined(OBX_OVER_L2CAP_INCLUDED) && OBX_OVER_L2CAP_INCLUDED == TRUE)
 BTA_API extern int bta_co_l2c_data_incoming(void *user_data, BT_HDR *p_buf);
@@ -2224,6 +2224,7 @@ static tBTA_JV_L2C_CB *bta_jv_add_listen_l2c (tBTA_JV_L2C_CB *p_l2c_cb)
 #define DATA_CO_CALLBACK_TYPE_INCOMING          1
 #define DATA_CO_CALLBACK_TYPE_OUTGOING_SIZE     2
 #define DATA_CO_CALLBACK_TYPE_OUTGOING          3
+#define DATA_CO_CALLBACK_TYPE_OUTGOING_SEGS     4
 */
 static int bta_jv_port_data_co_cback(UINT16 port_handle, UINT8 *buf, UINT16 len, int type)
 {
@@ -2247,6 +2248,8 @@ static int bta_jv_port_data_co_cback(UINT16 port_handle, UINT8 *buf, UINT16 len,
                 return bta_co_rfc_data_outgoing_size(p_pcb->user_data, (int*)buf);
             case DATA_CO_CALLBACK_TYPE_OUTGOING:
                 return bta_co_rfc_data_outgoing(p_pcb->user_data, buf, len);
+            case DATA_CO_CALLBACK_TYPE_OUTGOING_SEGS:
+                return bta_co_rfc_data_outgoing_segs(p_pcb->user_data, (tPORT_DATA_SEG*)buf, len);
             default:
                 APPL_TRACE_ERROR1("unknown callout type:%d", type);
                 break;
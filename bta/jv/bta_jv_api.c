@@ -318,9 +318,9 @@ INT32 BTA_JvGetPreknownDevice(UINT8 * p_bd_addr, UINT32 index)
         {
             /* p_bd_addr is NULL: count the number of preknown devices */
             /* set the index to an invalid size (too big) */
-            index = BTM_INQ_DB_SIZE;
+            index = BTM_INQ_DB_MAX_SIZE;
         }
-        else if(index >= BTM_INQ_DB_SIZE)
+        else if(index >= BTM_INQ_DB_MAX_SIZE)
         {
             /* invalid index - error */
             status = (tBTA_JV_STATUS)BTA_JV_INTERNAL_ERR;
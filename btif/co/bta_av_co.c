@@ -1074,6 +1074,21 @@ void bta_av_co_audio_drop(tBTA_AV_HNDL hndl)
     APPL_TRACE_ERROR1("bta_av_co_audio_drop dropped: x%x", hndl);
 }
 
+/*******************************************************************************
+ **
+ ** Function         bta_av_co_audio_tx_status
+ **
+ ** Description      A media packet was given to L2CAP or held back.
+ **                  The media task adapts the SBC bitpool to the link.
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+void bta_av_co_audio_tx_status(tBTA_AV_HNDL hndl, UINT8 l2c_bufs, BOOLEAN congested)
+{
+    btif_media_aa_tx_status(l2c_bufs, congested);
+}
+
 /*******************************************************************************
  **
  ** Function         bta_av_co_audio_delay
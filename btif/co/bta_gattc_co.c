@@ -17,13 +17,161 @@
  ******************************************************************************/
 
 
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
 #include "gki.h"
 #include "bta_gattc_co.h"
 #include "bta_gattc_ci.h"
+#include "crc_api.h"
+#include "btm_int.h"
 
 #if( defined BLE_INCLUDED ) && (BLE_INCLUDED == TRUE)
 #if( defined BTA_GATT_INCLUDED ) && (BTA_GATT_INCLUDED == TRUE)
 
+/*****************************************************************************
+**  Constants & Macros
+*****************************************************************************/
+
+#define GATTC_CACHE_PATH        "/data/misc/bluedroid/gatt_cache_"
+#define GATTC_CACHE_EXT_NEW     ".new"
+#define GATTC_CACHE_MAGIC       0x43544147  /* "GATC" */
+#define GATTC_CACHE_VERSION     1
+#define GATTC_CACHE_CRC_INIT    0xffff
+#define GATTC_CACHE_MAX_OPEN    4           /* servers loading or saving at once */
+
+/*****************************************************************************
+**  Type definitions
+*****************************************************************************/
+
+/* A cache file is this header followed by num_attr tBTA_GATTC_NV_ATTR records
+** in the order GATTC saved them. The records are mapped on load and handed out
+** by index, and the CRC over them is the content hash of the peer database:
+** a file whose hash does not verify is dropped and the server rediscovered.
+*/
+typedef struct
+{
+    UINT32  magic;
+    UINT16  version;
+    UINT16  attr_size;      /* sizeof(tBTA_GATTC_NV_ATTR) of the writer */
+    UINT16  num_attr;
+    UINT16  hash;           /* CRC-16 over the attribute records */
+} tGATTC_CACHE_HDR;
+
+typedef struct
+{
+    BOOLEAN             in_use;
+    BOOLEAN             to_save;
+    BOOLEAN             failed;     /* a save failed, do not commit the file */
+    BD_ADDR             bda;
+    int                 fd;
+    UINT8               *p_map;     /* mapped cache file when loading */
+    size_t              map_len;
+    tGATTC_CACHE_HDR    hdr;
+} tGATTC_CACHE_FILE;
+
+/*****************************************************************************
+**  Static variables
+*****************************************************************************/
+
+static tGATTC_CACHE_FILE gattc_cache_file[GATTC_CACHE_MAX_OPEN];
+
+/*****************************************************************************
+**  Static functions
+*****************************************************************************/
+
+static void gattc_cache_path(BD_ADDR bda, char *p_path, int len, BOOLEAN is_new)
+{
+    snprintf(p_path, len, "%s%02x%02x%02x%02x%02x%02x%s", GATTC_CACHE_PATH,
+             bda[0], bda[1], bda[2], bda[3], bda[4], bda[5],
+             is_new ? GATTC_CACHE_EXT_NEW : "");
+}
+
+static tGATTC_CACHE_FILE *gattc_cache_find(BD_ADDR bda)
+{
+    int i;
+
+    for (i = 0; i < GATTC_CACHE_MAX_OPEN; i ++)
+    {
+        if (gattc_cache_file[i].in_use && memcmp(gattc_cache_file[i].bda, bda, BD_ADDR_LEN) == 0)
+            return &gattc_cache_file[i];
+    }
+    return NULL;
+}
+
+/* closes an open cache file; a saved file replaces the old one only on commit */
+static void gattc_cache_release(tGATTC_CACHE_FILE *p_file, BOOLEAN commit)
+{
+    char path[64], path_new[64];
+
+    if (p_file->to_save)
+    {
+        gattc_cache_path(p_file->bda, path, sizeof(path), FALSE);
+        gattc_cache_path(p_file->bda, path_new, sizeof(path_new), TRUE);
+
+        if (commit && !p_file->failed && p_file->hdr.num_attr > 0 &&
+            pwrite(p_file->fd, &p_file->hdr, sizeof(p_file->hdr), 0) == sizeof(p_file->hdr) &&
+            fsync(p_file->fd) == 0)
+        {
+            close(p_file->fd);
+            if (rename(path_new, path) != 0)
+                unlink(path_new);
+        }
+        else
+        {
+            close(p_file->fd);
+            unlink(path_new);
+        }
+    }
+    else
+    {
+        munmap(p_file->p_map, p_file->map_len);
+        close(p_file->fd);
+    }
+    memset(p_file, 0, sizeof(tGATTC_CACHE_FILE));
+}
+
+/* maps the cache file and verifies its header and content hash */
+static BOOLEAN gattc_cache_map(tGATTC_CACHE_FILE *p_file, const char *p_path)
+{
+    struct stat st;
+
+    if ((p_file->fd = open(p_path, O_RDONLY)) < 0)
+        return FALSE;
+
+    if (fstat(p_file->fd, &st) == 0 && st.st_size > (off_t)sizeof(tGATTC_CACHE_HDR))
+    {
+        p_file->p_map = (UINT8 *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, p_file->fd, 0);
+
+        if (p_file->p_map != MAP_FAILED)
+        {
+            p_file->map_len = st.st_size;
+            memcpy(&p_file->hdr, p_file->p_map, sizeof(tGATTC_CACHE_HDR));
+
+            if (p_file->hdr.magic == GATTC_CACHE_MAGIC &&
+                p_file->hdr.version == GATTC_CACHE_VERSION &&
+                p_file->hdr.attr_size == sizeof(tBTA_GATTC_NV_ATTR) &&
+                p_file->hdr.num_attr > 0 &&
+                st.st_size == (off_t)(sizeof(tGATTC_CACHE_HDR) +
+                                      p_file->hdr.num_attr * sizeof(tBTA_GATTC_NV_ATTR)) &&
+                p_file->hdr.hash == CRC_Update16(GATTC_CACHE_CRC_INIT,
+                                                 p_file->p_map + sizeof(tGATTC_CACHE_HDR),
+                                                 p_file->hdr.num_attr * sizeof(tBTA_GATTC_NV_ATTR)))
+                return TRUE;
+
+            munmap(p_file->p_map, st.st_size);
+        }
+    }
+    APPL_TRACE_ERROR1("invalid GATT cache %s", p_path);
+    close(p_file->fd);
+    unlink(p_path);
+    return FALSE;
+}
 
 /*****************************************************************************
 **  Function Declarations
@@ -46,7 +194,68 @@
 *******************************************************************************/
 void bta_gattc_co_cache_open(BD_ADDR server_bda, UINT16 evt, UINT16 conn_id, BOOLEAN to_save)
 {
-    tBTA_GATT_STATUS    status = BTA_GATT_OK;
+    tBTA_GATT_STATUS    status = BTA_GATT_ERROR;
+    tGATTC_CACHE_FILE   *p_file;
+    char                path[64];
+    int                 i;
+
+    /* a previous load or save of this server never completed */
+    if ((p_file = gattc_cache_find(server_bda)) != NULL)
+        gattc_cache_release(p_file, FALSE);
+
+    /* a server that is not bonded does not tell us when its database changes,
+    ** so its cache is neither kept nor trusted */
+    if (!btm_sec_is_a_bonded_dev(server_bda))
+    {
+        bta_gattc_ci_cache_open(server_bda, evt, status, conn_id);
+        return;
+    }
+
+    for (i = 0, p_file = NULL; i < GATTC_CACHE_MAX_OPEN && p_file == NULL; i ++)
+    {
+        if (!gattc_cache_file[i].in_use)
+            p_file = &gattc_cache_file[i];
+    }
+
+    if (p_file != NULL)
+    {
+        memcpy(p_file->bda, server_bda, BD_ADDR_LEN);
+        p_file->to_save = to_save;
+
+        if (to_save)
+        {
+            gattc_cache_path(server_bda, path, sizeof(path), TRUE);
+
+            p_file->hdr.magic     = GATTC_CACHE_MAGIC;
+            p_file->hdr.version   = GATTC_CACHE_VERSION;
+            p_file->hdr.attr_size = sizeof(tBTA_GATTC_NV_ATTR);
+            p_file->hdr.hash      = GATTC_CACHE_CRC_INIT;
+
+            /* records are appended behind a header which is filled in on close */
+            if ((p_file->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0660)) >= 0)
+            {
+                if (write(p_file->fd, &p_file->hdr, sizeof(p_file->hdr)) == sizeof(p_file->hdr))
+                    status = BTA_GATT_OK;
+                else
+                {
+                    close(p_file->fd);
+                    unlink(path);
+                }
+            }
+        }
+        else
+        {
+            gattc_cache_path(server_bda, path, sizeof(path), FALSE);
+
+            if (gattc_cache_map(p_file, path))
+                status = BTA_GATT_OK;
+        }
+
+        if (status == BTA_GATT_OK)
+            p_file->in_use = TRUE;
+        else
+            memset(p_file, 0, sizeof(tGATTC_CACHE_FILE));
+    }
 
     /* open NV cache and send call in */
     bta_gattc_ci_cache_open(server_bda, evt, status, conn_id);
@@ -70,10 +279,26 @@ void bta_gattc_co_cache_open(BD_ADDR server_bda, UINT16 evt, UINT16 conn_id, BOO
 void bta_gattc_co_cache_load(BD_ADDR server_bda, UINT16 evt, UINT16 start_index, UINT16 conn_id)
 {
     UINT16              num_attr = 0;
-    tBTA_GATTC_NV_ATTR  attr[BTA_GATTC_NV_LOAD_MAX];
-    tBTA_GATT_STATUS    status = BTA_GATT_MORE;
+    tBTA_GATTC_NV_ATTR  *p_attr = NULL;
+    tBTA_GATT_STATUS    status = BTA_GATT_ERROR;
+    tGATTC_CACHE_FILE   *p_file = gattc_cache_find(server_bda);
+
+    if (p_file != NULL && !p_file->to_save && start_index < p_file->hdr.num_attr)
+    {
+        /* hand out the next records straight from the mapping */
+        p_attr = (tBTA_GATTC_NV_ATTR *)(p_file->p_map + sizeof(tGATTC_CACHE_HDR)) + start_index;
+        num_attr = p_file->hdr.num_attr - start_index;
 
-    bta_gattc_ci_cache_load(server_bda, evt, num_attr, attr, status, conn_id);
+        if (num_attr > BTA_GATTC_NV_LOAD_MAX)
+        {
+            num_attr = BTA_GATTC_NV_LOAD_MAX;
+            status = BTA_GATT_MORE;
+        }
+        else
+            status = BTA_GATT_OK;
+    }
+
+    bta_gattc_ci_cache_load(server_bda, evt, num_attr, p_attr, status, conn_id);
 }
 /*******************************************************************************
 **
@@ -94,7 +319,22 @@ void bta_gattc_co_cache_load(BD_ADDR server_bda, UINT16 evt, UINT16 start_index,
 void bta_gattc_co_cache_save (BD_ADDR server_bda, UINT16 evt, UINT16 num_attr,
                               tBTA_GATTC_NV_ATTR *p_attr_list, UINT16 attr_index, UINT16 conn_id)
 {
-    tBTA_GATT_STATUS    status = BTA_GATT_OK;
+    tBTA_GATT_STATUS    status = BTA_GATT_ERROR;
+    tGATTC_CACHE_FILE   *p_file = gattc_cache_find(server_bda);
+    ssize_t             len = num_attr * sizeof(tBTA_GATTC_NV_ATTR);
+
+    if (p_file != NULL && p_file->to_save && !p_file->failed)
+    {
+        if (attr_index == p_file->hdr.num_attr &&
+            write(p_file->fd, p_attr_list, len) == len)
+        {
+            p_file->hdr.hash = CRC_Update16(p_file->hdr.hash, (UINT8 *)p_attr_list, len);
+            p_file->hdr.num_attr += num_attr;
+            status = BTA_GATT_OK;
+        }
+        else
+            p_file->failed = TRUE;
+    }
 
     bta_gattc_ci_cache_save(server_bda, evt, status, conn_id);
 }
@@ -114,8 +354,11 @@ void bta_gattc_co_cache_save (BD_ADDR server_bda, UINT16 evt, UINT16 num_attr,
 *******************************************************************************/
 void bta_gattc_co_cache_close(BD_ADDR server_bda, UINT16 conn_id)
 {
-    /* close NV when server cache is done saving or loading,
-       does not need to do anything for now on Insight */
+    tGATTC_CACHE_FILE   *p_file = gattc_cache_find(server_bda);
+
+    /* close NV when server cache is done saving or loading */
+    if (p_file != NULL)
+        gattc_cache_release(p_file, TRUE);
 }
 
 /*******************************************************************************
@@ -132,6 +375,35 @@ void bta_gattc_co_cache_close(BD_ADDR server_bda, UINT16 conn_id)
 *******************************************************************************/
 void bta_gattc_co_cache_reset(BD_ADDR server_bda)
 {
+    tGATTC_CACHE_FILE   *p_file = gattc_cache_find(server_bda);
+    char                path[64];
+
+    if (p_file != NULL)
+        gattc_cache_release(p_file, FALSE);
+
+    gattc_cache_path(server_bda, path, sizeof(path), FALSE);
+    unlink(path);
+}
+
+/*******************************************************************************
+**
+** Function         bta_gattc_co_cache_remove
+**
+** Description      Deletes the cache file of a GATT server, called by btif
+**                  storage when the bond with the server is removed. Only the
+**                  file is touched, an open cache is left to its owner.
+**
+** Parameter        server_bda: server bd address of this cache belongs to
+**
+** Returns          void.
+**
+*******************************************************************************/
+void bta_gattc_co_cache_remove(BD_ADDR server_bda)
+{
+    char                path[64];
+
+    gattc_cache_path(server_bda, path, sizeof(path), FALSE);
+    unlink(path);
 }
 
 #endif
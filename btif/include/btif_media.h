@@ -198,6 +198,18 @@ extern BOOLEAN btif_media_task_aa_tx_flush_req(void);
  *******************************************************************************/
 extern BT_HDR *btif_media_aa_readbuf(void);
 
+/*******************************************************************************
+ **
+ ** Function         btif_media_aa_tx_status
+ **
+ ** Description      Reports the number of media packets queued in L2CAP and
+ **                  whether the stream is congested, to adapt the bitpool
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+extern void btif_media_aa_tx_status(UINT8 l2c_bufs, BOOLEAN congested);
+
 /*******************************************************************************
  **
  ** Function         btif_media_sink_enque_buf
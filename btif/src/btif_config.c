@@ -21,8 +21,9 @@
  *  Filename:      btif_config.c
  *
  *  Description:   Stores the local BT adapter and remote device properties in
- *                 NVRAM storage, typically as xml file in the
- *                 mobile's filesystem
+ *                 NVRAM storage, as a binary snapshot plus a journal of the
+ *                 changes made since, in the mobile's filesystem. The older
+ *                 xml file is only read to migrate it.
  *
  *
  ***********************************************************************************/
@@ -38,6 +39,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <stdlib.h>
 #include <private/android_filesystem_config.h>
 
@@ -49,6 +51,7 @@
 #include "btif_config_util.h"
 #include "btif_sock_thread.h"
 #include "btif_sock_util.h"
+#include "crc_api.h"
 
 //#define UNIT_TEST
 #define CFG_PATH "/data/misc/bluedroid/"
@@ -56,6 +59,14 @@
 #define CFG_FILE_EXT ".xml"
 #define CFG_FILE_EXT_OLD ".old"
 #define CFG_FILE_EXT_NEW ".new"
+#define CFG_FILE_EXT_BIN ".bin"
+#define CFG_FILE_EXT_JOURNAL ".journal"
+#define CFG_SNAPSHOT_MAGIC 0x53435442 /* "BTCS" */
+#define CFG_SNAPSHOT_VERSION 1
+#define CFG_JOURNAL_MAX_BYTES (64*1024) /* compacted into the snapshot beyond */
+#define CFG_REC_CRC_INIT 0xffff
+#define CFG_OP_SET 1
+#define CFG_OP_REMOVE 2
 #define CFG_GROW_SIZE (10*sizeof(cfg_node))
 #define GET_CHILD_MAX_COUNT(node) (short)((int)(node)->bytes / sizeof(cfg_node))
 #define GET_CHILD_COUNT(p) (short)((int)(p)->used / sizeof(cfg_node))
@@ -84,11 +95,36 @@ typedef struct cfg_node_s
     short flag;
 } cfg_node;
 
+/* one change in the journal, or one value in the snapshot, followed by the
+   section, key and name strings with their terminating 0 and the value */
+typedef struct
+{
+    uint16_t crc;         /* CRC-16 of the rest of the record */
+    uint8_t op;
+    uint8_t reserved;
+    uint16_t section_len;
+    uint16_t key_len;
+    uint16_t name_len;    /* 0 removes the whole key */
+    uint16_t type;
+    uint16_t bytes;
+} cfg_rec_hdr;
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t crc;         /* CRC-16 of all records */
+    uint32_t count;
+    uint32_t bytes;       /* of all records */
+} cfg_snapshot_hdr;
+
 static pthread_mutex_t slot_lock;
 static int pth = -1; //poll thread handle
 static cfg_node root;
 static int cached_change;
 static int processing_save_cmd;
+static int journal_fd = -1;
+static int journal_compact; //a change was not journaled
 static void cfg_cmd_callback(int cmd_fd, int type, int flags, uint32_t user_id);
 static inline short alloc_node(cfg_node* p, short grow);
 static inline void free_node(cfg_node* p);
@@ -101,7 +137,10 @@ static inline cfg_node* find_free_node(cfg_node* p);
 static int set_node(const char* section, const char* key, const char* name,
                         const char* value, short bytes, short type);
 static int save_cfg();
+static int sync_cfg();
 static void load_cfg();
+static void journal_add(int op, const char* section, const char* key, const char* name,
+                        const char* value, int bytes, int type);
 static short find_next_node(const cfg_node* p, short start, char* name, int* bytes);
 static int create_dir(const char* path);
 #ifdef UNIT_TEST
@@ -228,7 +267,13 @@ int btif_config_set(const char* section, const char* key, const char* name, cons
         lock_slot(&slot_lock);
         ret = set_node(section, key, name, value, (short)bytes, (short)type);
         if(ret && !(type & BTIF_CFG_TYPE_VOLATILE))
+        {
+            journal_add(CFG_OP_SET, section, key, name, value, bytes, type);
             cached_change++;
+        }
+        //volatile values are not saved, drop any saved one
+        else if(ret)
+            journal_add(CFG_OP_REMOVE, section, key, name, NULL, 0, 0);
         unlock_slot(&slot_lock);
     }
     return ret;
@@ -243,7 +288,10 @@ int btif_config_remove(const char* section, const char* key, const char* name)
          lock_slot(&slot_lock);
          ret = remove_node(section, key, name);
          if(ret)
+         {
+            journal_add(CFG_OP_REMOVE, section, key, name, NULL, 0, 0);
             cached_change++;
+         }
          unlock_slot(&slot_lock);
     }
     return ret;
@@ -260,7 +308,11 @@ int btif_config_filter_remove(const char* section, const char* filter[], int fil
          lock_slot(&slot_lock);
          ret = remove_filter_node(section, filter, filter_count, max_allowed);
          if(ret)
+         {
+            //rare bulk removal, let the next save rewrite the snapshot
+            journal_compact = 1;
             cached_change++;
+         }
          unlock_slot(&slot_lock);
     }
     return ret;
@@ -349,7 +401,7 @@ void btif_config_flush()
 {
     lock_slot(&slot_lock);
     if(cached_change > 0)
-        save_cfg();
+        sync_cfg();
     unlock_slot(&slot_lock);
 }
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -677,29 +729,271 @@ static int remove_filter_node(const char* section, const char* filter[], int fil
     return FALSE;
 }
 
-static int save_cfg()
+static inline void rec_crc(cfg_rec_hdr* hdr, const char* section, const char* key,
+                           const char* name, const char* value)
 {
-    const char* file_name = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT;
-    const char* file_name_new = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_NEW;
-    const char* file_name_old = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_OLD;
+    uint16_t crc = CFG_REC_CRC_INIT;
+    crc = CRC_Update16(crc, (const UINT8*)hdr + sizeof(hdr->crc), sizeof(*hdr) - sizeof(hdr->crc));
+    crc = CRC_Update16(crc, (const UINT8*)section, hdr->section_len);
+    crc = CRC_Update16(crc, (const UINT8*)key, hdr->key_len);
+    crc = CRC_Update16(crc, (const UINT8*)name, hdr->name_len);
+    crc = CRC_Update16(crc, (const UINT8*)value, hdr->bytes);
+    hdr->crc = crc;
+}
+static inline int rec_init(cfg_rec_hdr* hdr, int op, const char* section, const char* key,
+                           const char* name, const char* value, int bytes, int type)
+{
+    hdr->op = op;
+    hdr->reserved = 0;
+    hdr->section_len = strlen(section) + 1;
+    hdr->key_len = strlen(key) + 1;
+    hdr->name_len = name ? strlen(name) + 1 : 0;
+    hdr->type = type;
+    hdr->bytes = op == CFG_OP_SET ? bytes : 0;
+    rec_crc(hdr, section, key, name, value);
+    return sizeof(*hdr) + hdr->section_len + hdr->key_len + hdr->name_len + hdr->bytes;
+}
+//applies the records in buf, returns the length of the valid ones
+static int rec_apply(const char* buf, int len, uint32_t* count)
+{
+    int pos = 0;
+    while(len - pos >= (int)sizeof(cfg_rec_hdr))
+    {
+        cfg_rec_hdr hdr;
+        memcpy(&hdr, buf + pos, sizeof(hdr));
+        int rec_len = sizeof(hdr) + hdr.section_len + hdr.key_len + hdr.name_len + hdr.bytes;
+        if(rec_len > len - pos)
+            break;
+        const char* section = buf + pos + sizeof(hdr);
+        const char* key = section + hdr.section_len;
+        const char* name = hdr.name_len ? key + hdr.key_len : NULL;
+        const char* value = key + hdr.key_len + hdr.name_len;
+        uint16_t crc = hdr.crc;
+        rec_crc(&hdr, section, key, name, value);
+        if(crc != hdr.crc || hdr.section_len < 2 || section[hdr.section_len - 1] ||
+           hdr.key_len < 2 || key[hdr.key_len - 1] ||
+           (name && (hdr.name_len < 2 || name[hdr.name_len - 1])))
+            break;
+        if(hdr.op == CFG_OP_SET && name && hdr.bytes < MAX_NODE_BYTES)
+            set_node(section, key, name, value, hdr.bytes, hdr.type);
+        else if(hdr.op == CFG_OP_REMOVE)
+            remove_node(section, key, name);
+        else break;
+        pos += rec_len;
+        if(count)
+            (*count)++;
+    }
+    return pos;
+}
+static void journal_add(int op, const char* section, const char* key, const char* name,
+                        const char* value, int bytes, int type)
+{
+    cfg_rec_hdr hdr;
+    struct iovec iov[5];
+    int len;
+    if(journal_fd < 0)
+    {
+        journal_compact = 1;
+        return;
+    }
+    len = rec_init(&hdr, op, section, key, name, value, bytes, type);
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = (void*)section;
+    iov[1].iov_len = hdr.section_len;
+    iov[2].iov_base = (void*)key;
+    iov[2].iov_len = hdr.key_len;
+    iov[3].iov_base = (void*)name;
+    iov[3].iov_len = hdr.name_len;
+    iov[4].iov_base = (void*)value;
+    iov[4].iov_len = hdr.bytes;
+    if(writev(journal_fd, iov, 5) != len)
+    {
+        //a torn record ends the journal on the next load, rewrite the snapshot instead
+        bdle("journal write failed:%s", strerror(errno));
+        journal_compact = 1;
+    }
+}
+static int replay_journal(const char* file_name)
+{
+    struct stat st;
+    uint32_t count = 0;
+    int fd = open(file_name, O_RDWR);
+    if(fd < 0)
+        return FALSE;
+    if(fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        char* buf = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(buf != MAP_FAILED)
+        {
+            int len = rec_apply(buf, st.st_size, &count);
+            munmap(buf, st.st_size);
+            if(len < st.st_size)
+            {
+                bdle("journal ends with a bad record at %d of %d bytes", len, (int)st.st_size);
+                ftruncate(fd, len);
+            }
+        }
+    }
+    close(fd);
+    bdld("replayed %d changes", count);
+    return TRUE;
+}
+static int load_snapshot(const char* file_name)
+{
+    struct stat st;
     int ret = FALSE;
-    if(access(file_name_old,  F_OK) == 0)
-        unlink(file_name_old);
-    if(access(file_name_new, F_OK) == 0)
+    int fd = open(file_name, O_RDONLY);
+    if(fd < 0)
+        return FALSE;
+    if(fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(cfg_snapshot_hdr))
+    {
+        const char* buf = (const char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(buf != MAP_FAILED)
+        {
+            cfg_snapshot_hdr hdr;
+            memcpy(&hdr, buf, sizeof(hdr));
+            const char* recs = buf + sizeof(hdr);
+            uint32_t count = 0;
+            if(hdr.magic == CFG_SNAPSHOT_MAGIC && hdr.version == CFG_SNAPSHOT_VERSION &&
+               hdr.bytes == st.st_size - sizeof(hdr) &&
+               hdr.crc == CRC_Update16(CFG_REC_CRC_INIT, (const UINT8*)recs, hdr.bytes))
+                ret = rec_apply(recs, hdr.bytes, &count) == (int)hdr.bytes && count == hdr.count;
+            else bdle("invalid config snapshot:%s", file_name);
+            munmap((void*)buf, st.st_size);
+        }
+    }
+    close(fd);
+    return ret;
+}
+typedef struct {
+    FILE* file;
+    cfg_snapshot_hdr hdr;
+    int error;
+} snapshot_writer;
+static void snapshot_add(void* user_data, const char* section, const char* key, const char* name,
+                         const char* value, int bytes, int type)
+{
+    snapshot_writer* w = (snapshot_writer*)user_data;
+    cfg_rec_hdr hdr;
+    if(type & BTIF_CFG_TYPE_VOLATILE)
+        return; //skip any volatile value
+    int len = rec_init(&hdr, CFG_OP_SET, section, key, name, value, bytes, type);
+    if(fwrite(&hdr, sizeof(hdr), 1, w->file) != 1 ||
+       fwrite(section, hdr.section_len, 1, w->file) != 1 ||
+       fwrite(key, hdr.key_len, 1, w->file) != 1 ||
+       fwrite(name, hdr.name_len, 1, w->file) != 1 ||
+       (hdr.bytes && fwrite(value, hdr.bytes, 1, w->file) != 1))
+        w->error = 1;
+    uint16_t crc = w->hdr.crc;
+    crc = CRC_Update16(crc, (const UINT8*)&hdr, sizeof(hdr));
+    crc = CRC_Update16(crc, (const UINT8*)section, hdr.section_len);
+    crc = CRC_Update16(crc, (const UINT8*)key, hdr.key_len);
+    crc = CRC_Update16(crc, (const UINT8*)name, hdr.name_len);
+    w->hdr.crc = CRC_Update16(crc, (const UINT8*)value, hdr.bytes);
+    w->hdr.count++;
+    w->hdr.bytes += len;
+}
+//makes the renames and links done in the config directory durable
+static int sync_cfg_dir()
+{
+    int ret;
+    int fd = open(CFG_PATH, O_RDONLY | O_DIRECTORY);
+    if(fd < 0)
+        return FALSE;
+    ret = fsync(fd) == 0;
+    close(fd);
+    return ret;
+}
+static int save_snapshot(const char* file_name, const char* file_name_new, const char* file_name_old)
+{
+    snapshot_writer w;
+    memset(&w, 0, sizeof(w));
+    w.file = fopen(file_name_new, "w");
+    if(!w.file)
+    {
+        bdle("cannot create %s:%s", file_name_new, strerror(errno));
+        return FALSE;
+    }
+    w.hdr.crc = CFG_REC_CRC_INIT;
+    //header last, once the records are known
+    if(fwrite(&w.hdr, sizeof(w.hdr), 1, w.file) != 1)
+        w.error = 1;
+    btif_config_enum(snapshot_add, &w);
+    w.hdr.magic = CFG_SNAPSHOT_MAGIC;
+    w.hdr.version = CFG_SNAPSHOT_VERSION;
+    if(fseek(w.file, 0, SEEK_SET) != 0 || fwrite(&w.hdr, sizeof(w.hdr), 1, w.file) != 1 ||
+       fflush(w.file) != 0 || fdatasync(fileno(w.file)) != 0)
+        w.error = 1;
+    fclose(w.file);
+    if(w.error)
+    {
+        bdle("writing %s failed", file_name_new);
+        unlink(file_name_new);
+        return FALSE;
+    }
+    chown(file_name_new, -1, AID_NET_BT_STACK);
+    chmod(file_name_new, 0660);
+    //keep the current snapshot as the backup, the link leaves it in place until the rename
+    unlink(file_name_old);
+    if(link(file_name, file_name_old) != 0 && errno != ENOENT)
+        bdle("cannot back up %s:%s", file_name, strerror(errno));
+    if(rename(file_name_new, file_name) != 0)
+    {
+        bdle("cannot rename %s:%s", file_name_new, strerror(errno));
         unlink(file_name_new);
-   if(btif_config_save_file(file_name_new))
+        return FALSE;
+    }
+    //the rename must be on disk before the caller drops the journal
+    if(!sync_cfg_dir())
+    {
+        bdle("cannot sync %s:%s", CFG_PATH, strerror(errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+//rewrites the snapshot and empties the journal
+static int save_cfg()
+{
+    const char* file_name = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_BIN;
+    const char* file_name_new = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_BIN CFG_FILE_EXT_NEW;
+    const char* file_name_old = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_BIN CFG_FILE_EXT_OLD;
+    int ret = FALSE;
+    if(save_snapshot(file_name, file_name_new, file_name_old))
     {
+        //the snapshot has every journaled change now
+        if(journal_fd >= 0)
+            ftruncate(journal_fd, 0);
         cached_change = 0;
-        processing_save_cmd = 0;
-        chown(file_name_new, -1, AID_NET_BT_STACK);
-        chmod(file_name_new, 0660);
-        rename(file_name, file_name_old);
-        rename(file_name_new, file_name);
+        journal_compact = 0;
         ret = TRUE;
     }
-    else bdle("btif_config_save_file failed");
+    else bdle("save_snapshot failed");
     return ret;
 }
+//makes the journaled changes durable, compacting it once it grew large
+static int sync_cfg()
+{
+    struct stat st;
+    if(journal_compact || journal_fd < 0 ||
+       (fstat(journal_fd, &st) == 0 && st.st_size > CFG_JOURNAL_MAX_BYTES))
+        return save_cfg();
+    if(fdatasync(journal_fd) != 0)
+    {
+        bdle("journal sync failed:%s", strerror(errno));
+        return save_cfg();
+    }
+    cached_change = 0;
+    return TRUE;
+}
+static void open_journal()
+{
+    const char* file_name = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_JOURNAL;
+    journal_fd = open(file_name, O_WRONLY | O_CREAT | O_APPEND, 0660);
+    if(journal_fd < 0)
+        bdle("cannot open %s:%s, every save rewrites the snapshot", file_name, strerror(errno));
+    else chown(file_name, -1, AID_NET_BT_STACK);
+}
 
 static int load_bluez_cfg()
 {
@@ -759,14 +1053,45 @@ static void load_cfg()
     const char* file_name = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT;
     const char* file_name_new = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_NEW;
     const char* file_name_old = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_OLD;
-    if(!btif_config_load_file(file_name))
+    const char* file_name_bin = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_BIN;
+    const char* file_name_bin_old = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_BIN CFG_FILE_EXT_OLD;
+    const char* file_name_journal = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_JOURNAL;
+    if(load_snapshot(file_name_bin))
+    {
+        replay_journal(file_name_journal);
+        open_journal();
+        cached_change = 0;
+    }
+    else if(load_snapshot(file_name_bin_old))
     {
-        unlink(file_name);
-        if(!btif_config_load_file(file_name_old))
+        //the xml files are gone after the migration, the backup is the last good copy
+        bdle("cannot load %s, restored %s", file_name_bin, file_name_bin_old);
+        //put the backup back in place so the next save keeps it as the backup again
+        rename(file_name_bin_old, file_name_bin);
+        replay_journal(file_name_journal);
+        open_journal();
+        save_cfg();
+    }
+    else
+    {
+        //migrate the xml file, or the bluez one, into the snapshot
+        if(!btif_config_load_file(file_name))
+        {
+            unlink(file_name);
+            if(!btif_config_load_file(file_name_old))
+            {
+                unlink(file_name_old);
+                if(load_bluez_cfg() && save_cfg())
+                    remove_bluez_cfg();
+            }
+        }
+        replay_journal(file_name_journal);
+        open_journal();
+        if(save_cfg())
         {
+            unlink(file_name);
             unlink(file_name_old);
-            if(load_bluez_cfg() && save_cfg())
-                remove_bluez_cfg();
+            unlink(file_name_new);
         }
     }
     int bluez_migration_done = 0;
@@ -800,11 +1125,13 @@ static void cfg_cmd_callback(int cmd_fd, int type, int size, uint32_t user_id)
                 last_cached_change = cached_change;
             }
 #endif
-            bdld("writing the bt_config.xml now, cached change:%d", cached_change);
-            sleep(3); //Delay config update by 3sec
+            //batch the changes made in the mean time into one sync
+            usleep(BTIF_CONFIG_SYNC_DELAY_MS * 1000);
             lock_slot(&slot_lock);
+            bdld("syncing the config journal now, cached change:%d", cached_change);
             if(cached_change > 0)
-                save_cfg();
+                sync_cfg();
+            processing_save_cmd = 0;
             unlock_slot(&slot_lock);
             break;
         }
@@ -960,7 +960,7 @@ static bt_status_t btif_in_get_adapter_properties(void)
     bt_bdname_t name;
     bt_scan_mode_t mode;
     uint32_t disc_timeout;
-    bt_bdaddr_t bonded_devices[BTM_SEC_MAX_DEVICE_RECORDS];
+    bt_bdaddr_t bonded_devices[BTM_SEC_MAX_DEVICE_RECORDS_TOTAL];
     bt_uuid_t local_uuids[BT_MAX_NUM_UUIDS];
     num_props = 0;
 
@@ -42,6 +42,7 @@
 #include <pthread.h>
 #include <stdint.h>
 #include <sys/time.h>
+#include <sys/timerfd.h>
 #include <errno.h>
 
 #include "bt_target.h"
@@ -123,6 +124,9 @@ oi_sbc_decoder_vendor_interface_t *oi_sbc_decode_vnd_if = NULL;
 #define BTIF_MEDIA_AV_TASK_TIMER TIMER_1_EVT_MASK
 #define BTIF_MEDIA_AVK_TASK_TIMER TIMER_2_EVT_MASK
 
+/* sent by the media clock thread, see BTIF_MEDIA_AA_HR_CLOCK */
+#define BTIF_MEDIA_AA_CLOCK_EVT EVENT_MASK(APPL_EVT_0)
+
 
 #define BTIF_MEDIA_TASK_CMD_MBOX        TASK_MBOX_0     /* cmd mailbox  */
 #define BTIF_MEDIA_TASK_DATA_MBOX       TASK_MBOX_1     /* data mailbox  */
@@ -165,11 +169,65 @@ enum {
 #define BTIF_MEDIA_TIME_TICK                     (20 * BTIF_MEDIA_NUM_TICK)
 #define BTIF_SINK_MEDIA_TIME_TICK                (20 * BTIF_MEDIA_NUM_TICK)
 
+/* A2DP source: run the media task from a CLOCK_MONOTONIC timerfd rather than from
+   a GKI timer, which only ticks every 10 ms and jitters with the GKI timer thread.
+   If the timerfd cannot be set up the GKI timer is used. */
+#ifndef BTIF_MEDIA_AA_HR_CLOCK
+#define BTIF_MEDIA_AA_HR_CLOCK TRUE
+#endif
+
+/* A2DP source tick in milliseconds. Shorter ticks send smaller packets more often
+   for less latency. With the GKI timer it is rounded to (1000/TICKS_PER_SEC). */
+#ifndef BTIF_MEDIA_TX_TICK_MS
+#define BTIF_MEDIA_TX_TICK_MS                    BTIF_MEDIA_TIME_TICK
+#endif
+#define BTIF_MEDIA_TX_TICK_MIN_MS                5
+
+#if (BTIF_MEDIA_TX_TICK_MS < BTIF_MEDIA_TX_TICK_MIN_MS)
+#error "BTIF_MEDIA_TX_TICK_MS must be at least 5 ms"
+#endif
+
+/* at most this much PCM is owed after the media task was held up, older audio
+   is skipped rather than sent in a burst */
+#define BTIF_MEDIA_AA_MAX_LATE_MS                100
+
 
 /* buffer pool */
 #define BTIF_MEDIA_AA_POOL_ID GKI_POOL_ID_3
 #define BTIF_MEDIA_AA_BUF_SIZE GKI_BUF3_SIZE
 
+/* Number of buffers in the pool dedicated to the outgoing media packets. Once they
+   are all in flight the packets are taken from BTIF_MEDIA_AA_POOL_ID again.
+   0 takes all packets from BTIF_MEDIA_AA_POOL_ID. */
+#ifndef BTIF_MEDIA_AA_NUM_BUFS
+#define BTIF_MEDIA_AA_NUM_BUFS MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ
+#endif
+
+/* max number of SBC frames in a media packet (4 bit frame count of the payload header),
+   all of them encoded in one SBC_Encoder call */
+#define BTIF_MEDIA_AA_MAX_SBC_FRAMES 0x0F
+#define BTIF_MEDIA_AA_PCM_FRAME_SIZE (SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS \
+                                      * SBC_MAX_NUM_OF_SUBBANDS)
+
+/* Adaptive bitpool: the SBC bitpool is lowered when the link cannot keep up with the
+   stream and raised back once it has been idle for a while. It stays between the
+   negotiated min bitpool and the one picked by btif_media_task_enc_update. */
+#ifndef BTIF_MEDIA_BP_ADAPT_INCLUDED
+#define BTIF_MEDIA_BP_ADAPT_INCLUDED TRUE
+#endif
+
+/* a congested tick cuts the bitpool by 1/BTIF_MEDIA_BP_DEC_DIV */
+#define BTIF_MEDIA_BP_DEC_DIV           4
+/* ms to let the queues drain after a cut before cutting again */
+#define BTIF_MEDIA_BP_DEC_HOLD_MS       100
+/* the bitpool goes up by BTIF_MEDIA_BP_INC_STEP after BTIF_MEDIA_BP_INC_MS of idle link */
+#define BTIF_MEDIA_BP_INC_STEP          2
+#define BTIF_MEDIA_BP_INC_MS            1000
+/* TxAaQ depth above which the link is congested, and up to which it is idle
+   (L2CAP queue depth too) */
+#define BTIF_MEDIA_BP_TXQ_HIGH          (MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ / 4)
+#define BTIF_MEDIA_BP_IDLE_BUFS         1
+
 /* offset */
 #if (BTA_AV_CO_CP_SCMS_T == TRUE)
 #define BTIF_MEDIA_AA_SBC_OFFSET (AVDT_MEDIA_OFFSET + BTA_AV_SBC_HDR_SIZE + 1)
@@ -269,7 +327,9 @@ typedef struct
     INT32  aa_feed_counter;
     INT32  aa_feed_residue;
     UINT32 counter;
-    UINT32 bytes_per_tick;  /* pcm bytes read each media task tick */
+    UINT64 start_us;        /* CLOCK_MONOTONIC time the pcm is counted from */
+    UINT64 samples_due;     /* pcm samples per channel due since start_us */
+    UINT32 aa_feed_residue_offset;  /* where the residue sits in btif_media_aa_pcm */
 } tBTIF_AV_MEDIA_FEEDINGS_PCM_STATE;
 
 
@@ -303,6 +363,10 @@ typedef struct
     BOOLEAN is_source;
     UINT8   frames_to_process;
     BOOLEAN rx_audio_focus_gained;
+    UINT8   bp_min;         /* lowest bitpool the adaptive bitpool may use */
+    UINT8   bp_max;         /* bitpool of btif_media_task_enc_update, 0 if not set */
+    UINT16  bp_idle_ticks;  /* ticks the link has been idle */
+    UINT16  bp_hold_ticks;  /* ticks before the bitpool may be cut again */
 #endif
 
 } tBTIF_MEDIA_CB;
@@ -322,6 +386,28 @@ typedef struct {
 static tBTIF_MEDIA_CB btif_media_cb;
 static int media_task_running = MEDIA_TASK_STATE_OFF;
 
+#if (BTA_AV_INCLUDED == TRUE)
+/* PCM of the frames of the next media packet, read from UIPC in place and encoded
+   from there */
+static SINT16 __attribute__ ((aligned(32)))
+    btif_media_aa_pcm[BTIF_MEDIA_AA_MAX_SBC_FRAMES * BTIF_MEDIA_AA_PCM_FRAME_SIZE];
+
+/* pool of the outgoing media packets, kept across media task restarts since
+   packets of the previous stream may still be queued in the stack */
+static UINT8 btif_media_aa_pool_id = GKI_INVALID_POOL;
+
+/* link state reported by btif_media_aa_tx_status from BTU since the last media tick */
+static volatile UINT8 btif_media_aa_l2c_peak;
+static volatile BOOLEAN btif_media_aa_tx_cong;
+
+#if (BTIF_MEDIA_AA_HR_CLOCK == TRUE)
+/* media clock thread, running while the A2DP source streams */
+static pthread_t btif_media_aa_clock_tid;
+static int btif_media_aa_clock_fd = -1;
+static volatile BOOLEAN btif_media_aa_clock_running = FALSE;
+#endif
+#endif
+
 
 /*****************************************************************************
  **  Local functions
@@ -352,6 +438,12 @@ static void btif_media_task_handle_inc_media(tBT_SBC_HDR*p_msg);
 #endif
 
 #if (BTA_AV_INCLUDED == TRUE)
+static void btif_media_aa_pool_init(void);
+static UINT64 btif_media_time_us(void);
+static UINT32 btif_media_aa_pcm_bytes_due(void);
+static BOOLEAN btif_media_aa_clock_start(void);
+static void btif_media_aa_clock_stop(void);
+static void btif_media_aa_adapt_bitpool(void);
 static void btif_media_send_aa_frame(void);
 static void btif_media_task_feeding_state_reset(void);
 static void btif_media_task_aa_start_tx(void);
@@ -433,7 +525,7 @@ static void log_tstamps_us(char *comment)
     now_us = now.tv_sec*USEC_PER_SEC + now.tv_nsec/1000;
     diff_us = (now.tv_sec - prev.tv_sec) * USEC_PER_SEC + (now.tv_nsec - prev.tv_nsec)/1000;
 
-    if ((diff_us / USEC_PER_MSEC) > (BTIF_MEDIA_TIME_TICK + 10))
+    if ((diff_us / USEC_PER_MSEC) > (BTIF_MEDIA_TX_TICK_MS + 10))
     {
         APPL_TRACE_ERROR4("[%s] ts %08d, diff : %08d, queue sz %d", comment, now_us, diff_us,
                 btif_media_cb.TxAaQ.count);
@@ -485,6 +577,7 @@ static const char* dump_a2dp_ctrl_event(UINT8 event)
         CASE_RETURN_STR(A2DP_CTRL_CMD_START)
         CASE_RETURN_STR(A2DP_CTRL_CMD_STOP)
         CASE_RETURN_STR(A2DP_CTRL_CMD_SUSPEND)
+        CASE_RETURN_STR(A2DP_CTRL_CMD_OPEN_PCM_RING)
         default:
             return "UNKNOWN MSG ID";
     }
@@ -529,6 +622,7 @@ static void btif_recv_ctrl_data(void)
 {
     UINT8 cmd = 0;
     int n;
+    int fd;
     n = UIPC_Read(UIPC_CH_ID_AV_CTRL, NULL, &cmd, 1);
 
     /* detach on ctrl channel means audioflinger process was terminated */
@@ -636,6 +730,21 @@ static void btif_recv_ctrl_data(void)
             }
             break;
 
+        case A2DP_CTRL_CMD_OPEN_PCM_RING:
+            /* from now on UIPC_Read on the audio channel takes the pcm from
+               the ring, the data socket stays open to track the session */
+            if (UIPC_Ioctl(UIPC_CH_ID_AV_CTRL, UIPC_REQ_GET_RX_FD, &fd) &&
+                UIPC_Ioctl(UIPC_CH_ID_AV_AUDIO, UIPC_REQ_SET_PCM_RING, (void *)(long)fd))
+            {
+                a2dp_cmd_acknowledge(A2DP_CTRL_ACK_SUCCESS);
+            }
+            else
+            {
+                /* audio_a2dp_hw keeps writing to the socket */
+                a2dp_cmd_acknowledge(A2DP_CTRL_ACK_FAILURE);
+            }
+            break;
+
         default:
             APPL_TRACE_ERROR1("UNSUPPORTED CMD (%d)", cmd);
             a2dp_cmd_acknowledge(A2DP_CTRL_ACK_FAILURE);
@@ -1451,6 +1560,7 @@ void btif_media_task_init(void)
 
 #if (BTA_AV_INCLUDED == TRUE)
     UIPC_Open(UIPC_CH_ID_AV_CTRL , btif_a2dp_ctrl_cb);
+    btif_media_aa_pool_init();
 #endif
     btif_media_cb.is_source = TRUE;
     APPL_TRACE_DEBUG0("Reset to Source role");
@@ -1507,7 +1617,7 @@ int btif_media_task(void *p)
             }
         }
 
-        if (event & BTIF_MEDIA_AA_TASK_TIMER)
+        if (event & (BTIF_MEDIA_AA_TASK_TIMER | BTIF_MEDIA_AA_CLOCK_EVT))
         {
             /* advance audio timer expiration */
             btif_media_task_aa_handle_timer();
@@ -1531,6 +1641,10 @@ int btif_media_task(void *p)
             /* make sure no channels are restarted while shutting down */
             media_task_running = MEDIA_TASK_STATE_SHUTTING_DOWN;
 
+#if (BTA_AV_INCLUDED == TRUE)
+            btif_media_aa_clock_stop();
+#endif
+
             /* this calls blocks until uipc is fully closed */
             UIPC_Close(UIPC_CH_ID_ALL);
             break;
@@ -2119,6 +2233,13 @@ static void btif_media_task_enc_update(BT_HDR *p_msg)
 
         /* make sure we reinitialize encoder with new settings */
         SBC_Encoder_Init(&(btif_media_cb.encoder));
+
+        /* the adaptive bitpool starts from there and never goes above */
+        btif_media_cb.bp_max = (UINT8)btif_media_cb.encoder.s16BitPool;
+        btif_media_cb.bp_min = (pUpdateAudio->MinBitPool < btif_media_cb.bp_max) ?
+                               pUpdateAudio->MinBitPool : btif_media_cb.bp_max;
+        btif_media_cb.bp_idle_ticks = 0;
+        btif_media_cb.bp_hold_ticks = 0;
     }
 }
 
@@ -2507,17 +2628,178 @@ static void btif_media_task_feeding_state_reset(void)
 
     if (btif_media_cb.TxTranscoding == BTIF_MEDIA_TRSCD_PCM_2_SBC)
     {
-        btif_media_cb.media_feeding_state.pcm.bytes_per_tick =
-                (btif_media_cb.media_feeding.cfg.pcm.sampling_freq *
-                 btif_media_cb.media_feeding.cfg.pcm.bit_per_sample / 8 *
-                 btif_media_cb.media_feeding.cfg.pcm.num_channel *
-                 BTIF_MEDIA_TIME_TICK)/1000;
+        /* the pcm is counted from now on, the first tick asks for one tick of it */
+        btif_media_cb.media_feeding_state.pcm.start_us = btif_media_time_us();
 
         APPL_TRACE_DEBUG1("bit_per_sample %u", btif_media_cb.media_feeding.cfg.pcm.bit_per_sample);
 
-        APPL_TRACE_WARNING1("pcm bytes per tick %d",
-                            (int)btif_media_cb.media_feeding_state.pcm.bytes_per_tick);
+        APPL_TRACE_WARNING2("pcm bytes per tick %d, tick %d ms",
+                            (int)(btif_media_cb.media_feeding.cfg.pcm.sampling_freq *
+                                  btif_media_cb.media_feeding.cfg.pcm.bit_per_sample / 8 *
+                                  btif_media_cb.media_feeding.cfg.pcm.num_channel *
+                                  BTIF_MEDIA_TX_TICK_MS / 1000), BTIF_MEDIA_TX_TICK_MS);
+    }
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_time_us
+ **
+ ** Description      Reads CLOCK_MONOTONIC
+ **
+ ** Returns          time in microseconds
+ **
+ *******************************************************************************/
+static UINT64 btif_media_time_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (UINT64)now.tv_sec * USEC_PER_SEC + now.tv_nsec / 1000;
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_aa_pcm_bytes_due
+ **
+ ** Description      Computes how much pcm the stream has played since the last
+ **                  call from the time elapsed since start_us, so that late or
+ **                  merged ticks neither lose nor add audio and the count does
+ **                  not drift from the clock.
+ **
+ ** Returns          pcm bytes due
+ **
+ *******************************************************************************/
+static UINT32 btif_media_aa_pcm_bytes_due(void)
+{
+    tBTIF_AV_MEDIA_FEEDINGS_PCM_STATE *p_state = &btif_media_cb.media_feeding_state.pcm;
+    UINT32 freq = btif_media_cb.media_feeding.cfg.pcm.sampling_freq;
+    UINT64 samples;
+    UINT64 delta;
+
+    samples = (btif_media_time_us() - p_state->start_us) * freq / USEC_PER_SEC;
+    delta = samples - p_state->samples_due;
+    p_state->samples_due = samples;
+
+    if (delta > (UINT64)freq * BTIF_MEDIA_AA_MAX_LATE_MS / 1000)
+    {
+        APPL_TRACE_WARNING1("btif_media_aa_pcm_bytes_due late by %d samples, skipped",
+                            (int)(delta - (UINT64)freq * BTIF_MEDIA_AA_MAX_LATE_MS / 1000));
+        delta = (UINT64)freq * BTIF_MEDIA_AA_MAX_LATE_MS / 1000;
+    }
+
+    return (UINT32)delta * btif_media_cb.media_feeding.cfg.pcm.num_channel *
+           btif_media_cb.media_feeding.cfg.pcm.bit_per_sample / 8;
+}
+
+#if (BTIF_MEDIA_AA_HR_CLOCK == TRUE)
+/*******************************************************************************
+ **
+ ** Function         btif_media_aa_clock_thread
+ **
+ ** Description      Wakes the media task at each expiry of the media clock.
+ **                  Expiries missed in between are caught up by the pcm
+ **                  accounting of btif_media_aa_pcm_bytes_due.
+ **
+ ** Returns          NULL
+ **
+ *******************************************************************************/
+static void *btif_media_aa_clock_thread(void *arg)
+{
+    UINT64 expirations;
+    ssize_t ret;
+
+    raise_priority_a2dp(TASK_HIGH_MEDIA_CLOCK);
+
+    while (btif_media_aa_clock_running)
+    {
+        ret = read(btif_media_aa_clock_fd, &expirations, sizeof(expirations));
+        if (ret != sizeof(expirations))
+        {
+            if ((ret < 0) && (errno == EINTR))
+                continue;
+            APPL_TRACE_ERROR1("btif_media_aa_clock_thread read failed (%d)", errno);
+            break;
+        }
+        if (btif_media_aa_clock_running)
+            GKI_send_event(BT_MEDIA_TASK, BTIF_MEDIA_AA_CLOCK_EVT);
+    }
+    return NULL;
+}
+#endif
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_aa_clock_start
+ **
+ ** Description      Starts the media clock thread, ticking every
+ **                  BTIF_MEDIA_TX_TICK_MS from a CLOCK_MONOTONIC timerfd
+ **
+ ** Returns          TRUE if it runs, FALSE to use the GKI timer instead
+ **
+ *******************************************************************************/
+static BOOLEAN btif_media_aa_clock_start(void)
+{
+#if (BTIF_MEDIA_AA_HR_CLOCK == TRUE)
+    struct itimerspec its;
+
+    if (btif_media_aa_clock_running)
+        return TRUE;
+
+    btif_media_aa_clock_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+    if (btif_media_aa_clock_fd < 0)
+    {
+        APPL_TRACE_ERROR1("btif_media_aa_clock_start no timerfd (%d)", errno);
+        return FALSE;
+    }
+
+    its.it_interval.tv_sec = BTIF_MEDIA_TX_TICK_MS / 1000;
+    its.it_interval.tv_nsec = (BTIF_MEDIA_TX_TICK_MS % 1000) * 1000000L;
+    its.it_value = its.it_interval;
+
+    btif_media_aa_clock_running = TRUE;
+    if ((timerfd_settime(btif_media_aa_clock_fd, 0, &its, NULL) < 0) ||
+        (pthread_create(&btif_media_aa_clock_tid, NULL, btif_media_aa_clock_thread, NULL) != 0))
+    {
+        APPL_TRACE_ERROR1("btif_media_aa_clock_start failed (%d)", errno);
+        btif_media_aa_clock_running = FALSE;
+        close(btif_media_aa_clock_fd);
+        btif_media_aa_clock_fd = -1;
+        return FALSE;
     }
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_aa_clock_stop
+ **
+ ** Description      Stops the media clock thread if it runs
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+static void btif_media_aa_clock_stop(void)
+{
+#if (BTIF_MEDIA_AA_HR_CLOCK == TRUE)
+    struct itimerspec its;
+
+    if (!btif_media_aa_clock_running)
+        return;
+
+    /* expire right away so that the thread sees it has to stop */
+    btif_media_aa_clock_running = FALSE;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_nsec = 1;
+    timerfd_settime(btif_media_aa_clock_fd, 0, &its, NULL);
+
+    pthread_join(btif_media_aa_clock_tid, NULL);
+    close(btif_media_aa_clock_fd);
+    btif_media_aa_clock_fd = -1;
+#endif
 }
 /*******************************************************************************
  **
@@ -2541,10 +2823,25 @@ static void btif_media_task_aa_start_tx(void)
     /* Reset the media feeding state */
     btif_media_task_feeding_state_reset();
 
-    APPL_TRACE_EVENT2("starting timer %d ticks (%d)",
-                  GKI_MS_TO_TICKS(BTIF_MEDIA_TIME_TICK), TICKS_PER_SEC);
+    /* a new stream starts at full quality */
+    if (btif_media_cb.bp_max)
+        btif_media_cb.encoder.s16BitPool = btif_media_cb.bp_max;
+    btif_media_cb.bp_idle_ticks = 0;
+    btif_media_cb.bp_hold_ticks = 0;
+    btif_media_aa_l2c_peak = 0;
+    btif_media_aa_tx_cong = FALSE;
+
+    if (btif_media_aa_clock_start())
+    {
+        APPL_TRACE_EVENT1("starting media clock %d ms", BTIF_MEDIA_TX_TICK_MS);
+    }
+    else
+    {
+        APPL_TRACE_EVENT2("starting timer %d ticks (%d)",
+                      GKI_MS_TO_TICKS(BTIF_MEDIA_TX_TICK_MS), TICKS_PER_SEC);
 
-    GKI_start_timer(BTIF_MEDIA_AA_TASK_TIMER_ID, GKI_MS_TO_TICKS(BTIF_MEDIA_TIME_TICK), TRUE);
+        GKI_start_timer(BTIF_MEDIA_AA_TASK_TIMER_ID, GKI_MS_TO_TICKS(BTIF_MEDIA_TX_TICK_MS), TRUE);
+    }
 }
 
 /*******************************************************************************
@@ -2562,6 +2859,7 @@ static void btif_media_task_aa_stop_tx(void)
     APPL_TRACE_DEBUG1("btif_media_task_aa_stop_tx is timer: %d", btif_media_cb.is_tx_timer);
 
     /* Stop the timer first */
+    btif_media_aa_clock_stop();
     GKI_stop_timer(BTIF_MEDIA_AA_TASK_TIMER_ID);
     if (btif_media_cb.is_tx_timer)
     {
@@ -2672,8 +2970,7 @@ static void btif_get_num_aa_frame(UINT8 *num_of_iterations, UINT8 *num_of_frames
                              btif_media_cb.media_feeding.cfg.pcm.bit_per_sample / 8;
             APPL_TRACE_DEBUG1("pcm_bytes_per_frame %u", pcm_bytes_per_frame);
 
-            btif_media_cb.media_feeding_state.pcm.counter +=
-                                btif_media_cb.media_feeding_state.pcm.bytes_per_tick;
+            btif_media_cb.media_feeding_state.pcm.counter += btif_media_aa_pcm_bytes_due();
 
             /* calculate nbr of frames pending for this media tick */
             result = btif_media_cb.media_feeding_state.pcm.counter/pcm_bytes_per_frame;
@@ -2795,21 +3092,101 @@ BT_HDR *btif_media_aa_readbuf(void)
 
 /*******************************************************************************
  **
- ** Function         btif_media_aa_read_feeding
+ ** Function         btif_media_aa_pool_init
  **
- ** Description
+ ** Description      Creates the pool of the outgoing media packets, unless it
+ **                  is still there from a previous run of the media task.
  **
  ** Returns          void
  **
  *******************************************************************************/
+static void btif_media_aa_pool_init(void)
+{
+#if (BTIF_MEDIA_AA_NUM_BUFS > 0)
+    /* GKI drops the pool when it is shut down */
+    if ((btif_media_aa_pool_id != GKI_INVALID_POOL) &&
+        (GKI_poolcount(btif_media_aa_pool_id) == BTIF_MEDIA_AA_NUM_BUFS))
+        return;
+
+    GKI_disable();
+    btif_media_aa_pool_id = GKI_create_pool(BTIF_MEDIA_AA_BUF_SIZE, BTIF_MEDIA_AA_NUM_BUFS,
+                                            GKI_RESTRICTED_POOL, NULL);
+    GKI_enable();
+
+    if (btif_media_aa_pool_id == GKI_INVALID_POOL)
+        APPL_TRACE_WARNING0("btif_media_aa_pool_init no media pool, using shared pool");
+#endif
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_aa_getbuf
+ **
+ ** Description      Gets a buffer for an outgoing media packet. GKI falls back
+ **                  to the public pools when the media pool is exhausted.
+ **
+ ** Returns          the buffer, NULL if none is available
+ **
+ *******************************************************************************/
+static BT_HDR *btif_media_aa_getbuf(void)
+{
+    if (btif_media_aa_pool_id != GKI_INVALID_POOL)
+        return (BT_HDR *)GKI_getpoolbuf(btif_media_aa_pool_id);
+
+    return (BT_HDR *)GKI_getpoolbuf(BTIF_MEDIA_AA_POOL_ID);
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_aa_sbc_frames_per_pkt
+ **
+ ** Description      Number of SBC frames that go in one media packet with the
+ **                  current encoder settings: as many as stay under the MTU,
+ **                  at least one and at most BTIF_MEDIA_AA_MAX_SBC_FRAMES.
+ **
+ ** Returns          number of frames
+ **
+ *******************************************************************************/
+static UINT8 btif_media_aa_sbc_frames_per_pkt(void)
+{
+    SBC_ENC_PARAMS *p_enc = &btif_media_cb.encoder;
+    INT32 bits = p_enc->s16NumOfBlocks * p_enc->s16BitPool;
+    INT32 frame_len;
+    INT32 nb;
+
+    if ((p_enc->s16ChannelMode == SBC_MONO) || (p_enc->s16ChannelMode == SBC_DUAL))
+        bits *= p_enc->s16NumOfChannels;
+    else if (p_enc->s16ChannelMode == SBC_JOINT_STEREO)
+        bits += p_enc->s16NumOfSubBands;
+
+    /* header, scale factors and audio samples */
+    frame_len = 4 + (4 * p_enc->s16NumOfSubBands * p_enc->s16NumOfChannels) / 8 + (bits + 7) / 8;
+
+    nb = ((INT32)btif_media_cb.TxAaMtuSize - 1) / frame_len;
+    if (nb < 1)
+        nb = 1;
+    else if (nb > BTIF_MEDIA_AA_MAX_SBC_FRAMES)
+        nb = BTIF_MEDIA_AA_MAX_SBC_FRAMES;
+
+    return (UINT8)nb;
+}
 
-BOOLEAN btif_media_aa_read_feeding(tUIPC_CH_ID channel_id)
+/*******************************************************************************
+ **
+ ** Function         btif_media_aa_read_resampled
+ **
+ ** Description      Reads PCM at the feeding rate and up-samples it to the SBC
+ **                  rate until one SBC frame worth of PCM is available.
+ **
+ ** Returns          TRUE if a frame was copied to p_dst
+ **
+ *******************************************************************************/
+static BOOLEAN btif_media_aa_read_resampled(tUIPC_CH_ID channel_id, UINT16 sbc_sampling, UINT8 *p_dst)
 {
     UINT16 event;
     UINT16 blocm_x_subband = btif_media_cb.encoder.s16NumOfSubBands * \
                              btif_media_cb.encoder.s16NumOfBlocks;
     UINT32 read_size;
-    UINT16 sbc_sampling = 48000;
     UINT32 src_samples;
     UINT16 bytes_needed = blocm_x_subband * btif_media_cb.encoder.s16NumOfChannels * \
                           btif_media_cb.media_feeding.cfg.pcm.bit_per_sample / 8;
@@ -2827,40 +3204,6 @@ BOOLEAN btif_media_aa_read_feeding(tUIPC_CH_ID channel_id)
     char trace_buf[512];
     #endif
 
-    /* Get the SBC sampling rate */
-    switch (btif_media_cb.encoder.s16SamplingFreq)
-    {
-    case SBC_sf48000:
-        sbc_sampling = 48000;
-        break;
-    case SBC_sf44100:
-        sbc_sampling = 44100;
-        break;
-    case SBC_sf32000:
-        sbc_sampling = 32000;
-        break;
-    case SBC_sf16000:
-        sbc_sampling = 16000;
-        break;
-    }
-
-    if (sbc_sampling == btif_media_cb.media_feeding.cfg.pcm.sampling_freq) {
-        read_size = bytes_needed - btif_media_cb.media_feeding_state.pcm.aa_feed_residue;
-        nb_byte_read = UIPC_Read(channel_id, &event,
-                  ((UINT8 *)btif_media_cb.encoder.as16PcmBuffer) +
-                  btif_media_cb.media_feeding_state.pcm.aa_feed_residue,
-                  read_size);
-        if (nb_byte_read == read_size) {
-            btif_media_cb.media_feeding_state.pcm.aa_feed_residue = 0;
-            return TRUE;
-        } else {
-            APPL_TRACE_WARNING2("### UNDERFLOW :: ONLY READ %d BYTES OUT OF %d ###",
-                nb_byte_read, read_size);
-            btif_media_cb.media_feeding_state.pcm.aa_feed_residue += nb_byte_read;
-            return FALSE;
-        }
-    }
-
     /* Some Feeding PCM frequencies require to split the number of sample */
     /* to read. */
     /* E.g 128/6=21.3333 => read 22 and 21 and 21 => max = 2; threshold = 0*/
@@ -2955,7 +3298,7 @@ BOOLEAN btif_media_aa_read_feeding(tUIPC_CH_ID channel_id)
             &src_size_used);
 
 #if (defined(DEBUG_MEDIA_AV_FLOW) && (DEBUG_MEDIA_AV_FLOW == TRUE))
-    APPL_TRACE_DEBUG3("btif_media_aa_read_feeding readsz:%d src_size_used:%d dst_size_used:%d",
+    APPL_TRACE_DEBUG3("btif_media_aa_read_resampled readsz:%d src_size_used:%d dst_size_used:%d",
             read_size, src_size_used, dst_size_used);
 #endif
 
@@ -2966,9 +3309,7 @@ BOOLEAN btif_media_aa_read_feeding(tUIPC_CH_ID channel_id)
     if(btif_media_cb.media_feeding_state.pcm.aa_feed_residue >= bytes_needed)
     {
         /* Copy the output pcm samples in SBC encoding buffer */
-        memcpy((UINT8 *)btif_media_cb.encoder.as16PcmBuffer,
-                (UINT8 *)up_sampled_buffer,
-                bytes_needed);
+        memcpy(p_dst, (UINT8 *)up_sampled_buffer, bytes_needed);
         /* update the residue */
         btif_media_cb.media_feeding_state.pcm.aa_feed_residue -= bytes_needed;
 
@@ -2982,18 +3323,98 @@ BOOLEAN btif_media_aa_read_feeding(tUIPC_CH_ID channel_id)
     }
 
 #if (defined(DEBUG_MEDIA_AV_FLOW) && (DEBUG_MEDIA_AV_FLOW == TRUE))
-    APPL_TRACE_DEBUG3("btif_media_aa_read_feeding residue:%d, dst_size_used %d, bytes_needed %d",
+    APPL_TRACE_DEBUG3("btif_media_aa_read_resampled residue:%d, dst_size_used %d, bytes_needed %d",
             btif_media_cb.media_feeding_state.pcm.aa_feed_residue, dst_size_used, bytes_needed);
 #endif
 
     return FALSE;
 }
 
+/*******************************************************************************
+ **
+ ** Function         btif_media_aa_read_feeding
+ **
+ ** Description      Reads the PCM of up to nb_frame SBC frames into
+ **                  btif_media_aa_pcm. At the SBC rate the PCM is read from
+ **                  UIPC in place in one go, otherwise frame by frame through
+ **                  the up-sampler. A partial frame is kept as residue for the
+ **                  next call.
+ **
+ ** Returns          number of complete frames in btif_media_aa_pcm
+ **
+ *******************************************************************************/
+static UINT8 btif_media_aa_read_feeding(tUIPC_CH_ID channel_id, UINT8 nb_frame)
+{
+    tBTIF_AV_MEDIA_FEEDINGS_PCM_STATE *p_state = &btif_media_cb.media_feeding_state.pcm;
+    UINT16 event;
+    UINT16 sbc_sampling = 48000;
+    UINT32 bytes_needed = btif_media_cb.encoder.s16NumOfSubBands *
+                          btif_media_cb.encoder.s16NumOfBlocks *
+                          btif_media_cb.encoder.s16NumOfChannels *
+                          btif_media_cb.media_feeding.cfg.pcm.bit_per_sample / 8;
+    UINT32 read_size;
+    UINT32 nb_byte_read;
+    UINT8 nb_read;
+
+    /* Get the SBC sampling rate */
+    switch (btif_media_cb.encoder.s16SamplingFreq)
+    {
+    case SBC_sf48000:
+        sbc_sampling = 48000;
+        break;
+    case SBC_sf44100:
+        sbc_sampling = 44100;
+        break;
+    case SBC_sf32000:
+        sbc_sampling = 32000;
+        break;
+    case SBC_sf16000:
+        sbc_sampling = 16000;
+        break;
+    }
+
+    if (sbc_sampling != btif_media_cb.media_feeding.cfg.pcm.sampling_freq)
+    {
+        for (nb_read = 0; nb_read < nb_frame; nb_read++)
+        {
+            if (!btif_media_aa_read_resampled(channel_id, sbc_sampling,
+                    (UINT8 *)btif_media_aa_pcm + nb_read * bytes_needed))
+                break;
+        }
+        return nb_read;
+    }
+
+    /* the residue of the last underflow follows the frames encoded since */
+    if (p_state->aa_feed_residue && p_state->aa_feed_residue_offset)
+    {
+        memmove(btif_media_aa_pcm, (UINT8 *)btif_media_aa_pcm + p_state->aa_feed_residue_offset,
+                p_state->aa_feed_residue);
+    }
+
+    read_size = nb_frame * bytes_needed - p_state->aa_feed_residue;
+    nb_byte_read = UIPC_Read(channel_id, &event,
+                             (UINT8 *)btif_media_aa_pcm + p_state->aa_feed_residue, read_size);
+    if (nb_byte_read < read_size)
+    {
+        APPL_TRACE_WARNING2("### UNDERFLOW :: ONLY READ %d BYTES OUT OF %d ###",
+            nb_byte_read, read_size);
+    }
+
+    p_state->aa_feed_residue += nb_byte_read;
+    nb_read = (UINT8)(p_state->aa_feed_residue / bytes_needed);
+    p_state->aa_feed_residue -= nb_read * bytes_needed;
+    p_state->aa_feed_residue_offset = nb_read * bytes_needed;
+
+    return nb_read;
+}
+
 /*******************************************************************************
  **
  ** Function         btif_media_aa_prep_sbc_2_send
  **
- ** Description
+ ** Description      Encodes nb_frame SBC frames into media packets. The frames
+ **                  of a packet are encoded in one SBC_Encoder call, from the
+ **                  PCM staging buffer straight into the packet.
  **
  ** Returns          void
  **
@@ -3003,6 +3424,10 @@ static void btif_media_aa_prep_sbc_2_send(UINT8 nb_frame)
     BT_HDR * p_buf;
     UINT16 blocm_x_subband = btif_media_cb.encoder.s16NumOfSubBands *
                              btif_media_cb.encoder.s16NumOfBlocks;
+    UINT8 nb_batch;
+    UINT8 nb_read;
+    UINT8 *p_frame;
+    UINT8 i;
 
 #if (defined(DEBUG_MEDIA_AV_FLOW) && (DEBUG_MEDIA_AV_FLOW == TRUE))
     APPL_TRACE_DEBUG2("btif_media_aa_prep_sbc_2_send nb_frame %d, TxAaQ %d",
@@ -3010,7 +3435,7 @@ static void btif_media_aa_prep_sbc_2_send(UINT8 nb_frame)
 #endif
     while (nb_frame)
     {
-        if (NULL == (p_buf = GKI_getpoolbuf(BTIF_MEDIA_AA_POOL_ID)))
+        if (NULL == (p_buf = btif_media_aa_getbuf()))
         {
             APPL_TRACE_ERROR1 ("ERROR btif_media_aa_prep_sbc_2_send no buffer TxCnt %d ",
                                 btif_media_cb.TxAaQ.count);
@@ -3022,48 +3447,53 @@ static void btif_media_aa_prep_sbc_2_send(UINT8 nb_frame)
         p_buf->len = 0;
         p_buf->layer_specific = 0;
 
-        do
+        nb_batch = btif_media_aa_sbc_frames_per_pkt();
+        if (nb_batch > nb_frame)
+            nb_batch = nb_frame;
+
+        /* Read PCM data and upsample them if needed */
+        nb_read = btif_media_aa_read_feeding(UIPC_CH_ID_AV_AUDIO, nb_batch);
+        if (nb_read)
         {
-            /* Write @ of allocated buffer in encoder.pu8Packet */
-            btif_media_cb.encoder.pu8Packet = (UINT8 *) (p_buf + 1) + p_buf->offset + p_buf->len;
-            /* Fill allocated buffer with 0 */
-            memset(btif_media_cb.encoder.as16PcmBuffer, 0, blocm_x_subband
-                    * btif_media_cb.encoder.s16NumOfChannels);
-
-            /* Read PCM data and upsample them if needed */
-            if (btif_media_aa_read_feeding(UIPC_CH_ID_AV_AUDIO))
+            /* SBC encode all frames into the packet */
+            p_frame = (UINT8 *) (p_buf + 1) + p_buf->offset;
+            btif_media_cb.encoder.pu8Packet = p_frame;
+            btif_media_cb.encoder.ps16PcmBuffer = btif_media_aa_pcm;
+            btif_media_cb.encoder.u8NumPacketToEncode = nb_read;
+            SBC_Encoder(&(btif_media_cb.encoder));
+
+            /* descramble frame by frame, all have the same length */
+            for (i = 0; i < nb_read; i++)
             {
-                /* SBC encode and descramble frame */
-                SBC_Encoder(&(btif_media_cb.encoder));
-                A2D_SbcChkFrInit(btif_media_cb.encoder.pu8Packet);
-                A2D_SbcDescramble(btif_media_cb.encoder.pu8Packet, btif_media_cb.encoder.u16PacketLength);
-                /* Update SBC frame length */
-                p_buf->len += btif_media_cb.encoder.u16PacketLength;
-                nb_frame--;
-                p_buf->layer_specific++;
+                A2D_SbcChkFrInit(p_frame);
+                A2D_SbcDescramble(p_frame, btif_media_cb.encoder.u16PacketLength);
+                p_frame += btif_media_cb.encoder.u16PacketLength;
             }
-            else
+            /* Update SBC frame length */
+            p_buf->len = nb_read * btif_media_cb.encoder.u16PacketLength;
+            p_buf->layer_specific = nb_read;
+            nb_frame -= nb_read;
+        }
+
+        if (nb_read < nb_batch)
+        {
+            APPL_TRACE_WARNING2("btif_media_aa_prep_sbc_2_send underflow %d, %d",
+                nb_frame, btif_media_cb.media_feeding_state.pcm.aa_feed_residue);
+            btif_media_cb.media_feeding_state.pcm.counter += nb_frame *
+                 btif_media_cb.encoder.s16NumOfSubBands *
+                 btif_media_cb.encoder.s16NumOfBlocks *
+                 btif_media_cb.media_feeding.cfg.pcm.num_channel *
+                 btif_media_cb.media_feeding.cfg.pcm.bit_per_sample / 8;
+            /* no more pcm to read */
+            nb_frame = 0;
+
+            /* break read loop if timer was stopped (media task stopped) */
+            if ( btif_media_cb.is_tx_timer == FALSE )
             {
-                APPL_TRACE_WARNING2("btif_media_aa_prep_sbc_2_send underflow %d, %d",
-                    nb_frame, btif_media_cb.media_feeding_state.pcm.aa_feed_residue);
-                btif_media_cb.media_feeding_state.pcm.counter += nb_frame *
-                     btif_media_cb.encoder.s16NumOfSubBands *
-                     btif_media_cb.encoder.s16NumOfBlocks *
-                     btif_media_cb.media_feeding.cfg.pcm.num_channel *
-                     btif_media_cb.media_feeding.cfg.pcm.bit_per_sample / 8;
-                /* no more pcm to read */
-                nb_frame = 0;
-
-                /* break read loop if timer was stopped (media task stopped) */
-                if ( btif_media_cb.is_tx_timer == FALSE )
-                {
-                    GKI_freebuf(p_buf);
-                    return;
-                }
+                GKI_freebuf(p_buf);
+                return;
             }
-
-        } while (((p_buf->len + btif_media_cb.encoder.u16PacketLength) < btif_media_cb.TxAaMtuSize)
-                && (p_buf->layer_specific < 0x0F) && nb_frame);
+        }
 
         if(p_buf->len)
         {
@@ -3097,6 +3527,100 @@ static void btif_media_aa_prep_sbc_2_send(UINT8 nb_frame)
 }
 
 
+/*******************************************************************************
+ **
+ ** Function         btif_media_aa_tx_status
+ **
+ ** Description      Called from BTU each time BTA AV hands a media packet to
+ **                  L2CAP or holds it back. l2c_bufs is the number of packets
+ **                  queued in L2CAP for the stream, congested is TRUE when
+ **                  L2CAP does not take more, either because the ACL link is
+ **                  flow controlled or because the AVDTP channel is congested.
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+void btif_media_aa_tx_status(UINT8 l2c_bufs, BOOLEAN congested)
+{
+    /* read and cleared by the media task on its next tick */
+    if (l2c_bufs > btif_media_aa_l2c_peak)
+        btif_media_aa_l2c_peak = l2c_bufs;
+    if (congested)
+        btif_media_aa_tx_cong = TRUE;
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_aa_adapt_bitpool
+ **
+ ** Description      Runs once per media tick. Cuts the SBC bitpool when the
+ **                  link was congested or TxAaQ is backing up since the last
+ **                  tick, and raises it step by step while the link stays
+ **                  idle, so that the quality degrades instead of packets
+ **                  being dropped.
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+static void btif_media_aa_adapt_bitpool(void)
+{
+#if (BTIF_MEDIA_BP_ADAPT_INCLUDED == TRUE)
+    SINT16 bitpool = btif_media_cb.encoder.s16BitPool;
+    UINT8 l2c_peak = btif_media_aa_l2c_peak;
+    BOOLEAN cong = btif_media_aa_tx_cong;
+
+    btif_media_aa_l2c_peak = 0;
+    btif_media_aa_tx_cong = FALSE;
+
+    if ((btif_media_cb.TxTranscoding != BTIF_MEDIA_TRSCD_PCM_2_SBC) || !btif_media_cb.bp_max)
+        return;
+
+    if (btif_media_cb.TxAaQ.count > BTIF_MEDIA_BP_TXQ_HIGH)
+        cong = TRUE;
+
+    if (btif_media_cb.bp_hold_ticks)
+        btif_media_cb.bp_hold_ticks--;
+
+    if (cong)
+    {
+        btif_media_cb.bp_idle_ticks = 0;
+        if (!btif_media_cb.bp_hold_ticks && (bitpool > btif_media_cb.bp_min))
+        {
+            bitpool -= (bitpool / BTIF_MEDIA_BP_DEC_DIV) ? (bitpool / BTIF_MEDIA_BP_DEC_DIV) : 1;
+            if (bitpool < btif_media_cb.bp_min)
+                bitpool = btif_media_cb.bp_min;
+            btif_media_cb.bp_hold_ticks = BTIF_MEDIA_BP_DEC_HOLD_MS / BTIF_MEDIA_TX_TICK_MS;
+        }
+    }
+    else if ((btif_media_cb.TxAaQ.count <= BTIF_MEDIA_BP_IDLE_BUFS) &&
+             (l2c_peak <= BTIF_MEDIA_BP_IDLE_BUFS))
+    {
+        if ((++btif_media_cb.bp_idle_ticks >= BTIF_MEDIA_BP_INC_MS / BTIF_MEDIA_TX_TICK_MS) &&
+            (bitpool < btif_media_cb.bp_max))
+        {
+            btif_media_cb.bp_idle_ticks = 0;
+            bitpool += BTIF_MEDIA_BP_INC_STEP;
+            if (bitpool > btif_media_cb.bp_max)
+                bitpool = btif_media_cb.bp_max;
+        }
+    }
+    else
+    {
+        /* busy but keeping up, stay where we are */
+        btif_media_cb.bp_idle_ticks = 0;
+    }
+
+    if (bitpool != btif_media_cb.encoder.s16BitPool)
+    {
+        APPL_TRACE_EVENT4("btif_media_aa_adapt_bitpool %d -> %d (TxAaQ %d, l2c %d)",
+                          btif_media_cb.encoder.s16BitPool, bitpool,
+                          btif_media_cb.TxAaQ.count, l2c_peak);
+        /* every SBC frame carries its bitpool, the sink follows without reconfiguration */
+        btif_media_cb.encoder.s16BitPool = bitpool;
+    }
+#endif
+}
+
 /*******************************************************************************
  **
  ** Function         btif_media_aa_prep_2_send
@@ -3117,6 +3641,7 @@ static void btif_media_aa_prep_2_send(UINT8 nb_frame)
         APPL_TRACE_WARNING1("btif_media_aa_prep_2_send congestion buf count %d",
                              btif_media_cb.TxAaQ.count);
         GKI_freebuf(GKI_dequeue(&(btif_media_cb.TxAaQ)));
+        btif_media_aa_tx_cong = TRUE;
     }
 
     switch (btif_media_cb.TxTranscoding)
@@ -3150,6 +3675,9 @@ static void btif_media_send_aa_frame(void)
     char trace_buf[1024];
     #endif
 
+    /* follow the link with the bitpool before encoding this tick's frames */
+    btif_media_aa_adapt_bitpool();
+
     /* get the number of frame to send */
     btif_get_num_aa_frame(&nb_iterations, &nb_frame_2_send);
 
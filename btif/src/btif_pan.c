@@ -31,6 +31,7 @@
 #include <sys/select.h>
 #include <sys/poll.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <stdio.h>
@@ -53,6 +54,9 @@
 
 #include "bta_api.h"
 #include "bta_pan_api.h"
+#include "bta_pan_ci.h"
+#include "gki.h"
+#include "pan_api.h"
 #include "btif_sock_thread.h"
 #include "btif_sock_util.h"
 #include "btif_pan_internal.h"
@@ -377,6 +381,10 @@ int btpan_tap_open()
         close(fd);
         return err;
     }
+
+    /* the read thread drains all pending frames until EAGAIN */
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
     BTM_GetLocalDeviceAddr (local_addr);
     if(tap_if_up(TAP_IF_NAME, local_addr) == 0)
     {
@@ -398,19 +406,15 @@ int btpan_tap_send(int tap_fd, const BD_ADDR src, const BD_ADDR dst, UINT16 prot
         memcpy(&eth_hdr.h_dest, dst, ETH_ADDR_LEN);
         memcpy(&eth_hdr.h_src, src, ETH_ADDR_LEN);
         eth_hdr.h_proto = htons(proto);
-        char packet[2000];
-        memcpy(packet, &eth_hdr, sizeof(tETH_HDR));
-        if(len > 2000)
-        {
-            ALOGE("btpan_tap_send eth packet size:%d is exceeded limit!", len);
-            return -1;
-        }
-        memcpy(packet + sizeof(tETH_HDR), buf, len);
 
-        /* Send data to network interface */
-        //btnet_send(btpan_cb.conn[i].sock.sock, &buffer, (len + sizeof(tETH_HDR)));
-        //dump_bin("packet to network", packet, len + sizeof(tETH_HDR));
-        int ret = write(tap_fd, packet, len + sizeof(tETH_HDR));
+        /* Send data to network interface, the header and the payload of the
+           BNEP buffer in one frame without copying them together */
+        struct iovec iov[2];
+        iov[0].iov_base = &eth_hdr;
+        iov[0].iov_len = sizeof(tETH_HDR);
+        iov[1].iov_base = (void *)buf;
+        iov[1].iov_len = len;
+        int ret = writev(tap_fd, iov, 2);
         BTIF_TRACE_DEBUG1("ret:%d", ret);
         return ret;
     }
@@ -510,9 +514,7 @@ static inline int should_forward(tETH_HDR* hdr)
     BTIF_TRACE_DEBUG1("unknown proto:%x", ntohs(hdr->h_proto));
     return FALSE;
 }
-extern void bta_pan_ci_rx_write(UINT16 handle, BD_ADDR dst, BD_ADDR src, UINT16 protocol,
-        UINT8 *p_data, UINT16 len, BOOLEAN ext);
-static void forward_bnep(tETH_HDR* eth_hdr, char * packet, int size)
+static void forward_bnep(tETH_HDR* eth_hdr, BT_HDR *p_buf)
 {
     int broadcast = eth_hdr->h_dest[0] & 1;
     int i;
@@ -523,12 +525,13 @@ static void forward_bnep(tETH_HDR* eth_hdr, char * packet, int size)
                 (broadcast || memcmp(btpan_cb.conns[i].eth_addr, eth_hdr->h_dest, sizeof(BD_ADDR)) == 0
                  || memcmp(btpan_cb.conns[i].peer, eth_hdr->h_dest, sizeof(BD_ADDR)) == 0))
         {
-            BTIF_TRACE_DEBUG1("calling bta_pan_ci_rx_write, handle:%d", handle);
-            bta_pan_ci_rx_write(handle, eth_hdr->h_dest, eth_hdr->h_src,
-                    ntohs(eth_hdr->h_proto), (UINT8*)packet, size, 0);
-            break;
+            BTIF_TRACE_DEBUG1("calling bta_pan_ci_rx_writebuf, handle:%d", handle);
+            bta_pan_ci_rx_writebuf(handle, eth_hdr->h_dest, eth_hdr->h_src,
+                    ntohs(eth_hdr->h_proto), p_buf, 0);
+            return;
         }
     }
+    GKI_freebuf(p_buf);
 }
 
 static void bta_pan_callback_transfer(UINT16 event, char *p_param)
@@ -630,30 +633,57 @@ static void bta_pan_callback(tBTA_PAN_EVT event, tBTA_PAN *p_data)
     btif_transfer_context(bta_pan_callback_transfer, event, (char*)p_data, sizeof(tBTA_PAN), NULL);
 }
 #define MAX_PACKET_SIZE 2000
+/* frames read from the tap interface on one wake up of the read thread */
+#define TAP_READ_BATCH  8
 static void btpan_tap_fd_signaled(int fd, int type, int flags, uint32_t user_id)
 {
-    char packet[MAX_PACKET_SIZE];
+    static char drop[MAX_PACKET_SIZE];
     tETH_HDR eth_hdr;
+    BT_HDR *p_buf;
+    UINT8 *p_frame;
+    int size, room, i;
     if(flags & SOCK_THREAD_FD_EXCEPTION)
     {
         BTIF_TRACE_ERROR1("pan tap fd:%d exception", fd);
     }
     else if(flags & SOCK_THREAD_FD_RD)
     {
-        /* debug("tab fd read trigged,  data"); */
-        int size = read(fd, packet, MAX_PACKET_SIZE);
-        /* debug("tap fd read trigged, read size:%d", size); */
-        memcpy(&eth_hdr, &packet, sizeof(tETH_HDR));
-        /* debug("eth src = %02x:%02x:%02x:%02x:%02x:%02x", */
-        /*         eth_hdr.h_src[0],  eth_hdr.h_src[1], eth_hdr.h_src[2], eth_hdr.h_src[3], */
-        /*         eth_hdr.h_src[4], eth_hdr.h_src[5]); */
-        /* debug("eth dest = %02x:%02x:%02x:%02x:%02x:%02x", */
-        /*         eth_hdr.h_dest[0], eth_hdr.h_dest[1], eth_hdr.h_dest[2], eth_hdr.h_dest[3], */
-        /*         eth_hdr.h_dest[4], eth_hdr.h_dest[5]); */
-        //dump_bin("eth packet received", packet, size);
-        if(should_forward(&eth_hdr))
+        for(i = 0; i < TAP_READ_BATCH; i++)
         {
-            forward_bnep(&eth_hdr, packet + sizeof(tETH_HDR),  size - sizeof(tETH_HDR));
+            if((p_buf = (BT_HDR *)GKI_getpoolbuf(PAN_POOL_ID)) == NULL)
+            {
+                /* no buffer for BNEP, drop the frame as the stack would */
+                if(read(fd, drop, MAX_PACKET_SIZE) <= 0)
+                    break;
+                BTIF_TRACE_WARNING0("btpan_tap_fd_signaled: no PAN buffer, frame dropped");
+                continue;
+            }
+
+            /* read the frame after the room BNEP and L2CAP need for their
+               headers, the ethernet header is only parsed, not sent */
+            p_frame = (UINT8 *)(p_buf + 1) + PAN_MINIMUM_OFFSET;
+            room = GKI_get_buf_size(p_buf) - sizeof(BT_HDR) - PAN_MINIMUM_OFFSET;
+            if(room > MAX_PACKET_SIZE)
+                room = MAX_PACKET_SIZE;
+
+            size = read(fd, p_frame, room);
+            if(size < (int)sizeof(tETH_HDR))
+            {
+                GKI_freebuf(p_buf);
+                if(size < 0)
+                    break;          /* EAGAIN, all pending frames are read */
+                continue;
+            }
+            memcpy(&eth_hdr, p_frame, sizeof(tETH_HDR));
+            //dump_bin("eth packet received", p_frame, size);
+            if(!should_forward(&eth_hdr))
+            {
+                GKI_freebuf(p_buf);
+                continue;
+            }
+            p_buf->offset = PAN_MINIMUM_OFFSET + sizeof(tETH_HDR);
+            p_buf->len = size - sizeof(tETH_HDR);
+            forward_bnep(&eth_hdr, p_buf);
         }
         btsock_thread_add_fd(pth, fd, 0, SOCK_THREAD_FD_RD | SOCK_THREAD_ADD_FD_SYNC, 0);
     }
@@ -27,6 +27,7 @@
 #include <hardware/bt_sock.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <sys/ioctl.h>
 
@@ -967,52 +968,70 @@ static void jv_dm_cback(tBTA_JV_EVT event, tBTA_JV *p_data, void *user_data)
 #define SENT_PARTIAL 1
 #define SENT_NONE 0
 #define SENT_FAILED (-1)
-static int send_data_to_app(int fd, BT_HDR *p_buf)
+#define MAX_SEND_IOV 16
+/* send the buffers at the head of the queue with one sendmsg(), free the ones that
+ * went out and trim the one that went out in part. SENT_ALL means all the buffers
+ * taken went out, there may be more left in the queue */
+static int send_que_to_app(int fd, BUFFER_Q* q)
 {
-    if(p_buf->len == 0)
-        return SENT_ALL;
-    int sent = send(fd, (UINT8 *)(p_buf + 1) + p_buf->offset,  p_buf->len, MSG_DONTWAIT);
-    if(sent == p_buf->len)
-        return SENT_ALL;
+    struct iovec iov[MAX_SEND_IOV];
+    struct msghdr msg;
+    BT_HDR* p_buf;
+    int n = 0, cnt = 0, total = 0, sent = 0, left;
 
-    if(sent > 0 && sent < p_buf->len)
+    for(p_buf = GKI_getfirst(q); p_buf && cnt < MAX_SEND_IOV; p_buf = GKI_getnext(p_buf), n++)
     {
-        //sent partial
-        APPL_TRACE_ERROR2("send partial, sent:%d, p_buf->len:%d", sent, p_buf->len);
-        p_buf->offset += sent;
-        p_buf->len -= sent;
-        return SENT_PARTIAL;
-
+        if(p_buf->len == 0)
+            continue;
+        iov[cnt].iov_base = (UINT8 *)(p_buf + 1) + p_buf->offset;
+        iov[cnt].iov_len = p_buf->len;
+        total += p_buf->len;
+        cnt++;
     }
-    if(sent < 0 &&
-        (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    if(cnt)
     {
-        APPL_TRACE_ERROR1("send none, EAGAIN or EWOULDBLOCK, errno:%d", errno);
-        return SENT_NONE;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = cnt;
+        sent = sendmsg(fd, &msg, MSG_DONTWAIT);
+        if(sent < 0)
+        {
+            if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            {
+                APPL_TRACE_DEBUG1("send none, EAGAIN or EWOULDBLOCK, errno:%d", errno);
+                return SENT_NONE;
+            }
+            APPL_TRACE_ERROR3("unknown sendmsg() error, buffers:%d, len:%d, errno:%d", cnt, total, errno);
+            return SENT_FAILED;
+        }
     }
-    APPL_TRACE_ERROR3("unknown send() error, sent:%d, p_buf->len:%d,  errno:%d", sent, p_buf->len, errno);
-    return SENT_FAILED;
+    for(left = sent; n > 0; n--)
+    {
+        p_buf = GKI_getfirst(q);
+        if(p_buf->len > left)
+        {
+            APPL_TRACE_DEBUG2("send partial, sent:%d, len:%d", sent, total);
+            p_buf->offset += left;
+            p_buf->len -= left;
+            return sent ? SENT_PARTIAL : SENT_NONE;
+        }
+        left -= p_buf->len;
+        GKI_freebuf(GKI_dequeue(q));
+    }
+    return SENT_ALL;
 }
 static BOOLEAN flush_incoming_que_on_wr_signal(rfc_slot_t* rs)
 {
     while(!GKI_queue_is_empty(&rs->incoming_que))
     {
-        BT_HDR *p_buf = GKI_dequeue(&rs->incoming_que);
-        int sent = send_data_to_app(rs->fd, p_buf);
-        switch(sent)
+        switch(send_que_to_app(rs->fd, &rs->incoming_que))
         {
             case SENT_NONE:
             case SENT_PARTIAL:
-                //add it back to the queue at same position
-                GKI_enqueue_head (&rs->incoming_que, p_buf);
                 //monitor the fd to get callback when app is ready to receive data
                 btsock_thread_add_fd(pth, rs->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR, rs->id);
                 return TRUE;
-            case SENT_ALL:
-                GKI_freebuf(p_buf);
-                break;
             case SENT_FAILED:
-                GKI_freebuf(p_buf);
                 return FALSE;
         }
     }
@@ -1091,26 +1110,22 @@ int bta_co_rfc_data_incoming(void *user_data, BT_HDR *p_buf)
     rfc_slot_t* rs = find_rfc_slot_by_id(id);
     if(rs)
     {
-        if(!GKI_queue_is_empty(&rs->incoming_que))
-            GKI_enqueue(&rs->incoming_que, p_buf);
-        else
+        //buffers already waiting for the app go out first, in one go on the next write signal
+        BOOLEAN waiting = !GKI_queue_is_empty(&rs->incoming_que);
+        GKI_enqueue(&rs->incoming_que, p_buf);
+        if(!waiting)
         {
-            int sent = send_data_to_app(rs->fd, p_buf);
-            switch(sent)
+            switch(send_que_to_app(rs->fd, &rs->incoming_que))
             {
                 case SENT_NONE:
                 case SENT_PARTIAL:
-                    //add it to the end of the queue
-                    GKI_enqueue(&rs->incoming_que, p_buf);
                     //monitor the fd to get callback when app is ready to receive data
                     btsock_thread_add_fd(pth, rs->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR, rs->id);
                     break;
                 case SENT_ALL:
-                    GKI_freebuf(p_buf);
                     ret = 1;//enable the data flow
                     break;
                 case SENT_FAILED:
-                    GKI_freebuf(p_buf);
                     cleanup_rfc_slot(rs);
                     break;
             }
@@ -1165,4 +1180,41 @@ int bta_co_rfc_data_outgoing(void *user_data, UINT8* buf, UINT16 size)
     unlock_slot(&slot_lock);
     return ret;
 }
+int bta_co_rfc_data_outgoing_segs(void *user_data, tPORT_DATA_SEG *p_segs, UINT16 num_segs)
+{
+    uint32_t id = (uint32_t)user_data;
+    int ret = FALSE;
+    lock_slot(&slot_lock);
+    rfc_slot_t* rs = find_rfc_slot_by_id(id);
+    if(rs)
+    {
+        //read straight into the stack's buffers, one recvmsg() for all of them
+        struct iovec iov[PORT_TX_CO_MAX_SEGS];
+        struct msghdr msg;
+        int i, size = 0;
+        if(num_segs > PORT_TX_CO_MAX_SEGS)
+            num_segs = 0;
+        for(i = 0; i < num_segs; i++)
+        {
+            iov[i].iov_base = p_segs[i].p_data;
+            iov[i].iov_len = p_segs[i].len;
+            size += p_segs[i].len;
+        }
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = num_segs;
+        int received = num_segs ? recvmsg(rs->fd, &msg, 0) : -1;
+        if(received == size)
+            ret = TRUE;
+        else
+        {
+            APPL_TRACE_ERROR5("recvmsg error, errno:%d, fd:%d, buffers:%d, size:%d, received:%d",
+                             errno, rs->fd, num_segs, size, received);
+            cleanup_rfc_slot(rs);
+        }
+    }
+    else APPL_TRACE_ERROR1("bta_co_rfc_data_outgoing_segs, invalid slot id:%d", id);
+    unlock_slot(&slot_lock);
+    return ret;
+}
 
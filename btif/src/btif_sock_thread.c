@@ -44,8 +44,7 @@
 #include <pthread.h>
 #include <ctype.h>
 
-#include <sys/select.h>
-#include <sys/poll.h>
+#include <sys/epoll.h>
 #include <cutils/sockets.h>
 #include <alloca.h>
 
@@ -64,51 +63,77 @@
 #define asrt(s) if(!(s)) APPL_TRACE_ERROR3("## %s assert %s failed at line:%d ##",__FUNCTION__, #s, __LINE__)
 #define print_events(events) do { \
     APPL_TRACE_DEBUG1("print poll event:%x", events); \
-    if (events & POLLIN) APPL_TRACE_DEBUG0(  "   POLLIN "); \
-    if (events & POLLPRI) APPL_TRACE_DEBUG0( "   POLLPRI "); \
-    if (events & POLLOUT) APPL_TRACE_DEBUG0( "   POLLOUT "); \
-    if (events & POLLERR) APPL_TRACE_DEBUG0( "   POLLERR "); \
-    if (events & POLLHUP) APPL_TRACE_DEBUG0( "   POLLHUP "); \
-    if (events & POLLNVAL) APPL_TRACE_DEBUG0("   POLLNVAL "); \
-    if (events & POLLRDHUP) APPL_TRACE_DEBUG0("   POLLRDHUP"); \
+    if (events & EPOLLIN) APPL_TRACE_DEBUG0(  "   EPOLLIN "); \
+    if (events & EPOLLPRI) APPL_TRACE_DEBUG0( "   EPOLLPRI "); \
+    if (events & EPOLLOUT) APPL_TRACE_DEBUG0( "   EPOLLOUT "); \
+    if (events & EPOLLERR) APPL_TRACE_DEBUG0( "   EPOLLERR "); \
+    if (events & EPOLLHUP) APPL_TRACE_DEBUG0( "   EPOLLHUP "); \
+    if (events & EPOLLRDHUP) APPL_TRACE_DEBUG0("   EPOLLRDHUP"); \
     } while(0)
 
 #define MAX_THREAD 8
-#define MAX_POLL 64
-#define POLL_EXCEPTION_EVENTS (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL)
+#define MAX_POLL 64     //fds per poll thread
+#define POLL_HASH_SIZE 64 //power of 2
+/* Poll threads behind each thread handle. The fds are spread over them by fd
+ * number, so the callback of a handle may then run in several threads at once
+ * and must take its own lock, as the RFCOMM and L2CAP socket callbacks do. */
+#ifndef BTSOCK_POLL_SHARDS
+#define BTSOCK_POLL_SHARDS 1
+#endif
+#define POLL_EXCEPTION_EVENTS (EPOLLHUP | EPOLLRDHUP | EPOLLERR)
 #define IS_EXCEPTION(e) ((e) & POLL_EXCEPTION_EVENTS)
-#define IS_READ(e) ((e) & POLLIN)
-#define IS_WRITE(e) ((e) & POLLOUT)
+#define IS_READ(e) ((e) & EPOLLIN)
+#define IS_WRITE(e) ((e) & EPOLLOUT)
 /*cmd executes in socket poll thread */
 #define CMD_WAKEUP       1
 #define CMD_EXIT         2
 #define CMD_ADD_FD       3
 #define CMD_USER_PRIVATE 4
 
+/* epoll user data of an fd: its fd number and slot index + 1, 0 for the cmd fd */
+#define POLL_DATA(fd, i) (((uint64_t)(uint32_t)(fd) << 32) | (uint32_t)((i) + 1))
+#define POLL_DATA_FD(d) ((int)((d) >> 32))
+#define POLL_DATA_SLOT(d) ((int)((d) & 0xffffffff) - 1)
+
 typedef struct {
-    struct pollfd pfd;
+    int fd;
     uint32_t user_id;
     int type;
     int flags;
+    int next;   //next slot of the same fd hash bucket, or of the free list
 } poll_slot_t;
 typedef struct {
+    int h;
+    int epfd;
     int cmd_fdr, cmd_fdw;
     int poll_count;
     poll_slot_t ps[MAX_POLL];
-    int psi[MAX_POLL]; //index of poll slot
-    volatile pid_t thread_id;
+    int hash[POLL_HASH_SIZE]; //first slot of each fd hash bucket
+    int free_slot;
+    volatile pthread_t thread_id;
+} poll_shard_t;
+typedef struct {
+    poll_shard_t shard[BTSOCK_POLL_SHARDS];
     btsock_signaled_cb callback;
     btsock_cmd_cb cmd_callback;
     int used;
 } thread_slot_t;
 static thread_slot_t ts[MAX_THREAD];
+typedef struct
+{
+    int id;
+    int fd;
+    int type;
+    int flags;
+    uint32_t user_id;
+} sock_cmd_t;
 
 
 
 static void *sock_poll_thread(void *arg);
-static inline void close_cmd_fd(int h);
+static inline void close_cmd_fd(poll_shard_t* sh);
 
-static inline void add_poll(int h, int fd, int type, int flags, uint32_t user_id);
+static inline void add_poll(poll_shard_t* sh, int fd, int type, int flags, uint32_t user_id);
 
 static pthread_mutex_t thread_slot_lock;
 
@@ -175,7 +200,8 @@ static inline pthread_t create_thread(void *(*start_routine)(void *), void * arg
     }
     return thread_id;
 }
-static void init_poll(int cmd_fd);
+static int init_poll(int h);
+static void exit_poll(int h);
 static int alloc_thread_slot()
 {
     int i;
@@ -196,7 +222,7 @@ static void free_thread_slot(int h)
 {
     if(0 <= h && h < MAX_THREAD)
     {
-        close_cmd_fd(h);
+        exit_poll(h);
         ts[h].used = 0;
     }
     else APPL_TRACE_ERROR1("invalid thread handle:%d", h);
@@ -209,13 +235,18 @@ int btsock_thread_init()
     {
         initialized = 1;
         init_slot_lock(&thread_slot_lock);
-        int h;
+        int h, i;
         for(h = 0; h < MAX_THREAD; h++)
         {
-            ts[h].cmd_fdr = ts[h].cmd_fdw = -1;
+            for(i = 0; i < BTSOCK_POLL_SHARDS; i++)
+            {
+                ts[h].shard[i].h = h;
+                ts[h].shard[i].epfd = -1;
+                ts[h].shard[i].cmd_fdr = ts[h].shard[i].cmd_fdw = -1;
+                ts[h].shard[i].thread_id = -1;
+                ts[h].shard[i].poll_count = 0;
+            }
             ts[h].used = 0;
-            ts[h].thread_id = -1;
-            ts[h].poll_count = 0;
             ts[h].callback = NULL;
             ts[h].cmd_callback = NULL;
         }
@@ -232,56 +263,81 @@ int btsock_thread_create(btsock_signaled_cb callback, btsock_cmd_cb cmd_callback
     APPL_TRACE_DEBUG1("alloc_thread_slot ret:%d", h);
     if(h >= 0)
     {
-        init_poll(h);
-        if((ts[h].thread_id = create_thread(sock_poll_thread, (void*)h)) != -1)
+        int i;
+        if(!init_poll(h))
         {
-            APPL_TRACE_DEBUG2("h:%d, thread id:%d", h, ts[h].thread_id);
-            ts[h].callback = callback;
-            ts[h].cmd_callback = cmd_callback;
+            lock_slot(&thread_slot_lock);
+            free_thread_slot(h);
+            unlock_slot(&thread_slot_lock);
+            return -1;
         }
-        else
+        ts[h].callback = callback;
+        ts[h].cmd_callback = cmd_callback;
+        for(i = 0; i < BTSOCK_POLL_SHARDS; i++)
         {
+            poll_shard_t* sh = &ts[h].shard[i];
+            if((sh->thread_id = create_thread(sock_poll_thread, (void*)sh)) == -1)
+                break;
+            APPL_TRACE_DEBUG3("h:%d, shard:%d, thread id:%d", h, i, sh->thread_id);
+        }
+        if(i < BTSOCK_POLL_SHARDS)
+        {
+            //stop the threads already running
+            sock_cmd_t cmd = {CMD_EXIT, 0, 0, 0, 0};
+            while(--i >= 0)
+            {
+                pthread_t thread_id = ts[h].shard[i].thread_id;
+                if(send(ts[h].shard[i].cmd_fdw, &cmd, sizeof(cmd), 0) == sizeof(cmd))
+                    pthread_join(thread_id, 0);
+            }
+            lock_slot(&thread_slot_lock);
             free_thread_slot(h);
+            unlock_slot(&thread_slot_lock);
             h = -1;
         }
     }
     return h;
 }
 
-/* create dummy socket pair used to wake up select loop */
-static inline void init_cmd_fd(int h)
+static inline poll_shard_t* fd_shard(int h, int fd)
 {
-    asrt(ts[h].cmd_fdr == -1 && ts[h].cmd_fdw == -1);
-    if(socketpair(AF_UNIX, SOCK_STREAM, 0, &ts[h].cmd_fdr) < 0)
+    return &ts[h].shard[(unsigned int)fd % BTSOCK_POLL_SHARDS];
+}
+/* create dummy socket pair used to wake up the epoll loop */
+static inline int init_cmd_fd(poll_shard_t* sh)
+{
+    struct epoll_event ev;
+    asrt(sh->cmd_fdr == -1 && sh->cmd_fdw == -1);
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, &sh->cmd_fdr) < 0)
     {
         APPL_TRACE_ERROR1("socketpair failed: %s", strerror(errno));
-        return;
+        return FALSE;
+    }
+    APPL_TRACE_DEBUG3("h:%d, cmd_fdr:%d, cmd_fdw:%d", sh->h, sh->cmd_fdr, sh->cmd_fdw);
+    //the cmd fd stays level triggered, one cmd is read per wake up
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = 0;
+    if(epoll_ctl(sh->epfd, EPOLL_CTL_ADD, sh->cmd_fdr, &ev) < 0)
+    {
+        APPL_TRACE_ERROR1("epoll_ctl add cmd fd failed: %s", strerror(errno));
+        return FALSE;
     }
-    APPL_TRACE_DEBUG3("h:%d, cmd_fdr:%d, cmd_fdw:%d", h, ts[h].cmd_fdr, ts[h].cmd_fdw);
-    //add the cmd fd for read & write
-    add_poll(h, ts[h].cmd_fdr, 0, SOCK_THREAD_FD_RD, 0);
+    return TRUE;
 }
-static inline void close_cmd_fd(int h)
+static inline void close_cmd_fd(poll_shard_t* sh)
 {
-    if(ts[h].cmd_fdr != -1)
+    if(sh->cmd_fdr != -1)
     {
-        close(ts[h].cmd_fdr);
-        ts[h].cmd_fdr = -1;
+        close(sh->cmd_fdr);
+        sh->cmd_fdr = -1;
     }
-    if(ts[h].cmd_fdw != -1)
+    if(sh->cmd_fdw != -1)
     {
-        close(ts[h].cmd_fdw);
-        ts[h].cmd_fdw = -1;
+        close(sh->cmd_fdw);
+        sh->cmd_fdw = -1;
     }
 }
-typedef struct
-{
-    int id;
-    int fd;
-    int type;
-    int flags;
-    uint32_t user_id;
-} sock_cmd_t;
 int btsock_thread_add_fd(int h, int fd, int type, int flags, uint32_t user_id)
 {
     if(h < 0 || h >= MAX_THREAD)
@@ -289,26 +345,27 @@ int btsock_thread_add_fd(int h, int fd, int type, int flags, uint32_t user_id)
         APPL_TRACE_ERROR1("invalid bt thread handle:%d", h);
         return FALSE;
     }
-    if(ts[h].cmd_fdw == -1)
+    poll_shard_t* sh = fd_shard(h, fd);
+    if(sh->cmd_fdw == -1)
     {
         APPL_TRACE_ERROR0("cmd socket is not created. socket thread may not initialized");
         return FALSE;
     }
     if(flags & SOCK_THREAD_ADD_FD_SYNC)
     {
-        //must executed in socket poll thread
-        if(ts[h].thread_id == pthread_self())
+        //must executed in the poll thread of the fd
+        if(sh->thread_id == pthread_self())
         {
             //cleanup one-time flags
             flags &= ~SOCK_THREAD_ADD_FD_SYNC;
-            add_poll(h, fd, type, flags, user_id);
+            add_poll(sh, fd, type, flags, user_id);
             return TRUE;
         }
         APPL_TRACE_DEBUG0("THREAD_ADD_FD_SYNC is not called in poll thread, fallback to async");
     }
     sock_cmd_t cmd = {CMD_ADD_FD, fd, type, flags, user_id};
     APPL_TRACE_DEBUG2("adding fd:%d, flags:0x%x", fd, flags);
-    return send(ts[h].cmd_fdw, &cmd, sizeof(cmd), 0) == sizeof(cmd);
+    return send(sh->cmd_fdw, &cmd, sizeof(cmd), 0) == sizeof(cmd);
 }
 int btsock_thread_post_cmd(int h, int type, const unsigned char* data, int size, uint32_t user_id)
 {
@@ -317,7 +374,8 @@ int btsock_thread_post_cmd(int h, int type, const unsigned char* data, int size,
         APPL_TRACE_ERROR1("invalid bt thread handle:%d", h);
         return FALSE;
     }
-    if(ts[h].cmd_fdw == -1)
+    //user commands always run in the first poll thread
+    if(ts[h].shard[0].cmd_fdw == -1)
     {
         APPL_TRACE_ERROR0("cmd socket is not created. socket thread may not initialized");
         return FALSE;
@@ -341,7 +399,7 @@ int btsock_thread_post_cmd(int h, int type, const unsigned char* data, int size,
             return FALSE;
         }
     }
-    return send(ts[h].cmd_fdw, cmd_send, size_send, 0) == size_send;
+    return send(ts[h].shard[0].cmd_fdw, cmd_send, size_send, 0) == size_send;
 }
 int btsock_thread_wakeup(int h)
 {
@@ -350,122 +408,223 @@ int btsock_thread_wakeup(int h)
         APPL_TRACE_ERROR1("invalid bt thread handle:%d", h);
         return FALSE;
     }
-    if(ts[h].cmd_fdw == -1)
+    if(ts[h].shard[0].cmd_fdw == -1)
     {
         APPL_TRACE_ERROR1("thread handle:%d, cmd socket is not created", h);
         return FALSE;
     }
     sock_cmd_t cmd = {CMD_WAKEUP, 0, 0, 0, 0};
-    return send(ts[h].cmd_fdw, &cmd, sizeof(cmd), 0) == sizeof(cmd);
+    return send(ts[h].shard[0].cmd_fdw, &cmd, sizeof(cmd), 0) == sizeof(cmd);
 }
 int btsock_thread_exit(int h)
 {
+    int i, sent = 0;
     if(h < 0 || h >= MAX_THREAD)
     {
         APPL_TRACE_ERROR1("invalid bt thread handle:%d", h);
         return FALSE;
     }
-    if(ts[h].cmd_fdw == -1)
+    if(ts[h].shard[0].cmd_fdw == -1)
     {
         APPL_TRACE_ERROR0("cmd socket is not created");
         return FALSE;
     }
     sock_cmd_t cmd = {CMD_EXIT, 0, 0, 0, 0};
-    if(send(ts[h].cmd_fdw, &cmd, sizeof(cmd), 0) == sizeof(cmd))
+    for(i = 0; i < BTSOCK_POLL_SHARDS; i++)
     {
-        pthread_join(ts[h].thread_id, 0);
-        lock_slot(&thread_slot_lock);
-        free_thread_slot(h);
-        unlock_slot(&thread_slot_lock);
-        return TRUE;
+        //the thread clears its id when it exits
+        pthread_t thread_id = ts[h].shard[i].thread_id;
+        if(send(ts[h].shard[i].cmd_fdw, &cmd, sizeof(cmd), 0) == sizeof(cmd))
+        {
+            pthread_join(thread_id, 0);
+            sent++;
+        }
     }
-    return FALSE;
+    if(sent == 0)
+        return FALSE;
+    lock_slot(&thread_slot_lock);
+    free_thread_slot(h);
+    unlock_slot(&thread_slot_lock);
+    return TRUE;
 }
-static void init_poll(int h)
+static int init_poll(int h)
 {
-    int i;
-    ts[h].poll_count = 0;
-    ts[h].thread_id = -1;
+    int i, j;
     ts[h].callback = NULL;
     ts[h].cmd_callback = NULL;
-    for(i = 0; i < MAX_POLL; i++)
+    for(i = 0; i < BTSOCK_POLL_SHARDS; i++)
     {
-        ts[h].ps[i].pfd.fd = -1;
-        ts[h].psi[i] = -1;
+        poll_shard_t* sh = &ts[h].shard[i];
+        sh->h = h;
+        sh->poll_count = 0;
+        sh->thread_id = -1;
+        for(j = 0; j < MAX_POLL; j++)
+        {
+            sh->ps[j].fd = -1;
+            sh->ps[j].next = j + 1 < MAX_POLL ? j + 1 : -1;
+        }
+        sh->free_slot = 0;
+        for(j = 0; j < POLL_HASH_SIZE; j++)
+            sh->hash[j] = -1;
+        if((sh->epfd = epoll_create(MAX_POLL)) < 0)
+        {
+            APPL_TRACE_ERROR1("epoll_create failed: %s", strerror(errno));
+            return FALSE;
+        }
+        if(!init_cmd_fd(sh))
+            return FALSE;
+    }
+    return TRUE;
+}
+static void exit_poll(int h)
+{
+    int i;
+    for(i = 0; i < BTSOCK_POLL_SHARDS; i++)
+    {
+        poll_shard_t* sh = &ts[h].shard[i];
+        close_cmd_fd(sh);
+        if(sh->epfd != -1)
+        {
+            close(sh->epfd);
+            sh->epfd = -1;
+        }
+        sh->thread_id = -1;
     }
-    init_cmd_fd(h);
 }
 static inline unsigned int flags2pevents(int flags)
 {
-    unsigned int pevents = 0;
+    //one shot: the caller adds the fd again once it has handled the event
+    unsigned int pevents = EPOLLET | EPOLLONESHOT;
     if(flags & SOCK_THREAD_FD_WR)
-        pevents |= POLLOUT;
+        pevents |= EPOLLOUT;
     if(flags & SOCK_THREAD_FD_RD)
-        pevents |= POLLIN;
+        pevents |= EPOLLIN;
     pevents |= POLL_EXCEPTION_EVENTS;
     return pevents;
 }
-
+static inline int fd_hash(int fd)
+{
+    return (unsigned int)fd & (POLL_HASH_SIZE - 1);
+}
+static inline int find_poll(poll_shard_t* sh, int fd)
+{
+    int i;
+    for(i = sh->hash[fd_hash(fd)]; i >= 0; i = sh->ps[i].next)
+    {
+        if(sh->ps[i].fd == fd)
+            return i;
+    }
+    return -1;
+}
+static inline void free_poll(poll_shard_t* sh, int i)
+{
+    int* pi = &sh->hash[fd_hash(sh->ps[i].fd)];
+    while(*pi >= 0 && *pi != i)
+        pi = &sh->ps[*pi].next;
+    if(*pi == i)
+        *pi = sh->ps[i].next;
+    memset(&sh->ps[i], 0, sizeof(sh->ps[i]));
+    sh->ps[i].fd = -1;
+    sh->ps[i].next = sh->free_slot;
+    sh->free_slot = i;
+    --sh->poll_count;
+}
+/* An fd closed while it is watched leaves epoll silently, free its slot */
+static void gc_poll(poll_shard_t* sh)
+{
+    struct epoll_event ev;
+    int i;
+    for(i = 0; i < MAX_POLL; i++)
+    {
+        if(sh->ps[i].fd == -1)
+            continue;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = sh->ps[i].flags ? flags2pevents(sh->ps[i].flags) : EPOLLET | EPOLLONESHOT;
+        ev.data.u64 = POLL_DATA(sh->ps[i].fd, i);
+        if(epoll_ctl(sh->epfd, EPOLL_CTL_MOD, sh->ps[i].fd, &ev) < 0 && (errno == ENOENT || errno == EBADF))
+        {
+            APPL_TRACE_DEBUG1("fd:%d was closed while watched, slot freed", sh->ps[i].fd);
+            free_poll(sh, i);
+        }
+    }
+}
+static inline int arm_poll(poll_shard_t* sh, int i, int op)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = flags2pevents(sh->ps[i].flags);
+    ev.data.u64 = POLL_DATA(sh->ps[i].fd, i);
+    return epoll_ctl(sh->epfd, op, sh->ps[i].fd, &ev);
+}
 static inline void set_poll(poll_slot_t* ps, int fd, int type, int flags, uint32_t user_id)
 {
-    ps->pfd.fd = fd;
+    ps->fd = fd;
     ps->user_id = user_id;
     if(ps->type != 0 && ps->type != type)
         APPL_TRACE_ERROR2("poll socket type should not changed! type was:%d, type now:%d", ps->type, type);
     ps->type = type;
     ps->flags = flags;
-    ps->pfd.events = flags2pevents(flags);
-    ps->pfd.revents = 0;
 }
-static inline void add_poll(int h, int fd, int type, int flags, uint32_t user_id)
+static inline void add_poll(poll_shard_t* sh, int fd, int type, int flags, uint32_t user_id)
 {
     asrt(fd != -1);
-    int i;
-    int empty = -1;
-    poll_slot_t* ps = ts[h].ps;
+    int i = find_poll(sh, fd);
 
-    for(i = 0; i < MAX_POLL; i++)
+    if(i >= 0)
     {
-        if(ps[i].pfd.fd == fd)
-        {
-            asrt(ts[h].poll_count < MAX_POLL);
-
-            set_poll(&ps[i], fd, type, flags | ps[i].flags, user_id);
+        set_poll(&sh->ps[i], fd, type, flags | sh->ps[i].flags, user_id);
+        if(arm_poll(sh, i, EPOLL_CTL_MOD) == 0)
             return;
+        //the fd was closed and its number reused, the slot is of the old fd
+        APPL_TRACE_DEBUG2("fd:%d, new fd in an old slot, errno:%d", fd, errno);
+        sh->ps[i].flags = flags;
+        if(arm_poll(sh, i, EPOLL_CTL_ADD) < 0)
+        {
+            APPL_TRACE_ERROR2("epoll_ctl add fd:%d failed: %s", fd, strerror(errno));
+            free_poll(sh, i);
         }
-        else if(empty < 0 && ps[i].pfd.fd == -1)
-            empty = i;
+        return;
     }
-    if(empty >= 0)
+    if(sh->free_slot < 0)
+        gc_poll(sh);
+    if((i = sh->free_slot) >= 0)
     {
-        asrt(ts[h].poll_count < MAX_POLL);
-        set_poll(&ps[empty], fd, type, flags, user_id);
-        ++ts[h].poll_count;
+        asrt(sh->poll_count < MAX_POLL);
+        sh->free_slot = sh->ps[i].next;
+        set_poll(&sh->ps[i], fd, type, flags, user_id);
+        sh->ps[i].next = sh->hash[fd_hash(fd)];
+        sh->hash[fd_hash(fd)] = i;
+        ++sh->poll_count;
+        if(arm_poll(sh, i, EPOLL_CTL_ADD) < 0)
+        {
+            APPL_TRACE_ERROR2("epoll_ctl add fd:%d failed: %s", fd, strerror(errno));
+            free_poll(sh, i);
+        }
         return;
     }
     APPL_TRACE_ERROR1("exceeded max poll slot:%d!", MAX_POLL);
 }
-static inline void remove_poll(int h, poll_slot_t* ps, int flags)
+static inline void remove_poll(poll_shard_t* sh, int i, int flags)
 {
+    poll_slot_t* ps = &sh->ps[i];
     if(flags == ps->flags)
     {
         //all monitored events signaled. To remove it, just clear the slot
-        --ts[h].poll_count;
-        memset(ps, 0, sizeof(*ps));
-        ps->pfd.fd = -1;
+        epoll_ctl(sh->epfd, EPOLL_CTL_DEL, ps->fd, NULL);
+        free_poll(sh, i);
     }
     else
     {
         //one read or one write monitor event signaled, removed the accordding bit
         ps->flags &= ~flags;
-        //update the poll events mask
-        ps->pfd.events = flags2pevents(ps->flags);
+        //the one shot event disarmed the fd, arm it for the other events
+        arm_poll(sh, i, EPOLL_CTL_MOD);
     }
 }
-static int process_cmd_sock(int h)
+static int process_cmd_sock(poll_shard_t* sh)
 {
     sock_cmd_t cmd = {-1, 0, 0, 0, 0};
-    int fd = ts[h].cmd_fdr;
+    int fd = sh->cmd_fdr;
     if(recv(fd, &cmd, sizeof(cmd), MSG_WAITALL) != sizeof(cmd))
     {
         APPL_TRACE_ERROR1("recv cmd errno:%d", errno);
@@ -475,14 +634,14 @@ static int process_cmd_sock(int h)
     switch(cmd.id)
     {
         case CMD_ADD_FD:
-            add_poll(h, cmd.fd, cmd.type, cmd.flags, cmd.user_id);
+            add_poll(sh, cmd.fd, cmd.type, cmd.flags, cmd.user_id);
             break;
         case CMD_WAKEUP:
             break;
         case CMD_USER_PRIVATE:
-            asrt(ts[h].cmd_callback);
-            if(ts[h].cmd_callback)
-                ts[h].cmd_callback(fd, cmd.type, cmd.flags, cmd.user_id);
+            asrt(ts[sh->h].cmd_callback);
+            if(ts[sh->h].cmd_callback)
+                ts[sh->h].cmd_callback(fd, cmd.type, cmd.flags, cmd.user_id);
             break;
         case CMD_EXIT:
             return FALSE;
@@ -492,105 +651,76 @@ static int process_cmd_sock(int h)
     }
     return TRUE;
 }
-static void process_data_sock(int h, struct pollfd *pfds, int count)
+static void process_data_sock(poll_shard_t* sh, uint64_t data, uint32_t events)
 {
-    asrt(count <= ts[h].poll_count);
-    int i;
-    for( i= 1; i < ts[h].poll_count; i++)
+    int ps_i = POLL_DATA_SLOT(data);
+    int fd = POLL_DATA_FD(data);
+    if(ps_i < 0 || ps_i >= MAX_POLL || sh->ps[ps_i].fd != fd)
     {
-        if(pfds[i].revents)
-        {
-            int ps_i = ts[h].psi[i];
-            asrt(pfds[i].fd == ts[h].ps[ps_i].pfd.fd);
-            uint32_t user_id = ts[h].ps[ps_i].user_id;
-            int type = ts[h].ps[ps_i].type;
-            int flags = 0;
-            print_events(pfds[i].revents);
-            if(IS_READ(pfds[i].revents))
-            {
-                flags |= SOCK_THREAD_FD_RD;
-            }
-            if(IS_WRITE(pfds[i].revents))
-            {
-                flags |= SOCK_THREAD_FD_WR;
-            }
-            if(IS_EXCEPTION(pfds[i].revents))
-            {
-                flags |= SOCK_THREAD_FD_EXCEPTION;
-                //remove the whole slot not flags
-                remove_poll(h, &ts[h].ps[ps_i], ts[h].ps[ps_i].flags);
-            }
-            else if(flags)
-                 remove_poll(h, &ts[h].ps[ps_i], flags); //remove the monitor flags that already processed
-            if(flags)
-                ts[h].callback(pfds[i].fd, type, flags, user_id);
-        }
+        //the slot was freed by an earlier event of this wake up
+        APPL_TRACE_DEBUG1("stale event of fd:%d", fd);
+        return;
     }
-}
-
-static void prepare_poll_fds(int h, struct pollfd* pfds)
-{
-    int count = 0;
-    int ps_i = 0;
-    int pfd_i = 0;
-    asrt(ts[h].poll_count <= MAX_POLL);
-    memset(pfds, 0, sizeof(pfds[0])*ts[h].poll_count);
-    while(count < ts[h].poll_count)
-    {
-        if(ps_i >= MAX_POLL)
-        {
-            APPL_TRACE_ERROR4("exceed max poll range, ps_i:%d, MAX_POLL:%d, count:%d, ts[h].poll_count:%d",
-                    ps_i, MAX_POLL, count, ts[h].poll_count);
-            return;
-        }
-        if(ts[h].ps[ps_i].pfd.fd >= 0)
-        {
-            pfds[pfd_i] =  ts[h].ps[ps_i].pfd;
-            ts[h].psi[pfd_i] = ps_i;
-            count++;
-            pfd_i++;
-        }
-        ps_i++;
+    uint32_t user_id = sh->ps[ps_i].user_id;
+    int type = sh->ps[ps_i].type;
+    int flags = 0;
+    print_events(events);
+    if(IS_READ(events))
+    {
+        flags |= SOCK_THREAD_FD_RD;
     }
+    if(IS_WRITE(events))
+    {
+        flags |= SOCK_THREAD_FD_WR;
+    }
+    if(IS_EXCEPTION(events))
+    {
+        flags |= SOCK_THREAD_FD_EXCEPTION;
+        //remove the whole slot not flags
+        remove_poll(sh, ps_i, sh->ps[ps_i].flags);
+    }
+    else if(flags)
+         remove_poll(sh, ps_i, flags); //remove the monitor flags that already processed
+    if(flags)
+        ts[sh->h].callback(fd, type, flags, user_id);
 }
+
 static void *sock_poll_thread(void *arg)
 {
-    struct pollfd pfds[MAX_POLL];
-    memset(pfds, 0, sizeof(pfds));
-    int h = (int)arg;
+    struct epoll_event events[MAX_POLL];
+    poll_shard_t* sh = (poll_shard_t*)arg;
+    int h = sh->h;
 
     prctl(PR_SET_NAME, (unsigned long)"btif_sock_poll", 0, 0, 0);
     for(;;)
     {
-        prepare_poll_fds(h, pfds);
-        int ret = poll(pfds, ts[h].poll_count, -1);
+        int ret = epoll_wait(sh->epfd, events, MAX_POLL, -1);
         if(ret == -1)
         {
-            APPL_TRACE_ERROR2("poll ret -1, exit the thread, errno:%d, err:%s", errno, strerror(errno));
+            if(errno == EINTR)
+                continue;
+            APPL_TRACE_ERROR2("epoll_wait ret -1, exit the thread, errno:%d, err:%s", errno, strerror(errno));
             break;
         }
-        if(ret != 0)
+        int i, exit = FALSE;
+        for(i = 0; i < ret; i++)
         {
-            int need_process_data_fd = TRUE;
-            if(pfds[0].revents) //cmd fd always is the first one
+            //each event carries its slot, no scan of the watched fds
+            if(events[i].data.u64 == 0)
             {
-                asrt(pfds[0].fd == ts[h].cmd_fdr);
-                if(!process_cmd_sock(h))
+                if(!process_cmd_sock(sh))
                 {
                     APPL_TRACE_DEBUG1("h:%d, process_cmd_sock return false, exit...", h);
+                    exit = TRUE;
                     break;
                 }
-                if(ret == 1)
-                    need_process_data_fd = FALSE;
-                else ret--; //exclude the cmd fd
             }
-            if(need_process_data_fd)
-                process_data_sock(h, pfds, ret);
+            else process_data_sock(sh, events[i].data.u64, events[i].events);
         }
-        else {APPL_TRACE_DEBUG1("no data, select ret: %d", ret)};
+        if(exit)
+            break;
     }
-    ts[h].thread_id = -1;
+    sh->thread_id = -1;
     APPL_TRACE_DEBUG1("socket poll thread exiting, h:%d", h);
     return 0;
 }
-
@@ -163,7 +163,7 @@
 typedef struct
 {
     uint32_t num_devices;
-    bt_bdaddr_t devices[BTM_SEC_MAX_DEVICE_RECORDS];
+    bt_bdaddr_t devices[BTM_SEC_MAX_DEVICE_RECORDS_TOTAL];
 } btif_bonded_devices_t;
 
 /************************************************************************************
@@ -177,6 +177,7 @@ extern bt_bdaddr_t btif_local_bd_addr;
 ************************************************************************************/
 
 extern void btif_gatts_add_bonded_dev_from_nv(BD_ADDR bda);
+extern void bta_gattc_co_cache_remove(BD_ADDR server_bda);
 
 /************************************************************************************
 **  Internal Functions
@@ -849,6 +850,11 @@ bt_status_t btif_storage_remove_bonded_device(bt_bdaddr_t *remote_bd_addr)
         ret &= btif_config_remove("Remote", bdstr, "PinLength");
     if(btif_config_exist("Remote", bdstr, "LinkKey"))
         ret &= btif_config_remove("Remote", bdstr, "LinkKey");
+#if (defined(BLE_INCLUDED) && (BLE_INCLUDED == TRUE)) && \
+    (defined(BTA_GATT_INCLUDED) && (BTA_GATT_INCLUDED == TRUE))
+    /* the GATT cache is only kept for bonded servers */
+    bta_gattc_co_cache_remove(remote_bd_addr->address);
+#endif
     /* write bonded info immediately */
     btif_config_flush();
     return ret ? BT_STATUS_SUCCESS : BT_STATUS_FAIL;
@@ -53,5 +53,41 @@ extern void EncQuantizer(SBC_ENC_PARAMS *);
 #if (SBC_DSP_OPT==TRUE)
     SINT32 SBC_Multiply_32_16_Simplified(SINT32 s32In2Temp,SINT32 s32In1Temp);
 #endif
+
+#if (SBC_SIMD_OPT == TRUE)
+/* SIMD instruction sets the analysis kernels can run on */
+#define SBC_SIMD_NONE   0
+#define SBC_SIMD_SSE2   1
+#define SBC_SIMD_AVX2   2
+#define SBC_SIMD_NEON   3
+
+/* number of (block, channel) items of one frame; stride of the SIMD matrixing output */
+#define SBC_SIMD_ITEMS  (SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS)
+
+/* Analysis kernels. The windowing writes the 2*numOfSubBands partial sums of one item
+** to a row of 16 ints, the matrixing reads SBC_SIMD_ITEMS such rows and writes the
+** subband samples transposed (out[subband * SBC_SIMD_ITEMS + item]). Lanes are 32 bit
+** whatever the size of SINT32 is. */
+typedef struct
+{
+    UINT8   level;
+    void    (*window4)(const SINT16 *ps16X, int *ps32Y);
+    void    (*window8)(const SINT16 *ps16X, int *ps32Y);
+    void    (*idct4)(const int *ps32Y, int *ps32Out, SINT32 s32NumOfItems);
+    void    (*idct8)(const int *ps32Y, int *ps32Out, SINT32 s32NumOfItems);
+    UINT32  (*scale_factors)(const SINT32 *ps32SbBuffer, SINT32 s32NumOfCols,
+                             SINT32 s32NumOfBlocks, SINT16 *ps16ScaleFactor);
+} tSBC_ENC_SIMD;
+
+/* kernels in use, NULL when the C implementation is used */
+extern const tSBC_ENC_SIMD *sbc_enc_simd;
+
+/* window taps laid out tap major: gas16SimdWinX[tap * 2 * numOfSubBands + row] */
+extern const SINT16 gas16SimdWin4[];
+extern const SINT16 gas16SimdWin8[];
+
+extern void SbcEncSimdInit(void);
+extern BOOLEAN SbcEncSimdSelect(UINT8 u8Level);
+#endif
 #endif
 
@@ -132,10 +132,31 @@
 #endif
 
 /* TRUE -> application should provide PCM buffer, FALSE PCM buffer reside in SBC_ENC_PARAMS */
+/* With FALSE the application may still pass its own buffer in ps16PcmBuffer for a given call */
 #ifndef SBC_NO_PCM_CPY_OPTION
 #define SBC_NO_PCM_CPY_OPTION FALSE
 #endif
 
+/* Set SBC_SIMD_OPT to TRUE to run the windowing, matrixing and scale factor search on SSE2/AVX2 */
+/* or NEON when the CPU supports it. The kernels are bit-exact with the default C configuration */
+/* (SBC_IPAQ_OPT, 16 bit window coefficients, 16 bit IDCT coefficients, fast DCT) only. */
+#ifndef SBC_SIMD_OPT
+#define SBC_SIMD_OPT TRUE
+#endif
+
+/* Set SBC_SIMD_NEON_OPT to TRUE to also build the NEON kernels on ARM. They are off until */
+/* sbcenc_simd_test shows them bit-exact with the C encoder on the target; that test builds */
+/* them regardless. */
+#ifndef SBC_SIMD_NEON_OPT
+#define SBC_SIMD_NEON_OPT FALSE
+#endif
+
+#if (SBC_SIMD_OPT == TRUE) && ((SBC_IPAQ_OPT == FALSE) || (SBC_ARM_ASM_OPT == TRUE) || \
+    (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE) || (SBC_IS_64_MULT_IN_IDCT == TRUE) || (SBC_FAST_DCT == FALSE))
+#undef SBC_SIMD_OPT
+#define SBC_SIMD_OPT FALSE
+#endif
+
 #define MINIMUM_ENC_VX_BUFFER_SIZE (8*10*2)
 #ifndef ENC_VX_BUFFER_SIZE
 #define ENC_VX_BUFFER_SIZE (MINIMUM_ENC_VX_BUFFER_SIZE + 64)
@@ -171,9 +192,9 @@ typedef struct SBC_ENC_PARAMS_TAG
     SINT16 as16ScaleFactor[SBC_MAX_NUM_OF_CHANNELS*SBC_MAX_NUM_OF_SUBBANDS];
 
     SINT16 *ps16NextPcmBuffer;
-#if (SBC_NO_PCM_CPY_OPTION == TRUE)
-    SINT16 *ps16PcmBuffer;
-#else
+    SINT16 *ps16PcmBuffer;                          /* u8NumPacketToEncode frames of PCM provided by the
+                                                       application; if NULL as16PcmBuffer is encoded */
+#if (SBC_NO_PCM_CPY_OPTION == FALSE)
     SINT16 as16PcmBuffer[SBC_MAX_NUM_FRAME*SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS * SBC_MAX_NUM_OF_SUBBANDS];
 #endif
 
@@ -159,14 +159,72 @@
 static SINT32   s32DCTY[16]  = {0};
 static SINT32   s32X[ENC_VX_BUFFER_SIZE/2];
 static SINT16   *s16X=(SINT16*) s32X;      /* s16X must be 32 bits aligned cf  SHIFTUP_X8_2*/
+#if (SBC_SIMD_OPT == TRUE)
+static int      as32SimdY[SBC_SIMD_ITEMS * 2 * SBC_MAX_NUM_OF_SUBBANDS];    /* windowing output, one row per item */
+static int      as32SimdSb[SBC_MAX_NUM_OF_SUBBANDS * SBC_SIMD_ITEMS];       /* matrixing output, one row per subband */
+#endif
 #if (SBC_USE_ARM_PRAGMA==TRUE)
 #pragma arm section zidata
 #endif
 
+#if (SBC_SIMD_OPT == TRUE)
+/* Same taps as WINDOW_ACCU_4_x: row k weights s16X[ChOffset+k+8*tap], row 8-k is row k reversed */
+const SINT16 gas16SimdWin4[5 * 8] =
+{
+    0,                      WIND_4_SUBBANDS_1_0,    WIND_4_SUBBANDS_2_0,    WIND_4_SUBBANDS_3_0,
+    WIND_4_SUBBANDS_4_0,    WIND_4_SUBBANDS_3_4,    WIND_4_SUBBANDS_2_4,    WIND_4_SUBBANDS_1_4,
+
+    WIND_4_SUBBANDS_0_1,    WIND_4_SUBBANDS_1_1,    WIND_4_SUBBANDS_2_1,    WIND_4_SUBBANDS_3_1,
+    WIND_4_SUBBANDS_4_1,    WIND_4_SUBBANDS_3_3,    WIND_4_SUBBANDS_2_3,    WIND_4_SUBBANDS_1_3,
+
+    WIND_4_SUBBANDS_0_2,    WIND_4_SUBBANDS_1_2,    WIND_4_SUBBANDS_2_2,    WIND_4_SUBBANDS_3_2,
+    WIND_4_SUBBANDS_4_2,    WIND_4_SUBBANDS_3_2,    WIND_4_SUBBANDS_2_2,    WIND_4_SUBBANDS_1_2,
+
+    -WIND_4_SUBBANDS_0_2,   WIND_4_SUBBANDS_1_3,    WIND_4_SUBBANDS_2_3,    WIND_4_SUBBANDS_3_3,
+    WIND_4_SUBBANDS_4_1,    WIND_4_SUBBANDS_3_1,    WIND_4_SUBBANDS_2_1,    WIND_4_SUBBANDS_1_1,
+
+    -WIND_4_SUBBANDS_0_1,   WIND_4_SUBBANDS_1_4,    WIND_4_SUBBANDS_2_4,    WIND_4_SUBBANDS_3_4,
+    WIND_4_SUBBANDS_4_0,    WIND_4_SUBBANDS_3_0,    WIND_4_SUBBANDS_2_0,    WIND_4_SUBBANDS_1_0
+};
+
+/* Same taps as WINDOW_ACCU_8_x: row k weights s16X[ChOffset+k+16*tap], row 16-k is row k reversed */
+const SINT16 gas16SimdWin8[5 * 16] =
+{
+    0,                      WIND_8_SUBBANDS_1_0,    WIND_8_SUBBANDS_2_0,    WIND_8_SUBBANDS_3_0,
+    WIND_8_SUBBANDS_4_0,    WIND_8_SUBBANDS_5_0,    WIND_8_SUBBANDS_6_0,    WIND_8_SUBBANDS_7_0,
+    WIND_8_SUBBANDS_8_0,    WIND_8_SUBBANDS_7_4,    WIND_8_SUBBANDS_6_4,    WIND_8_SUBBANDS_5_4,
+    WIND_8_SUBBANDS_4_4,    WIND_8_SUBBANDS_3_4,    WIND_8_SUBBANDS_2_4,    WIND_8_SUBBANDS_1_4,
+
+    WIND_8_SUBBANDS_0_1,    WIND_8_SUBBANDS_1_1,    WIND_8_SUBBANDS_2_1,    WIND_8_SUBBANDS_3_1,
+    WIND_8_SUBBANDS_4_1,    WIND_8_SUBBANDS_5_1,    WIND_8_SUBBANDS_6_1,    WIND_8_SUBBANDS_7_1,
+    WIND_8_SUBBANDS_8_1,    WIND_8_SUBBANDS_7_3,    WIND_8_SUBBANDS_6_3,    WIND_8_SUBBANDS_5_3,
+    WIND_8_SUBBANDS_4_3,    WIND_8_SUBBANDS_3_3,    WIND_8_SUBBANDS_2_3,    WIND_8_SUBBANDS_1_3,
+
+    WIND_8_SUBBANDS_0_2,    WIND_8_SUBBANDS_1_2,    WIND_8_SUBBANDS_2_2,    WIND_8_SUBBANDS_3_2,
+    WIND_8_SUBBANDS_4_2,    WIND_8_SUBBANDS_5_2,    WIND_8_SUBBANDS_6_2,    WIND_8_SUBBANDS_7_2,
+    WIND_8_SUBBANDS_8_2,    WIND_8_SUBBANDS_7_2,    WIND_8_SUBBANDS_6_2,    WIND_8_SUBBANDS_5_2,
+    WIND_8_SUBBANDS_4_2,    WIND_8_SUBBANDS_3_2,    WIND_8_SUBBANDS_2_2,    WIND_8_SUBBANDS_1_2,
+
+    -WIND_8_SUBBANDS_0_2,   WIND_8_SUBBANDS_1_3,    WIND_8_SUBBANDS_2_3,    WIND_8_SUBBANDS_3_3,
+    WIND_8_SUBBANDS_4_3,    WIND_8_SUBBANDS_5_3,    WIND_8_SUBBANDS_6_3,    WIND_8_SUBBANDS_7_3,
+    WIND_8_SUBBANDS_8_1,    WIND_8_SUBBANDS_7_1,    WIND_8_SUBBANDS_6_1,    WIND_8_SUBBANDS_5_1,
+    WIND_8_SUBBANDS_4_1,    WIND_8_SUBBANDS_3_1,    WIND_8_SUBBANDS_2_1,    WIND_8_SUBBANDS_1_1,
+
+    -WIND_8_SUBBANDS_0_1,   WIND_8_SUBBANDS_1_4,    WIND_8_SUBBANDS_2_4,    WIND_8_SUBBANDS_3_4,
+    WIND_8_SUBBANDS_4_4,    WIND_8_SUBBANDS_5_4,    WIND_8_SUBBANDS_6_4,    WIND_8_SUBBANDS_7_4,
+    WIND_8_SUBBANDS_8_0,    WIND_8_SUBBANDS_7_0,    WIND_8_SUBBANDS_6_0,    WIND_8_SUBBANDS_5_0,
+    WIND_8_SUBBANDS_4_0,    WIND_8_SUBBANDS_3_0,    WIND_8_SUBBANDS_2_0,    WIND_8_SUBBANDS_1_0
+};
+#endif
+
+/* The SHIFTUP_X macros move two SINT16 samples per access: the pointer type must be */
+/* 32 bits wide even where SINT32 (long) is 64 bits. */
+typedef int SBC_X_PAIR;
+
 /* This macro is for 4 subbands */
 #define SHIFTUP_X4                                                               \
 {                                                                                   \
-    ps32X=(SINT32 *)(s16X+EncMaxShiftCounter+38);                                 \
+    ps32X=(SBC_X_PAIR *)(s16X+EncMaxShiftCounter+38);                                 \
     for (i=0;i<9;i++)                                                               \
     {                                                                               \
         *ps32X=*(ps32X-2-(ShiftCounter>>1));  ps32X--;                                 \
@@ -175,8 +233,8 @@ static SINT16   *s16X=(SINT16*) s32X;      /* s16X must be 32 bits aligned cf  S
 }
 #define SHIFTUP_X4_2                                                              \
 {                                                                                   \
-    ps32X=(SINT32 *)(s16X+EncMaxShiftCounter+38);                                   \
-    ps32X2=(SINT32 *)(s16X+(EncMaxShiftCounter<<1)+78);                             \
+    ps32X=(SBC_X_PAIR *)(s16X+EncMaxShiftCounter+38);                                   \
+    ps32X2=(SBC_X_PAIR *)(s16X+(EncMaxShiftCounter<<1)+78);                             \
     for (i=0;i<9;i++)                                                               \
     {                                                                               \
         *ps32X=*(ps32X-2-(ShiftCounter>>1));  *(ps32X2)=*(ps32X2-2-(ShiftCounter>>1)); ps32X--;  ps32X2--;                     \
@@ -187,7 +245,7 @@ static SINT16   *s16X=(SINT16*) s32X;      /* s16X must be 32 bits aligned cf  S
 /* This macro is for 8 subbands */
 #define SHIFTUP_X8                                                               \
 {                                                                                   \
-    ps32X=(SINT32 *)(s16X+EncMaxShiftCounter+78);                                 \
+    ps32X=(SBC_X_PAIR *)(s16X+EncMaxShiftCounter+78);                                 \
     for (i=0;i<9;i++)                                                               \
     {                                                                               \
         *ps32X=*(ps32X-4-(ShiftCounter>>1));  ps32X--;                                 \
@@ -198,8 +256,8 @@ static SINT16   *s16X=(SINT16*) s32X;      /* s16X must be 32 bits aligned cf  S
 }
 #define SHIFTUP_X8_2                                                               \
 {                                                                                   \
-    ps32X=(SINT32 *)(s16X+EncMaxShiftCounter+78);                                   \
-    ps32X2=(SINT32 *)(s16X+(EncMaxShiftCounter<<1)+158);                             \
+    ps32X=(SBC_X_PAIR *)(s16X+EncMaxShiftCounter+78);                                   \
+    ps32X2=(SBC_X_PAIR *)(s16X+(EncMaxShiftCounter<<1)+158);                             \
     for (i=0;i<9;i++)                                                               \
     {                                                                               \
         *ps32X=*(ps32X-4-(ShiftCounter>>1));  *(ps32X2)=*(ps32X2-4-(ShiftCounter>>1)); ps32X--;  ps32X2--;                     \
@@ -899,6 +957,31 @@ static SINT16   *s16X=(SINT16*) s32X;      /* s16X must be 32 bits aligned cf  S
 
 static SINT16 ShiftCounter=0;
 extern SINT16 EncMaxShiftCounter;
+
+#if (SBC_SIMD_OPT == TRUE)
+/****************************************************************************
+* SbcAnalysisSimdMatrix - runs the matrixing of all the windowed items of the
+* frame at once and stores the subband samples in the C layout
+*
+* RETURNS : N/A
+*/
+static void SbcAnalysisSimdMatrix(SINT32 *ps32SbBuf, SINT32 s32NumOfItems, SINT32 s32NumOfSubBands)
+{
+    SINT32 s32Item, s32Sb;
+
+    if (s32NumOfSubBands == SUB_BANDS_4)
+        sbc_enc_simd->idct4(as32SimdY, as32SimdSb, s32NumOfItems);
+    else
+        sbc_enc_simd->idct8(as32SimdY, as32SimdSb, s32NumOfItems);
+
+    for (s32Item = 0; s32Item < s32NumOfItems; s32Item++)
+    {
+        for (s32Sb = 0; s32Sb < s32NumOfSubBands; s32Sb++)
+            *ps32SbBuf++ = as32SimdSb[s32Sb * SBC_SIMD_ITEMS + s32Item];
+    }
+}
+#endif
+
 /****************************************************************************
 * SbcAnalysisFilter - performs Analysis of the input audio stream
 *
@@ -910,7 +993,8 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS *pstrEncParams)
     SINT32 *ps32SbBuf;
     SINT32  s32Blk,s32Ch;
     SINT32  s32NumOfChannels, s32NumOfBlocks;
-    SINT32 i,*ps32X,*ps32X2;
+    SINT32 i;
+    SBC_X_PAIR *ps32X,*ps32X2;
     SINT32 Offset,Offset2,ChOffset;
 #if (SBC_ARM_ASM_OPT==TRUE)
     register SINT32 s32Hi,s32Hi2;
@@ -963,6 +1047,14 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS *pstrEncParams)
         {
             ChOffset=s32Ch*Offset2+Offset;
 
+#if (SBC_SIMD_OPT == TRUE)
+            /* window now, the matrixing of the whole frame is done after the last block */
+            if (sbc_enc_simd != NULL)
+            {
+                sbc_enc_simd->window4(s16X+ChOffset, as32SimdY + (s32Blk*s32NumOfChannels+s32Ch)*2*SBC_MAX_NUM_OF_SUBBANDS);
+                continue;
+            }
+#endif
             WINDOW_PARTIAL_4
 
             SBC_FastIDCT4(s32DCTY, ps32SbBuf);
@@ -994,6 +1086,10 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS *pstrEncParams)
             }
         }
     }
+#if (SBC_SIMD_OPT == TRUE)
+    if (sbc_enc_simd != NULL)
+        SbcAnalysisSimdMatrix(pstrEncParams->s32SbBuffer, s32NumOfBlocks*s32NumOfChannels, SUB_BANDS_4);
+#endif
 }
 
 /* //////////////////////////////////////////////////////////////////////////////////////////////////////////////////// */
@@ -1004,7 +1100,8 @@ void SbcAnalysisFilter8 (SBC_ENC_PARAMS *pstrEncParams)
     SINT32  s32Blk,s32Ch;                                     /* counter for block*/
     SINT32 Offset,Offset2;
     SINT32  s32NumOfChannels, s32NumOfBlocks;
-    SINT32 i,*ps32X,*ps32X2;
+    SINT32 i;
+    SBC_X_PAIR *ps32X,*ps32X2;
     SINT32 ChOffset;
 #if (SBC_ARM_ASM_OPT==TRUE)
     register SINT32 s32Hi,s32Hi2;
@@ -1067,6 +1164,14 @@ void SbcAnalysisFilter8 (SBC_ENC_PARAMS *pstrEncParams)
         {
             ChOffset=s32Ch*Offset2+Offset;
 
+#if (SBC_SIMD_OPT == TRUE)
+            /* window now, the matrixing of the whole frame is done after the last block */
+            if (sbc_enc_simd != NULL)
+            {
+                sbc_enc_simd->window8(s16X+ChOffset, as32SimdY + (s32Blk*s32NumOfChannels+s32Ch)*2*SBC_MAX_NUM_OF_SUBBANDS);
+                continue;
+            }
+#endif
             WINDOW_PARTIAL_8
 
             SBC_FastIDCT8 (s32DCTY, ps32SbBuf);
@@ -1098,10 +1203,17 @@ void SbcAnalysisFilter8 (SBC_ENC_PARAMS *pstrEncParams)
             }
         }
     }
+#if (SBC_SIMD_OPT == TRUE)
+    if (sbc_enc_simd != NULL)
+        SbcAnalysisSimdMatrix(pstrEncParams->s32SbBuffer, s32NumOfBlocks*s32NumOfChannels, SUB_BANDS_8);
+#endif
 }
 
 void SbcAnalysisInit (void)
 {
     memset(s16X,0,ENC_VX_BUFFER_SIZE*sizeof(SINT16));
     ShiftCounter=0;
+#if (SBC_SIMD_OPT == TRUE)
+    SbcEncSimdInit();
+#endif
 }
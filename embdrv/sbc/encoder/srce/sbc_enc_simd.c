@@ -0,0 +1,771 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 1999-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the SIMD versions of the analysis filter (windowing and
+ *  matrixing) and of the scale factor search. They give the same results as
+ *  the C code built with SBC_IPAQ_OPT. The instruction set is picked at run
+ *  time on x86 (SSE2, AVX2) and at build time on ARM (NEON, only with
+ *  SBC_SIMD_NEON_OPT).
+ *
+ ******************************************************************************/
+#include "sbc_encoder.h"
+#include "sbc_enc_func_declare.h"
+#include "sbc_dct.h"
+
+#if (SBC_SIMD_OPT == TRUE)
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define SBC_SIMD_X86 TRUE
+#include <immintrin.h>
+#define SBC_SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SBC_SIMD_X86 FALSE
+#endif
+
+#if (SBC_SIMD_NEON_OPT == TRUE) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define SBC_SIMD_ARM_NEON TRUE
+#include <arm_neon.h>
+#else
+#define SBC_SIMD_ARM_NEON FALSE
+#endif
+
+/* SINT32 is 64 bits wide on LP64 targets, subband samples are narrowed when loaded */
+#if defined(__LP64__)
+#define SBC_SIMD_LP64 TRUE
+#else
+#define SBC_SIMD_LP64 FALSE
+#endif
+
+/* stride of the windowing output rows */
+#define SBC_SIMD_ROW    (2 * SBC_MAX_NUM_OF_SUBBANDS)
+
+const tSBC_ENC_SIMD *sbc_enc_simd = NULL;
+static BOOLEAN sbc_enc_simd_selected = FALSE;
+
+#if (SBC_SIMD_X86 == TRUE)
+/* window taps paired for pmaddwd: [pair][row][2] holds taps 2*pair and 2*pair+1 of row */
+static SINT16 as16Win4Pairs[3 * 8 * 2];
+static SINT16 as16Win8Pairs[3 * 16 * 2];
+/* same pairs in the 256 bit unpack order: [pair][0] rows 0-3 and 8-11, [pair][1] rows 4-7 and 12-15 */
+static SINT16 as16Win8PairsAvx[3 * 2 * 16];
+#endif
+
+/*******************************************************************************
+**
+** Function         sbc_enc_simd_prepare
+**
+** Description      Builds the tap layouts used by the x86 windowing kernels
+**                  from gas16SimdWin4 and gas16SimdWin8.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void sbc_enc_simd_prepare(void)
+{
+#if (SBC_SIMD_X86 == TRUE)
+    static BOOLEAN prepared = FALSE;
+    int p, r, i;
+
+    if (prepared)
+        return;
+
+    for (p = 0; p < 3; p++)
+    {
+        for (r = 0; r < 8; r++)
+        {
+            as16Win4Pairs[(p * 8 + r) * 2]     = gas16SimdWin4[2 * p * 8 + r];
+            as16Win4Pairs[(p * 8 + r) * 2 + 1] = (p < 2) ? gas16SimdWin4[(2 * p + 1) * 8 + r] : 0;
+        }
+        for (r = 0; r < 16; r++)
+        {
+            as16Win8Pairs[(p * 16 + r) * 2]     = gas16SimdWin8[2 * p * 16 + r];
+            as16Win8Pairs[(p * 16 + r) * 2 + 1] = (p < 2) ? gas16SimdWin8[(2 * p + 1) * 16 + r] : 0;
+        }
+        for (i = 0; i < 16; i++)
+        {
+            /* i / 8 selects the half, i % 8 the row within rows 0-3,8-11 or 4-7,12-15 */
+            r = (i % 8 < 4) ? (i % 8) : (i % 8 + 4);
+            r += (i / 8) * 4;
+            as16Win8PairsAvx[(p * 2 + i / 8) * 16 + (i % 8) * 2]     = as16Win8Pairs[(p * 16 + r) * 2];
+            as16Win8PairsAvx[(p * 2 + i / 8) * 16 + (i % 8) * 2 + 1] = as16Win8Pairs[(p * 16 + r) * 2 + 1];
+        }
+    }
+    prepared = TRUE;
+#endif
+}
+
+/*******************************************************************************
+**
+** Function         sbc_enc_simd_scf
+**
+** Description      Turns the absolute maximum of each column into its scale
+**                  factor, the smallest u (at most 15) with max <= 0x8000 << u,
+**                  as the C search of SBC_Encoder() does.
+**
+** Returns          largest scale factor
+**
+*******************************************************************************/
+static UINT32 sbc_enc_simd_scf(const int *ps32Max, SINT32 s32NumOfCols, SINT16 *ps16ScaleFactor)
+{
+    UINT32 u32Count, u32Val, u32MaxBit = 0;
+    SINT32 s32Col;
+
+    for (s32Col = 0; s32Col < s32NumOfCols; s32Col++)
+    {
+        u32Count = 0;
+        if (ps32Max[s32Col] > 0x8000)
+        {
+            for (u32Val = (UINT32)(ps32Max[s32Col] - 1) >> 15; (u32Val != 0) && (u32Count < 15); u32Val >>= 1)
+                u32Count++;
+        }
+        ps16ScaleFactor[s32Col] = (SINT16)u32Count;
+        if (u32Count > u32MaxBit)
+            u32MaxBit = u32Count;
+    }
+    return u32MaxBit;
+}
+
+/* Fast DCT of SBC_FastIDCT8() on vectors of items: y[0..15] in, o[0..7] out.
+** VADD, VSUB, VSRA1 (>> 1), VSHL1 (<< 1) and VMUL (SBC_MULT_32_16_SIMPLIFIED)
+** are defined by each instruction set below. */
+#define SBC_SIMD_FAST_IDCT8(V, y, o)                                            \
+{                                                                               \
+    V x0, x1, x2, x3, x4, x5, x6, x7, t, e0, e1, e2, e3, d0, d1, d2, d3;       \
+    x0 = VMUL(SBC_COS_PI_SUR_4, y[4]);                                          \
+    x1 = VSRA1(VADD(y[3], y[5]));                                               \
+    x2 = VSRA1(VADD(y[2], y[6]));                                               \
+    x3 = VSRA1(VADD(y[1], y[7]));                                               \
+    x4 = VSRA1(VADD(y[0], y[8]));                                               \
+    x5 = VSRA1(VSUB(y[9], y[15]));                                              \
+    x6 = VSRA1(VSUB(y[10], y[14]));                                             \
+    x7 = VSRA1(VSUB(y[11], y[13]));                                             \
+    t  = VADD(x0, x4);                                                          \
+    x4 = VMUL(SBC_COS_PI_SUR_4, VSUB(x0, x4));                                  \
+    x0 = VMUL(SBC_COS_PI_SUR_4, t);                                             \
+    x2 = VSUB(x2, x6);                                                          \
+    x6 = VMUL(SBC_COS_PI_SUR_4, VSHL1(x6));                                     \
+    t  = VADD(x2, x6);                                                          \
+    x6 = VMUL(SBC_COS_3PI_SUR_8, VSUB(x2, x6));                                 \
+    x2 = VMUL(SBC_COS_PI_SUR_8, t);                                             \
+    e0 = VADD(x0, x2);                                                          \
+    e1 = VADD(x4, x6);                                                          \
+    e2 = VSUB(x4, x6);                                                          \
+    e3 = VSUB(x0, x2);                                                          \
+    x7 = VSHL1(x7);                                                             \
+    x5 = VSUB(VSHL1(x5), x7);                                                   \
+    x3 = VSUB(VSHL1(x3), x5);                                                   \
+    x1 = VSUB(x1, VSRA1(x3));                                                   \
+    x5 = VMUL(SBC_COS_PI_SUR_4, x5);                                            \
+    t  = x1;                                                                    \
+    x1 = VADD(x1, x5);                                                          \
+    x5 = VSUB(t, x5);                                                           \
+    x3 = VSUB(x3, x7);                                                          \
+    x7 = VMUL(SBC_COS_PI_SUR_4, VSHL1(x7));                                     \
+    t  = VADD(x3, x7);                                                          \
+    x7 = VMUL(SBC_COS_3PI_SUR_8, VSUB(x3, x7));                                 \
+    x3 = VMUL(SBC_COS_PI_SUR_8, t);                                             \
+    d0 = VMUL(SBC_COS_PI_SUR_16, VADD(x1, x3));                                 \
+    d1 = VMUL(SBC_COS_3PI_SUR_16, VADD(x5, x7));                                \
+    d2 = VMUL(SBC_COS_5PI_SUR_16, VSUB(x5, x7));                                \
+    d3 = VMUL(SBC_COS_7PI_SUR_16, VSUB(x1, x3));                                \
+    o[0] = VADD(e0, d0);                                                        \
+    o[1] = VADD(e1, d1);                                                        \
+    o[2] = VADD(e2, d2);                                                        \
+    o[3] = VADD(e3, d3);                                                        \
+    o[7] = VSUB(e0, d0);                                                        \
+    o[6] = VSUB(e1, d1);                                                        \
+    o[5] = VSUB(e2, d2);                                                        \
+    o[4] = VSUB(e3, d3);                                                        \
+}
+
+/* Fast DCT of SBC_FastIDCT4() on vectors of items: y[0..7] in, o[0..3] out */
+#define SBC_SIMD_FAST_IDCT4(V, y, o)                                            \
+{                                                                               \
+    V x2, t, t0, t1, t2, t3, t4, t5, t6, t7;                                    \
+    x2 = VSRA1(y[2]);                                                           \
+    t0 = VMUL(SBC_COS_PI_SUR_4 >> 1, VADD(y[0], y[4]));                         \
+    t1 = VSUB(x2, t0);                                                          \
+    t0 = VADD(t0, x2);                                                          \
+    t  = VADD(y[1], y[3]);                                                      \
+    t3 = VMUL(SBC_COS_3PI_SUR_8 >> 1, t);                                       \
+    t2 = VMUL(SBC_COS_PI_SUR_8 >> 1, t);                                        \
+    t  = VSUB(y[5], y[7]);                                                      \
+    t5 = VMUL(SBC_COS_3PI_SUR_8 >> 1, t);                                       \
+    t4 = VMUL(SBC_COS_PI_SUR_8 >> 1, t);                                        \
+    t6 = VADD(t2, t5);                                                          \
+    t7 = VSUB(t3, t4);                                                          \
+    o[0] = VADD(t0, t6);                                                        \
+    o[1] = VADD(t1, t7);                                                        \
+    o[2] = VSUB(t1, t7);                                                        \
+    o[3] = VSUB(t0, t6);                                                        \
+}
+
+#if (SBC_SIMD_X86 == TRUE)
+/*******************************************************************************
+** SSE2
+*******************************************************************************/
+
+/* c * x >> 15 with c < 0x8000: c * (x >> 16) << 1 by pmaddwd plus c * (x & 0xFFFF) >> 15
+** rebuilt from pmullw/pmulhuw, exact for the full 32 bit range of x */
+#define SBC_SSE2_MULT(c, a)                                                                     \
+    _mm_add_epi32(_mm_slli_epi32(_mm_madd_epi16(_mm_srai_epi32((a), 16), _mm_set1_epi32(c)), 1), \
+        _mm_srli_epi32(_mm_or_si128(                                                            \
+            _mm_slli_epi32(_mm_mulhi_epu16(_mm_and_si128((a), s128Low), _mm_set1_epi32(c)), 16),\
+            _mm_mullo_epi16(_mm_and_si128((a), s128Low), _mm_set1_epi32(c))), 15))
+
+/* loads 4 columns of 4 windowing rows, one vector per column */
+#define SBC_SSE2_LOAD_4X4(p, v)                                                 \
+{                                                                               \
+    __m128i r0 = _mm_loadu_si128((const __m128i *)(p));                         \
+    __m128i r1 = _mm_loadu_si128((const __m128i *)((p) + SBC_SIMD_ROW));        \
+    __m128i r2 = _mm_loadu_si128((const __m128i *)((p) + 2 * SBC_SIMD_ROW));    \
+    __m128i r3 = _mm_loadu_si128((const __m128i *)((p) + 3 * SBC_SIMD_ROW));    \
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1);                                    \
+    __m128i t1 = _mm_unpacklo_epi32(r2, r3);                                    \
+    __m128i t2 = _mm_unpackhi_epi32(r0, r1);                                    \
+    __m128i t3 = _mm_unpackhi_epi32(r2, r3);                                    \
+    (v)[0] = _mm_unpacklo_epi64(t0, t1);                                        \
+    (v)[1] = _mm_unpackhi_epi64(t0, t1);                                        \
+    (v)[2] = _mm_unpacklo_epi64(t2, t3);                                        \
+    (v)[3] = _mm_unpackhi_epi64(t2, t3);                                        \
+}
+
+#if (SBC_SIMD_LP64 == TRUE)
+#define SBC_SSE2_LOAD_SB(p)                                                     \
+    _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(p))), \
+        _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)((p) + 2))), _MM_SHUFFLE(2, 0, 2, 0)))
+#else
+#define SBC_SSE2_LOAD_SB(p) _mm_loadu_si128((const __m128i *)(p))
+#endif
+
+#define SBC_SSE2_WIN(p, g) _mm_loadu_si128((const __m128i *)(p) + (g))
+
+#define VADD(a, b)  _mm_add_epi32(a, b)
+#define VSUB(a, b)  _mm_sub_epi32(a, b)
+#define VSRA1(a)    _mm_srai_epi32(a, 1)
+#define VSHL1(a)    _mm_slli_epi32(a, 1)
+#define VMUL(c, a)  SBC_SSE2_MULT(c, a)
+
+static SBC_SIMD_TARGET("sse2") void sbc_enc_window4_sse2(const SINT16 *ps16X, int *ps32Y)
+{
+    const SINT16 *pw0 = as16Win4Pairs, *pw1 = as16Win4Pairs + 16, *pw2 = as16Win4Pairs + 32;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i x0, x1, x2, x3, x4, a0, a1;
+
+    x0 = _mm_loadu_si128((const __m128i *)ps16X);
+    x1 = _mm_loadu_si128((const __m128i *)(ps16X + 8));
+    x2 = _mm_loadu_si128((const __m128i *)(ps16X + 16));
+    x3 = _mm_loadu_si128((const __m128i *)(ps16X + 24));
+    x4 = _mm_loadu_si128((const __m128i *)(ps16X + 32));
+
+    /* rows 0-3 */
+    a0 = _mm_madd_epi16(_mm_unpacklo_epi16(x0, x1), SBC_SSE2_WIN(pw0, 0));
+    a0 = _mm_add_epi32(a0, _mm_madd_epi16(_mm_unpacklo_epi16(x2, x3), SBC_SSE2_WIN(pw1, 0)));
+    a0 = _mm_add_epi32(a0, _mm_madd_epi16(_mm_unpacklo_epi16(x4, zero), SBC_SSE2_WIN(pw2, 0)));
+    /* rows 4-7 */
+    a1 = _mm_madd_epi16(_mm_unpackhi_epi16(x0, x1), SBC_SSE2_WIN(pw0, 1));
+    a1 = _mm_add_epi32(a1, _mm_madd_epi16(_mm_unpackhi_epi16(x2, x3), SBC_SSE2_WIN(pw1, 1)));
+    a1 = _mm_add_epi32(a1, _mm_madd_epi16(_mm_unpackhi_epi16(x4, zero), SBC_SSE2_WIN(pw2, 1)));
+
+    _mm_storeu_si128((__m128i *)ps32Y, a0);
+    _mm_storeu_si128((__m128i *)(ps32Y + 4), a1);
+}
+
+static SBC_SIMD_TARGET("sse2") void sbc_enc_window8_sse2(const SINT16 *ps16X, int *ps32Y)
+{
+    const SINT16 *pw0 = as16Win8Pairs, *pw1 = as16Win8Pairs + 32, *pw2 = as16Win8Pairs + 64;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i xl[5], xh[5], a;
+    int j;
+
+    for (j = 0; j < 5; j++)
+    {
+        xl[j] = _mm_loadu_si128((const __m128i *)(ps16X + 16 * j));
+        xh[j] = _mm_loadu_si128((const __m128i *)(ps16X + 16 * j + 8));
+    }
+
+    /* rows 0-3 */
+    a = _mm_madd_epi16(_mm_unpacklo_epi16(xl[0], xl[1]), SBC_SSE2_WIN(pw0, 0));
+    a = _mm_add_epi32(a, _mm_madd_epi16(_mm_unpacklo_epi16(xl[2], xl[3]), SBC_SSE2_WIN(pw1, 0)));
+    a = _mm_add_epi32(a, _mm_madd_epi16(_mm_unpacklo_epi16(xl[4], zero), SBC_SSE2_WIN(pw2, 0)));
+    _mm_storeu_si128((__m128i *)ps32Y, a);
+    /* rows 4-7 */
+    a = _mm_madd_epi16(_mm_unpackhi_epi16(xl[0], xl[1]), SBC_SSE2_WIN(pw0, 1));
+    a = _mm_add_epi32(a, _mm_madd_epi16(_mm_unpackhi_epi16(xl[2], xl[3]), SBC_SSE2_WIN(pw1, 1)));
+    a = _mm_add_epi32(a, _mm_madd_epi16(_mm_unpackhi_epi16(xl[4], zero), SBC_SSE2_WIN(pw2, 1)));
+    _mm_storeu_si128((__m128i *)(ps32Y + 4), a);
+    /* rows 8-11 */
+    a = _mm_madd_epi16(_mm_unpacklo_epi16(xh[0], xh[1]), SBC_SSE2_WIN(pw0, 2));
+    a = _mm_add_epi32(a, _mm_madd_epi16(_mm_unpacklo_epi16(xh[2], xh[3]), SBC_SSE2_WIN(pw1, 2)));
+    a = _mm_add_epi32(a, _mm_madd_epi16(_mm_unpacklo_epi16(xh[4], zero), SBC_SSE2_WIN(pw2, 2)));
+    _mm_storeu_si128((__m128i *)(ps32Y + 8), a);
+    /* rows 12-15 */
+    a = _mm_madd_epi16(_mm_unpackhi_epi16(xh[0], xh[1]), SBC_SSE2_WIN(pw0, 3));
+    a = _mm_add_epi32(a, _mm_madd_epi16(_mm_unpackhi_epi16(xh[2], xh[3]), SBC_SSE2_WIN(pw1, 3)));
+    a = _mm_add_epi32(a, _mm_madd_epi16(_mm_unpackhi_epi16(xh[4], zero), SBC_SSE2_WIN(pw2, 3)));
+    _mm_storeu_si128((__m128i *)(ps32Y + 12), a);
+}
+
+static SBC_SIMD_TARGET("sse2") void sbc_enc_idct4_sse2(const int *ps32Y, int *ps32Out, SINT32 s32NumOfItems)
+{
+    const __m128i s128Low = _mm_set1_epi32(0xFFFF);
+    __m128i y[8], o[4];
+    SINT32 i, k;
+
+    for (i = 0; i < s32NumOfItems; i += 4)
+    {
+        SBC_SSE2_LOAD_4X4(ps32Y + i * SBC_SIMD_ROW, y);
+        SBC_SSE2_LOAD_4X4(ps32Y + i * SBC_SIMD_ROW + 4, y + 4);
+        SBC_SIMD_FAST_IDCT4(__m128i, y, o);
+        for (k = 0; k < 4; k++)
+            _mm_storeu_si128((__m128i *)(ps32Out + k * SBC_SIMD_ITEMS + i), o[k]);
+    }
+}
+
+static SBC_SIMD_TARGET("sse2") void sbc_enc_idct8_sse2(const int *ps32Y, int *ps32Out, SINT32 s32NumOfItems)
+{
+    const __m128i s128Low = _mm_set1_epi32(0xFFFF);
+    __m128i y[16], o[8];
+    SINT32 i, k;
+
+    for (i = 0; i < s32NumOfItems; i += 4)
+    {
+        for (k = 0; k < 16; k += 4)
+            SBC_SSE2_LOAD_4X4(ps32Y + i * SBC_SIMD_ROW + k, y + k);
+        SBC_SIMD_FAST_IDCT8(__m128i, y, o);
+        for (k = 0; k < 8; k++)
+            _mm_storeu_si128((__m128i *)(ps32Out + k * SBC_SIMD_ITEMS + i), o[k]);
+    }
+}
+
+static SBC_SIMD_TARGET("sse2") UINT32 sbc_enc_scale_factors_sse2(const SINT32 *ps32SbBuffer, SINT32 s32NumOfCols,
+                                                                 SINT32 s32NumOfBlocks, SINT16 *ps16ScaleFactor)
+{
+    int as32Max[SBC_MAX_NUM_OF_CHANNELS * SBC_MAX_NUM_OF_SUBBANDS];
+    const SINT32 *ps32Sb;
+    __m128i v, s, m, gt;
+    SINT32 s32Col, s32Blk;
+
+    for (s32Col = 0; s32Col < s32NumOfCols; s32Col += 4)
+    {
+        m = _mm_setzero_si128();
+        ps32Sb = ps32SbBuffer + s32Col;
+        for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk++)
+        {
+            v  = SBC_SSE2_LOAD_SB(ps32Sb);
+            s  = _mm_srai_epi32(v, 31);
+            v  = _mm_sub_epi32(_mm_xor_si128(v, s), s);
+            gt = _mm_cmpgt_epi32(v, m);
+            m  = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, m));
+            ps32Sb += s32NumOfCols;
+        }
+        _mm_storeu_si128((__m128i *)(as32Max + s32Col), m);
+    }
+    return sbc_enc_simd_scf(as32Max, s32NumOfCols, ps16ScaleFactor);
+}
+
+#undef VMUL
+
+/*******************************************************************************
+** AVX2
+*******************************************************************************/
+
+#define SBC_AVX2_MULT(c, a)                                                                             \
+    _mm256_add_epi32(_mm256_slli_epi32(_mm256_madd_epi16(_mm256_srai_epi32((a), 16), _mm256_set1_epi32(c)), 1), \
+        _mm256_srli_epi32(_mm256_or_si256(                                                              \
+            _mm256_slli_epi32(_mm256_mulhi_epu16(_mm256_and_si256((a), s256Low), _mm256_set1_epi32(c)), 16), \
+            _mm256_mullo_epi16(_mm256_and_si256((a), s256Low), _mm256_set1_epi32(c))), 15))
+
+/* loads 4 columns of 8 windowing rows, one vector per column */
+#define SBC_AVX2_LOAD_8X4(p, v)                                                 \
+{                                                                               \
+    __m128i lo[4], hi[4];                                                       \
+    SBC_SSE2_LOAD_4X4(p, lo);                                                   \
+    SBC_SSE2_LOAD_4X4((p) + 4 * SBC_SIMD_ROW, hi);                              \
+    (v)[0] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo[0]), hi[0], 1);  \
+    (v)[1] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo[1]), hi[1], 1);  \
+    (v)[2] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo[2]), hi[2], 1);  \
+    (v)[3] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo[3]), hi[3], 1);  \
+}
+
+#if (SBC_SIMD_LP64 == TRUE)
+#define SBC_AVX2_LOAD_SB(p)                                                     \
+    _mm256_permute2x128_si256(                                                  \
+        _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)(p)), s256Even), \
+        _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)((p) + 4)), s256Even), 0x20)
+#else
+#define SBC_AVX2_LOAD_SB(p) _mm256_loadu_si256((const __m256i *)(p))
+#endif
+
+#undef VADD
+#undef VSUB
+#undef VSRA1
+#undef VSHL1
+#define VADD(a, b)  _mm256_add_epi32(a, b)
+#define VSUB(a, b)  _mm256_sub_epi32(a, b)
+#define VSRA1(a)    _mm256_srai_epi32(a, 1)
+#define VSHL1(a)    _mm256_slli_epi32(a, 1)
+#define VMUL(c, a)  SBC_AVX2_MULT(c, a)
+
+static SBC_SIMD_TARGET("avx2") void sbc_enc_window8_avx2(const SINT16 *ps16X, int *ps32Y)
+{
+    const __m256i *pw = (const __m256i *)as16Win8PairsAvx;
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i x0, x1, x2, x3, x4, lo, hi;
+
+    x0 = _mm256_loadu_si256((const __m256i *)ps16X);
+    x1 = _mm256_loadu_si256((const __m256i *)(ps16X + 16));
+    x2 = _mm256_loadu_si256((const __m256i *)(ps16X + 32));
+    x3 = _mm256_loadu_si256((const __m256i *)(ps16X + 48));
+    x4 = _mm256_loadu_si256((const __m256i *)(ps16X + 64));
+
+    /* rows 0-3 and 8-11 */
+    lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(x0, x1), _mm256_loadu_si256(pw));
+    lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(x2, x3), _mm256_loadu_si256(pw + 2)));
+    lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(x4, zero), _mm256_loadu_si256(pw + 4)));
+    /* rows 4-7 and 12-15 */
+    hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(x0, x1), _mm256_loadu_si256(pw + 1));
+    hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(x2, x3), _mm256_loadu_si256(pw + 3)));
+    hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(x4, zero), _mm256_loadu_si256(pw + 5)));
+
+    _mm256_storeu_si256((__m256i *)ps32Y, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i *)(ps32Y + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+static SBC_SIMD_TARGET("avx2") void sbc_enc_idct4_avx2(const int *ps32Y, int *ps32Out, SINT32 s32NumOfItems)
+{
+    const __m256i s256Low = _mm256_set1_epi32(0xFFFF);
+    __m256i y[8], o[4];
+    SINT32 i, k;
+
+    /* the item count is a multiple of 4, the tail lanes compute unused items */
+    for (i = 0; i < s32NumOfItems; i += 8)
+    {
+        SBC_AVX2_LOAD_8X4(ps32Y + i * SBC_SIMD_ROW, y);
+        SBC_AVX2_LOAD_8X4(ps32Y + i * SBC_SIMD_ROW + 4, y + 4);
+        SBC_SIMD_FAST_IDCT4(__m256i, y, o);
+        for (k = 0; k < 4; k++)
+            _mm256_storeu_si256((__m256i *)(ps32Out + k * SBC_SIMD_ITEMS + i), o[k]);
+    }
+}
+
+static SBC_SIMD_TARGET("avx2") void sbc_enc_idct8_avx2(const int *ps32Y, int *ps32Out, SINT32 s32NumOfItems)
+{
+    const __m256i s256Low = _mm256_set1_epi32(0xFFFF);
+    __m256i y[16], o[8];
+    SINT32 i, k;
+
+    for (i = 0; i < s32NumOfItems; i += 8)
+    {
+        for (k = 0; k < 16; k += 4)
+            SBC_AVX2_LOAD_8X4(ps32Y + i * SBC_SIMD_ROW + k, y + k);
+        SBC_SIMD_FAST_IDCT8(__m256i, y, o);
+        for (k = 0; k < 8; k++)
+            _mm256_storeu_si256((__m256i *)(ps32Out + k * SBC_SIMD_ITEMS + i), o[k]);
+    }
+}
+
+static SBC_SIMD_TARGET("avx2") UINT32 sbc_enc_scale_factors_avx2(const SINT32 *ps32SbBuffer, SINT32 s32NumOfCols,
+                                                                 SINT32 s32NumOfBlocks, SINT16 *ps16ScaleFactor)
+{
+    int as32Max[SBC_MAX_NUM_OF_CHANNELS * SBC_MAX_NUM_OF_SUBBANDS];
+#if (SBC_SIMD_LP64 == TRUE)
+    const __m256i s256Even = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+#endif
+    const SINT32 *ps32Sb;
+    __m256i m;
+    SINT32 s32Col, s32Blk;
+
+    /* mono 4 subbands: a single 128 bit column group */
+    if (s32NumOfCols & 7)
+        return sbc_enc_scale_factors_sse2(ps32SbBuffer, s32NumOfCols, s32NumOfBlocks, ps16ScaleFactor);
+
+    for (s32Col = 0; s32Col < s32NumOfCols; s32Col += 8)
+    {
+        m = _mm256_setzero_si256();
+        ps32Sb = ps32SbBuffer + s32Col;
+        for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk++)
+        {
+            m = _mm256_max_epi32(m, _mm256_abs_epi32(SBC_AVX2_LOAD_SB(ps32Sb)));
+            ps32Sb += s32NumOfCols;
+        }
+        _mm256_storeu_si256((__m256i *)(as32Max + s32Col), m);
+    }
+    return sbc_enc_simd_scf(as32Max, s32NumOfCols, ps16ScaleFactor);
+}
+
+#undef VADD
+#undef VSUB
+#undef VSRA1
+#undef VSHL1
+#undef VMUL
+
+static const tSBC_ENC_SIMD sbc_enc_simd_sse2 =
+{
+    SBC_SIMD_SSE2,
+    sbc_enc_window4_sse2,
+    sbc_enc_window8_sse2,
+    sbc_enc_idct4_sse2,
+    sbc_enc_idct8_sse2,
+    sbc_enc_scale_factors_sse2
+};
+
+static const tSBC_ENC_SIMD sbc_enc_simd_avx2 =
+{
+    SBC_SIMD_AVX2,
+    sbc_enc_window4_sse2,   /* 8 rows of 32 bits fit in two SSE2 registers already */
+    sbc_enc_window8_avx2,
+    sbc_enc_idct4_avx2,
+    sbc_enc_idct8_avx2,
+    sbc_enc_scale_factors_avx2
+};
+#endif /* SBC_SIMD_X86 */
+
+#if (SBC_SIMD_ARM_NEON == TRUE)
+/*******************************************************************************
+** NEON
+*******************************************************************************/
+
+#define SBC_NEON_MULT(c, a)                                                     \
+    vaddq_s32(vshlq_n_s32(vmulq_s32(vshrq_n_s32((a), 16), vdupq_n_s32(c)), 1), \
+        vreinterpretq_s32_u32(vshrq_n_u32(vmulq_u32(vandq_u32(vreinterpretq_u32_s32(a), \
+            vdupq_n_u32(0xFFFF)), vdupq_n_u32(c)), 15)))
+
+/* loads 4 columns of 4 windowing rows, one vector per column */
+#define SBC_NEON_LOAD_4X4(p, v)                                                 \
+{                                                                               \
+    int32x4x2_t t01 = vtrnq_s32(vld1q_s32(p), vld1q_s32((p) + SBC_SIMD_ROW));   \
+    int32x4x2_t t23 = vtrnq_s32(vld1q_s32((p) + 2 * SBC_SIMD_ROW),              \
+                                vld1q_s32((p) + 3 * SBC_SIMD_ROW));             \
+    (v)[0] = vcombine_s32(vget_low_s32(t01.val[0]), vget_low_s32(t23.val[0]));  \
+    (v)[1] = vcombine_s32(vget_low_s32(t01.val[1]), vget_low_s32(t23.val[1]));  \
+    (v)[2] = vcombine_s32(vget_high_s32(t01.val[0]), vget_high_s32(t23.val[0]));\
+    (v)[3] = vcombine_s32(vget_high_s32(t01.val[1]), vget_high_s32(t23.val[1]));\
+}
+
+#if (SBC_SIMD_LP64 == TRUE)
+#define SBC_NEON_LOAD_SB(p)                                                     \
+    vcombine_s32(vmovn_s64(vld1q_s64((const int64_t *)(p))),                    \
+                 vmovn_s64(vld1q_s64((const int64_t *)((p) + 2))))
+#else
+#define SBC_NEON_LOAD_SB(p) vld1q_s32((const int32_t *)(p))
+#endif
+
+#define VADD(a, b)  vaddq_s32(a, b)
+#define VSUB(a, b)  vsubq_s32(a, b)
+#define VSRA1(a)    vshrq_n_s32(a, 1)
+#define VSHL1(a)    vshlq_n_s32(a, 1)
+#define VMUL(c, a)  SBC_NEON_MULT(c, a)
+
+static void sbc_enc_window4_neon(const SINT16 *ps16X, int *ps32Y)
+{
+    int32x4_t a0, a1;
+    int j;
+
+    a0 = vmull_s16(vld1_s16(ps16X), vld1_s16(gas16SimdWin4));
+    a1 = vmull_s16(vld1_s16(ps16X + 4), vld1_s16(gas16SimdWin4 + 4));
+    for (j = 1; j < 5; j++)
+    {
+        a0 = vmlal_s16(a0, vld1_s16(ps16X + 8 * j), vld1_s16(gas16SimdWin4 + 8 * j));
+        a1 = vmlal_s16(a1, vld1_s16(ps16X + 8 * j + 4), vld1_s16(gas16SimdWin4 + 8 * j + 4));
+    }
+    vst1q_s32(ps32Y, a0);
+    vst1q_s32(ps32Y + 4, a1);
+}
+
+static void sbc_enc_window8_neon(const SINT16 *ps16X, int *ps32Y)
+{
+    int32x4_t a0, a1, a2, a3;
+    int j;
+
+    a0 = vmull_s16(vld1_s16(ps16X), vld1_s16(gas16SimdWin8));
+    a1 = vmull_s16(vld1_s16(ps16X + 4), vld1_s16(gas16SimdWin8 + 4));
+    a2 = vmull_s16(vld1_s16(ps16X + 8), vld1_s16(gas16SimdWin8 + 8));
+    a3 = vmull_s16(vld1_s16(ps16X + 12), vld1_s16(gas16SimdWin8 + 12));
+    for (j = 1; j < 5; j++)
+    {
+        a0 = vmlal_s16(a0, vld1_s16(ps16X + 16 * j), vld1_s16(gas16SimdWin8 + 16 * j));
+        a1 = vmlal_s16(a1, vld1_s16(ps16X + 16 * j + 4), vld1_s16(gas16SimdWin8 + 16 * j + 4));
+        a2 = vmlal_s16(a2, vld1_s16(ps16X + 16 * j + 8), vld1_s16(gas16SimdWin8 + 16 * j + 8));
+        a3 = vmlal_s16(a3, vld1_s16(ps16X + 16 * j + 12), vld1_s16(gas16SimdWin8 + 16 * j + 12));
+    }
+    vst1q_s32(ps32Y, a0);
+    vst1q_s32(ps32Y + 4, a1);
+    vst1q_s32(ps32Y + 8, a2);
+    vst1q_s32(ps32Y + 12, a3);
+}
+
+static void sbc_enc_idct4_neon(const int *ps32Y, int *ps32Out, SINT32 s32NumOfItems)
+{
+    int32x4_t y[8], o[4];
+    SINT32 i, k;
+
+    for (i = 0; i < s32NumOfItems; i += 4)
+    {
+        SBC_NEON_LOAD_4X4(ps32Y + i * SBC_SIMD_ROW, y);
+        SBC_NEON_LOAD_4X4(ps32Y + i * SBC_SIMD_ROW + 4, y + 4);
+        SBC_SIMD_FAST_IDCT4(int32x4_t, y, o);
+        for (k = 0; k < 4; k++)
+            vst1q_s32(ps32Out + k * SBC_SIMD_ITEMS + i, o[k]);
+    }
+}
+
+static void sbc_enc_idct8_neon(const int *ps32Y, int *ps32Out, SINT32 s32NumOfItems)
+{
+    int32x4_t y[16], o[8];
+    SINT32 i, k;
+
+    for (i = 0; i < s32NumOfItems; i += 4)
+    {
+        for (k = 0; k < 16; k += 4)
+            SBC_NEON_LOAD_4X4(ps32Y + i * SBC_SIMD_ROW + k, y + k);
+        SBC_SIMD_FAST_IDCT8(int32x4_t, y, o);
+        for (k = 0; k < 8; k++)
+            vst1q_s32(ps32Out + k * SBC_SIMD_ITEMS + i, o[k]);
+    }
+}
+
+static UINT32 sbc_enc_scale_factors_neon(const SINT32 *ps32SbBuffer, SINT32 s32NumOfCols,
+                                         SINT32 s32NumOfBlocks, SINT16 *ps16ScaleFactor)
+{
+    int as32Max[SBC_MAX_NUM_OF_CHANNELS * SBC_MAX_NUM_OF_SUBBANDS];
+    const SINT32 *ps32Sb;
+    int32x4_t m;
+    SINT32 s32Col, s32Blk;
+
+    for (s32Col = 0; s32Col < s32NumOfCols; s32Col += 4)
+    {
+        m = vdupq_n_s32(0);
+        ps32Sb = ps32SbBuffer + s32Col;
+        for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk++)
+        {
+            m = vmaxq_s32(m, vabsq_s32(SBC_NEON_LOAD_SB(ps32Sb)));
+            ps32Sb += s32NumOfCols;
+        }
+        vst1q_s32(as32Max + s32Col, m);
+    }
+    return sbc_enc_simd_scf(as32Max, s32NumOfCols, ps16ScaleFactor);
+}
+
+#undef VADD
+#undef VSUB
+#undef VSRA1
+#undef VSHL1
+#undef VMUL
+
+static const tSBC_ENC_SIMD sbc_enc_simd_neon =
+{
+    SBC_SIMD_NEON,
+    sbc_enc_window4_neon,
+    sbc_enc_window8_neon,
+    sbc_enc_idct4_neon,
+    sbc_enc_idct8_neon,
+    sbc_enc_scale_factors_neon
+};
+#endif /* SBC_SIMD_ARM_NEON */
+
+/*******************************************************************************
+**
+** Function         sbc_enc_simd_get
+**
+** Description      Looks up the kernels of an instruction set.
+**
+** Returns          kernels, NULL if u8Level is SBC_SIMD_NONE or the CPU
+**                  cannot run them
+**
+*******************************************************************************/
+static const tSBC_ENC_SIMD *sbc_enc_simd_get(UINT8 u8Level)
+{
+#if (SBC_SIMD_X86 == TRUE)
+    __builtin_cpu_init();
+#endif
+    switch (u8Level)
+    {
+#if (SBC_SIMD_X86 == TRUE)
+    case SBC_SIMD_SSE2:
+        if (__builtin_cpu_supports("sse2"))
+            return &sbc_enc_simd_sse2;
+        break;
+
+    case SBC_SIMD_AVX2:
+        if (__builtin_cpu_supports("avx2"))
+            return &sbc_enc_simd_avx2;
+        break;
+#endif
+#if (SBC_SIMD_ARM_NEON == TRUE)
+    case SBC_SIMD_NEON:
+        return &sbc_enc_simd_neon;
+#endif
+    default:
+        break;
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         SbcEncSimdSelect
+**
+** Description      Forces the instruction set used by the encoder,
+**                  SBC_SIMD_NONE selects the C implementation. The choice
+**                  sticks across SBC_Encoder_Init() calls.
+**
+** Returns          TRUE if the instruction set can be used on this CPU
+**
+*******************************************************************************/
+BOOLEAN SbcEncSimdSelect(UINT8 u8Level)
+{
+    const tSBC_ENC_SIMD *p_simd = NULL;
+
+    if (u8Level != SBC_SIMD_NONE)
+    {
+        if ((p_simd = sbc_enc_simd_get(u8Level)) == NULL)
+            return FALSE;
+        sbc_enc_simd_prepare();
+    }
+    sbc_enc_simd = p_simd;
+    sbc_enc_simd_selected = TRUE;
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         SbcEncSimdInit
+**
+** Description      Picks the widest instruction set the CPU supports, unless
+**                  one was already chosen.
+**
+** Returns          void
+**
+*******************************************************************************/
+void SbcEncSimdInit(void)
+{
+    if (sbc_enc_simd_selected)
+        return;
+
+    if (!SbcEncSimdSelect(SBC_SIMD_AVX2) &&
+        !SbcEncSimdSelect(SBC_SIMD_SSE2) &&
+        !SbcEncSimdSelect(SBC_SIMD_NEON))
+    {
+        SbcEncSimdSelect(SBC_SIMD_NONE);
+    }
+}
+
+#endif /* SBC_SIMD_OPT */
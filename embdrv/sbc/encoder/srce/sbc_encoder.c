@@ -139,7 +139,10 @@ void SBC_Encoder(SBC_ENC_PARAMS *pstrEncParams)
 #if (SBC_NO_PCM_CPY_OPTION == TRUE)
     pstrEncParams->ps16NextPcmBuffer = pstrEncParams->ps16PcmBuffer;
 #else
-    pstrEncParams->ps16NextPcmBuffer  = pstrEncParams->as16PcmBuffer;
+    if (pstrEncParams->ps16PcmBuffer != NULL)
+        pstrEncParams->ps16NextPcmBuffer = pstrEncParams->ps16PcmBuffer;
+    else
+        pstrEncParams->ps16NextPcmBuffer  = pstrEncParams->as16PcmBuffer;
 #endif
     do
     {
@@ -155,6 +158,15 @@ void SBC_Encoder(SBC_ENC_PARAMS *pstrEncParams)
 
             pstrEncParams->ps16NextPcmBuffer+=s32Ch*s32NumOfBlocks; /* in case of multible sbc frame to encode update the pcm pointer */
 
+#if (SBC_SIMD_OPT == TRUE)
+        if (sbc_enc_simd != NULL)
+        {
+            u32Count = sbc_enc_simd->scale_factors(pstrEncParams->s32SbBuffer, s32Ch, s32NumOfBlocks, ps16ScfL);
+            if (u32Count > maxBit)
+                maxBit = u32Count;
+        }
+        else
+#endif
         for (s32Sb=0; s32Sb<s32Ch; s32Sb++)
         {
             SbBuffer=pstrEncParams->s32SbBuffer+s32Sb;
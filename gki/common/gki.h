@@ -353,15 +353,35 @@ typedef struct _tle
     TIMER_PARAM_TYPE   param;
     UINT16        event;
     UINT8         in_use;
+    UINT16        wheel_slot;       /* wheel slot holding the entry, or GKI_TIMER_EXPIRED */
+    UINT32        expiry;           /* list time (in list units) at which the entry expires */
 } TIMER_LIST_ENT;
 
+/* Timer lists are kept in a hierarchical timing wheel so that adding and
+** removing an entry does not depend on the number of running timers.
+** Level 0 resolves single list units, each higher level is 64 times coarser.
+*/
+#define GKI_TIMER_WHEEL_BITS    6
+#define GKI_TIMER_WHEEL_SIZE    (1 << GKI_TIMER_WHEEL_BITS)
+#define GKI_TIMER_WHEEL_MASK    (GKI_TIMER_WHEEL_SIZE - 1)
+#define GKI_TIMER_WHEEL_LEVELS  4
+#define GKI_TIMER_EXPIRED       0xFFFF
+
 /* Define a timer list queue
+**
+** p_first/p_last hold the expired entries (ticks == 0) in expiry order.  While
+** no entry has expired but timers are still running, p_first points to the
+** 'pending' placeholder, which is never in use and never expires, so that
+** "p_first == NULL" still means the list is empty.
 */
 typedef struct
 {
     TIMER_LIST_ENT   *p_first;
     TIMER_LIST_ENT   *p_last;
-    INT32             last_ticks;
+    UINT32            now;              /* list time of the last update */
+    UINT16            wheel_count[GKI_TIMER_WHEEL_LEVELS];
+    TIMER_LIST_ENT    pending;
+    TIMER_LIST_ENT   *wheel[GKI_TIMER_WHEEL_LEVELS][GKI_TIMER_WHEEL_SIZE];
 } TIMER_LIST_Q;
 
 
@@ -16,6 +16,7 @@
  *
  ******************************************************************************/
 #include "gki_int.h"
+#include <string.h>
 #include <cutils/log.h>
 
 #if (GKI_NUM_TOTAL_BUF_POOLS > 16)
@@ -24,6 +25,11 @@
 
 static void gki_add_to_pool_list(UINT8 pool_id);
 static void gki_remove_from_pool_list(UINT8 pool_id);
+static void gki_build_size_classes(void);
+
+/* Incremented whenever the pools are (re)initialized or released, so that
+** thread caches filled from an earlier generation are discarded. */
+static volatile UINT32 gki_buf_gen;
 
 /*******************************************************************************
 **
@@ -97,7 +103,7 @@ static BOOLEAN gki_alloc_free_queue(UINT8 id)
     tGKI_COM_CB *p_cb = &gki_cb.com;
     GKI_TRACE("\ngki_alloc_free_queue in, id:%d \n", (int)id );
 
-    Q = &p_cb->freeq[p_cb->pool_list[id]];
+    Q = &p_cb->freeq[id];
 
     if(Q->p_first == 0)
     {
@@ -121,6 +127,9 @@ void gki_dealloc_free_queue(void)
     UINT8   i;
     tGKI_COM_CB *p_cb = &gki_cb.com;
 
+    /* buffers still parked in thread caches point into the memory freed below */
+    gki_buf_gen++;
+
     for (i=0; i < p_cb->curr_total_no_of_pools; i++)
     {
         if ( 0 < p_cb->freeq[i].max_cnt )
@@ -142,6 +151,511 @@ void gki_dealloc_free_queue(void)
 #endif
 // btla-specific --
 
+/*******************************************************************************
+**
+** Function         gki_buf_count_inc
+**
+** Description      Internal function to account for a buffer handed out of a
+**                  pool. The counters are updated atomically because buffers
+**                  served from a thread cache do not take the GKI mutex.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_buf_count_inc (FREE_QUEUE_T *Q)
+{
+    UINT16 cnt = __sync_add_and_fetch(&Q->cur_cnt, 1);
+    UINT16 max;
+
+    while ((max = Q->max_cnt) < cnt)
+    {
+        if (__sync_bool_compare_and_swap(&Q->max_cnt, max, cnt))
+            break;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         gki_buf_count_dec
+**
+** Description      Internal function to account for a buffer returned to a pool.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_buf_count_dec (FREE_QUEUE_T *Q)
+{
+    UINT16 cnt;
+
+    while ((cnt = Q->cur_cnt) > 0)
+    {
+        if (__sync_bool_compare_and_swap(&Q->cur_cnt, cnt, cnt - 1))
+            break;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         gki_freeq_dequeue
+**
+** Description      Internal function to unlink the first buffer of a free
+**                  queue, allocating the pool memory first if it was deferred.
+**                  Must be called with GKI disabled.
+**
+** Returns          the buffer header, or NULL if the free queue is empty
+**
+*******************************************************************************/
+static BUFFER_HDR_T *gki_freeq_dequeue (UINT8 pool_id)
+{
+    FREE_QUEUE_T  *Q = &gki_cb.com.freeq[pool_id];
+    BUFFER_HDR_T  *p_hdr;
+
+// btla-specific ++
+#ifdef GKI_USE_DEFERED_ALLOC_BUF_POOLS
+    if (Q->p_first == 0 && gki_cb.com.pool_start[pool_id] == NULL && Q->total != 0)
+    {
+        if (gki_alloc_free_queue(pool_id) != TRUE)
+            return (NULL);
+    }
+#endif
+// btla-specific --
+
+    if ((p_hdr = Q->p_first) == NULL)
+        return (NULL);
+
+    Q->p_first = p_hdr->p_next;
+
+    if (!Q->p_first)
+        Q->p_last = NULL;
+
+    return (p_hdr);
+}
+
+/*******************************************************************************
+**
+** Function         gki_freeq_enqueue
+**
+** Description      Internal function to append a chain of free buffers to the
+**                  end of a free queue. Must be called with GKI disabled.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_freeq_enqueue (UINT8 pool_id, BUFFER_HDR_T *p_first, BUFFER_HDR_T *p_last)
+{
+    FREE_QUEUE_T  *Q = &gki_cb.com.freeq[pool_id];
+
+    if (Q->p_last)
+        Q->p_last->p_next = p_first;
+    else
+        Q->p_first = p_first;
+
+    Q->p_last       = p_last;
+    p_last->p_next  = NULL;
+}
+
+#if (GKI_USE_BUF_CACHE == TRUE)
+/* List of all thread caches, so that a thread that finds a pool empty can
+** reclaim the buffers other threads are holding. Modified with GKI disabled. */
+static tGKI_BUF_CACHE *gki_buf_cache_list;
+
+/*******************************************************************************
+**
+** Function         gki_buf_cache_lock
+**
+** Description      Internal functions to lock and unlock a thread cache. The
+**                  owning thread holds the lock for a few instructions only,
+**                  and never while taking the GKI mutex.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_buf_cache_lock (tGKI_BUF_CACHE *p_cache)
+{
+    while (__sync_lock_test_and_set(&p_cache->lock, 1))
+    {
+        while (p_cache->lock)
+            ;
+    }
+}
+
+static void gki_buf_cache_unlock (tGKI_BUF_CACHE *p_cache)
+{
+    __sync_lock_release(&p_cache->lock);
+}
+
+/*******************************************************************************
+**
+** Function         gki_buf_cache_get
+**
+** Description      Internal function to get the buffer cache of the calling
+**                  thread, creating it on first use. A cache left over from a
+**                  previous pool generation is emptied without touching its
+**                  buffers, since their memory has been released.
+**
+** Returns          pointer to the cache, or NULL if none could be created
+**
+*******************************************************************************/
+static tGKI_BUF_CACHE *gki_buf_cache_get (void)
+{
+    tGKI_BUF_CACHE *p_cache = gki_os_get_buf_cache();
+
+    if (p_cache == NULL)
+    {
+        if ((p_cache = (tGKI_BUF_CACHE *)GKI_os_malloc(sizeof(tGKI_BUF_CACHE))) == NULL)
+            return (NULL);
+
+        memset(p_cache, 0, sizeof(tGKI_BUF_CACHE));
+        p_cache->gen = gki_buf_gen;
+        gki_os_set_buf_cache(p_cache);
+
+        GKI_disable();
+        p_cache->p_next = gki_buf_cache_list;
+        gki_buf_cache_list = p_cache;
+        GKI_enable();
+    }
+    else if (p_cache->gen != gki_buf_gen)
+    {
+        gki_buf_cache_lock(p_cache);
+        memset(p_cache->p_first, 0, sizeof(p_cache->p_first));
+        memset(p_cache->count, 0, sizeof(p_cache->count));
+        p_cache->gen = gki_buf_gen;
+        gki_buf_cache_unlock(p_cache);
+    }
+
+    return (p_cache);
+}
+
+/*******************************************************************************
+**
+** Function         gki_buf_cache_detach
+**
+** Description      Internal function to unlink up to num buffers from the head
+**                  of a thread cache. Must be called with the cache locked.
+**
+** Returns          the first unlinked buffer, or NULL if none; *pp_last is set
+**                  to the last one
+**
+*******************************************************************************/
+static BUFFER_HDR_T *gki_buf_cache_detach (tGKI_BUF_CACHE *p_cache, UINT8 pool_id, UINT8 num,
+                                           BUFFER_HDR_T **pp_last)
+{
+    BUFFER_HDR_T  *p_first = p_cache->p_first[pool_id];
+    BUFFER_HDR_T  *p_last  = p_first;
+
+    if (!p_first || !num)
+        return (NULL);
+
+    p_cache->count[pool_id]--;
+    while (--num && p_last->p_next)
+    {
+        p_last = p_last->p_next;
+        p_cache->count[pool_id]--;
+    }
+
+    p_cache->p_first[pool_id] = p_last->p_next;
+
+    *pp_last = p_last;
+    return (p_first);
+}
+
+/*******************************************************************************
+**
+** Function         gki_buf_cache_reclaim
+**
+** Description      Internal function to move the buffers of a pool held in all
+**                  thread caches back to the pool free queue. Called when the
+**                  free queue ran dry, since a thread that only frees buffers
+**                  of a pool never gives its cached ones back by itself.
+**                  Must be called with GKI disabled.
+**
+** Returns          TRUE if any buffer was reclaimed
+**
+*******************************************************************************/
+static BOOLEAN gki_buf_cache_reclaim (UINT8 pool_id)
+{
+    tGKI_BUF_CACHE *p_cache;
+    BUFFER_HDR_T   *p_first, *p_last;
+    BOOLEAN         found = FALSE;
+
+    if (pool_id >= GKI_NUM_FIXED_BUF_POOLS || gki_cb.com.buf_cache_limit[pool_id] == 0)
+        return (FALSE);
+
+    for (p_cache = gki_buf_cache_list; p_cache; p_cache = p_cache->p_next)
+    {
+        gki_buf_cache_lock(p_cache);
+
+        p_first = NULL;
+        if (p_cache->gen == gki_buf_gen)
+            p_first = gki_buf_cache_detach(p_cache, pool_id, p_cache->count[pool_id], &p_last);
+
+        gki_buf_cache_unlock(p_cache);
+
+        if (p_first)
+        {
+            gki_freeq_enqueue(pool_id, p_first, p_last);
+            found = TRUE;
+        }
+    }
+
+    return (found);
+}
+
+/*******************************************************************************
+**
+** Function         gki_buf_cache_release
+**
+** Description      Called by the OS layer when a thread exits to return all of
+**                  its cached buffers to the pools.
+**
+** Returns          void
+**
+*******************************************************************************/
+void gki_buf_cache_release (void *p)
+{
+    tGKI_BUF_CACHE  *p_cache = (tGKI_BUF_CACHE *)p;
+    tGKI_BUF_CACHE **pp;
+    BUFFER_HDR_T    *p_first, *p_last;
+    UINT8            i;
+
+    if (p_cache == NULL)
+        return;
+
+    GKI_disable();
+
+    for (pp = &gki_buf_cache_list; *pp; pp = &(*pp)->p_next)
+    {
+        if (*pp == p_cache)
+        {
+            *pp = p_cache->p_next;
+            break;
+        }
+    }
+
+    if (p_cache->gen == gki_buf_gen)
+    {
+        for (i = 0; i < GKI_NUM_FIXED_BUF_POOLS; i++)
+        {
+            if ((p_first = gki_buf_cache_detach(p_cache, i, p_cache->count[i], &p_last)) != NULL)
+                gki_freeq_enqueue(i, p_first, p_last);
+        }
+    }
+
+    GKI_enable();
+
+    GKI_os_free(p_cache);
+}
+
+/*******************************************************************************
+**
+** Function         gki_buf_cache_alloc
+**
+** Description      Internal function to take a buffer from the calling thread's
+**                  cache. When the cache is empty it is refilled with a batch
+**                  of buffers from the pool free queue.
+**
+** Returns          the buffer header, or NULL if the pool is not cached or
+**                  has no free buffers
+**
+*******************************************************************************/
+static BUFFER_HDR_T *gki_buf_cache_alloc (UINT8 pool_id)
+{
+    tGKI_BUF_CACHE *p_cache;
+    BUFFER_HDR_T   *p_hdr;
+    BUFFER_HDR_T   *p_batch = NULL;
+    UINT8           limit, num, got = 0;
+
+    if (pool_id >= GKI_NUM_FIXED_BUF_POOLS || (limit = gki_cb.com.buf_cache_limit[pool_id]) == 0)
+        return (NULL);
+
+    if ((p_cache = gki_buf_cache_get()) == NULL)
+        return (NULL);
+
+    gki_buf_cache_lock(p_cache);
+    if ((p_hdr = p_cache->p_first[pool_id]) != NULL)
+    {
+        p_cache->p_first[pool_id] = p_hdr->p_next;
+        p_cache->count[pool_id]--;
+    }
+    gki_buf_cache_unlock(p_cache);
+
+    if (p_hdr)
+        return (p_hdr);
+
+    /* Refill outside of the cache lock, the GKI mutex is never taken under it */
+    GKI_disable();
+    for (num = limit / 2; num > 0; num--)
+    {
+        if ((p_hdr = gki_freeq_dequeue(pool_id)) == NULL)
+            break;
+
+        p_hdr->p_next = p_batch;
+        p_batch = p_hdr;
+        got++;
+    }
+    GKI_enable();
+
+    if (p_batch == NULL)
+        return (NULL);
+
+    /* Keep the first buffer of the batch for the caller */
+    p_hdr = p_batch;
+    if (--got)
+    {
+        gki_buf_cache_lock(p_cache);
+        p_cache->p_first[pool_id] = p_hdr->p_next;
+        p_cache->count[pool_id]   = got;
+        gki_buf_cache_unlock(p_cache);
+    }
+
+    return (p_hdr);
+}
+
+/*******************************************************************************
+**
+** Function         gki_buf_cache_free
+**
+** Description      Internal function to park a freed buffer in the calling
+**                  thread's cache. Once the cache goes over its limit, half
+**                  of it is returned to the pool free queue.
+**
+** Returns          TRUE if the buffer was cached, FALSE if the caller must
+**                  return it to the free queue itself
+**
+*******************************************************************************/
+static BOOLEAN gki_buf_cache_free (BUFFER_HDR_T *p_hdr)
+{
+    tGKI_BUF_CACHE *p_cache;
+    BUFFER_HDR_T   *p_first = NULL, *p_last;
+    UINT8           pool_id = p_hdr->q_id;
+    UINT8           limit;
+
+    if (pool_id >= GKI_NUM_FIXED_BUF_POOLS || (limit = gki_cb.com.buf_cache_limit[pool_id]) == 0)
+        return (FALSE);
+
+    if ((p_cache = gki_buf_cache_get()) == NULL)
+        return (FALSE);
+
+    gki_buf_cache_lock(p_cache);
+
+    p_hdr->p_next = p_cache->p_first[pool_id];
+    p_cache->p_first[pool_id] = p_hdr;
+
+    if (++p_cache->count[pool_id] > limit)
+        p_first = gki_buf_cache_detach(p_cache, pool_id,
+                                       (UINT8)(p_cache->count[pool_id] - limit / 2), &p_last);
+
+    gki_buf_cache_unlock(p_cache);
+
+    if (p_first)
+    {
+        GKI_disable();
+        gki_freeq_enqueue(pool_id, p_first, p_last);
+        GKI_enable();
+    }
+
+    return (TRUE);
+}
+#endif  /* GKI_USE_BUF_CACHE */
+
+/*******************************************************************************
+**
+** Function         gki_alloc_buf_hdr
+**
+** Description      Internal function to take a free buffer out of a pool,
+**                  first from the calling thread's cache and otherwise from
+**                  the pool free queue, and mark it as owned by the caller.
+**
+** Returns          the buffer header, or NULL if the pool has no free buffers
+**
+*******************************************************************************/
+static BUFFER_HDR_T *gki_alloc_buf_hdr (UINT8 pool_id)
+{
+    BUFFER_HDR_T  *p_hdr;
+
+#if (GKI_USE_BUF_CACHE == TRUE)
+    if ((p_hdr = gki_buf_cache_alloc(pool_id)) == NULL)
+#endif
+    {
+        /* Make sure the buffers aren't disturbed til finished with allocation */
+        GKI_disable();
+        p_hdr = gki_freeq_dequeue(pool_id);
+#if (GKI_USE_BUF_CACHE == TRUE)
+        /* The free buffers may all be parked in other threads' caches */
+        if (p_hdr == NULL && gki_buf_cache_reclaim(pool_id))
+            p_hdr = gki_freeq_dequeue(pool_id);
+#endif
+        GKI_enable();
+
+        if (p_hdr == NULL)
+            return (NULL);
+    }
+
+    gki_buf_count_inc(&gki_cb.com.freeq[pool_id]);
+
+    p_hdr->task_id = GKI_get_taskid();
+
+    p_hdr->status  = BUF_STATUS_UNLINKED;
+    p_hdr->p_next  = NULL;
+    p_hdr->Type    = 0;
+
+    return (p_hdr);
+}
+
+/*******************************************************************************
+**
+** Function         gki_build_size_classes
+**
+** Description      Internal function to rebuild the size class table used by
+**                  GKI_getbuf. Each entry holds the index in pool_list of the
+**                  first pool large enough for the smallest size of the class,
+**                  so a lookup replaces the linear scan over the pools.
+**                  Also computes the per-thread cache limit of each pool.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_build_size_classes(void)
+{
+    tGKI_COM_CB *p_cb = &gki_cb.com;
+    UINT32       cls;
+    UINT8        i = 0;
+    UINT16       limit;
+
+    for (cls = 0; cls < GKI_NUM_SIZE_CLASSES; cls++)
+    {
+        /* smallest size that falls in this class */
+        while ((i < p_cb->curr_total_no_of_pools) &&
+               (p_cb->freeq[p_cb->pool_list[i]].size < (cls << GKI_SIZE_CLASS_SHIFT) + 1))
+            i++;
+
+        p_cb->size_class[cls] = i;
+    }
+
+    for (i = 0; i < GKI_NUM_TOTAL_BUF_POOLS; i++)
+    {
+        limit = 0;
+#if (GKI_USE_BUF_CACHE == TRUE)
+        if (i < GKI_NUM_FIXED_BUF_POOLS)
+        {
+            limit = p_cb->freeq[i].total / GKI_BUF_CACHE_SHARE;
+            if (limit > GKI_BUF_CACHE_MAX)
+                limit = GKI_BUF_CACHE_MAX;
+            if (limit < GKI_BUF_CACHE_MIN)
+                limit = 0;
+        }
+#if (defined(OBX_OVER_L2CAP_INCLUDED) && OBX_OVER_L2CAP_INCLUDED == TRUE)
+#if (defined(OBX_OVER_L2C_DYNAMIC_POOL_ENABLED) && OBX_OVER_L2C_DYNAMIC_POOL_ENABLED == TRUE)
+        /* buffers of this pool are malloc'ed one by one */
+        if (i == GKI_POOL_ID_10)
+            limit = 0;
+#endif
+#endif
+#endif
+        p_cb->buf_cache_limit[i] = (UINT8)limit;
+    }
+}
+
 /*******************************************************************************
 **
 ** Function         gki_buffer_init
@@ -327,6 +841,9 @@ void gki_buffer_init(void)
 
     p_cb->curr_total_no_of_pools = GKI_NUM_FIXED_BUF_POOLS;
 
+    gki_build_size_classes();
+    gki_buf_gen++;
+
     return;
 }
 
@@ -368,7 +885,7 @@ void GKI_init_q (BUFFER_Q *p_q)
 void *GKI_getbuf (UINT16 size)
 {
     UINT8         i;
-    FREE_QUEUE_T  *Q;
+    UINT8         pool_id;
     BUFFER_HDR_T  *p_hdr;
     tGKI_COM_CB *p_cb = &gki_cb.com;
 
@@ -378,12 +895,9 @@ void *GKI_getbuf (UINT16 size)
         return (NULL);
     }
 
-    /* Find the first buffer pool that is public that can hold the desired size */
-    for (i=0; i < p_cb->curr_total_no_of_pools; i++)
-    {
-        if ( size <= p_cb->freeq[p_cb->pool_list[i]].size )
-            break;
-    }
+    /* Find the first buffer pool that can hold the desired size */
+    i = (size > MAX_USER_BUF_SIZE) ? p_cb->curr_total_no_of_pools
+                                   : p_cb->size_class[GKI_SIZE_CLASS(size)];
 
     if(i == p_cb->curr_total_no_of_pools)
     {
@@ -395,52 +909,22 @@ void *GKI_getbuf (UINT16 size)
         return NULL;
 #endif
 
-    /* Make sure the buffers aren't disturbed til finished with allocation */
-    GKI_disable();
-
     /* search the public buffer pools that are big enough to hold the size
      * until a free buffer is found */
     for ( ; i < p_cb->curr_total_no_of_pools; i++)
     {
+        pool_id = p_cb->pool_list[i];
+
         /* Only look at PUBLIC buffer pools (bypass RESTRICTED pools) */
-        if (((UINT16)1 << p_cb->pool_list[i]) & p_cb->pool_access_mask)
+        if (((UINT16)1 << pool_id) & p_cb->pool_access_mask)
+            continue;
+        if ( size > p_cb->freeq[pool_id].size )
             continue;
-        if ( size <= p_cb->freeq[p_cb->pool_list[i]].size )
-             Q = &p_cb->freeq[p_cb->pool_list[i]];
-        else
-             continue;
-
-        if(Q->cur_cnt < Q->total)
-        {
-// btla-specific ++
-        #ifdef GKI_USE_DEFERED_ALLOC_BUF_POOLS
-            if(Q->p_first == 0 && gki_alloc_free_queue(i) != TRUE)
-                return NULL;
-        #endif
-// btla-specific --
-            p_hdr = Q->p_first;
-            Q->p_first = p_hdr->p_next;
-
-            if (!Q->p_first)
-                Q->p_last = NULL;
-
-            if(++Q->cur_cnt > Q->max_cnt)
-                Q->max_cnt = Q->cur_cnt;
-
-            GKI_enable();
-
-            p_hdr->task_id = GKI_get_taskid();
-
-            p_hdr->status  = BUF_STATUS_UNLINKED;
-            p_hdr->p_next  = NULL;
-            p_hdr->Type    = 0;
 
+        if ((p_hdr = gki_alloc_buf_hdr(pool_id)) != NULL)
             return ((void *) ((UINT8 *)p_hdr + BUFFER_HDR_SIZE));
-        }
     }
 
-    GKI_enable();
-
     GKI_exception (GKI_ERROR_OUT_OF_BUFFERS, "getbuf: out of buffers");
     return (NULL);
 }
@@ -463,7 +947,6 @@ void *GKI_getbuf (UINT16 size)
 *******************************************************************************/
 void *GKI_getpoolbuf (UINT8 pool_id)
 {
-    FREE_QUEUE_T  *Q;
     BUFFER_HDR_T  *p_hdr;
     tGKI_COM_CB *p_cb = &gki_cb.com;
 
@@ -473,71 +956,47 @@ void *GKI_getpoolbuf (UINT8 pool_id)
         return (NULL);
     }
 
-    /* Make sure the buffers aren't disturbed til finished with allocation */
-    GKI_disable();
-
-    Q = &p_cb->freeq[pool_id];
-    if(Q->cur_cnt < Q->total)
-    {
-
 #if (defined(OBX_OVER_L2CAP_INCLUDED) && OBX_OVER_L2CAP_INCLUDED == TRUE)
 #if (defined(OBX_OVER_L2C_DYNAMIC_POOL_ENABLED) && OBX_OVER_L2C_DYNAMIC_POOL_ENABLED == TRUE)
+    if(pool_id == GKI_POOL_ID_10)
+    {
+        FREE_QUEUE_T    *Q = &p_cb->freeq[pool_id];
         UINT32          *magic;
-        if(pool_id == GKI_POOL_ID_10)
-        {
-            void* p_mem = GKI_os_malloc((Q->size + BUFFER_PADDING_SIZE));
-
-            if(p_mem)
-            {
-                p_hdr = (BUFFER_HDR_T *)p_mem;
-                p_hdr->task_id = GKI_INVALID_TASK;
-                p_hdr->q_id    = pool_id;
-                p_hdr->status  = BUF_STATUS_UNLINKED;
-                magic        = (UINT32 *)((UINT8 *)p_hdr + BUFFER_HDR_SIZE + Q->size);
-                *magic       = MAGIC_NO;
-                p_hdr->p_next = NULL;
-                p_hdr->Type    = 0;
-
-                if(++Q->cur_cnt > Q->max_cnt)
-                    Q->max_cnt = Q->cur_cnt;
-
-                GKI_enable();
-
-                return ((void *) ((UINT8 *)p_hdr + BUFFER_HDR_SIZE));
-            }
-        }
-#endif
-#endif
+        void            *p_mem = NULL;
 
-// btla-specific ++
-#ifdef GKI_USE_DEFERED_ALLOC_BUF_POOLS
-        if(Q->p_first == 0 && gki_alloc_free_queue(pool_id) != TRUE)
-            return NULL;
-#endif
-// btla-specific --
-        p_hdr = Q->p_first;
-        Q->p_first = p_hdr->p_next;
-
-        if (!Q->p_first)
-            Q->p_last = NULL;
+        GKI_disable();
+        if(Q->cur_cnt < Q->total)
+            p_mem = GKI_os_malloc((Q->size + BUFFER_PADDING_SIZE));
 
-        if(++Q->cur_cnt > Q->max_cnt)
-            Q->max_cnt = Q->cur_cnt;
+        if(p_mem)
+        {
+            p_hdr = (BUFFER_HDR_T *)p_mem;
+            p_hdr->task_id = GKI_INVALID_TASK;
+            p_hdr->q_id    = pool_id;
+            p_hdr->status  = BUF_STATUS_UNLINKED;
+            magic        = (UINT32 *)((UINT8 *)p_hdr + BUFFER_HDR_SIZE + Q->size);
+            *magic       = MAGIC_NO;
+            p_hdr->p_next = NULL;
+            p_hdr->Type    = 0;
 
-        GKI_enable();
+            gki_buf_count_inc(Q);
 
+            GKI_enable();
 
-        p_hdr->task_id = GKI_get_taskid();
+            return ((void *) ((UINT8 *)p_hdr + BUFFER_HDR_SIZE));
+        }
+        GKI_enable();
 
-        p_hdr->status  = BUF_STATUS_UNLINKED;
-        p_hdr->p_next  = NULL;
-        p_hdr->Type    = 0;
+        /* try for free buffers in public pools */
+        return (GKI_getbuf(p_cb->freeq[pool_id].size));
+    }
+#endif
+#endif
 
+    if ((p_hdr = gki_alloc_buf_hdr(pool_id)) != NULL)
         return ((void *) ((UINT8 *)p_hdr + BUFFER_HDR_SIZE));
-    }
 
     /* If here, no buffers in the specified pool */
-    GKI_enable();
 
     /* try for free buffers in public pools */
     return (GKI_getbuf(p_cb->freeq[pool_id].size));
@@ -582,17 +1041,17 @@ void GKI_freebuf (void *p_buf)
         return;
     }
 
-    GKI_disable();
 #if (defined(OBX_OVER_L2CAP_INCLUDED) && OBX_OVER_L2CAP_INCLUDED == TRUE)
 #if (defined(OBX_OVER_L2C_DYNAMIC_POOL_ENABLED) && OBX_OVER_L2C_DYNAMIC_POOL_ENABLED == TRUE)
     if(p_hdr->q_id == GKI_POOL_ID_10)
     {
         Q  = &gki_cb.com.freeq[p_hdr->q_id];
 
+        GKI_disable();
+
         GKI_os_free(p_hdr);
 
-        if (Q->cur_cnt > 0)
-            Q->cur_cnt--;
+        gki_buf_count_dec(Q);
 
         GKI_enable();
 
@@ -605,18 +1064,18 @@ void GKI_freebuf (void *p_buf)
     ** Release the buffer
     */
     Q  = &gki_cb.com.freeq[p_hdr->q_id];
-    if (Q->p_last)
-        Q->p_last->p_next = p_hdr;
-    else
-        Q->p_first = p_hdr;
 
-    Q->p_last      = p_hdr;
-    p_hdr->p_next  = NULL;
     p_hdr->status  = BUF_STATUS_FREE;
     p_hdr->task_id = GKI_INVALID_TASK;
-    if (Q->cur_cnt > 0)
-        Q->cur_cnt--;
+    gki_buf_count_dec(Q);
+
+#if (GKI_USE_BUF_CACHE == TRUE)
+    if (gki_buf_cache_free(p_hdr))
+        return;
+#endif
 
+    GKI_disable();
+    gki_freeq_enqueue(p_hdr->q_id, p_hdr, p_hdr);
     GKI_enable();
 
     return;
@@ -1228,16 +1687,9 @@ void *GKI_igetpoolbuf (UINT8 pool_id)
 
 
     Q = &gki_cb.com.freeq[pool_id];
-    if(Q->cur_cnt < Q->total)
+    if ((p_hdr = gki_freeq_dequeue(pool_id)) != NULL)
     {
-        p_hdr = Q->p_first;
-        Q->p_first = p_hdr->p_next;
-
-        if (!Q->p_first)
-            Q->p_last = NULL;
-
-        if(++Q->cur_cnt > Q->max_cnt)
-            Q->max_cnt = Q->cur_cnt;
+        gki_buf_count_inc(Q);
 
         p_hdr->task_id = GKI_get_taskid();
 
@@ -1280,7 +1732,9 @@ UINT16 GKI_poolcount (UINT8 pool_id)
 **
 ** Parameters       pool_id - (input) pool ID to get the free count of.
 **
-** Returns          the number of free buffers in the pool
+** Returns          the number of free buffers in the pool, including the ones
+**                  held in thread caches, which GKI_getbuf reclaims when the
+**                  pool free queue runs dry
 **
 *******************************************************************************/
 UINT16 GKI_poolfreecount (UINT8 pool_id)
@@ -1408,10 +1862,11 @@ UINT8 GKI_create_pool (UINT16 size, UINT16 count, UINT8 permission, void *p_mem_
     if (size > MAX_USER_BUF_SIZE)
         return (GKI_INVALID_POOL);
 
-    /* First, look for an unused pool */
+    /* First, look for an unused pool. A fixed pool whose memory is allocated on
+       first use has no pool_start yet but is not free. */
     for (xx = 0; xx < GKI_NUM_TOTAL_BUF_POOLS; xx++)
     {
-        if (!p_cb->pool_start[xx])
+        if (!p_cb->pool_start[xx] && !p_cb->freeq[xx].total)
             break;
     }
 
@@ -1433,6 +1888,7 @@ UINT8 GKI_create_pool (UINT16 size, UINT16 count, UINT8 permission, void *p_mem_
         gki_add_to_pool_list(xx);
         (void) GKI_set_pool_permission (xx, permission);
         p_cb->curr_total_no_of_pools++;
+        gki_build_size_classes();
 
         return (xx);
     }
@@ -1466,6 +1922,11 @@ void GKI_delete_pool (UINT8 pool_id)
 
     if (!Q->cur_cnt)
     {
+#if (GKI_USE_BUF_CACHE == TRUE)
+        /* buffers parked in thread caches point into the memory freed below */
+        gki_buf_cache_reclaim(pool_id);
+#endif
+
         Q->size      = 0;
         Q->total     = 0;
         Q->cur_cnt   = 0;
@@ -1481,6 +1942,7 @@ void GKI_delete_pool (UINT8 pool_id)
 
         gki_remove_from_pool_list(pool_id);
         p_cb->curr_total_no_of_pools--;
+        gki_build_size_classes();
     }
     else
         GKI_exception(GKI_ERROR_DELETE_POOL_BAD_QID, "Deleting bad pool");
@@ -78,6 +78,20 @@ typedef struct _free_queue
 } FREE_QUEUE_T;
 
 
+/* Per-thread cache of free buffers taken from the fixed pools. It is guarded by
+** its own spin lock instead of the GKI mutex; the lock is only contended when
+** another thread reclaims the cached buffers of a pool that ran dry.
+*/
+typedef struct _gki_buf_cache
+{
+    BUFFER_HDR_T *p_first[GKI_NUM_FIXED_BUF_POOLS]; /* cached free buffers, LIFO */
+    UINT8         count[GKI_NUM_FIXED_BUF_POOLS];   /* number of cached buffers */
+    UINT32        gen;                              /* buffer pool generation the cache belongs to */
+    volatile UINT32 lock;                           /* spin lock, see gki_buf_cache_lock() */
+    struct _gki_buf_cache *p_next;                  /* next cache in the list of all caches */
+} tGKI_BUF_CACHE;
+
+
 /* Buffer related defines
 */
 #define ALIGN_POOL(pl_size)  ( (((pl_size) + 3) / sizeof(UINT32)) * sizeof(UINT32))
@@ -86,6 +100,11 @@ typedef struct _free_queue
 #define MAX_USER_BUF_SIZE   ((UINT16)0xffff - BUFFER_PADDING_SIZE)  /* pool size must allow for header */
 #define MAGIC_NO            0xDDBADDBA
 
+/* Size class lookup used by GKI_getbuf to find the first candidate pool */
+#define GKI_SIZE_CLASS_SHIFT 6
+#define GKI_NUM_SIZE_CLASSES ((MAX_USER_BUF_SIZE >> GKI_SIZE_CLASS_SHIFT) + 1)
+#define GKI_SIZE_CLASS(sz)   (((sz) - 1) >> GKI_SIZE_CLASS_SHIFT)
+
 #define BUF_STATUS_FREE     0
 #define BUF_STATUS_UNLINKED 1
 #define BUF_STATUS_QUEUED   2
@@ -323,6 +342,8 @@ typedef struct
     UINT16      pool_access_mask;                   /* Bits are set if the corresponding buffer pool is a restricted pool */
     UINT8       pool_list[GKI_NUM_TOTAL_BUF_POOLS]; /* buffer pools arranged in the order of size */
     UINT8       curr_total_no_of_pools;             /* number of fixed buf pools + current number of dynamic pools */
+    UINT8       size_class[GKI_NUM_SIZE_CLASSES];   /* index into pool_list of the first pool for each size class */
+    UINT8       buf_cache_limit[GKI_NUM_TOTAL_BUF_POOLS]; /* max buffers per thread cache, 0 if pool is not cached */
 
     BOOLEAN     timer_nesting;                      /* flag to prevent timer interrupt nesting */
 
@@ -356,6 +377,18 @@ extern void      gki_adjust_timer_count (INT32);
 extern void      gki_dealloc_free_queue(void);
 #endif
 
+#if (GKI_USE_BUF_CACHE == TRUE)
+extern void      gki_buf_cache_release(void *p_cache);
+extern tGKI_BUF_CACHE *gki_os_get_buf_cache(void);
+extern void      gki_os_set_buf_cache(tGKI_BUF_CACHE *p_cache);
+#endif
+
+#if (GKI_TICKLESS == TRUE)
+extern UINT32    gki_os_tick_count(void);
+extern void      gki_os_timer_sync(void);
+extern void      gki_os_timer_rearm(void);
+#endif
+
 extern void    OSStartRdy(void);
 extern void	   OSCtxSw(void);
 extern void	   OSIntCtxSw(void);
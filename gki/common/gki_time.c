@@ -33,6 +33,9 @@
 #define GKI_UNUSED_LIST_ENTRY   (0x80000000L)   /* Marks an unused timer list entry (initial value) */
 #define GKI_MAX_INT32           (0x7fffffffL)
 
+/* Furthest expiry (in list units) the timer wheel can file directly */
+#define GKI_TIMER_WHEEL_MAX_DELTA ((1UL << (GKI_TIMER_WHEEL_LEVELS * GKI_TIMER_WHEEL_BITS)) - 1)
+
 /*******************************************************************************
 **
 ** Function         gki_timers_init
@@ -149,7 +152,12 @@ BOOLEAN gki_timers_is_timer_running(void)
 *******************************************************************************/
 UINT32  GKI_get_tick_count(void)
 {
+#if (GKI_TICKLESS == TRUE)
+    /* OSTicks only advances when the timer thread wakes up */
+    return gki_os_tick_count();
+#else
     return gki_cb.com.OSTicks;
+#endif
 }
 
 
@@ -216,6 +224,11 @@ void GKI_start_timer (UINT8 tnum, INT32 ticks, BOOLEAN is_continuous)
 
     GKI_disable();
 
+#if (GKI_TICKLESS == TRUE)
+    /* Account for the ticks that passed while the timer thread was asleep */
+    gki_os_timer_sync();
+#endif
+
     if(gki_timers_is_timer_running() == FALSE)
     {
 #if (defined(GKI_DELAY_STOP_SYS_TICK) && (GKI_DELAY_STOP_SYS_TICK > 0))
@@ -628,6 +641,234 @@ void GKI_timer_queue_register_callback (SYSTEM_TICK_CBACK *p_callback)
     return;
 }
 
+/*******************************************************************************
+**
+** Function         gki_timer_list_set_first
+**
+** Description      Internal function to point p_first at the first expired
+**                  entry, at the 'pending' placeholder if only unexpired
+**                  entries are left, or at NULL if the list is empty.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_timer_list_set_first (TIMER_LIST_Q *p_timer_listq)
+{
+    UINT8 level;
+
+    if (p_timer_listq->p_last != NULL)
+        return;
+
+    p_timer_listq->p_first = NULL;
+
+    for (level = 0; level < GKI_TIMER_WHEEL_LEVELS; level++)
+    {
+        if (p_timer_listq->wheel_count[level])
+        {
+            p_timer_listq->p_first = &p_timer_listq->pending;
+            break;
+        }
+    }
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_list_expire
+**
+** Description      Internal function to append an entry to the expired part
+**                  of a timer list.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_timer_list_expire (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT *p_tle)
+{
+    /* We set the number of ticks to '0' so that the legacy code
+     * that assumes a '0' or nonzero value will still work as coded. */
+    p_tle->ticks      = 0;
+    p_tle->wheel_slot = GKI_TIMER_EXPIRED;
+    p_tle->p_next     = NULL;
+    p_tle->p_prev     = p_timer_listq->p_last;
+
+    if (p_timer_listq->p_last == NULL)
+        p_timer_listq->p_first = p_tle;
+    else
+        p_timer_listq->p_last->p_next = p_tle;
+
+    p_timer_listq->p_last = p_tle;
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_wheel_insert
+**
+** Description      Internal function to file an unexpired entry in the wheel
+**                  slot matching its expiry time.  Entries further away than
+**                  the wheel can hold are parked in the last slot reachable
+**                  and filed again when that slot cascades.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_timer_wheel_insert (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT *p_tle)
+{
+    UINT32           delta = p_tle->expiry - p_timer_listq->now;
+    UINT32           slot_time = p_tle->expiry;
+    UINT8            level = 0;
+    UINT8            idx;
+
+    while ((level < GKI_TIMER_WHEEL_LEVELS - 1) &&
+           (delta >= (1UL << ((level + 1) * GKI_TIMER_WHEEL_BITS))))
+        level++;
+
+    if (delta > GKI_TIMER_WHEEL_MAX_DELTA)
+        slot_time = p_timer_listq->now + GKI_TIMER_WHEEL_MAX_DELTA;
+
+    idx = (UINT8)((slot_time >> (level * GKI_TIMER_WHEEL_BITS)) & GKI_TIMER_WHEEL_MASK);
+
+    p_tle->p_prev = NULL;
+    p_tle->p_next = p_timer_listq->wheel[level][idx];
+    if (p_tle->p_next != NULL)
+        p_tle->p_next->p_prev = p_tle;
+
+    p_timer_listq->wheel[level][idx] = p_tle;
+    p_timer_listq->wheel_count[level]++;
+    p_tle->wheel_slot = (level << GKI_TIMER_WHEEL_BITS) | idx;
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_wheel_unlink
+**
+** Description      Internal function to take an unexpired entry out of its
+**                  wheel slot.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_timer_wheel_unlink (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT *p_tle)
+{
+    UINT8 level = (UINT8)(p_tle->wheel_slot >> GKI_TIMER_WHEEL_BITS);
+    UINT8 idx   = (UINT8)(p_tle->wheel_slot & GKI_TIMER_WHEEL_MASK);
+
+    if (p_tle->p_next != NULL)
+        p_tle->p_next->p_prev = p_tle->p_prev;
+
+    if (p_tle->p_prev != NULL)
+        p_tle->p_prev->p_next = p_tle->p_next;
+    else
+        p_timer_listq->wheel[level][idx] = p_tle->p_next;
+
+    p_timer_listq->wheel_count[level]--;
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_wheel_cascade
+**
+** Description      Internal function to re-file the entries of the current
+**                  slot of a wheel level into the finer levels below it.
+**
+** Returns          index of the slot that was cascaded
+**
+*******************************************************************************/
+static UINT8 gki_timer_wheel_cascade (TIMER_LIST_Q *p_timer_listq, UINT8 level)
+{
+    UINT8            idx = (UINT8)((p_timer_listq->now >> (level * GKI_TIMER_WHEEL_BITS)) & GKI_TIMER_WHEEL_MASK);
+    TIMER_LIST_ENT  *p_tle = p_timer_listq->wheel[level][idx];
+    TIMER_LIST_ENT  *p_next;
+
+    p_timer_listq->wheel[level][idx] = NULL;
+
+    while (p_tle != NULL)
+    {
+        p_next = p_tle->p_next;
+        p_timer_listq->wheel_count[level]--;
+        gki_timer_wheel_insert(p_timer_listq, p_tle);
+        p_tle = p_next;
+    }
+
+    return (idx);
+}
+
+/*******************************************************************************
+**
+** Function         gki_timer_wheel_advance
+**
+** Description      Internal function to move the list time forward, moving
+**                  every entry that expires on the way to the expired part
+**                  of the list.  Stretches in which the lower levels are
+**                  empty are skipped in one step.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_timer_wheel_advance (TIMER_LIST_Q *p_timer_listq, UINT32 units)
+{
+    TIMER_LIST_ENT  *p_tle;
+    TIMER_LIST_ENT  *p_next;
+    UINT32           gap;
+    UINT8            level;
+    UINT8            idx;
+
+    while (units)
+    {
+        /* Find the finest level that holds any entry */
+        for (level = 0; level < GKI_TIMER_WHEEL_LEVELS; level++)
+        {
+            if (p_timer_listq->wheel_count[level])
+                break;
+        }
+
+        if (level == GKI_TIMER_WHEEL_LEVELS)
+        {
+            p_timer_listq->now += units;
+            break;
+        }
+
+        /* Nothing can expire before that level cascades again */
+        if (level > 0)
+        {
+            gap = ((1UL << (level * GKI_TIMER_WHEEL_BITS)) - 1) -
+                  (p_timer_listq->now & ((1UL << (level * GKI_TIMER_WHEEL_BITS)) - 1));
+
+            if (units <= gap)
+            {
+                p_timer_listq->now += units;
+                break;
+            }
+
+            p_timer_listq->now += gap;
+            units -= gap;
+        }
+
+        p_timer_listq->now++;
+        units--;
+
+        idx = (UINT8)(p_timer_listq->now & GKI_TIMER_WHEEL_MASK);
+
+        if (idx == 0)
+        {
+            for (level = 1; level < GKI_TIMER_WHEEL_LEVELS; level++)
+            {
+                if (gki_timer_wheel_cascade(p_timer_listq, level) != 0)
+                    break;
+            }
+        }
+
+        p_tle = p_timer_listq->wheel[0][idx];
+        p_timer_listq->wheel[0][idx] = NULL;
+
+        while (p_tle != NULL)
+        {
+            p_next = p_tle->p_next;
+            p_timer_listq->wheel_count[0]--;
+            gki_timer_list_expire(p_timer_listq, p_tle);
+            p_tle = p_next;
+        }
+    }
+}
+
 /*******************************************************************************
 **
 ** Function         GKI_init_timer_list
@@ -642,9 +883,24 @@ void GKI_timer_queue_register_callback (SYSTEM_TICK_CBACK *p_callback)
 *******************************************************************************/
 void GKI_init_timer_list (TIMER_LIST_Q *p_timer_listq)
 {
+    UINT8 level;
+    UINT8 idx;
+
     p_timer_listq->p_first    = NULL;
     p_timer_listq->p_last     = NULL;
-    p_timer_listq->last_ticks = 0;
+    p_timer_listq->now        = 0;
+
+    for (level = 0; level < GKI_TIMER_WHEEL_LEVELS; level++)
+    {
+        p_timer_listq->wheel_count[level] = 0;
+
+        for (idx = 0; idx < GKI_TIMER_WHEEL_SIZE; idx++)
+            p_timer_listq->wheel[level][idx] = NULL;
+    }
+
+    /* The placeholder never expires, so expiry loops in the callers stop at it */
+    GKI_init_timer_list_entry(&p_timer_listq->pending);
+    p_timer_listq->pending.ticks = GKI_MAX_INT32;
 
     return;
 }
@@ -664,10 +920,12 @@ void GKI_init_timer_list (TIMER_LIST_Q *p_timer_listq)
 *******************************************************************************/
 void GKI_init_timer_list_entry (TIMER_LIST_ENT  *p_tle)
 {
-    p_tle->p_next  = NULL;
-    p_tle->p_prev  = NULL;
-    p_tle->ticks   = GKI_UNUSED_LIST_ENTRY;
-    p_tle->in_use  = FALSE;
+    p_tle->p_next     = NULL;
+    p_tle->p_prev     = NULL;
+    p_tle->ticks      = GKI_UNUSED_LIST_ENTRY;
+    p_tle->in_use     = FALSE;
+    p_tle->wheel_slot = GKI_TIMER_EXPIRED;
+    p_tle->expiry     = 0;
 }
 
 
@@ -693,52 +951,20 @@ UINT16 GKI_update_timer_list (TIMER_LIST_Q *p_timer_listq, INT32 num_units_since
 {
     TIMER_LIST_ENT  *p_tle;
     UINT16           num_time_out = 0;
-    INT32            rem_ticks;
-    INT32            temp_ticks;
 
-    p_tle = p_timer_listq->p_first;
+    GKI_disable();
 
-    /* First, get the guys who have previously timed out */
-    /* Note that the tick value of the timers should always be '0' */
-    while ((p_tle) && (p_tle->ticks <= 0))
+    if (num_units_since_last_update > 0)
     {
-        num_time_out++;
-        p_tle = p_tle->p_next;
+        gki_timer_wheel_advance(p_timer_listq, (UINT32)num_units_since_last_update);
+        gki_timer_list_set_first(p_timer_listq);
     }
 
-    /* Timer entriy tick values are relative to the preceeding entry */
-    rem_ticks = num_units_since_last_update;
-
-    /* Now, adjust remaining timer entries */
-    while ((p_tle != NULL) && (rem_ticks > 0))
-    {
-        temp_ticks = p_tle->ticks;
-        p_tle->ticks -= rem_ticks;
-
-        /* See if this timer has just timed out */
-        if (p_tle->ticks <= 0)
-        {
-            /* We set the number of ticks to '0' so that the legacy code
-             * that assumes a '0' or nonzero value will still work as coded. */
-            p_tle->ticks = 0;
-
-            num_time_out++;
-        }
-
-        rem_ticks -= temp_ticks;  /* Decrement the remaining ticks to process */
-        p_tle = p_tle->p_next;
-    }
-
-    if (p_timer_listq->last_ticks > 0)
-    {
-        p_timer_listq->last_ticks -= num_units_since_last_update;
+    /* Count the expired entries, including the ones that timed out previously */
+    for (p_tle = (p_timer_listq->p_last ? p_timer_listq->p_first : NULL); p_tle != NULL; p_tle = p_tle->p_next)
+        num_time_out++;
 
-        /* If the last timer has expired set last_ticks to 0 so that other list update
-        * functions will calculate correctly
-        */
-        if (p_timer_listq->last_ticks < 0)
-            p_timer_listq->last_ticks = 0;
-    }
+    GKI_enable();
 
     return (num_time_out);
 }
@@ -753,36 +979,18 @@ UINT16 GKI_update_timer_list (TIMER_LIST_Q *p_timer_listq, INT32 num_units_since
 ** Parameters       p_timer_listq   - (input) pointer to the timer list queue object
 **                  p_target_tle    - (input) pointer to a timer list queue entry
 **
-** Returns          0 if timer is not used or timer is not in the list
+** Returns          0 if timer is not used or timer has expired
 **                  remaining ticks if success
 **
 *******************************************************************************/
 UINT32 GKI_get_remaining_ticks (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT  *p_target_tle)
 {
-    TIMER_LIST_ENT  *p_tle;
     UINT32           rem_ticks = 0;
 
     if (p_target_tle->in_use)
     {
-        p_tle = p_timer_listq->p_first;
-
-        /* adding up all of ticks in previous entries */
-        while ((p_tle)&&(p_tle != p_target_tle))
-        {
-            rem_ticks += p_tle->ticks;
-            p_tle = p_tle->p_next;
-        }
-
-        /* if found target entry */
-        if (p_tle == p_target_tle)
-        {
-            rem_ticks += p_tle->ticks;
-        }
-        else
-        {
-            BT_ERROR_TRACE_0(TRACE_LAYER_GKI, "GKI_get_remaining_ticks: No timer entry in the list");
-            return(0);
-        }
+        if (p_target_tle->wheel_slot != GKI_TIMER_EXPIRED)
+            rem_ticks = p_target_tle->expiry - p_timer_listq->now;
     }
     else
     {
@@ -810,65 +1018,22 @@ UINT32 GKI_get_remaining_ticks (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT  *p_
 *******************************************************************************/
 void GKI_add_to_timer_list (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT  *p_tle)
 {
-    UINT32           nr_ticks_total;
     UINT8 tt;
-    TIMER_LIST_ENT  *p_temp;
     /* block others to edit the timer_queue list while it is getting modified */
     GKI_disable();
 
     /* Only process valid tick values */
     if (p_tle->ticks >= 0)
     {
-        /* If this entry is the last in the list */
-        if (p_tle->ticks >= p_timer_listq->last_ticks)
+        if (p_tle->ticks == 0)
         {
-            /* If this entry is the only entry in the list */
-            if (p_timer_listq->p_first == NULL)
-                p_timer_listq->p_first = p_tle;
-            else
-            {
-                /* Insert the entry onto the end of the list */
-                if (p_timer_listq->p_last != NULL)
-                    p_timer_listq->p_last->p_next = p_tle;
-
-                p_tle->p_prev = p_timer_listq->p_last;
-            }
-
-            p_tle->p_next = NULL;
-            p_timer_listq->p_last = p_tle;
-            nr_ticks_total = p_tle->ticks;
-            p_tle->ticks -= p_timer_listq->last_ticks;
-
-            p_timer_listq->last_ticks = nr_ticks_total;
+            gki_timer_list_expire(p_timer_listq, p_tle);
         }
-        else    /* This entry needs to be inserted before the last entry */
+        else
         {
-            /* Find the entry that the new one needs to be inserted in front of */
-            p_temp = p_timer_listq->p_first;
-            while (p_tle->ticks > p_temp->ticks)
-            {
-                /* Update the tick value if looking at an unexpired entry */
-                if (p_temp->ticks > 0)
-                    p_tle->ticks -= p_temp->ticks;
-
-                p_temp = p_temp->p_next;
-            }
-
-            /* The new entry is the first in the list */
-            if (p_temp == p_timer_listq->p_first)
-            {
-                p_tle->p_next = p_timer_listq->p_first;
-                p_timer_listq->p_first->p_prev = p_tle;
-                p_timer_listq->p_first = p_tle;
-            }
-            else
-            {
-                p_temp->p_prev->p_next = p_tle;
-                p_tle->p_prev = p_temp->p_prev;
-                p_temp->p_prev = p_tle;
-                p_tle->p_next = p_temp;
-            }
-            p_temp->ticks -= p_tle->ticks;
+            p_tle->expiry = p_timer_listq->now + (UINT32)p_tle->ticks;
+            gki_timer_wheel_insert(p_timer_listq, p_tle);
+            gki_timer_list_set_first(p_timer_listq);
         }
 
         p_tle->in_use = TRUE;
@@ -923,67 +1088,33 @@ void GKI_remove_from_timer_list (TIMER_LIST_Q *p_timer_listq, TIMER_LIST_ENT  *p
     /* block others to edit the timer_queue list while it is getting modified */
     GKI_disable();
 
-    /* Add the ticks remaining in this timer (if any) to the next guy in the list.
-    ** Note: Expired timers have a tick value of '0'.
-    */
-    if (p_tle->p_next != NULL)
+    if (p_tle->wheel_slot == GKI_TIMER_EXPIRED)
     {
-        p_tle->p_next->ticks += p_tle->ticks;
-    }
-    else
-    {
-        p_timer_listq->last_ticks -= p_tle->ticks;
-    }
-
-    /* Unlink timer from the list.
-    */
-    if (p_timer_listq->p_first == p_tle)
-    {
-        p_timer_listq->p_first = p_tle->p_next;
-
-        if (p_timer_listq->p_first != NULL)
-            p_timer_listq->p_first->p_prev = NULL;
+        /* Unlink timer from the expired part of the list */
+        if (p_tle->p_next != NULL)
+            p_tle->p_next->p_prev = p_tle->p_prev;
+        else
+            p_timer_listq->p_last = p_tle->p_prev;
 
-        if (p_timer_listq->p_last == p_tle)
-            p_timer_listq->p_last = NULL;
+        if (p_tle->p_prev != NULL)
+            p_tle->p_prev->p_next = p_tle->p_next;
+        else
+            p_timer_listq->p_first = p_tle->p_next;
     }
     else
     {
-        if (p_timer_listq->p_last == p_tle)
-        {
-            p_timer_listq->p_last = p_tle->p_prev;
-
-            if (p_timer_listq->p_last != NULL)
-                p_timer_listq->p_last->p_next = NULL;
-        }
-        else
-        {
-            if (p_tle->p_next != NULL && p_tle->p_next->p_prev == p_tle)
-                p_tle->p_next->p_prev = p_tle->p_prev;
-            else
-            {
-                /* Error case - chain messed up ?? */
-                GKI_enable();
-                return;
-            }
-
-            if (p_tle->p_prev != NULL && p_tle->p_prev->p_next == p_tle)
-                p_tle->p_prev->p_next = p_tle->p_next;
-            else
-            {
-                /* Error case - chain messed up ?? */
-                GKI_enable();
-                return;
-            }
-        }
+        gki_timer_wheel_unlink(p_timer_listq, p_tle);
     }
 
+    gki_timer_list_set_first(p_timer_listq);
+
     p_tle->p_next = p_tle->p_prev = NULL;
     p_tle->ticks = GKI_UNUSED_LIST_ENTRY;
     p_tle->in_use = FALSE;
+    p_tle->wheel_slot = GKI_TIMER_EXPIRED;
 
     /* if timer queue is empty */
-    if (p_timer_listq->p_first == NULL && p_timer_listq->p_last == NULL)
+    if (p_timer_listq->p_first == NULL)
     {
         for (tt = 0; tt < GKI_MAX_TIMER_QUEUES; tt++)
         {
@@ -1025,6 +1156,11 @@ void gki_adjust_timer_count (INT32 ticks)
         {
             gki_cb.com.OSNumOrigTicks = (gki_cb.com.OSNumOrigTicks - gki_cb.com.OSTicksTilExp) + ticks;
             gki_cb.com.OSTicksTilExp = ticks;
+
+#if (GKI_TICKLESS == TRUE)
+            /* The timer thread may be sleeping until a later expiration */
+            gki_os_timer_rearm();
+#endif
         }
     }
 
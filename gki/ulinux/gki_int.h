@@ -79,6 +79,12 @@ typedef struct
     int                 no_timer_suspend;   /* 1: no suspend, 0 stop calling GKI_timer_update() */
     pthread_mutex_t     gki_timer_mutex;
     pthread_cond_t      gki_timer_cond;
+#if (GKI_TICKLESS == TRUE)
+    pthread_mutex_t     gki_tickless_mutex;
+    pthread_cond_t      gki_tickless_cond;  /* wakes the timer thread on an earlier expiration */
+    BOOLEAN             tickless_rearm;
+    struct timespec     tickless_base;      /* monotonic time of the last accounted tick */
+#endif
 #if (GKI_DEBUG == TRUE)
     pthread_mutex_t     GKI_trace_mutex;
 #endif
@@ -79,6 +79,7 @@
 
 /* works only for 1ms to 1000ms heart beat ranges */
 #define LINUX_SEC (1000/TICKS_PER_SEC)
+#define LINUX_TICK_NSEC (LINUX_SEC * NANOSEC_PER_MILLISEC)
 
 #define LOCK(m)  pthread_mutex_lock(&m)
 #define UNLOCK(m) pthread_mutex_unlock(&m)
@@ -187,6 +188,9 @@ void gki_task_entry(UINT32 params)
 void GKI_init(void)
 {
     pthread_mutexattr_t attr;
+#if (GKI_TICKLESS == TRUE)
+    pthread_condattr_t  cond_attr;
+#endif
     tGKI_OS             *p_os;
 
     memset (&gki_cb, 0, sizeof (gki_cb));
@@ -216,6 +220,15 @@ void GKI_init(void)
 #ifndef NO_GKI_RUN_RETURN
     pthread_cond_init(&p_os->gki_timer_cond, NULL);
 #endif
+
+#if (GKI_TICKLESS == TRUE)
+    /* the tickless timer thread sleeps on absolute CLOCK_MONOTONIC deadlines */
+    pthread_mutex_init(&p_os->gki_tickless_mutex, NULL);
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&p_os->gki_tickless_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+#endif
 }
 
 
@@ -230,8 +243,12 @@ void GKI_init(void)
 *******************************************************************************/
 UINT32 GKI_get_os_tick_count(void)
 {
+#if (GKI_TICKLESS == TRUE)
+    return gki_os_tick_count();
+#else
      /* TODO - add any OS specific code here */
     return (gki_cb.com.OSTicks);
+#endif
 }
 
 /*******************************************************************************
@@ -597,6 +614,10 @@ void gki_system_tick_start_stop_cback(BOOLEAN start)
         *p_run_cond = GKI_TIMER_TICK_RUN_COND;
 
 #ifdef NO_GKI_RUN_RETURN
+#if (GKI_TICKLESS == TRUE)
+        /* time spent with the tick stopped is not counted */
+        clock_gettime(CLOCK_MONOTONIC, &p_os->tickless_base);
+#endif
         pthread_mutex_unlock( &p_os->gki_timer_mutex );
 #else
         pthread_mutex_lock( &p_os->gki_timer_mutex );
@@ -609,6 +630,220 @@ void gki_system_tick_start_stop_cback(BOOLEAN start)
 }
 
 
+#if defined(NO_GKI_RUN_RETURN) && (GKI_TICKLESS == TRUE)
+/*******************************************************************************
+**
+** Function         gki_tickless_elapsed
+**
+** Description      Returns the number of whole ticks elapsed since the last
+**                  accounted tick and moves the tick base forward by as many
+**                  ticks, so that fractions of a tick are not lost.
+**                  Must be called with GKI disabled.
+**
+** Returns          number of elapsed ticks
+**
+*******************************************************************************/
+static INT32 gki_tickless_elapsed(void)
+{
+    tGKI_OS         *p_os = &gki_cb.os;
+    struct timespec current;
+    long long       delta_ns;
+    INT32           ticks;
+
+    clock_gettime(CLOCK_MONOTONIC, &current);
+
+    delta_ns = (long long)(current.tv_sec - p_os->tickless_base.tv_sec) * NSEC_PER_SEC;
+    delta_ns += current.tv_nsec - p_os->tickless_base.tv_nsec;
+
+    if (delta_ns < LINUX_TICK_NSEC)
+        return 0;
+
+    ticks = (INT32)(delta_ns / LINUX_TICK_NSEC);
+
+    delta_ns = p_os->tickless_base.tv_nsec + (long long)ticks * LINUX_TICK_NSEC;
+    p_os->tickless_base.tv_sec += delta_ns / NSEC_PER_SEC;
+    p_os->tickless_base.tv_nsec = delta_ns % NSEC_PER_SEC;
+
+    return ticks;
+}
+#endif
+
+#if (GKI_TICKLESS == TRUE)
+/*******************************************************************************
+**
+** Function         gki_os_tick_count
+**
+** Description      Returns the GKI tick count including the ticks that elapsed
+**                  since the timer thread last ran. The timer thread may sleep
+**                  up to GKI_TICKLESS_MAX_TICKS, so gki_cb.com.OSTicks alone
+**                  can be stale. The pending ticks are not consumed here; the
+**                  timer thread still accounts them to the timers.
+**
+** Returns          current tick count
+**
+*******************************************************************************/
+UINT32 gki_os_tick_count(void)
+{
+    UINT32 ticks;
+#ifdef NO_GKI_RUN_RETURN
+    tGKI_OS         *p_os = &gki_cb.os;
+    struct timespec current;
+    long long       delta_ns;
+#endif
+
+    GKI_disable();
+
+    ticks = gki_cb.com.OSTicks;
+
+#ifdef NO_GKI_RUN_RETURN
+    /* the tick count does not advance while the system tick is stopped */
+    if (p_os->no_timer_suspend == GKI_TIMER_TICK_RUN_COND)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &current);
+
+        delta_ns = (long long)(current.tv_sec - p_os->tickless_base.tv_sec) * NSEC_PER_SEC;
+        delta_ns += current.tv_nsec - p_os->tickless_base.tv_nsec;
+
+        if (delta_ns >= LINUX_TICK_NSEC)
+            ticks += (UINT32)(delta_ns / LINUX_TICK_NSEC);
+    }
+#endif
+
+    GKI_enable();
+
+    return ticks;
+}
+
+/*******************************************************************************
+**
+** Function         gki_os_timer_sync
+**
+** Description      Brings the GKI tick count and timers up to date with the
+**                  time elapsed since the timer thread last ran.
+**                  Must be called with GKI disabled.
+**
+** Returns          void
+**
+*******************************************************************************/
+void gki_os_timer_sync(void)
+{
+#ifdef NO_GKI_RUN_RETURN
+    INT32 ticks;
+
+    /* the tick base is reset when the system tick restarts */
+    if (gki_cb.os.no_timer_suspend != GKI_TIMER_TICK_RUN_COND)
+        return;
+
+    if ((ticks = gki_tickless_elapsed()) > 0)
+        GKI_timer_update(ticks);
+#endif
+}
+
+/*******************************************************************************
+**
+** Function         gki_os_timer_rearm
+**
+** Description      Wakes up the timer thread so that it recomputes its sleep
+**                  time after the next timer expiration moved earlier.
+**
+** Returns          void
+**
+*******************************************************************************/
+void gki_os_timer_rearm(void)
+{
+#ifdef NO_GKI_RUN_RETURN
+    tGKI_OS *p_os = &gki_cb.os;
+
+    pthread_mutex_lock(&p_os->gki_tickless_mutex);
+    p_os->tickless_rearm = TRUE;
+    pthread_cond_signal(&p_os->gki_tickless_cond);
+    pthread_mutex_unlock(&p_os->gki_tickless_mutex);
+#endif
+}
+#endif
+
+#if defined(NO_GKI_RUN_RETURN) && (GKI_TICKLESS == TRUE)
+/*******************************************************************************
+**
+** Function         timer_thread
+**
+** Description      Tickless timer thread. Instead of waking up on every tick
+**                  it sleeps until the next timer expiration (bounded by
+**                  GKI_TICKLESS_MAX_TICKS), then updates the GKI timers with
+**                  all the ticks that elapsed meanwhile.
+**
+** Returns          NULL
+**
+*******************************************************************************/
+void* timer_thread(void *arg)
+{
+    struct timespec timeout;
+    long long       timeout_ns;
+    INT32           sleep_ticks;
+    tGKI_OS         *p_os = &gki_cb.os;
+    int             *p_run_cond = &p_os->no_timer_suspend;
+
+    prctl(PR_SET_NAME, (unsigned long)"gki timer", 0, 0, 0);
+
+    raise_priority_a2dp(TASK_HIGH_GKI_TIMER);
+
+    GKI_disable();
+    clock_gettime(CLOCK_MONOTONIC, &p_os->tickless_base);
+    GKI_enable();
+
+    while(!shutdown_timer)
+    {
+        /* If the timer has been stopped (no SW timer running) */
+        if (*p_run_cond == GKI_TIMER_TICK_STOP_COND)
+        {
+            /* This mutex will be unlocked when timer is re-started */
+            GKI_TRACE("GKI_run lock mutex");
+            pthread_mutex_lock(&p_os->gki_timer_mutex);
+            GKI_TRACE("GKI_run unlock mutex");
+            pthread_mutex_unlock(&p_os->gki_timer_mutex);
+            continue;
+        }
+
+        GKI_disable();
+
+        gki_os_timer_sync();
+
+        sleep_ticks = gki_cb.com.OSTicksTilExp;
+
+#if (defined(GKI_DELAY_STOP_SYS_TICK) && (GKI_DELAY_STOP_SYS_TICK > 0))
+        /* wake up in time to stop the system tick */
+        if (gki_cb.com.OSTicksTilStop &&
+            (sleep_ticks <= 0 || (INT32)gki_cb.com.OSTicksTilStop < sleep_ticks))
+            sleep_ticks = (INT32)gki_cb.com.OSTicksTilStop;
+#endif
+
+        if (sleep_ticks <= 0 || sleep_ticks > GKI_TICKLESS_MAX_TICKS)
+            sleep_ticks = GKI_TICKLESS_MAX_TICKS;
+
+        /* Deadline is relative to the last accounted tick, not to the current time */
+        timeout_ns = p_os->tickless_base.tv_nsec + (long long)sleep_ticks * LINUX_TICK_NSEC;
+        timeout.tv_sec = p_os->tickless_base.tv_sec + timeout_ns / NSEC_PER_SEC;
+        timeout.tv_nsec = timeout_ns % NSEC_PER_SEC;
+
+        GKI_enable();
+
+        pthread_mutex_lock(&p_os->gki_tickless_mutex);
+        while (!p_os->tickless_rearm && !shutdown_timer)
+        {
+            if (pthread_cond_timedwait_monotonic(&p_os->gki_tickless_cond,
+                    &p_os->gki_tickless_mutex, &timeout) == ETIMEDOUT)
+                break;
+        }
+        p_os->tickless_rearm = FALSE;
+        pthread_mutex_unlock(&p_os->gki_tickless_mutex);
+    }
+    GKI_TRACE("gki_ulinux: Exiting timer_thread");
+    pthread_exit(NULL);
+    return NULL;
+}
+#endif
+
+
 /*******************************************************************************
 **
 ** Function         GKI_run
@@ -622,7 +857,7 @@ void gki_system_tick_start_stop_cback(BOOLEAN start)
 **                  one step, If your OS does it in one step, this function
 **                  should be empty.
 *********************************************************************************/
-#ifdef NO_GKI_RUN_RETURN
+#if defined(NO_GKI_RUN_RETURN) && (GKI_TICKLESS == FALSE)
 void* timer_thread(void *arg)
 {
     int timeout_ns=0;
@@ -804,6 +1039,9 @@ void GKI_freeze()
 #ifdef NO_GKI_RUN_RETURN
    shutdown_timer = 1;
    pthread_mutex_unlock( &gki_cb.os.gki_timer_mutex );
+#if (GKI_TICKLESS == TRUE)
+   gki_os_timer_rearm();
+#endif
    /* Ensure that the timer thread exits */
    pthread_join(timer_thread_id, NULL);
 #endif
@@ -1422,6 +1660,47 @@ void GKI_os_free (void *p_mem)
     return;
 }
 
+#if (GKI_USE_BUF_CACHE == TRUE)
+static pthread_once_t buf_cache_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  buf_cache_key;
+
+static void buf_cache_key_create(void)
+{
+    /* cached buffers are handed back to the pools when the thread exits */
+    pthread_key_create(&buf_cache_key, gki_buf_cache_release);
+}
+
+/*******************************************************************************
+**
+** Function         gki_os_get_buf_cache
+**
+** Description      Returns the buffer cache of the calling thread.
+**
+** Returns          pointer to the cache, or NULL if the thread has none yet
+**
+*******************************************************************************/
+tGKI_BUF_CACHE *gki_os_get_buf_cache(void)
+{
+    pthread_once(&buf_cache_key_once, buf_cache_key_create);
+    return (tGKI_BUF_CACHE *)pthread_getspecific(buf_cache_key);
+}
+
+/*******************************************************************************
+**
+** Function         gki_os_set_buf_cache
+**
+** Description      Attaches a buffer cache to the calling thread.
+**
+** Returns          void
+**
+*******************************************************************************/
+void gki_os_set_buf_cache(tGKI_BUF_CACHE *p_cache)
+{
+    pthread_once(&buf_cache_key_once, buf_cache_key_create);
+    pthread_setspecific(buf_cache_key, p_cache);
+}
+#endif
+
 
 /*******************************************************************************
 **
@@ -54,6 +54,10 @@
 #include <fcntl.h>
 /* defines the O_* open parameters */
 #include <fcntl.h>
+/* for writev */
+#include <sys/uio.h>
+#include <limits.h>
+#include <cutils/properties.h>
 
 #define LOG_TAG "BTSNOOP-DISP"
 #include <cutils/log.h>
@@ -79,6 +83,48 @@
 /* file descriptor of the BT snoop file (by default, -1 means disabled) */
 int hci_btsnoop_fd = -1;
 
+/* Size of the in-memory ring holding records until the flusher writes them */
+#ifndef BTSNOOP_RING_SIZE
+#define BTSNOOP_RING_SIZE       (256 * 1024)
+#endif
+
+/* Size in bytes at which the snoop file is rotated, 0 for no limit.
+** Can be overridden with the persist.bluetooth.btsnoopsize property. */
+#ifndef BTSNOOP_MAX_FILE_SIZE
+#define BTSNOOP_MAX_FILE_SIZE   0
+#endif
+#define BTSNOOP_MAX_FILE_SIZE_PROP "persist.bluetooth.btsnoopsize"
+
+/* Suffix of the previous snoop file kept on rotation */
+#define BTSNOOP_ROTATE_SUFFIX   ".last"
+
+/* Record header: original length, included length, flags, cumulative
+** drops and 64-bit timestamp, followed by the H4 packet type byte */
+#define BTSNOOP_REC_HDR_SIZE    25
+
+/* btsnoop file header */
+#define BTSNOOP_FILE_HDR        "btsnoop\0\0\0\0\1\0\0\x3\xea"
+#define BTSNOOP_FILE_HDR_SIZE   16
+
+/* Records are queued by the HCI threads and written out by a flusher thread,
+** so the data path never blocks on the file system. */
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    pthread_t       thread_id;
+    uint8_t         *p_ring;        /* BTSNOOP_RING_SIZE bytes of queued records */
+    uint32_t        head;           /* free running write position */
+    uint32_t        tail;           /* free running flush position */
+    uint32_t        drops;          /* cumulative number of dropped records */
+    uint8_t         running;
+    uint32_t        file_size;      /* bytes written to the current file */
+    uint32_t        max_file_size;  /* rotation threshold, 0 for none */
+    char            path[PATH_MAX];
+} tBTSNOOP_WRITER;
+
+static tBTSNOOP_WRITER snoop_writer = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
 /* Local parser definitions */
 #define EXT_PARSER_LOCAL_NAME "bthcitraffic"
 static int local_ext_parser_fd = -1;
@@ -197,6 +243,303 @@ static uint32_t l_to_be(uint32_t x)
     return x;
 }
 
+/*******************************************************************************
+ **
+ ** Function         btsnoop_file_create
+ **
+ ** Description      Function to create the BTSNOOP file and write its header
+ **
+ ** Returns          file descriptor, -1 on failure
+*******************************************************************************/
+static int btsnoop_file_create(char *path)
+{
+    int fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, \
+                  S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH);
+
+    if (fd != -1)
+    {
+        write(fd, BTSNOOP_FILE_HDR, BTSNOOP_FILE_HDR_SIZE);
+        snoop_writer.file_size = BTSNOOP_FILE_HDR_SIZE;
+    }
+
+    return fd;
+}
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_file_rotate
+ **
+ ** Description      Function to keep the full BTSNOOP file aside and start a
+ **                  new one. Only called from the flusher thread between
+ **                  records.
+ **
+ ** Returns          None
+*******************************************************************************/
+static void btsnoop_file_rotate(void)
+{
+    char last_path[PATH_MAX + sizeof(BTSNOOP_ROTATE_SUFFIX)];
+    int fd;
+
+    snprintf(last_path, sizeof(last_path), "%s%s", snoop_writer.path, \
+             BTSNOOP_ROTATE_SUFFIX);
+
+    SNOOPDBG("btsnoop_file_rotate: %u bytes, keep as %s", \
+             snoop_writer.file_size, last_path);
+
+    if (rename(snoop_writer.path, last_path) < 0)
+        ALOGE("btsnoop: unable to rename %s (%s)", snoop_writer.path, strerror(errno));
+
+    if ((fd = btsnoop_file_create(snoop_writer.path)) == -1)
+    {
+        ALOGE("btsnoop: unable to reopen %s (%s)", snoop_writer.path, strerror(errno));
+        return;
+    }
+
+    close(hci_btsnoop_fd);
+    hci_btsnoop_fd = fd;
+}
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_flush_thread
+ **
+ ** Description      Flusher thread, writes queued records to the BTSNOOP file
+ **                  with one writev() per batch until the writer is stopped
+ **                  and the ring is empty.
+ **
+ ** Returns          None
+*******************************************************************************/
+static void *btsnoop_flush_thread(void *arg)
+{
+    tBTSNOOP_WRITER *p_w = &snoop_writer;
+    struct iovec iov[2];
+    uint32_t tail, pending, idx;
+    uint8_t rec_aligned = TRUE;
+    int iovcnt;
+    ssize_t ret;
+
+    prctl(PR_SET_NAME, (unsigned long)"btsnoop_flush", 0, 0, 0);
+
+    pthread_mutex_lock(&p_w->lock);
+
+    while (TRUE)
+    {
+        while (p_w->running && (p_w->head == p_w->tail))
+            pthread_cond_wait(&p_w->cond, &p_w->lock);
+
+        if (p_w->head == p_w->tail)
+            break;
+
+        tail = p_w->tail;
+        pending = p_w->head - tail;
+        pthread_mutex_unlock(&p_w->lock);
+
+        /* never start a new file in the middle of a record */
+        if (rec_aligned && p_w->max_file_size && \
+            (p_w->file_size >= p_w->max_file_size))
+            btsnoop_file_rotate();
+
+        idx = tail % BTSNOOP_RING_SIZE;
+        iov[0].iov_base = p_w->p_ring + idx;
+        if (idx + pending > BTSNOOP_RING_SIZE)
+        {
+            iov[0].iov_len = BTSNOOP_RING_SIZE - idx;
+            iov[1].iov_base = p_w->p_ring;
+            iov[1].iov_len = pending - iov[0].iov_len;
+            iovcnt = 2;
+        }
+        else
+        {
+            iov[0].iov_len = pending;
+            iovcnt = 1;
+        }
+
+        ret = writev(hci_btsnoop_fd, iov, iovcnt);
+
+        if ((ret < 0) && (errno == EINTR))
+            ret = 0;
+        else if (ret <= 0)
+        {
+            /* file system error, discard the batch rather than spin */
+            ALOGE("btsnoop: write failed (%s)", strerror(errno));
+            ret = pending;
+        }
+
+        p_w->file_size += ret;
+        rec_aligned = ((uint32_t)ret == pending);
+
+        pthread_mutex_lock(&p_w->lock);
+        p_w->tail += ret;
+    }
+
+    pthread_mutex_unlock(&p_w->lock);
+
+    return NULL;
+}
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_writer_start
+ **
+ ** Description      Function to allocate the record ring and start the
+ **                  flusher thread for the opened BTSNOOP file
+ **
+ ** Returns          TRUE if started
+*******************************************************************************/
+static uint8_t btsnoop_writer_start(char *path)
+{
+    tBTSNOOP_WRITER *p_w = &snoop_writer;
+    char value[PROPERTY_VALUE_MAX];
+    uint8_t *p_ring;
+
+    if ((p_ring = (uint8_t *)malloc(BTSNOOP_RING_SIZE)) == NULL)
+        return FALSE;
+
+    strlcpy(p_w->path, path, sizeof(p_w->path));
+    p_w->max_file_size = BTSNOOP_MAX_FILE_SIZE;
+    if (property_get(BTSNOOP_MAX_FILE_SIZE_PROP, value, NULL) > 0)
+        p_w->max_file_size = (uint32_t)strtoul(value, NULL, 0);
+
+    pthread_mutex_lock(&p_w->lock);
+    p_w->p_ring = p_ring;
+    p_w->head = p_w->tail = 0;
+    p_w->drops = 0;
+    p_w->running = TRUE;
+    pthread_mutex_unlock(&p_w->lock);
+
+    if (pthread_create(&p_w->thread_id, NULL, btsnoop_flush_thread, NULL) != 0)
+    {
+        ALOGE("btsnoop: flusher thread creation failed (%s)", strerror(errno));
+
+        pthread_mutex_lock(&p_w->lock);
+        p_w->p_ring = NULL;
+        p_w->running = FALSE;
+        pthread_mutex_unlock(&p_w->lock);
+
+        free(p_ring);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_writer_stop
+ **
+ ** Description      Function to flush all queued records and stop the
+ **                  flusher thread
+ **
+ ** Returns          None
+*******************************************************************************/
+static void btsnoop_writer_stop(void)
+{
+    tBTSNOOP_WRITER *p_w = &snoop_writer;
+    uint8_t *p_ring;
+
+    pthread_mutex_lock(&p_w->lock);
+    if (!p_w->running)
+    {
+        pthread_mutex_unlock(&p_w->lock);
+        return;
+    }
+    p_w->running = FALSE;
+    pthread_cond_signal(&p_w->cond);
+    pthread_mutex_unlock(&p_w->lock);
+
+    pthread_join(p_w->thread_id, NULL);
+
+    pthread_mutex_lock(&p_w->lock);
+    p_ring = p_w->p_ring;
+    p_w->p_ring = NULL;
+    pthread_mutex_unlock(&p_w->lock);
+
+    if (p_w->drops)
+        ALOGW("btsnoop: %u records dropped", p_w->drops);
+
+    free(p_ring);
+}
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_write_record
+ **
+ ** Description      Function to queue a packet record for the BTSNOOP file.
+ **                  If the ring is full the record is dropped and counted in
+ **                  the cumulative drops field of the following records.
+ **
+ ** Returns          None
+*******************************************************************************/
+static void btsnoop_write_record(uint8_t type, uint32_t flags, uint8_t *p, uint32_t len)
+{
+    tBTSNOOP_WRITER *p_w = &snoop_writer;
+    uint8_t hdr[BTSNOOP_REC_HDR_SIZE];
+    uint32_t value, value_hi, idx, n;
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    tv_to_btsnoop_ts(&value, &value_hi, &tv);
+    value_hi = l_to_be(value_hi);
+    value = l_to_be(value);
+    memcpy(hdr + 16, &value_hi, 4);
+    memcpy(hdr + 20, &value, 4);
+
+    /* store the length in both original and included fields */
+    value = l_to_be(len + 1);
+    memcpy(hdr, &value, 4);
+    memcpy(hdr + 4, &value, 4);
+    value = l_to_be(flags);
+    memcpy(hdr + 8, &value, 4);
+    hdr[24] = type;
+
+    pthread_mutex_lock(&p_w->lock);
+
+    if (!p_w->running)
+    {
+        pthread_mutex_unlock(&p_w->lock);
+        return;
+    }
+
+    if (BTSNOOP_RING_SIZE - (p_w->head - p_w->tail) < BTSNOOP_REC_HDR_SIZE + len)
+    {
+        p_w->drops++;
+        pthread_mutex_unlock(&p_w->lock);
+        return;
+    }
+
+    value = l_to_be(p_w->drops);
+    memcpy(hdr + 12, &value, 4);
+
+    /* copy header and packet, wrapping around the end of the ring */
+    idx = p_w->head % BTSNOOP_RING_SIZE;
+    n = BTSNOOP_RING_SIZE - idx;
+    if (n >= BTSNOOP_REC_HDR_SIZE)
+        memcpy(p_w->p_ring + idx, hdr, BTSNOOP_REC_HDR_SIZE);
+    else
+    {
+        memcpy(p_w->p_ring + idx, hdr, n);
+        memcpy(p_w->p_ring, hdr + n, BTSNOOP_REC_HDR_SIZE - n);
+    }
+
+    idx = (p_w->head + BTSNOOP_REC_HDR_SIZE) % BTSNOOP_RING_SIZE;
+    n = BTSNOOP_RING_SIZE - idx;
+    if (n >= len)
+        memcpy(p_w->p_ring + idx, p, len);
+    else
+    {
+        memcpy(p_w->p_ring + idx, p, n);
+        memcpy(p_w->p_ring, p + n, len - n);
+    }
+
+    /* the flusher only sleeps on an empty ring */
+    if (p_w->head == p_w->tail)
+        pthread_cond_signal(&p_w->cond);
+
+    p_w->head += BTSNOOP_REC_HDR_SIZE + len;
+
+    pthread_mutex_unlock(&p_w->lock);
+}
+
 /*******************************************************************************
  **
  ** Function         btsnoop_is_open
@@ -238,9 +581,7 @@ static int btsnoop_log_open(char *btsnoop_logfile)
     /* write the BT snoop header */
     if ((btsnoop_logfile != NULL) && (strlen(btsnoop_logfile) != 0))
     {
-        hci_btsnoop_fd = open(btsnoop_logfile, \
-                              O_WRONLY|O_CREAT|O_TRUNC, \
-                              S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH);
+        hci_btsnoop_fd = btsnoop_file_create(btsnoop_logfile);
         if (hci_btsnoop_fd == -1)
         {
             perror("open");
@@ -248,7 +589,13 @@ static int btsnoop_log_open(char *btsnoop_logfile)
             hci_btsnoop_fd = -1;
             return 0;
         }
-        write(hci_btsnoop_fd, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16);
+        if (btsnoop_writer_start(btsnoop_logfile) == FALSE)
+        {
+            ALOGE("btsnoop_log_open: Unable to start snoop writer");
+            close(hci_btsnoop_fd);
+            hci_btsnoop_fd = -1;
+            return 0;
+        }
         return 1;
     }
     else /* Null passed for external snoop dump enabling */
@@ -285,6 +632,7 @@ static int btsnoop_log_close(void)
     if (hci_btsnoop_fd != -1)
     {
         SNOOPDBG("btsnoop_log_close: Closing snoop log file\n");
+        btsnoop_writer_stop();
         close(hci_btsnoop_fd);
         hci_btsnoop_fd = -1;
         return 1;
@@ -317,37 +665,7 @@ void btsnoop_hci_cmd(uint8_t *p)
     SNOOPDBG("btsnoop_hci_cmd: fd = %d", hci_btsnoop_fd);
 
     if (hci_btsnoop_fd != -1)
-    {
-        uint32_t value, value_hi;
-        struct timeval tv;
-
-        /* since these display functions are called from different contexts */
-        utils_lock();
-
-        /* store the length in both original and included fields */
-        value = l_to_be(p[2] + 4);
-        write(hci_btsnoop_fd, &value, 4);
-        write(hci_btsnoop_fd, &value, 4);
-        /* flags: command sent from the host */
-        value = l_to_be(2);
-        write(hci_btsnoop_fd, &value, 4);
-        /* drops: none */
-        value = 0;
-        write(hci_btsnoop_fd, &value, 4);
-        /* time */
-        gettimeofday(&tv, NULL);
-        tv_to_btsnoop_ts(&value, &value_hi, &tv);
-        value_hi = l_to_be(value_hi);
-        value = l_to_be(value);
-        write(hci_btsnoop_fd, &value_hi, 4);
-        write(hci_btsnoop_fd, &value, 4);
-        /* data */
-        write(hci_btsnoop_fd, "\x1", 1);
-        write(hci_btsnoop_fd, p, p[2] + 3);
-
-        /* since these display functions are called from different contexts */
-        utils_unlock();
-    }
+        btsnoop_write_record(HCIT_TYPE_COMMAND, 2, p, p[2] + 3);
 }
 
 /*******************************************************************************
@@ -363,37 +681,7 @@ void btsnoop_hci_evt(uint8_t *p)
     SNOOPDBG("btsnoop_hci_evt: fd = %d", hci_btsnoop_fd);
 
     if (hci_btsnoop_fd != -1)
-    {
-        uint32_t value, value_hi;
-        struct timeval tv;
-
-        /* since these display functions are called from different contexts */
-        utils_lock();
-
-        /* store the length in both original and included fields */
-        value = l_to_be(p[1] + 3);
-        write(hci_btsnoop_fd, &value, 4);
-        write(hci_btsnoop_fd, &value, 4);
-        /* flags: event received in the host */
-        value = l_to_be(3);
-        write(hci_btsnoop_fd, &value, 4);
-        /* drops: none */
-        value = 0;
-        write(hci_btsnoop_fd, &value, 4);
-        /* time */
-        gettimeofday(&tv, NULL);
-        tv_to_btsnoop_ts(&value, &value_hi, &tv);
-        value_hi = l_to_be(value_hi);
-        value = l_to_be(value);
-        write(hci_btsnoop_fd, &value_hi, 4);
-        write(hci_btsnoop_fd, &value, 4);
-        /* data */
-        write(hci_btsnoop_fd, "\x4", 1);
-        write(hci_btsnoop_fd, p, p[1] + 2);
-
-        /* since these display functions are called from different contexts */
-        utils_unlock();
-    }
+        btsnoop_write_record(HCIT_TYPE_EVENT, 3, p, p[1] + 2);
 }
 
 /*******************************************************************************
@@ -409,37 +697,7 @@ void btsnoop_sco_data(uint8_t *p, uint8_t is_rcvd)
     SNOOPDBG("btsnoop_sco_data: fd = %d", hci_btsnoop_fd);
 
     if (hci_btsnoop_fd != -1)
-    {
-        uint32_t value, value_hi;
-        struct timeval tv;
-
-        /* since these display functions are called from different contexts */
-        utils_lock();
-
-        /* store the length in both original and included fields */
-        value = l_to_be(p[2] + 4);
-        write(hci_btsnoop_fd, &value, 4);
-        write(hci_btsnoop_fd, &value, 4);
-        /* flags: data can be sent or received */
-        value = l_to_be(is_rcvd?1:0);
-        write(hci_btsnoop_fd, &value, 4);
-        /* drops: none */
-        value = 0;
-        write(hci_btsnoop_fd, &value, 4);
-        /* time */
-        gettimeofday(&tv, NULL);
-        tv_to_btsnoop_ts(&value, &value_hi, &tv);
-        value_hi = l_to_be(value_hi);
-        value = l_to_be(value);
-        write(hci_btsnoop_fd, &value_hi, 4);
-        write(hci_btsnoop_fd, &value, 4);
-        /* data */
-        write(hci_btsnoop_fd, "\x3", 1);
-        write(hci_btsnoop_fd, p, p[2] + 3);
-
-        /* since these display functions are called from different contexts */
-        utils_unlock();
-    }
+        btsnoop_write_record(HCIT_TYPE_SCO_DATA, is_rcvd?1:0, p, p[2] + 3);
 }
 
 /*******************************************************************************
@@ -454,37 +712,7 @@ void btsnoop_acl_data(uint8_t *p, uint8_t is_rcvd)
 {
     SNOOPDBG("btsnoop_acl_data: fd = %d", hci_btsnoop_fd);
     if (hci_btsnoop_fd != -1)
-    {
-        uint32_t value, value_hi;
-        struct timeval tv;
-
-        /* since these display functions are called from different contexts */
-        utils_lock();
-
-        /* store the length in both original and included fields */
-        value = l_to_be((p[3]<<8) + p[2] + 5);
-        write(hci_btsnoop_fd, &value, 4);
-        write(hci_btsnoop_fd, &value, 4);
-        /* flags: data can be sent or received */
-        value = l_to_be(is_rcvd?1:0);
-        write(hci_btsnoop_fd, &value, 4);
-        /* drops: none */
-        value = 0;
-        write(hci_btsnoop_fd, &value, 4);
-        /* time */
-        gettimeofday(&tv, NULL);
-        tv_to_btsnoop_ts(&value, &value_hi, &tv);
-        value_hi = l_to_be(value_hi);
-        value = l_to_be(value);
-        write(hci_btsnoop_fd, &value_hi, 4);
-        write(hci_btsnoop_fd, &value, 4);
-        /* data */
-        write(hci_btsnoop_fd, "\x2", 1);
-        write(hci_btsnoop_fd, p, (p[3]<<8) + p[2] + 4);
-
-        /* since these display functions are called from different contexts */
-        utils_unlock();
-    }
+        btsnoop_write_record(HCIT_TYPE_ACL_DATA, is_rcvd?1:0, p, (p[3]<<8) + p[2] + 4);
 }
 
 
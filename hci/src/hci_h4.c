@@ -98,6 +98,10 @@ static const uint16_t msg_evt_table[] =
 #define ACL_RX_PKT_CONTINUE     1
 #define L2CAP_HEADER_SIZE       4
 
+/* Scratch space used to skip the payload of a packet that could not be
+** given a buffer */
+#define H4_RX_DISCARD_SIZE      64
+
 /* Maximum numbers of allowed internal
 ** outstanding command packets at any time
 */
@@ -748,6 +752,12 @@ void hci_h4_send_msg(HC_BT_HDR *p_msg)
 ** Description     Construct HCI EVENT/ACL packets and send them to stack once
 **                 complete packet has been received.
 **
+**                 Input is consumed in runs rather than one byte at a time:
+**                 the whole preamble is requested at once, and once the
+**                 payload length is known the payload is read straight into
+**                 the message buffer. All packets available are framed in
+**                 one call.
+**
 ** Returns         Number of read bytes
 **
 *******************************************************************************/
@@ -757,22 +767,20 @@ uint16_t hci_h4_receive_msg(void)
     uint8_t     byte;
     uint16_t    msg_len, len;
     uint8_t     msg_received;
+    uint8_t     discard[H4_RX_DISCARD_SIZE];
     tHCI_H4_CB  *p_cb=&h4_cb;
 
     while (TRUE)
     {
-        /* Read one byte to see if there is anything waiting to be read */
-        if (p_userial_if->read(0 /*dummy*/, &byte, 1) == 0)
-        {
-            break;
-        }
-
-        bytes_read++;
         msg_received = FALSE;
 
         switch (p_cb->rcv_state)
         {
         case H4_RX_MSGTYPE_ST:
+            /* Read one byte to see if there is anything waiting to be read */
+            if ((len = p_userial_if->read(0 /*dummy*/, &byte, 1)) == 0)
+                break;
+
             /* Start of new message */
             if ((byte < H4_TYPE_ACL_DATA) || (byte > H4_TYPE_EVENT))
             {
@@ -793,130 +801,127 @@ uint16_t hci_h4_receive_msg(void)
 
         case H4_RX_LEN_ST:
             /* Receiving preamble */
-            p_cb->preload_buffer[p_cb->preload_count++] = byte;
-            p_cb->rcv_len--;
+            len = p_userial_if->read(0 /*dummy*/, \
+                  p_cb->preload_buffer + p_cb->preload_count, p_cb->rcv_len);
+            p_cb->preload_count += len;
+            p_cb->rcv_len -= len;
 
             /* Check if we received entire preamble yet */
-            if (p_cb->rcv_len == 0)
+            if ((len == 0) || (p_cb->rcv_len != 0))
+                break;
+
+            byte = p_cb->preload_buffer[p_cb->preload_count - 1];
+
+            if (p_cb->rcv_msg_type == H4_TYPE_ACL_DATA)
             {
-                if (p_cb->rcv_msg_type == H4_TYPE_ACL_DATA)
+                /* ACL data lengths are 16-bits */
+                msg_len = p_cb->preload_buffer[3];
+                msg_len = (msg_len << 8) + p_cb->preload_buffer[2];
+
+                if (msg_len && (p_cb->preload_count == 4))
                 {
-                    /* ACL data lengths are 16-bits */
-                    msg_len = p_cb->preload_buffer[3];
-                    msg_len = (msg_len << 8) + p_cb->preload_buffer[2];
+                    /* Check if this is a start packet */
+                    byte = ((p_cb->preload_buffer[1] >> 4) & 0x03);
 
-                    if (msg_len && (p_cb->preload_count == 4))
+                    if (byte == ACL_RX_PKT_START)
                     {
-                        /* Check if this is a start packet */
-                        byte = ((p_cb->preload_buffer[1] >> 4) & 0x03);
-
-                        if (byte == ACL_RX_PKT_START)
-                        {
-                           /*
-                            * A start packet & with non-zero data payload length.
-                            * We want to read 2 more bytes to get L2CAP payload
-                            * length.
-                            */
-                            p_cb->rcv_len = 2;
-
-                            break;
-                        }
+                       /*
+                        * A start packet & with non-zero data payload length.
+                        * We want to read 2 more bytes to get L2CAP payload
+                        * length.
+                        */
+                        p_cb->rcv_len = 2;
+
+                        break;
                     }
-
-                    /*
-                     * Check for segmented packets. If this is a continuation
-                     * packet, then we will continue appending data to the
-                     * original rcv buffer.
-                     */
-                    p_cb->p_rcv_msg = acl_rx_frame_buffer_alloc();
                 }
-                else
-                {
-                    /* Received entire preamble.
-                     * Length is in the last received byte */
-                    msg_len = byte;
-                    p_cb->rcv_len = msg_len;
 
-                    /* Allocate a buffer for message */
-                    if (bt_hc_cbacks)
-                    {
-                        len = msg_len + p_cb->preload_count + BT_HC_HDR_SIZE;
-                        p_cb->p_rcv_msg = \
-                            (HC_BT_HDR *) bt_hc_cbacks->alloc(len);
-                    }
+                /*
+                 * Check for segmented packets. If this is a continuation
+                 * packet, then we will continue appending data to the
+                 * original rcv buffer.
+                 */
+                p_cb->p_rcv_msg = acl_rx_frame_buffer_alloc();
+            }
+            else
+            {
+                /* Received entire preamble.
+                 * Length is in the last received byte */
+                msg_len = byte;
+                p_cb->rcv_len = msg_len;
 
-                    if (p_cb->p_rcv_msg)
-                    {
-                        /* Initialize buffer with preloaded data */
-                        p_cb->p_rcv_msg->offset = 0;
-                        p_cb->p_rcv_msg->layer_specific = 0;
-                        p_cb->p_rcv_msg->event = \
-                            msg_evt_table[p_cb->rcv_msg_type-1];
-                        p_cb->p_rcv_msg->len = p_cb->preload_count;
-                        memcpy((uint8_t *)(p_cb->p_rcv_msg + 1), \
-                               p_cb->preload_buffer, p_cb->preload_count);
-                    }
+                /* Allocate a buffer for message */
+                if (bt_hc_cbacks)
+                {
+                    len = msg_len + p_cb->preload_count + BT_HC_HDR_SIZE;
+                    p_cb->p_rcv_msg = \
+                        (HC_BT_HDR *) bt_hc_cbacks->alloc(len);
                 }
 
-                if (p_cb->p_rcv_msg == NULL)
+                if (p_cb->p_rcv_msg)
                 {
-                    /* Unable to acquire message buffer. */
-                    ALOGE( \
-                     "H4: Unable to acquire buffer for incoming HCI message." \
-                    );
-
-                    if (msg_len == 0)
-                    {
-                        /* Wait for next message */
-                        p_cb->rcv_state = H4_RX_MSGTYPE_ST;
-                    }
-                    else
-                    {
-                        /* Ignore rest of the packet */
-                        p_cb->rcv_state = H4_RX_IGNORE_ST;
-                    }
-
-                    break;
+                    /* Initialize buffer with preloaded data */
+                    p_cb->p_rcv_msg->offset = 0;
+                    p_cb->p_rcv_msg->layer_specific = 0;
+                    p_cb->p_rcv_msg->event = \
+                        msg_evt_table[p_cb->rcv_msg_type-1];
+                    p_cb->p_rcv_msg->len = p_cb->preload_count;
+                    memcpy((uint8_t *)(p_cb->p_rcv_msg + 1), \
+                           p_cb->preload_buffer, p_cb->preload_count);
                 }
+            }
+
+            if (p_cb->p_rcv_msg == NULL)
+            {
+                /* Unable to acquire message buffer. */
+                ALOGE( \
+                 "H4: Unable to acquire buffer for incoming HCI message." \
+                );
 
-                /* Message length is valid */
-                if (msg_len)
+                if (p_cb->rcv_len == 0)
                 {
-                    /* Read rest of message */
-                    p_cb->rcv_state = H4_RX_DATA_ST;
+                    /* Wait for next message */
+                    p_cb->rcv_state = H4_RX_MSGTYPE_ST;
                 }
                 else
                 {
-                    /* Message has no additional parameters.
-                     * (Entire message has been received) */
-                    if (p_cb->rcv_msg_type == H4_TYPE_ACL_DATA)
-                        acl_rx_frame_end_chk(); /* to print snoop trace */
+                    /* Ignore rest of the packet */
+                    p_cb->rcv_state = H4_RX_IGNORE_ST;
+                }
 
-                    msg_received = TRUE;
+                break;
+            }
 
-                    /* Next, wait for next message */
-                    p_cb->rcv_state = H4_RX_MSGTYPE_ST;
-                }
+            /* Message length is valid */
+            if (p_cb->rcv_len)
+            {
+                /* Read rest of message */
+                p_cb->rcv_state = H4_RX_DATA_ST;
             }
-            break;
+            else
+            {
+                /* Message has no additional parameters.
+                 * (Entire message has been received) */
+                if (p_cb->rcv_msg_type == H4_TYPE_ACL_DATA)
+                    acl_rx_frame_end_chk(); /* to print snoop trace */
 
-        case H4_RX_DATA_ST:
-            *((uint8_t *)(p_cb->p_rcv_msg + 1) + p_cb->p_rcv_msg->len++) = byte;
-            p_cb->rcv_len--;
+                msg_received = TRUE;
 
-            if (p_cb->rcv_len > 0)
-            {
-                /* Read in the rest of the message */
-                len = p_userial_if->read(0 /*dummy*/, \
-                      ((uint8_t *)(p_cb->p_rcv_msg+1) + p_cb->p_rcv_msg->len), \
-                      p_cb->rcv_len);
-                p_cb->p_rcv_msg->len += len;
-                p_cb->rcv_len -= len;
-                bytes_read += len;
+                /* Next, wait for next message */
+                p_cb->rcv_state = H4_RX_MSGTYPE_ST;
             }
+            break;
+
+        case H4_RX_DATA_ST:
+            /* Payload length is known, copy it straight into the message */
+            len = p_userial_if->read(0 /*dummy*/, \
+                  ((uint8_t *)(p_cb->p_rcv_msg+1) + p_cb->p_rcv_msg->len), \
+                  p_cb->rcv_len);
+            p_cb->p_rcv_msg->len += len;
+            p_cb->rcv_len -= len;
 
             /* Check if we read in entire message yet */
-            if (p_cb->rcv_len == 0)
+            if ((len != 0) && (p_cb->rcv_len == 0))
             {
                 /* Received entire packet. */
                 /* Check for segmented l2cap packets */
@@ -939,7 +944,10 @@ uint16_t hci_h4_receive_msg(void)
 
         case H4_RX_IGNORE_ST:
             /* Ignore reset of packet */
-            p_cb->rcv_len--;
+            len = p_userial_if->read(0 /*dummy*/, discard, \
+                  (p_cb->rcv_len < H4_RX_DISCARD_SIZE) ? \
+                  p_cb->rcv_len : H4_RX_DISCARD_SIZE);
+            p_cb->rcv_len -= len;
 
             /* Check if we read in entire message yet */
             if (p_cb->rcv_len == 0)
@@ -948,8 +956,17 @@ uint16_t hci_h4_receive_msg(void)
                 p_cb->rcv_state = H4_RX_MSGTYPE_ST;
             }
             break;
+
+        default:
+            len = 0;
+            break;
         }
 
+        /* Nothing more waiting to be read */
+        if (len == 0)
+            break;
+
+        bytes_read += len;
 
         /* If we received entire message, then send it to the task */
         if (msg_received)
@@ -448,6 +448,12 @@
 #define BTIF_DM_OOB_TEST  TRUE
 #endif
 
+/* how long btif_config_save() lets changes to the config journal accumulate
+   before they are synced to storage */
+#ifndef BTIF_CONFIG_SYNC_DELAY_MS
+#define BTIF_CONFIG_SYNC_DELAY_MS  1000
+#endif
+
 //------------------End added from bdroid_buildcfg.h---------------------
 
 
@@ -919,11 +925,22 @@ and USER_HW_DISABLE_API macros */
 #define BTM_SCO_MAX_BUF_CAP     (BTM_SCO_INIT_XMIT_CREDIT * 4)
 #endif
 
-/* The size in bytes of the BTM inquiry database. */
+/* The number of entries of the BTM inquiry database when the stack starts.
+** BTM_SetInqDbSize() changes it for the next stack start, up to BTM_INQ_DB_MAX_SIZE. */
 #ifndef BTM_INQ_DB_SIZE
 #define BTM_INQ_DB_SIZE             40
 #endif
 
+#ifndef BTM_INQ_DB_MAX_SIZE
+#define BTM_INQ_DB_MAX_SIZE         255
+#endif
+
+/* Number of hash buckets to look up the inquiry database by BD_ADDR.
+** Must be a power of 2, at most 256. */
+#ifndef BTM_INQ_DB_HASH_SIZE
+#define BTM_INQ_DB_HASH_SIZE        64
+#endif
+
 /* This is set to enable automatic periodic inquiry at startup. */
 #ifndef BTM_ENABLE_AUTO_INQUIRY
 #define BTM_ENABLE_AUTO_INQUIRY     FALSE
@@ -1076,6 +1093,22 @@ and USER_HW_DISABLE_API macros */
 #define BTM_SEC_MAX_DEVICE_RECORDS  100
 #endif
 
+/* The security records for peer devices come in blocks of BTM_SEC_MAX_DEVICE_RECORDS.
+** The first one is static, the others are allocated when all records are in use,
+** up to this number of blocks. With 1 the oldest record is reused instead. */
+#ifndef BTM_SEC_DEV_REC_MAX_BLOCKS
+#define BTM_SEC_DEV_REC_MAX_BLOCKS  1
+#endif
+
+/* The most security records for peer devices there can be. */
+#define BTM_SEC_MAX_DEVICE_RECORDS_TOTAL    (BTM_SEC_MAX_DEVICE_RECORDS * BTM_SEC_DEV_REC_MAX_BLOCKS)
+
+/* Number of hash buckets to look up the security records by BD_ADDR and by HCI handle.
+** Must be a power of 2, at most 256. */
+#ifndef BTM_SEC_DEV_HASH_SIZE
+#define BTM_SEC_DEV_HASH_SIZE       64
+#endif
+
 /* The number of security records for services. */
 #ifndef BTM_SEC_MAX_SERVICE_RECORDS
 #define BTM_SEC_MAX_SERVICE_RECORDS 32
@@ -1247,6 +1280,19 @@ and USER_HW_DISABLE_API macros */
 #define BTM_BLE_CONFORMANCE_TESTING           FALSE
 #endif
 
+/* Number of random addresses remembered with the device they resolved to, or with
+** none, so that the same address is not resolved again on every advertising report.
+** 0 resolves every time. */
+#ifndef BTM_BLE_RPA_CACHE_SIZE
+#define BTM_BLE_RPA_CACHE_SIZE                16
+#endif
+
+/* Seconds a random address stays in the cache. Peers change their resolvable
+** private address every 15 minutes by default. */
+#ifndef BTM_BLE_RPA_CACHE_TIMEOUT
+#define BTM_BLE_RPA_CACHE_TIMEOUT             900
+#endif
+
 /* Maximum number of consecutive HCI commands  that can time out
 * before  it gets treated as H/w error*/
 #ifndef BTM_MAX_HCI_CMD_TOUT_BEFORE_RESTART
@@ -1265,6 +1311,11 @@ and USER_HW_DISABLE_API macros */
 #define L2CAP_FCR_INCLUDED TRUE
 #endif
 
+/* Set CRC_PCLMUL_OPT to TRUE to compute the L2CAP FCS with carry-less multiply on x86 CPUs that have it */
+#ifndef CRC_PCLMUL_OPT
+#define CRC_PCLMUL_OPT TRUE
+#endif
+
 /* The maximum number of simultaneous links that L2CAP can support. */
 #ifndef MAX_ACL_CONNECTIONS
 #define MAX_L2CAP_LINKS             7
@@ -1397,6 +1448,17 @@ and USER_HW_DISABLE_API macros */
 #define L2CAP_ROUND_ROBIN_CHANNEL_SERVICE   TRUE
 #endif
 
+/* Bytes a channel of weight 1 may send in its turn of the round robin service. The low,
+** medium and high priority groups get 1, 2 and 3 times this amount in their turn. */
+#ifndef L2CAP_DRR_QUANTUM
+#define L2CAP_DRR_QUANTUM                   1024
+#endif
+
+/* Round robin weight of a PSM that has not been given one with L2CA_SetTxWeight() */
+#ifndef L2CAP_DEFAULT_TX_WEIGHT
+#define L2CAP_DEFAULT_TX_WEIGHT             1
+#endif
+
 /* Used for calculating transmit buffers off of */
 #ifndef L2CAP_NUM_XMIT_BUFFS
 #define L2CAP_NUM_XMIT_BUFFS                HCI_ACL_BUF_MAX
@@ -1503,6 +1565,13 @@ and USER_HW_DISABLE_API macros */
 #endif
 #endif
 
+/* Max number of ATT write commands waiting in L2CAP for the controller on an LE
+** link. Write commands beyond it are held by GATT until packets complete.
+*/
+#ifndef GATT_WRITE_CMD_WINDOW
+#define GATT_WRITE_CMD_WINDOW       4
+#endif
+
 /* Used for conformance testing ONLY */
 #ifndef GATT_CONFORMANCE_TESTING
 #define GATT_CONFORMANCE_TESTING           FALSE
@@ -1715,6 +1784,11 @@ and USER_HW_DISABLE_API macros */
 #define PORT_TX_BUF_CRITICAL_WM     15
 #endif
 
+/* The maximum number of transmit buffers filled by one call-out read of the application data. */
+#ifndef PORT_TX_CO_MAX_SEGS
+#define PORT_TX_CO_MAX_SEGS         8
+#endif
+
 /* The RFCOMM multiplexer preferred flow control mechanism. */
 #ifndef PORT_FC_DEFAULT
 #define PORT_FC_DEFAULT             PORT_FC_CREDIT
@@ -2114,6 +2188,11 @@ Range: Minimum 12000 (12 secs) on BR/EDR when supporting PBF.
 #define AVDT_NUM_LINKS              2
 #endif
 
+/* L2CAP round robin weight of the AVDTP PSM, against L2CAP_DEFAULT_TX_WEIGHT of the others */
+#ifndef AVDT_TX_WEIGHT
+#define AVDT_TX_WEIGHT              4
+#endif
+
 /* Number of simultaneous stream endpoints. */
 #ifndef AVDT_NUM_SEPS
 #define AVDT_NUM_SEPS               3
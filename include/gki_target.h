@@ -140,6 +140,18 @@
 #define GKI_TIMER_LIST_NOPREEMPT    FALSE
 #endif
 
+/* TRUE if the timer thread sleeps until the next timer expiration instead of waking up
+ * on every tick. Only used when NO_GKI_RUN_RETURN is defined. Off by default until every
+ * GKI_get_tick_count() user has been checked against the tickless tick accounting. */
+#ifndef GKI_TICKLESS
+#define GKI_TICKLESS                FALSE
+#endif
+
+/* Longest time (in ticks) the tickless timer thread sleeps before updating the tick count. */
+#ifndef GKI_TICKLESS_MAX_TICKS
+#define GKI_TICKLESS_MAX_TICKS      TICKS_PER_SEC
+#endif
+
 /******************************************************************************
 **
 ** Buffer configuration
@@ -262,9 +274,10 @@ POOL_ID 9 is a public pool meant for large buffer needs such as SDP_DB
 #endif
 // btla-specific --
 
-/* The number of fixed and dynamic buffer pools */
+/* The number of fixed and dynamic buffer pools. One dynamic pool is created by
+** the A2DP media task for its outgoing packets. */
 #ifndef GKI_NUM_TOTAL_BUF_POOLS
-#define GKI_NUM_TOTAL_BUF_POOLS     11
+#define GKI_NUM_TOTAL_BUF_POOLS     (GKI_NUM_FIXED_BUF_POOLS + 1)
 #endif
 
 /* The following is intended to be a reserved pool for L2CAP
@@ -296,6 +309,28 @@ of order */
 #define GKI_ENABLE_BUF_CORRUPTION_CHECK TRUE
 #endif
 
+/* TRUE to front the fixed buffer pools with per-thread buffer caches, so that
+** most GKI_getbuf/GKI_freebuf calls complete without taking the GKI mutex. */
+#ifndef GKI_USE_BUF_CACHE
+#define GKI_USE_BUF_CACHE           TRUE
+#endif
+
+/* Maximum number of free buffers one thread may hold per pool. */
+#ifndef GKI_BUF_CACHE_MAX
+#define GKI_BUF_CACHE_MAX           16
+#endif
+
+/* A thread may cache at most 1/GKI_BUF_CACHE_SHARE of a pool's buffers. */
+#ifndef GKI_BUF_CACHE_SHARE
+#define GKI_BUF_CACHE_SHARE         8
+#endif
+
+/* Pools too small to give a thread at least GKI_BUF_CACHE_MIN buffers are not cached,
+** so that a single thread never holds a large part of a small pool. */
+#ifndef GKI_BUF_CACHE_MIN
+#define GKI_BUF_CACHE_MIN           4
+#endif
+
 /* The GKI severe error macro. */
 #ifndef GKI_SEVERE
 #define GKI_SEVERE(code)
@@ -80,6 +80,7 @@ LOCAL_SRC_FILES+= \
 	../embdrv/sbc/encoder/srce/sbc_enc_bit_alloc_mono.c \
 	../embdrv/sbc/encoder/srce/sbc_enc_bit_alloc_ste.c \
 	../embdrv/sbc/encoder/srce/sbc_enc_coeffs.c \
+	../embdrv/sbc/encoder/srce/sbc_enc_simd.c \
 	../embdrv/sbc/encoder/srce/sbc_encoder.c \
 	../embdrv/sbc/encoder/srce/sbc_packing.c \
 
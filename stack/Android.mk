@@ -136,6 +136,7 @@ LOCAL_SRC_FILES:= \
     ./btu/btu_hcif.c \
     ./btu/btu_init.c \
     ./btu/btu_task.c \
+    ./crc/crc.c \
     ./l2cap/l2c_fcr.c \
     ./l2cap/l2c_ucd.c \
     ./l2cap/l2c_main.c \
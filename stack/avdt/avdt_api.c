@@ -118,6 +118,9 @@ void AVDT_Register(tAVDT_REG *p_reg, tAVDT_CTRL_CBACK *p_cback)
     /* register PSM with L2CAP */
     L2CA_Register(AVDT_PSM, (tL2CAP_APPL_INFO *) &avdt_l2c_appl);
 
+    /* media must keep its share of the link next to bulk transfers */
+    L2CA_SetTxWeight(AVDT_PSM, AVDT_TX_WEIGHT);
+
     /* set security level */
     BTM_SetSecurityLevel(TRUE, "", BTM_SEC_SERVICE_AVDTP, p_reg->sec_mask,
         AVDT_PSM, BTM_SEC_PROTO_AVDT, AVDT_CHAN_SIG);
@@ -65,7 +65,6 @@ BOOLEAN BTM_SecAddBleDevice (BD_ADDR bd_addr, BD_NAME bd_name, tBT_DEVICE_TYPE d
 {
 #if BLE_INCLUDED == TRUE
     tBTM_SEC_DEV_REC  *p_dev_rec;
-    UINT8               i = 0;
     tBTM_INQ_INFO      *p_info=NULL;
 
     BTM_TRACE_DEBUG1 ("BTM_SecAddBleDevice dev_type=0x%x", dev_type);
@@ -77,32 +76,16 @@ BOOLEAN BTM_SecAddBleDevice (BD_ADDR bd_addr, BD_NAME bd_name, tBT_DEVICE_TYPE d
 
         /* There is no device record, allocate one.
          * If we can not find an empty spot for this one, let it fail. */
-        for (i = 0; i < BTM_SEC_MAX_DEVICE_RECORDS; i++)
-        {
-            if (!(btm_cb.sec_dev_rec[i].sec_flags & BTM_SEC_IN_USE))
-            {
-                BTM_TRACE_DEBUG1 ("allocate a new dev rec idx=0x%x ", i );
-                p_dev_rec = &btm_cb.sec_dev_rec[i];
-
-                /* Mark this record as in use and initialize */
-                memset (p_dev_rec, 0, sizeof (tBTM_SEC_DEV_REC));
-                p_dev_rec->sec_flags = BTM_SEC_IN_USE;
-                memcpy (p_dev_rec->bd_addr, bd_addr, BD_ADDR_LEN);
-                p_dev_rec->hci_handle = BTM_GetHCIConnHandle (bd_addr);
-
-                /* update conn params, use default value for background connection params */
-                p_dev_rec->conn_params.min_conn_int     =
-                p_dev_rec->conn_params.max_conn_int     =
-                p_dev_rec->conn_params.supervision_tout =
-                p_dev_rec->conn_params.slave_latency    = BTM_BLE_CONN_PARAM_UNDEF;
-
-                BTM_TRACE_DEBUG1 ("hci_handl=0x%x ",  p_dev_rec->hci_handle );
-                break;
-            }
-        }
-
-        if (!p_dev_rec)
+        if ((p_dev_rec = btm_sec_alloc_free_dev (bd_addr)) == NULL)
             return(FALSE);
+
+        /* update conn params, use default value for background connection params */
+        p_dev_rec->conn_params.min_conn_int     =
+        p_dev_rec->conn_params.max_conn_int     =
+        p_dev_rec->conn_params.supervision_tout =
+        p_dev_rec->conn_params.slave_latency    = BTM_BLE_CONN_PARAM_UNDEF;
+
+        BTM_TRACE_DEBUG1 ("hci_handl=0x%x ",  p_dev_rec->hci_handle );
     }
     else
     {
@@ -938,6 +921,7 @@ void btm_sec_save_le_key(BD_ADDR bd_addr, tBTM_LE_KEY_TYPE key_type, tBTM_LE_KEY
                 memcpy(p_rec->ble.static_addr, p_keys->pid_key.static_addr, BD_ADDR_LEN);
                 p_rec->ble.static_addr_type = p_keys->pid_key.addr_type;
                 p_rec->ble.key_type |= BTM_LE_KEY_PID;
+                btm_ble_irk_list_changed();
                 BTM_TRACE_DEBUG1("BTM_LE_KEY_PID key_type=0x%x save peer IRK",  p_rec->ble.key_type);
                 break;
 
@@ -1599,7 +1583,7 @@ void btm_ble_connected (UINT8 *bda, UINT16 handle, UINT8 enc_mode, UINT8 role,
 
     /* update device information */
     p_dev_rec->device_type |= BT_DEVICE_TYPE_BLE;
-    p_dev_rec->hci_handle = handle;
+    btm_sec_set_dev_handle (p_dev_rec, handle);
     p_dev_rec->ble.ble_addr_type = addr_type;
 
     if (role == HCI_ROLE_MASTER)
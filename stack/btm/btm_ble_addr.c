@@ -195,120 +195,205 @@ void btm_gen_non_resolvable_private_addr (tBTM_BLE_ADDR_CBACK *p_cback, void *p)
     }
 
 }
-    #if SMP_INCLUDED == TRUE
+/* The IRK list and the RPA cache only exist in tBTM_LE_RANDOM_CB with SMP */
+#if (SMP_INCLUDED == TRUE)
 /*******************************************************************************
 **  Utility functions for Random address resolving
 *******************************************************************************/
 /*******************************************************************************
 **
-** Function         btm_ble_resolve_address_cmpl
+** Function         btm_ble_irk_list_free
 **
-** Description      This function sends the random address resolving complete
-**                  callback.
+** Description      This function frees the expanded IRKs of the bonded devices.
 **
 ** Returns          None.
 **
 *******************************************************************************/
-static void btm_ble_resolve_address_cmpl(void)
+void btm_ble_irk_list_free(void)
 {
     tBTM_LE_RANDOM_CB   *p_mgnt_cb = &btm_cb.ble_ctr_cb.addr_mgnt_cb;
-    tBTM_SEC_DEV_REC    *p_dev_rec = NULL;
 
-    BTM_TRACE_EVENT1 ("btm_ble_resolve_address_cmpl p_mgnt_cb->index = %d", p_mgnt_cb->index);
+    if (p_mgnt_cb->p_irk_ks)
+        GKI_os_free(p_mgnt_cb->p_irk_ks);
+    if (p_mgnt_cb->p_irk_rec)
+        GKI_os_free(p_mgnt_cb->p_irk_rec);
+
+    p_mgnt_cb->p_irk_ks = NULL;
+    p_mgnt_cb->p_irk_rec = NULL;
+    p_mgnt_cb->irk_num = 0;
+    p_mgnt_cb->irk_list_valid = FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         btm_ble_irk_list_changed
+**
+** Description      This function is called when the IRK of a device record is
+**                  set or cleared. The expanded IRKs are built again on the next
+**                  address to resolve and the addresses resolved so far are
+**                  forgotten.
+**
+** Returns          None.
+**
+*******************************************************************************/
+void btm_ble_irk_list_changed(void)
+{
+    tBTM_LE_RANDOM_CB   *p_mgnt_cb = &btm_cb.ble_ctr_cb.addr_mgnt_cb;
+
+    p_mgnt_cb->irk_list_valid = FALSE;
+#if (BTM_BLE_RPA_CACHE_SIZE > 0)
+    memset(p_mgnt_cb->rpa_cache, 0, sizeof(p_mgnt_cb->rpa_cache));
+    p_mgnt_cb->rpa_cache_next = 0;
+#endif
+}
+
+/*******************************************************************************
+**
+** Function         btm_ble_irk_list_build
+**
+** Description      This function expands the IRK of every device record that
+**                  has one, so that an address is resolved against all of them
+**                  in one SMP_EncryptMatch call.
+**
+** Returns          None.
+**
+*******************************************************************************/
+static void btm_ble_irk_list_build(void)
+{
+    tBTM_LE_RANDOM_CB   *p_mgnt_cb = &btm_cb.ble_ctr_cb.addr_mgnt_cb;
+    tBTM_SEC_DEV_REC    *p_dev_rec;
+    UINT16              i, num = 0;
+
+    btm_ble_irk_list_free();
 
-    if (p_mgnt_cb->index < BTM_SEC_MAX_DEVICE_RECORDS)
+    for (i = 0; (p_dev_rec = btm_sec_dev_rec_at(i)) != NULL; i++)
     {
-        p_dev_rec = &btm_cb.sec_dev_rec[p_mgnt_cb->index];
+        if (p_dev_rec->ble.key_type & BTM_LE_KEY_PID)
+            num++;
     }
 
-    p_mgnt_cb->busy = FALSE;
+    if (num)
+    {
+        p_mgnt_cb->p_irk_ks = (tSMP_AES_KS *)GKI_os_malloc(num * sizeof(tSMP_AES_KS));
+        p_mgnt_cb->p_irk_rec = (UINT16 *)GKI_os_malloc(num * sizeof(UINT16));
+        if (!p_mgnt_cb->p_irk_ks || !p_mgnt_cb->p_irk_rec)
+        {
+            BTM_TRACE_ERROR1("btm_ble_irk_list_build no memory for %d IRKs", num);
+            btm_ble_irk_list_free();
+            return;
+        }
+
+        for (i = 0; (p_dev_rec = btm_sec_dev_rec_at(i)) != NULL; i++)
+        {
+            if ((p_dev_rec->ble.key_type & BTM_LE_KEY_PID) &&
+                SMP_ExpandKey(p_dev_rec->ble.keys.irk, BT_OCTET16_LEN,
+                              &p_mgnt_cb->p_irk_ks[p_mgnt_cb->irk_num]))
+            {
+                p_mgnt_cb->p_irk_rec[p_mgnt_cb->irk_num++] = i;
+            }
+        }
+    }
 
-    (* p_mgnt_cb->p_resolve_cback)(p_dev_rec, p_mgnt_cb->p);
+    BTM_TRACE_EVENT1("btm_ble_irk_list_build %d IRKs", p_mgnt_cb->irk_num);
+    p_mgnt_cb->irk_list_valid = TRUE;
 }
+
+#if (BTM_BLE_RPA_CACHE_SIZE > 0)
 /*******************************************************************************
 **
-** Function         btm_ble_proc_resolve_x
+** Function         btm_ble_rpa_cache_find
 **
-** Description      This function compares the X with random address 3 MSO bytes
-**                  to find a match, if not match, continue for next record.
+** Description      This function looks for a random address resolved before.
 **
-** Returns          None.
+** Returns          TRUE if found, with the record index or BTM_BLE_RPA_NO_MATCH
+**                  in p_rec_index.
 **
 *******************************************************************************/
-static BOOLEAN btm_ble_proc_resolve_x(tSMP_ENC *p)
+static BOOLEAN btm_ble_rpa_cache_find(BD_ADDR random_bda, UINT16 *p_rec_index)
 {
     tBTM_LE_RANDOM_CB   *p_mgnt_cb = &btm_cb.ble_ctr_cb.addr_mgnt_cb;
-    UINT8    comp[3];
-    BTM_TRACE_EVENT0 ("btm_ble_proc_resolve_x");
-    /* compare the hash with 3 LSB of bd address */
-    comp[0] = p_mgnt_cb->random_bda[5];
-    comp[1] = p_mgnt_cb->random_bda[4];
-    comp[2] = p_mgnt_cb->random_bda[3];
+    tBTM_BLE_RPA_CACHE  *p_entry = p_mgnt_cb->rpa_cache;
+    UINT32              now = GKI_get_tick_count();
+    int                 i;
 
-    if (p)
+    for (i = 0; i < BTM_BLE_RPA_CACHE_SIZE; i++, p_entry++)
     {
-        if (!memcmp(p->param_buf, &comp[0], 3))
+        if (p_entry->expire && !memcmp(p_entry->rpa, random_bda, BD_ADDR_LEN))
         {
-            /* match is found */
-            BTM_TRACE_EVENT0 ("match is found");
-            btm_ble_resolve_address_cmpl();
+            if ((INT32)(p_entry->expire - now) <= 0)
+            {
+                /* the peer has most likely moved to a new address */
+                p_entry->expire = 0;
+                return FALSE;
+            }
+            *p_rec_index = p_entry->rec_index;
             return TRUE;
         }
     }
     return FALSE;
 }
+
+/*******************************************************************************
+**
+** Function         btm_ble_rpa_cache_add
+**
+** Description      This function remembers what a random address resolved to.
+**
+** Returns          None.
+**
+*******************************************************************************/
+static void btm_ble_rpa_cache_add(BD_ADDR random_bda, UINT16 rec_index)
+{
+    tBTM_LE_RANDOM_CB   *p_mgnt_cb = &btm_cb.ble_ctr_cb.addr_mgnt_cb;
+    tBTM_BLE_RPA_CACHE  *p_entry = &p_mgnt_cb->rpa_cache[p_mgnt_cb->rpa_cache_next];
+
+    memcpy(p_entry->rpa, random_bda, BD_ADDR_LEN);
+    p_entry->rec_index = rec_index;
+    p_entry->expire = GKI_get_tick_count() + GKI_SECS_TO_TICKS(BTM_BLE_RPA_CACHE_TIMEOUT);
+    /* 0 marks a free entry */
+    if (p_entry->expire == 0)
+        p_entry->expire = 1;
+
+    p_mgnt_cb->rpa_cache_next = (p_mgnt_cb->rpa_cache_next + 1) % BTM_BLE_RPA_CACHE_SIZE;
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         btm_ble_match_random_bda
 **
-** Description      This function match the random address to the appointed device
-**                  record, starting from calculating IRK. If record index exceed
-**                  the maximum record number, matching failed and send callback.
+** Description      This function finds the device record whose IRK generated the
+**                  random address, testing the address against the expanded
+**                  IRKs of all the bonded devices.
 **
-** Returns          None.
+** Returns          Index of the device record, BTM_BLE_RPA_NO_MATCH if none.
 **
 *******************************************************************************/
-static BOOLEAN btm_ble_match_random_bda(UINT16 rec_index)
+static UINT16 btm_ble_match_random_bda(BD_ADDR random_bda)
 {
-#if (BLE_INCLUDED == TRUE && SMP_INCLUDED == TRUE)
-    tBTM_SEC_DEV_REC    *p_dev_rec;
     tBTM_LE_RANDOM_CB   *p_mgnt_cb = &btm_cb.ble_ctr_cb.addr_mgnt_cb;
     UINT8       rand[3];
-    tSMP_ENC    output;
+    UINT8       comp[3];
+    UINT16      k;
 
-    /* use the 3 MSB of bd address as prand */
-    rand[0] = p_mgnt_cb->random_bda[2];
-    rand[1] = p_mgnt_cb->random_bda[1];
-    rand[2] = p_mgnt_cb->random_bda[0];
+    if (!p_mgnt_cb->irk_list_valid)
+        btm_ble_irk_list_build();
 
-    BTM_TRACE_EVENT1("btm_ble_match_random_bda rec_index = %d", rec_index);
+    /* use the 3 MSB of bd address as prand */
+    rand[0] = random_bda[2];
+    rand[1] = random_bda[1];
+    rand[2] = random_bda[0];
+    /* compare the hash with 3 LSB of bd address */
+    comp[0] = random_bda[5];
+    comp[1] = random_bda[4];
+    comp[2] = random_bda[3];
 
-    if (rec_index < BTM_SEC_MAX_DEVICE_RECORDS)
-    {
-        p_dev_rec = &btm_cb.sec_dev_rec[rec_index];
+    /* generate X = E irk(R0, R1, R2) for each IRK, R is random address 3 LSO */
+    k = SMP_EncryptMatch(p_mgnt_cb->p_irk_ks, p_mgnt_cb->irk_num, rand, 3, comp, 3);
 
-        BTM_TRACE_ERROR2("sec_flags = %02x device_type = %d", p_dev_rec->sec_flags, p_dev_rec->device_type);
+    BTM_TRACE_EVENT2("btm_ble_match_random_bda IRK %d of %d", k, p_mgnt_cb->irk_num);
 
-        if ((p_dev_rec->device_type == BT_DEVICE_TYPE_BLE) &&
-            (p_dev_rec->ble.key_type & BTM_LE_KEY_PID))
-        {
-            /* generate X = E irk(R0, R1, R2) and R is random address 3 LSO */
-            SMP_Encrypt(p_dev_rec->ble.keys.irk, BT_OCTET16_LEN,
-                        &rand[0], 3, &output);
-            return btm_ble_proc_resolve_x(&output);
-        }
-        else
-        {
-            // not completed
-            return FALSE;
-        }
-    }
-    else /* no  match found */
-    {
-        btm_ble_resolve_address_cmpl();
-        return TRUE;
-    }
-#endif
+    return (k < p_mgnt_cb->irk_num) ? p_mgnt_cb->p_irk_rec[k] : BTM_BLE_RPA_NO_MATCH;
 }
 
 /*******************************************************************************
@@ -324,31 +409,60 @@ static BOOLEAN btm_ble_match_random_bda(UINT16 rec_index)
 void btm_ble_resolve_random_addr(BD_ADDR random_bda, tBTM_BLE_RESOLVE_CBACK * p_cback, void *p)
 {
     tBTM_LE_RANDOM_CB   *p_mgnt_cb = &btm_cb.ble_ctr_cb.addr_mgnt_cb;
+    tBTM_SEC_DEV_REC    *p_dev_rec = NULL;
+    UINT16              rec_index;
+    BOOLEAN             cached = FALSE;
 
     BTM_TRACE_EVENT0 ("btm_ble_resolve_random_addr");
     if ( !p_mgnt_cb->busy)
     {
         p_mgnt_cb->p = p;
         p_mgnt_cb->busy = TRUE;
-        p_mgnt_cb->index = 0;
         p_mgnt_cb->p_resolve_cback = p_cback;
         memcpy(p_mgnt_cb->random_bda, random_bda, BD_ADDR_LEN);
-        /* start to resolve random address */
-        /* check for next security record */
-        while (TRUE)
+
+#if (BTM_BLE_RPA_CACHE_SIZE > 0)
+        cached = btm_ble_rpa_cache_find(random_bda, &rec_index);
+#endif
+        if (!cached)
+        {
+            rec_index = btm_ble_match_random_bda(random_bda);
+#if (BTM_BLE_RPA_CACHE_SIZE > 0)
+            btm_ble_rpa_cache_add(random_bda, rec_index);
+#endif
+        }
+
+        if (rec_index != BTM_BLE_RPA_NO_MATCH)
         {
-            if (btm_ble_match_random_bda(p_mgnt_cb->index))
+            p_dev_rec = btm_sec_dev_rec_at(rec_index);
+
+            /* the record was taken for another device without its keys being cleared */
+            if (!p_dev_rec || !(p_dev_rec->ble.key_type & BTM_LE_KEY_PID))
             {
-                /* atch found or went through the list */
-                break;
+                btm_ble_irk_list_changed();
+                rec_index = btm_ble_match_random_bda(random_bda);
+#if (BTM_BLE_RPA_CACHE_SIZE > 0)
+                btm_ble_rpa_cache_add(random_bda, rec_index);
+#endif
+                p_dev_rec = btm_sec_dev_rec_at(rec_index);
             }
-	        p_mgnt_cb->index ++;
+
+            /* only LE only devices are resolved */
+            if (p_dev_rec && (p_dev_rec->device_type != BT_DEVICE_TYPE_BLE))
+                p_dev_rec = NULL;
         }
+
+        BTM_TRACE_EVENT2 ("btm_ble_resolve_random_addr rec_index = %d cached = %d", rec_index, cached);
+
+        p_mgnt_cb->index = rec_index;
+        p_mgnt_cb->busy = FALSE;
+
+        (* p_mgnt_cb->p_resolve_cback)(p_dev_rec, p_mgnt_cb->p);
     }
     else
         (*p_cback)(NULL, p);
 }
-    #endif
+#endif  /* SMP_INCLUDED */
 /*******************************************************************************
 **  address mapping between pseudo address and real connection address
 *******************************************************************************/
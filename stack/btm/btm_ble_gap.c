@@ -2190,9 +2190,12 @@ static void btm_ble_process_adv_pkt_cont(BD_ADDR bda, UINT8 addr_type, UINT8 evt
             to_report = FALSE;
         }
     }
-    else if (p_i->inq_count != p_inq->inq_counter) /* first time seen in this inquiry */
+    else
     {
-        p_inq->inq_cmpl_info.num_resp++;
+        btm_inq_db_touch (p_i);
+
+        if (p_i->inq_count != p_inq->inq_counter) /* first time seen in this inquiry */
+            p_inq->inq_cmpl_info.num_resp++;
     }
     /* update the LE device information in inquiry database */
     to_report_LE = btm_ble_update_inq_result(p_i, addr_type, evt_type, p);
@@ -147,6 +147,15 @@ typedef void (tBTM_BLE_RESOLVE_CBACK) (void * match_rec, void *p);
 
 typedef void (tBTM_BLE_ADDR_CBACK) (BD_ADDR_PTR static_random, void *p);
 
+/* random address resolved earlier, and the device record it resolved to */
+#define BTM_BLE_RPA_NO_MATCH    0xFFFF  /* rec_index of an address no IRK resolves */
+typedef struct
+{
+    BD_ADDR                     rpa;
+    UINT16                      rec_index;
+    UINT32                      expire;         /* GKI tick */
+} tBTM_BLE_RPA_CACHE;
+
 /* random address management control block */
 typedef struct
 {
@@ -159,6 +168,18 @@ typedef struct
     tBTM_BLE_ADDR_CBACK         *p_generate_cback;
     void                        *p;
     TIMER_LIST_ENT              raddr_timer_ent;
+
+#if SMP_INCLUDED == TRUE
+    /* expanded IRKs of the device records with one, built again after a change */
+    tSMP_AES_KS                 *p_irk_ks;
+    UINT16                      *p_irk_rec;     /* record index of each IRK */
+    UINT16                      irk_num;
+    BOOLEAN                     irk_list_valid;
+#if (BTM_BLE_RPA_CACHE_SIZE > 0)
+    tBTM_BLE_RPA_CACHE          rpa_cache[BTM_BLE_RPA_CACHE_SIZE];
+    UINT8                       rpa_cache_next; /* entry to replace */
+#endif
+#endif
 } tBTM_LE_RANDOM_CB;
 
 #define BTM_BLE_MAX_BG_CONN_DEV_NUM    10
@@ -326,7 +347,11 @@ extern void btm_ble_enqueue_direct_conn_req(void *p_param);
 /* BLE address management */
 extern void btm_gen_resolvable_private_addr (void);
 extern void btm_gen_non_resolvable_private_addr (tBTM_BLE_ADDR_CBACK *p_cback, void *p);
+#if SMP_INCLUDED == TRUE
 extern void btm_ble_resolve_random_addr(BD_ADDR random_bda, tBTM_BLE_RESOLVE_CBACK * p_cback, void *p);
+extern void btm_ble_irk_list_changed(void);
+extern void btm_ble_irk_list_free(void);
+#endif
 extern void btm_ble_update_reconnect_address(BD_ADDR bd_addr);
 
 #if BTM_BLE_CONFORMANCE_TESTING == TRUE
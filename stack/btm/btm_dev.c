@@ -36,6 +36,16 @@
 #include "hcidefs.h"
 #include "l2c_api.h"
 static tBTM_SEC_DEV_REC *btm_find_oldest_dev (void);
+static tBTM_SEC_DEV_REC *btm_sec_find_free_dev (void);
+static void btm_sec_dev_hash (tBTM_SEC_DEV_REC *p_dev_rec);
+static void btm_sec_dev_unhash (tBTM_SEC_DEV_REC *p_dev_rec);
+
+#define BTM_SEC_HASH_MASK   (BTM_SEC_DEV_HASH_SIZE - 1)
+
+/* the LAP bytes vary the most between devices */
+#define BTM_SEC_ADDR_HASH(a)    ((UINT8)(((a)[5] ^ ((a)[4] << 1) ^ ((a)[3] << 2) ^ (a)[2]) \
+                                         & BTM_SEC_HASH_MASK))
+#define BTM_SEC_HANDLE_HASH(h)  ((UINT8)((h) & BTM_SEC_HASH_MASK))
 
 /*******************************************************************************
 **
@@ -70,29 +80,14 @@ BOOLEAN BTM_SecAddDevice (BD_ADDR bd_addr, DEV_CLASS dev_class, BD_NAME bd_name,
     {
         /* There is no device record, allocate one.
          * If we can not find an empty spot for this one, let it fail. */
-        for (i = 0; i < BTM_SEC_MAX_DEVICE_RECORDS; i++)
-        {
-            if (!(btm_cb.sec_dev_rec[i].sec_flags & BTM_SEC_IN_USE))
-            {
-                p_dev_rec = &btm_cb.sec_dev_rec[i];
-
-                /* Mark this record as in use and initialize */
-                memset (p_dev_rec, 0, sizeof (tBTM_SEC_DEV_REC));
-                p_dev_rec->sec_flags = BTM_SEC_IN_USE;
-                memcpy (p_dev_rec->bd_addr, bd_addr, BD_ADDR_LEN);
-                p_dev_rec->hci_handle = BTM_GetHCIConnHandle (bd_addr);
+        if ((p_dev_rec = btm_sec_alloc_free_dev (bd_addr)) == NULL)
+            return(FALSE);
 
 #if BLE_INCLUDED == TRUE
-                /* use default value for background connection params */
-                /* update conn params, use default value for background connection params */
-                memset(&p_dev_rec->conn_params, 0xff, sizeof(tBTM_LE_CONN_PRAMS));
+        /* use default value for background connection params */
+        /* update conn params, use default value for background connection params */
+        memset(&p_dev_rec->conn_params, 0xff, sizeof(tBTM_LE_CONN_PRAMS));
 #endif
-                break;
-            }
-        }
-
-        if (!p_dev_rec)
-            return(FALSE);
     }
 
     p_dev_rec->timestamp = btm_cb.dev_rec_count++;
@@ -225,53 +220,37 @@ char *BTM_SecReadDevName (BD_ADDR bd_addr)
 *******************************************************************************/
 tBTM_SEC_DEV_REC *btm_sec_alloc_dev (BD_ADDR bd_addr)
 {
-    tBTM_SEC_DEV_REC *p_dev_rec = NULL;
+    tBTM_SEC_DEV_REC *p_dev_rec;
     tBTM_INQ_INFO    *p_inq_info;
-    int               i;
     DEV_CLASS         old_cod;
-    int               i_new_entry = BTM_SEC_MAX_DEVICE_RECORDS;
-    int               i_old_entry = BTM_SEC_MAX_DEVICE_RECORDS;
+    BOOLEAN           old_entry = FALSE;
     BTM_TRACE_EVENT0 ("btm_sec_alloc_dev");
 
-    for (i = 0; i < BTM_SEC_MAX_DEVICE_RECORDS; i++)
+    /* look for old entry where device details are present, freed records stay
+       on the address hash until they are reused */
+    for (p_dev_rec = btm_cb.p_sec_addr_hash[BTM_SEC_ADDR_HASH(bd_addr)]; p_dev_rec;
+         p_dev_rec = p_dev_rec->p_addr_next)
     {
-        /* look for old entry where device details are present */
-        if (!(btm_cb.sec_dev_rec[i].sec_flags & BTM_SEC_IN_USE) &&
-             (!memcmp (btm_cb.sec_dev_rec[i].bd_addr, bd_addr, BD_ADDR_LEN)))
+        if (!(p_dev_rec->sec_flags & BTM_SEC_IN_USE) &&
+             (!memcmp (p_dev_rec->bd_addr, bd_addr, BD_ADDR_LEN)))
         {
-            i_old_entry = i;
+            old_entry = TRUE;
+            memcpy (old_cod, p_dev_rec->dev_class, DEV_CLASS_LEN);
             BTM_TRACE_EVENT0 ("btm_sec_alloc_dev  old device found");
             break;
         }
     }
 
-    for (i = 0; i < BTM_SEC_MAX_DEVICE_RECORDS; i++)
-    {
-        if (!(btm_cb.sec_dev_rec[i].sec_flags & BTM_SEC_IN_USE))
-        {
-            i_new_entry = i;
-            break;
-        }
-    }
-
-    if (i_new_entry == BTM_SEC_MAX_DEVICE_RECORDS) {
+    /* if the old device entry not present go with new entry,
+       or the oldest one if all are in use */
+    if (!p_dev_rec && ((p_dev_rec = btm_sec_find_free_dev()) == NULL))
         p_dev_rec = btm_find_oldest_dev();
-    }
-    else {
-        /* if the old device entry not present go with
-            new entry */
-        if(i_old_entry == BTM_SEC_MAX_DEVICE_RECORDS) {
-            p_dev_rec = &btm_cb.sec_dev_rec[i_new_entry];
-        }
-        else {
-            p_dev_rec = &btm_cb.sec_dev_rec[i_old_entry];
-            memcpy (old_cod, p_dev_rec->dev_class, DEV_CLASS_LEN);
-        }
-    }
+
+    btm_sec_dev_unhash (p_dev_rec);
     memset (p_dev_rec, 0, sizeof (tBTM_SEC_DEV_REC));
 
     /* Retain the old COD for device */
-    if(i_old_entry != BTM_SEC_MAX_DEVICE_RECORDS) {
+    if (old_entry) {
         BTM_TRACE_EVENT0 ("btm_sec_alloc_dev restoring cod ");
         memcpy (p_dev_rec->dev_class, old_cod, DEV_CLASS_LEN);
 
@@ -320,6 +299,36 @@ tBTM_SEC_DEV_REC *btm_sec_alloc_dev (BD_ADDR bd_addr)
 
     p_dev_rec->pin_key_len = 0;
 
+    btm_sec_dev_hash (p_dev_rec);
+
+    return(p_dev_rec);
+}
+
+/*******************************************************************************
+**
+** Function         btm_sec_alloc_free_dev
+**
+** Description      Takes a record that is not in use, growing the table if
+**                  there is none, and initializes it for bd_addr
+**
+** Returns          Pointer to the record or NULL if the table is full
+**
+*******************************************************************************/
+tBTM_SEC_DEV_REC *btm_sec_alloc_free_dev (BD_ADDR bd_addr)
+{
+    tBTM_SEC_DEV_REC *p_dev_rec;
+
+    if ((p_dev_rec = btm_sec_find_free_dev()) == NULL)
+        return(NULL);
+
+    /* Mark this record as in use and initialize */
+    btm_sec_dev_unhash (p_dev_rec);
+    memset (p_dev_rec, 0, sizeof (tBTM_SEC_DEV_REC));
+    p_dev_rec->sec_flags = BTM_SEC_IN_USE;
+    memcpy (p_dev_rec->bd_addr, bd_addr, BD_ADDR_LEN);
+    p_dev_rec->hci_handle = BTM_GetHCIConnHandle (bd_addr);
+    btm_sec_dev_hash (p_dev_rec);
+
     return(p_dev_rec);
 }
 
@@ -411,8 +420,7 @@ BOOLEAN btm_dev_support_switch (BD_ADDR bd_addr)
 *******************************************************************************/
 tBTM_SEC_DEV_REC *btm_find_dev_by_handle (UINT16 handle)
 {
-    tBTM_SEC_DEV_REC *p_dev_rec = &btm_cb.sec_dev_rec[0];
-    int i;
+    tBTM_SEC_DEV_REC *p_dev_rec;
 
     if(handle == BTM_INVALID_HCI_HANDLE)
     {
@@ -420,7 +428,8 @@ tBTM_SEC_DEV_REC *btm_find_dev_by_handle (UINT16 handle)
         return (NULL);
     }
 
-    for (i = 0; i < BTM_SEC_MAX_DEVICE_RECORDS; i++, p_dev_rec++)
+    for (p_dev_rec = btm_cb.p_sec_handle_hash[BTM_SEC_HANDLE_HASH(handle)]; p_dev_rec;
+         p_dev_rec = p_dev_rec->p_handle_next)
     {
         if ((p_dev_rec->sec_flags & BTM_SEC_IN_USE)
             && (p_dev_rec->hci_handle == handle))
@@ -441,11 +450,11 @@ tBTM_SEC_DEV_REC *btm_find_dev_by_handle (UINT16 handle)
 *******************************************************************************/
 tBTM_SEC_DEV_REC *btm_find_dev_by_sec_state(UINT8 sec_state)
 {
-    tBTM_SEC_DEV_REC *p_dev_rec = &btm_cb.sec_dev_rec[0];
-    int i;
+    tBTM_SEC_DEV_REC *p_dev_rec;
+    UINT16 i;
     BTM_TRACE_DEBUG1("btm_find_dev_by_sec_state: sec_state : %d", sec_state);
 
-    for (i = 0; i < BTM_SEC_MAX_DEVICE_RECORDS; i++, p_dev_rec++)
+    for (i = 0; (p_dev_rec = btm_sec_dev_rec_at(i)) != NULL; i++)
     {
         if ((p_dev_rec->sec_flags & BTM_SEC_IN_USE)
             && (p_dev_rec->sec_state == sec_state))
@@ -466,12 +475,12 @@ tBTM_SEC_DEV_REC *btm_find_dev_by_sec_state(UINT8 sec_state)
 *******************************************************************************/
 tBTM_SEC_DEV_REC *btm_find_dev (BD_ADDR bd_addr)
 {
-    tBTM_SEC_DEV_REC *p_dev_rec = &btm_cb.sec_dev_rec[0];
-    int i;
+    tBTM_SEC_DEV_REC *p_dev_rec;
 
     if (bd_addr)
     {
-        for (i = 0; i < BTM_SEC_MAX_DEVICE_RECORDS; i++, p_dev_rec++)
+        for (p_dev_rec = btm_cb.p_sec_addr_hash[BTM_SEC_ADDR_HASH(bd_addr)]; p_dev_rec;
+             p_dev_rec = p_dev_rec->p_addr_next)
         {
             if ((p_dev_rec->sec_flags & BTM_SEC_IN_USE)
                 && (!memcmp (p_dev_rec->bd_addr, bd_addr, BD_ADDR_LEN)))
@@ -517,13 +526,13 @@ tBTM_SEC_DEV_REC *btm_find_or_alloc_dev (BD_ADDR bd_addr)
 *******************************************************************************/
 tBTM_SEC_DEV_REC *btm_find_oldest_dev (void)
 {
-    tBTM_SEC_DEV_REC *p_dev_rec = &btm_cb.sec_dev_rec[0];
-    tBTM_SEC_DEV_REC *p_oldest = p_dev_rec;
+    tBTM_SEC_DEV_REC *p_dev_rec;
+    tBTM_SEC_DEV_REC *p_oldest = &btm_cb.sec_dev_rec[0];
     UINT32       ot = 0xFFFFFFFF;
-    int i;
+    UINT16 i;
 
     /* First look for the non-paired devices for the oldest entry */
-    for (i = 0; i < BTM_SEC_MAX_DEVICE_RECORDS; i++, p_dev_rec++)
+    for (i = 0; (p_dev_rec = btm_sec_dev_rec_at(i)) != NULL; i++)
     {
         if (((p_dev_rec->sec_flags & BTM_SEC_IN_USE) == 0)
             || ((p_dev_rec->sec_flags & BTM_SEC_LINK_KEY_KNOWN) != 0))
@@ -540,8 +549,7 @@ tBTM_SEC_DEV_REC *btm_find_oldest_dev (void)
         return(p_oldest);
 
     /* All devices are paired; find the oldest */
-    p_dev_rec = &btm_cb.sec_dev_rec[0];
-    for (i = 0; i < BTM_SEC_MAX_DEVICE_RECORDS; i++, p_dev_rec++)
+    for (i = 0; (p_dev_rec = btm_sec_dev_rec_at(i)) != NULL; i++)
     {
         if ((p_dev_rec->sec_flags & BTM_SEC_IN_USE) == 0)
             continue;
@@ -555,4 +563,177 @@ tBTM_SEC_DEV_REC *btm_find_oldest_dev (void)
     return(p_oldest);
 }
 
+/*******************************************************************************
+**
+** Function         btm_sec_dev_rec_at
+**
+** Description      Gives the record at index in the device database, to walk
+**                  all of it whatever the number of blocks allocated
+**
+** Returns          Pointer to the record or NULL past the last one
+**
+*******************************************************************************/
+tBTM_SEC_DEV_REC *btm_sec_dev_rec_at (UINT16 index)
+{
+    if (index < BTM_SEC_MAX_DEVICE_RECORDS)
+        return(&btm_cb.sec_dev_rec[index]);
+
+#if (BTM_SEC_DEV_REC_MAX_BLOCKS > 1)
+    index -= BTM_SEC_MAX_DEVICE_RECORDS;
+    if ((index / BTM_SEC_MAX_DEVICE_RECORDS) < btm_cb.sec_dev_num_blk)
+        return(btm_cb.p_sec_dev_blk[index / BTM_SEC_MAX_DEVICE_RECORDS]
+               + (index % BTM_SEC_MAX_DEVICE_RECORDS));
+#endif
+    return(NULL);
+}
+
+/*******************************************************************************
+**
+** Function         btm_sec_find_free_dev
+**
+** Description      Looks for a record that is not in use. If there is none, a
+**                  new block of records is allocated when the configuration
+**                  allows it.
+**
+** Returns          Pointer to the record or NULL
+**
+*******************************************************************************/
+static tBTM_SEC_DEV_REC *btm_sec_find_free_dev (void)
+{
+    tBTM_SEC_DEV_REC *p_dev_rec;
+    UINT16 i;
+
+    for (i = 0; (p_dev_rec = btm_sec_dev_rec_at(i)) != NULL; i++)
+    {
+        if (!(p_dev_rec->sec_flags & BTM_SEC_IN_USE))
+            return(p_dev_rec);
+    }
+
+#if (BTM_SEC_DEV_REC_MAX_BLOCKS > 1)
+    if (btm_cb.sec_dev_num_blk < (BTM_SEC_DEV_REC_MAX_BLOCKS - 1))
+    {
+        p_dev_rec = (tBTM_SEC_DEV_REC *)GKI_os_malloc(BTM_SEC_MAX_DEVICE_RECORDS * sizeof(tBTM_SEC_DEV_REC));
+        if (p_dev_rec)
+        {
+            memset (p_dev_rec, 0, BTM_SEC_MAX_DEVICE_RECORDS * sizeof(tBTM_SEC_DEV_REC));
+            btm_cb.p_sec_dev_blk[btm_cb.sec_dev_num_blk++] = p_dev_rec;
+            BTM_TRACE_EVENT1 ("btm_sec_find_free_dev %d device records",
+                              BTM_SEC_MAX_DEVICE_RECORDS * (btm_cb.sec_dev_num_blk + 1));
+            return(p_dev_rec);
+        }
+        BTM_TRACE_ERROR0 ("btm_sec_find_free_dev no memory for more device records");
+    }
+#endif
+    return(NULL);
+}
+
+/*******************************************************************************
+**
+** Function         btm_sec_dev_rec_free_blocks
+**
+** Description      Frees the blocks of records past the first one
+**
+** Returns          void
+**
+*******************************************************************************/
+void btm_sec_dev_rec_free_blocks (void)
+{
+#if (BTM_SEC_DEV_REC_MAX_BLOCKS > 1)
+    while (btm_cb.sec_dev_num_blk)
+        GKI_os_free (btm_cb.p_sec_dev_blk[--btm_cb.sec_dev_num_blk]);
+#endif
+}
+
+/*******************************************************************************
+**
+** Function         btm_sec_dev_hash
+**
+** Description      Puts the record on the hash chains of its BD address and,
+**                  if it has one, of its HCI handle
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btm_sec_dev_hash (tBTM_SEC_DEV_REC *p_dev_rec)
+{
+    UINT8 bucket = BTM_SEC_ADDR_HASH(p_dev_rec->bd_addr);
+
+    p_dev_rec->addr_bucket = bucket;
+    p_dev_rec->p_addr_next = btm_cb.p_sec_addr_hash[bucket];
+    btm_cb.p_sec_addr_hash[bucket] = p_dev_rec;
+    p_dev_rec->hash_flags |= BTM_SEC_HASH_ADDR;
 
+    btm_sec_set_dev_handle (p_dev_rec, p_dev_rec->hci_handle);
+}
+
+/*******************************************************************************
+**
+** Function         btm_sec_dev_unhash
+**
+** Description      Takes the record off the hash chains it is on
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btm_sec_dev_unhash (tBTM_SEC_DEV_REC *p_dev_rec)
+{
+    tBTM_SEC_DEV_REC **pp;
+
+    if (p_dev_rec->hash_flags & BTM_SEC_HASH_ADDR)
+    {
+        for (pp = &btm_cb.p_sec_addr_hash[p_dev_rec->addr_bucket]; *pp; pp = &(*pp)->p_addr_next)
+        {
+            if (*pp == p_dev_rec)
+            {
+                *pp = p_dev_rec->p_addr_next;
+                break;
+            }
+        }
+        p_dev_rec->p_addr_next = NULL;
+        p_dev_rec->hash_flags &= ~BTM_SEC_HASH_ADDR;
+    }
+
+    btm_sec_set_dev_handle (p_dev_rec, BTM_SEC_INVALID_HANDLE);
+}
+
+/*******************************************************************************
+**
+** Function         btm_sec_set_dev_handle
+**
+** Description      Sets the HCI handle of the record and moves it to the hash
+**                  chain of that handle. The handle of a record must only be
+**                  changed with this function.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btm_sec_set_dev_handle (tBTM_SEC_DEV_REC *p_dev_rec, UINT16 handle)
+{
+    tBTM_SEC_DEV_REC **pp;
+    UINT8 bucket;
+
+    if (p_dev_rec->hash_flags & BTM_SEC_HASH_HANDLE)
+    {
+        for (pp = &btm_cb.p_sec_handle_hash[p_dev_rec->handle_bucket]; *pp; pp = &(*pp)->p_handle_next)
+        {
+            if (*pp == p_dev_rec)
+            {
+                *pp = p_dev_rec->p_handle_next;
+                break;
+            }
+        }
+        p_dev_rec->p_handle_next = NULL;
+        p_dev_rec->hash_flags &= ~BTM_SEC_HASH_HANDLE;
+    }
+
+    p_dev_rec->hci_handle = handle;
+
+    if (handle != BTM_SEC_INVALID_HANDLE)
+    {
+        bucket = BTM_SEC_HANDLE_HASH(handle);
+        p_dev_rec->handle_bucket = bucket;
+        p_dev_rec->p_handle_next = btm_cb.p_sec_handle_hash[bucket];
+        btm_cb.p_sec_handle_hash[bucket] = p_dev_rec;
+        p_dev_rec->hash_flags |= BTM_SEC_HASH_HANDLE;
+    }
+}
@@ -668,7 +668,8 @@ void btm_dev_timeout (TIMER_LIST_ENT  *p_tle)
 *******************************************************************************/
 void btm_reset_complete (void)
 {
-    int devinx;
+    tBTM_SEC_DEV_REC *p_dev_rec;
+    UINT16 devinx;
 
     BTM_TRACE_EVENT0 ("btm_reset_complete");
 
@@ -679,9 +680,9 @@ void btm_reset_complete (void)
         l2cu_device_reset ();
 
         /* Clear current security state */
-        for (devinx = 0; devinx < BTM_SEC_MAX_DEVICE_RECORDS; devinx++)
+        for (devinx = 0; (p_dev_rec = btm_sec_dev_rec_at(devinx)) != NULL; devinx++)
         {
-            btm_cb.sec_dev_rec[devinx].sec_state = BTM_SEC_STATE_IDLE;
+            p_dev_rec->sec_state = BTM_SEC_STATE_IDLE;
         }
 
         /* After the reset controller should restore all parameters to defaults. */
@@ -44,12 +44,19 @@
 #ifndef BTM_INQ_DEBUG
 #define BTM_INQ_DEBUG   FALSE
 #endif
+
+#define BTM_INQ_HASH_MASK       (BTM_INQ_DB_HASH_SIZE - 1)
+#define BTM_INQ_HASH(a)         ((UINT8)(((a)[5] ^ ((a)[4] << 1) ^ ((a)[3] << 2) ^ (a)[2]) \
+                                         & BTM_INQ_HASH_MASK))
 /********************************************************************************/
 /*                 L O C A L    D A T A    D E F I N I T I O N S                */
 /********************************************************************************/
 static const LAP general_inq_lap = {0x9e,0x8b,0x33};
 static const LAP limited_inq_lap = {0x9e,0x8b,0x00};
 
+/* number of inquiry database entries, kept across btm_init() */
+static UINT16 btm_inq_db_cfg_size = BTM_INQ_DB_SIZE;
+
 #if (( BTM_EIR_CLIENT_INCLUDED == TRUE )||( BTM_EIR_SERVER_INCLUDED == TRUE ))
 #ifndef BTM_EIR_UUID_LKUP_TBL
 const UINT16 BTM_EIR_UUID_LKUP_TBL[BTM_EIR_MAX_SERVICES] =
@@ -145,6 +152,9 @@ extern UINT16 BTM_EIR_UUID_LKUP_TBL[BTM_EIR_MAX_SERVICES];
 static void         btm_initiate_inquiry (tBTM_INQUIRY_VAR_ST *p_inq);
 static tBTM_STATUS  btm_set_inq_event_filter (UINT8 filter_cond_type, tBTM_INQ_FILT_COND *p_filt_cond);
 static void         btm_clr_inq_result_flt (void);
+static void         btm_inq_db_empty (void);
+static void         btm_inq_db_link (tINQ_DB_ENT *p_ent);
+static void         btm_inq_db_unlink (tINQ_DB_ENT *p_ent);
 
 #if ((BTM_EIR_SERVER_INCLUDED == TRUE)||(BTM_EIR_CLIENT_INCLUDED == TRUE))
 static UINT8        btm_convert_uuid_to_eir_service( UINT16 uuid16 );
@@ -1178,7 +1188,7 @@ tBTM_INQ_INFO *BTM_InqFirstResult (void)
     tINQ_DB_ENT  *p_ent = btm_cb.btm_inq_vars.inq_db;
     UINT32       cur_inq_count = btm_cb.btm_inq_vars.inq_counter - 1;
 
-    for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++)
+    for (xx = 0; xx < btm_cb.btm_inq_vars.inq_db_size; xx++, p_ent++)
     {
         if (p_ent->in_use && p_ent->inq_count == cur_inq_count)
             return (&p_ent->inq_info);
@@ -1211,7 +1221,7 @@ tBTM_INQ_INFO *BTM_InqNextResult (tBTM_INQ_INFO *p_cur)
         p_ent = (tINQ_DB_ENT *) ((UINT8 *)p_cur - offsetof (tINQ_DB_ENT, inq_info));
         inx = (UINT16)((p_ent - btm_cb.btm_inq_vars.inq_db) + 1);
 
-        for (p_ent = &btm_cb.btm_inq_vars.inq_db[inx]; inx < BTM_INQ_DB_SIZE; inx++, p_ent++)
+        for (p_ent = &btm_cb.btm_inq_vars.inq_db[inx]; inx < btm_cb.btm_inq_vars.inq_db_size; inx++, p_ent++)
         {
             if (p_ent->in_use && p_ent->inq_count == cur_inq_count)
                 return (&p_ent->inq_info);
@@ -1238,17 +1248,13 @@ tBTM_INQ_INFO *BTM_InqNextResult (tBTM_INQ_INFO *p_cur)
 *******************************************************************************/
 tBTM_INQ_INFO *BTM_InqDbRead (BD_ADDR p_bda)
 {
-    UINT16       xx;
-    tINQ_DB_ENT  *p_ent = btm_cb.btm_inq_vars.inq_db;
+    tINQ_DB_ENT  *p_ent;
 
     BTM_TRACE_API6 ("BTM_InqDbRead: bd addr [%02x%02x%02x%02x%02x%02x]",
                p_bda[0], p_bda[1], p_bda[2], p_bda[3], p_bda[4], p_bda[5]);
 
-    for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++)
-    {
-        if ((p_ent->in_use) && (!memcmp (p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN)))
-            return (&p_ent->inq_info);
-    }
+    if ((p_ent = btm_inq_db_find (p_bda)) != NULL)
+        return (&p_ent->inq_info);
 
     /* If here, not found */
     return ((tBTM_INQ_INFO *)NULL);
@@ -1272,7 +1278,7 @@ tBTM_INQ_INFO *BTM_InqDbFirst (void)
     UINT16       xx;
     tINQ_DB_ENT  *p_ent = btm_cb.btm_inq_vars.inq_db;
 
-    for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++)
+    for (xx = 0; xx < btm_cb.btm_inq_vars.inq_db_size; xx++, p_ent++)
     {
         if (p_ent->in_use)
             return (&p_ent->inq_info);
@@ -1304,7 +1310,7 @@ tBTM_INQ_INFO *BTM_InqDbNext (tBTM_INQ_INFO *p_cur)
         p_ent = (tINQ_DB_ENT *) ((UINT8 *)p_cur - offsetof (tINQ_DB_ENT, inq_info));
         inx = (UINT16)((p_ent - btm_cb.btm_inq_vars.inq_db) + 1);
 
-        for (p_ent = &btm_cb.btm_inq_vars.inq_db[inx]; inx < BTM_INQ_DB_SIZE; inx++, p_ent++)
+        for (p_ent = &btm_cb.btm_inq_vars.inq_db[inx]; inx < btm_cb.btm_inq_vars.inq_db_size; inx++, p_ent++)
         {
             if (p_ent->in_use)
                 return (&p_ent->inq_info);
@@ -1360,7 +1366,7 @@ UINT8 BTM_ReadNumInqDbEntries (void)
     UINT8         num_results;
     tINQ_DB_ENT  *p_ent = btm_cb.btm_inq_vars.inq_db;
 
-    for (num_entries = 0, num_results = 0; num_entries < BTM_INQ_DB_SIZE; num_entries++, p_ent++)
+    for (num_entries = 0, num_results = 0; num_entries < btm_cb.btm_inq_vars.inq_db_size; num_entries++, p_ent++)
     {
         if (p_ent->in_use)
             num_results++;
@@ -1370,6 +1376,35 @@ UINT8 BTM_ReadNumInqDbEntries (void)
 }
 
 
+/*******************************************************************************
+**
+** Function         BTM_SetInqDbSize
+**
+** Description      This function is called to change the number of entries of
+**                  the inquiry database. The new size takes effect the next
+**                  time the stack is started; the current database is left in
+**                  place since BTA may hold pointers into it.
+**
+** Parameter        num_entries - (input) 1 to BTM_INQ_DB_MAX_SIZE
+**
+** Returns          BTM_ILLEGAL_VALUE if the size is out of range
+**                  otherwise BTM_SUCCESS
+**
+*******************************************************************************/
+tBTM_STATUS BTM_SetInqDbSize (UINT16 num_entries)
+{
+    BTM_TRACE_API1 ("BTM_SetInqDbSize: %d entries", num_entries);
+
+    if (num_entries == 0 || num_entries > BTM_INQ_DB_MAX_SIZE)
+        return (BTM_ILLEGAL_VALUE);
+
+    /* applied by btm_inq_db_init() */
+    btm_inq_db_cfg_size = num_entries;
+
+    return (BTM_SUCCESS);
+}
+
+
 /*******************************************************************************
 **
 ** Function         BTM_InquiryRegisterForChanges
@@ -1571,6 +1606,39 @@ void btm_inq_db_init (void)
     memset (&btm_cb.btm_inq_vars, 0, sizeof (tBTM_INQUIRY_VAR_ST));
 #endif
     btm_cb.btm_inq_vars.no_inc_ssp = BTM_NO_SSP_ON_INQUIRY;
+
+    btm_cb.btm_inq_vars.inq_db = (tINQ_DB_ENT *)GKI_os_malloc(btm_inq_db_cfg_size * sizeof(tINQ_DB_ENT));
+    if (btm_cb.btm_inq_vars.inq_db)
+    {
+        memset (btm_cb.btm_inq_vars.inq_db, 0, btm_inq_db_cfg_size * sizeof(tINQ_DB_ENT));
+        btm_cb.btm_inq_vars.inq_db_size = btm_inq_db_cfg_size;
+    }
+    else
+        BTM_TRACE_ERROR1 ("btm_inq_db_init no memory for %d entries", btm_inq_db_cfg_size);
+
+    btm_inq_db_empty();
+}
+
+/*******************************************************************************
+**
+** Function         btm_inq_db_free
+**
+** Description      This function frees the entries of the inquiry database.
+**                  It is called before btm_init() clears the control block.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btm_inq_db_free (void)
+{
+    tBTM_INQUIRY_VAR_ST     *p_inq = &btm_cb.btm_inq_vars;
+
+    if (p_inq->inq_db)
+        GKI_os_free(p_inq->inq_db);
+
+    p_inq->inq_db      = NULL;
+    p_inq->inq_db_size = 0;
+    btm_inq_db_empty();
 }
 
 /*********************************************************************************
@@ -1646,13 +1714,27 @@ void btm_clr_inq_db (BD_ADDR p_bda)
     BTM_TRACE_DEBUG2 ("btm_clr_inq_db: inq_active:0x%x state:%d",
         btm_cb.btm_inq_vars.inq_active, btm_cb.btm_inq_vars.state);
 #endif
-    for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++)
+    if (p_bda != NULL)
     {
-        if (p_ent->in_use)
+        if ((p_ent = btm_inq_db_find (p_bda)) != NULL)
         {
-            /* If this is the specified BD_ADDR or clearing all devices */
-            if (p_bda == NULL ||
-                (!memcmp (p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN)))
+            btm_inq_db_unlink (p_ent);
+            p_ent->in_use = FALSE;
+#if (BTM_INQ_GET_REMOTE_NAME == TRUE)
+            p_ent->inq_info.remote_name_state = BTM_INQ_RMT_NAME_EMPTY;
+#endif
+            p_ent->p_lru_next = p_inq->p_inq_free;
+            p_inq->p_inq_free = p_ent;
+
+            if (btm_cb.btm_inq_vars.p_inq_change_cb)
+                (*btm_cb.btm_inq_vars.p_inq_change_cb) (&p_ent->inq_info, FALSE);
+        }
+    }
+    else
+    {
+        for (xx = 0; xx < p_inq->inq_db_size; xx++, p_ent++)
+        {
+            if (p_ent->in_use)
             {
                 p_ent->in_use = FALSE;
 #if (BTM_INQ_GET_REMOTE_NAME == TRUE)
@@ -1663,6 +1745,7 @@ void btm_clr_inq_db (BD_ADDR p_bda)
                     (*btm_cb.btm_inq_vars.p_inq_change_cb) (&p_ent->inq_info, FALSE);
             }
         }
+        btm_inq_db_empty();
     }
 #if (BTM_INQ_DEBUG == TRUE)
     BTM_TRACE_DEBUG2 ("inq_active:0x%x state:%d",
@@ -1670,6 +1753,135 @@ void btm_clr_inq_db (BD_ADDR p_bda)
 #endif
 }
 
+/*******************************************************************************
+**
+** Function         btm_inq_db_empty
+**
+** Description      This function puts all the entries of the inquiry database
+**                  on the free list, without notifying anyone.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btm_inq_db_empty (void)
+{
+    tBTM_INQUIRY_VAR_ST     *p_inq = &btm_cb.btm_inq_vars;
+    tINQ_DB_ENT             *p_ent;
+    UINT16                   xx;
+
+    memset (p_inq->p_inq_hash, 0, sizeof(p_inq->p_inq_hash));
+    p_inq->p_lru_first = NULL;
+    p_inq->p_lru_last  = NULL;
+    p_inq->p_inq_free  = NULL;
+
+    /* lowest entries are taken first */
+    for (xx = p_inq->inq_db_size, p_ent = p_inq->inq_db + xx; xx > 0; xx--)
+    {
+        p_ent--;
+        p_ent->in_use      = FALSE;
+        p_ent->p_hash_next = NULL;
+        p_ent->p_lru_prev  = NULL;
+        p_ent->p_lru_next  = p_inq->p_inq_free;
+        p_inq->p_inq_free  = p_ent;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         btm_inq_db_link
+**
+** Description      This function puts an entry in use on the hash chain of its
+**                  BD address, and first in the LRU list.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btm_inq_db_link (tINQ_DB_ENT *p_ent)
+{
+    tBTM_INQUIRY_VAR_ST     *p_inq = &btm_cb.btm_inq_vars;
+    UINT8                    bucket = BTM_INQ_HASH(p_ent->inq_info.results.remote_bd_addr);
+
+    p_ent->p_hash_next = p_inq->p_inq_hash[bucket];
+    p_inq->p_inq_hash[bucket] = p_ent;
+
+    p_ent->p_lru_prev = NULL;
+    p_ent->p_lru_next = p_inq->p_lru_first;
+    if (p_inq->p_lru_first)
+        p_inq->p_lru_first->p_lru_prev = p_ent;
+    else
+        p_inq->p_lru_last = p_ent;
+    p_inq->p_lru_first = p_ent;
+}
+
+/*******************************************************************************
+**
+** Function         btm_inq_db_unlink
+**
+** Description      This function takes an entry off its hash chain and off
+**                  the LRU list.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btm_inq_db_unlink (tINQ_DB_ENT *p_ent)
+{
+    tBTM_INQUIRY_VAR_ST     *p_inq = &btm_cb.btm_inq_vars;
+    tINQ_DB_ENT            **pp;
+
+    for (pp = &p_inq->p_inq_hash[BTM_INQ_HASH(p_ent->inq_info.results.remote_bd_addr)];
+         *pp; pp = &(*pp)->p_hash_next)
+    {
+        if (*pp == p_ent)
+        {
+            *pp = p_ent->p_hash_next;
+            break;
+        }
+    }
+    p_ent->p_hash_next = NULL;
+
+    if (p_ent->p_lru_prev)
+        p_ent->p_lru_prev->p_lru_next = p_ent->p_lru_next;
+    else
+        p_inq->p_lru_first = p_ent->p_lru_next;
+    if (p_ent->p_lru_next)
+        p_ent->p_lru_next->p_lru_prev = p_ent->p_lru_prev;
+    else
+        p_inq->p_lru_last = p_ent->p_lru_prev;
+    p_ent->p_lru_prev = NULL;
+    p_ent->p_lru_next = NULL;
+}
+
+/*******************************************************************************
+**
+** Function         btm_inq_db_touch
+**
+** Description      This function is called when a device in the inquiry
+**                  database responds again. Its entry becomes the last one
+**                  to be reused.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btm_inq_db_touch (tINQ_DB_ENT *p_ent)
+{
+    tBTM_INQUIRY_VAR_ST     *p_inq = &btm_cb.btm_inq_vars;
+
+    if (p_ent == p_inq->p_lru_first)
+        return;
+
+    /* it is not first, so it has a previous entry */
+    p_ent->p_lru_prev->p_lru_next = p_ent->p_lru_next;
+    if (p_ent->p_lru_next)
+        p_ent->p_lru_next->p_lru_prev = p_ent->p_lru_prev;
+    else
+        p_inq->p_lru_last = p_ent->p_lru_prev;
+
+    p_ent->p_lru_prev = NULL;
+    p_ent->p_lru_next = p_inq->p_lru_first;
+    p_inq->p_lru_first->p_lru_prev = p_ent;
+    p_inq->p_lru_first = p_ent;
+}
+
 
 /*******************************************************************************
 **
@@ -1748,12 +1960,11 @@ BOOLEAN btm_inq_find_bdaddr (BD_ADDR p_bda)
 *******************************************************************************/
 tINQ_DB_ENT *btm_inq_db_find (BD_ADDR p_bda)
 {
-    UINT16       xx;
-    tINQ_DB_ENT  *p_ent = btm_cb.btm_inq_vars.inq_db;
+    tINQ_DB_ENT  *p_ent = btm_cb.btm_inq_vars.p_inq_hash[BTM_INQ_HASH(p_bda)];
 
-    for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++)
+    for ( ; p_ent; p_ent = p_ent->p_hash_next)
     {
-        if ((p_ent->in_use) && (!memcmp (p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN)))
+        if (!memcmp (p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN))
             return (p_ent);
     }
 
@@ -1766,57 +1977,43 @@ tINQ_DB_ENT *btm_inq_db_find (BD_ADDR p_bda)
 **
 ** Function         btm_inq_db_new
 **
-** Description      This function looks through the inquiry database for an unused
-**                  entry. If no entry is free, it allocates the oldest entry.
+** Description      This function takes an unused entry of the inquiry database.
+**                  If no entry is free, it reuses the entry of the device that
+**                  responded least recently.
 **
-** Returns          pointer to entry
+** Returns          pointer to entry, or NULL if there is no database
 **
 *******************************************************************************/
 tINQ_DB_ENT *btm_inq_db_new (BD_ADDR p_bda)
 {
-    UINT16       xx;
-    tINQ_DB_ENT  *p_ent = btm_cb.btm_inq_vars.inq_db;
-    tINQ_DB_ENT  *p_old = btm_cb.btm_inq_vars.inq_db;
-    UINT32       ot = 0xFFFFFFFF;
+    tBTM_INQUIRY_VAR_ST  *p_inq = &btm_cb.btm_inq_vars;
+    tINQ_DB_ENT          *p_ent;
 
-    for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++)
+    if ((p_ent = p_inq->p_inq_free) != NULL)
+        p_inq->p_inq_free = p_ent->p_lru_next;
+    else if ((p_ent = p_inq->p_lru_last) != NULL)
     {
-        if (!p_ent->in_use)
-        {
-            memset (p_ent, 0, sizeof (tINQ_DB_ENT));
-            memcpy (p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN);
-            p_ent->in_use = TRUE;
+        btm_inq_db_unlink (p_ent);
 
-#if (BTM_INQ_GET_REMOTE_NAME==TRUE)
-            p_ent->inq_info.remote_name_state = BTM_INQ_RMT_NAME_EMPTY;
-#endif
-
-            return (p_ent);
-        }
-
-        if (p_ent->time_of_resp < ot)
-        {
-            p_old = p_ent;
-            ot    = p_ent->time_of_resp;
-        }
+        /* Before deleting the oldest, if anyone is registered for change */
+        /* notifications, then tell him we are deleting an entry.         */
+        if (p_inq->p_inq_change_cb)
+            (*p_inq->p_inq_change_cb) (&p_ent->inq_info, FALSE);
     }
+    else
+        return (NULL);
 
-    /* If here, no free entry found. Return the oldest. */
-
-    /* Before deleting the oldest, if anyone is registered for change */
-    /* notifications, then tell him we are deleting an entry.         */
-    if (btm_cb.btm_inq_vars.p_inq_change_cb)
-        (*btm_cb.btm_inq_vars.p_inq_change_cb) (&p_old->inq_info, FALSE);
-
-    memset (p_old, 0, sizeof (tINQ_DB_ENT));
-    memcpy (p_old->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN);
-    p_old->in_use = TRUE;
+    memset (p_ent, 0, sizeof (tINQ_DB_ENT));
+    memcpy (p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN);
+    p_ent->in_use = TRUE;
 
 #if (BTM_INQ_GET_REMOTE_NAME==TRUE)
-    p_old->inq_info.remote_name_state = BTM_INQ_RMT_NAME_EMPTY;
+    p_ent->inq_info.remote_name_state = BTM_INQ_RMT_NAME_EMPTY;
 #endif
 
-    return (p_old);
+    btm_inq_db_link (p_ent);
+
+    return (p_ent);
 }
 
 
@@ -2028,7 +2225,8 @@ static void btm_initiate_inquiry (tBTM_INQUIRY_VAR_ST *p_inq)
     }
 
     /* Make sure the number of responses doesn't overflow the database configuration */
-    p_inqparms->max_resps = (UINT8)((p_inqparms->max_resps <= BTM_INQ_DB_SIZE) ? p_inqparms->max_resps : BTM_INQ_DB_SIZE);
+    if (p_inqparms->max_resps > p_inq->inq_db_size)
+        p_inqparms->max_resps = (UINT8)p_inq->inq_db_size;
 
     lap = (p_inq->inq_active & BTM_LIMITED_INQUIRY_ACTIVE) ? &limited_inq_lap : &general_inq_lap;
 
@@ -2202,7 +2400,8 @@ void btm_process_inq_results (UINT8 *p, UINT8 inq_res_mode)
         /* If existing entry, use that, else get a new one (possibly reusing the oldest) */
         if (p_i == NULL)
         {
-            p_i = btm_inq_db_new (bda);
+            if ((p_i = btm_inq_db_new (bda)) == NULL)
+                continue;
             is_new = TRUE;
         }
 
@@ -2217,6 +2416,8 @@ void btm_process_inq_results (UINT8 *p, UINT8 inq_res_mode)
             )
             is_new = FALSE;
 
+        btm_inq_db_touch (p_i);
+
         /* keep updating RSSI to have latest value */
         if( inq_res_mode != BTM_INQ_RESULT_STANDARD )
             p_i->inq_info.results.rssi = (INT8)rssi;
@@ -2363,19 +2564,31 @@ void btm_process_inq_results (UINT8 *p, UINT8 inq_res_mode)
 *******************************************************************************/
 void btm_sort_inq_result(void)
 {
-    UINT8               xx, yy, num_resp;
+    tBTM_INQUIRY_VAR_ST *p_inq  = &btm_cb.btm_inq_vars;
+    UINT16              xx, yy, num_resp, num_lru = 0, rank;
     tINQ_DB_ENT         *p_tmp  = NULL;
-    tINQ_DB_ENT         *p_ent  = btm_cb.btm_inq_vars.inq_db;
-    tINQ_DB_ENT         *p_next = btm_cb.btm_inq_vars.inq_db+1;
+    tINQ_DB_ENT         *p_ent  = p_inq->inq_db;
+    tINQ_DB_ENT         *p_next = p_inq->inq_db+1;
+    UINT16              *p_rank;            /* LRU position of the entry in each slot */
+    UINT16              *p_slot;            /* slot of each LRU position */
     int                 size;
 
-    num_resp = (btm_cb.btm_inq_vars.inq_cmpl_info.num_resp<BTM_INQ_DB_SIZE)?
-                btm_cb.btm_inq_vars.inq_cmpl_info.num_resp: BTM_INQ_DB_SIZE;
+    num_resp = (p_inq->inq_cmpl_info.num_resp < p_inq->inq_db_size)?
+                p_inq->inq_cmpl_info.num_resp: p_inq->inq_db_size;
+
+    if (num_resp < 2)
+        return;
 
-    if((p_tmp = (tINQ_DB_ENT *)GKI_getbuf(sizeof(tINQ_DB_ENT))) != NULL)
+    if((p_tmp = (tINQ_DB_ENT *)GKI_getbuf((UINT16)(sizeof(tINQ_DB_ENT) +
+                                         2 * p_inq->inq_db_size * sizeof(UINT16)))) != NULL)
     {
+        p_rank = (UINT16 *)(p_tmp + 1);
+        p_slot = p_rank + p_inq->inq_db_size;
+        for (p_ent = p_inq->p_lru_first; p_ent; p_ent = p_ent->p_lru_next)
+            p_rank[p_ent - p_inq->inq_db] = num_lru++;
+
         size = sizeof(tINQ_DB_ENT);
-        for(xx = 0; xx < num_resp-1; xx++, p_ent++)
+        for(xx = 0, p_ent = p_inq->inq_db; xx < num_resp-1; xx++, p_ent++)
         {
             for(yy = xx+1, p_next = p_ent+1; yy < num_resp; yy++, p_next++)
             {
@@ -2384,10 +2597,36 @@ void btm_sort_inq_result(void)
                     memcpy (p_tmp,  p_next, size);
                     memcpy (p_next, p_ent,  size);
                     memcpy (p_ent,  p_tmp,  size);
+                    rank = p_rank[yy];
+                    p_rank[yy] = p_rank[xx];
+                    p_rank[xx] = rank;
                 }
             }
         }
 
+        /* The entries moved with their links: build the hash chains, the LRU
+           list and the free list again */
+        memset (p_inq->p_inq_hash, 0, sizeof(p_inq->p_inq_hash));
+        p_inq->p_lru_first = NULL;
+        p_inq->p_lru_last  = NULL;
+        p_inq->p_inq_free  = NULL;
+
+        for (xx = p_inq->inq_db_size, p_ent = p_inq->inq_db + xx; xx > 0; xx--)
+        {
+            p_ent--;
+            if (p_ent->in_use)
+                p_slot[p_rank[xx - 1]] = xx - 1;
+            else
+            {
+                p_ent->p_lru_next = p_inq->p_inq_free;
+                p_inq->p_inq_free = p_ent;
+            }
+        }
+
+        /* least recently used first, each one goes in front of the list */
+        for (xx = num_lru; xx > 0; xx--)
+            btm_inq_db_link (&p_inq->inq_db[p_slot[xx - 1]]);
+
         GKI_freebuf(p_tmp);
     }
 }
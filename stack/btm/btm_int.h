@@ -261,7 +261,7 @@ typedef struct
 } tINQ_BDADDR;
 #endif
 
-typedef struct
+typedef struct t_inq_db_ent
 {
     UINT32          time_of_resp;
     UINT32          inq_count;          /* "timestamps" the entry with a particular inquiry count   */
@@ -275,6 +275,12 @@ typedef struct
 #if (BLE_INCLUDED == TRUE)
     BOOLEAN         scan_rsp;
 #endif
+
+    /* hash chain of btm_inq_vars.p_inq_hash, and LRU list of the entries in use
+       (free list of the others), only changed by btm_inq.c */
+    struct t_inq_db_ent *p_hash_next;
+    struct t_inq_db_ent *p_lru_prev;
+    struct t_inq_db_ent *p_lru_next;
 } tINQ_DB_ENT;
 
 
@@ -327,7 +333,12 @@ typedef struct
     UINT16           num_bd_entries;        /* Number of entries in database */
     UINT16           max_bd_entries;        /* Maximum number of entries that can be stored */
 #endif
-    tINQ_DB_ENT      inq_db[BTM_INQ_DB_SIZE];
+    tINQ_DB_ENT     *inq_db;                /* inq_db_size entries */
+    UINT16           inq_db_size;
+    tINQ_DB_ENT     *p_inq_hash[BTM_INQ_DB_HASH_SIZE]; /* entries in use by bd_addr */
+    tINQ_DB_ENT     *p_lru_first;           /* entry that responded last */
+    tINQ_DB_ENT     *p_lru_last;            /* entry reused when the database is full */
+    tINQ_DB_ENT     *p_inq_free;            /* entries not in use */
     tBTM_INQ_PARMS   inqparms;              /* Contains the parameters for the current inquiry */
     tBTM_INQUIRY_CMPL inq_cmpl_info;        /* Status and number of responses from the last inquiry */
 
@@ -526,7 +537,7 @@ typedef struct
 ** Define structure for Security Device Record.
 ** A record exists for each device authenticated with this device
 */
-typedef struct
+typedef struct t_btm_sec_dev_rec
 {
     tBTM_SEC_SERV_REC   *p_cur_service;
     tBTM_SEC_CALLBACK   *p_callback;
@@ -607,6 +618,16 @@ typedef struct
 #define BTM_SEC_NO_LAST_SERVICE_ID      0
     UINT8           last_author_service_id;         /* ID of last serviced authorized: Reset after each l2cap connection */
 
+    /* hash chains of btm_cb.p_sec_addr_hash and btm_cb.p_sec_handle_hash,
+       only changed by btm_dev.c */
+#define BTM_SEC_HASH_ADDR       0x01
+#define BTM_SEC_HASH_HANDLE     0x02
+    struct t_btm_sec_dev_rec *p_addr_next;
+    struct t_btm_sec_dev_rec *p_handle_next;
+    UINT8           hash_flags;         /* chains the record is on */
+    UINT8           addr_bucket;
+    UINT8           handle_bucket;
+
 } tBTM_SEC_DEV_REC;
 
 #define BTM_SEC_IS_SM4(sm) ((BOOLEAN)(BTM_SM4_TRUE == ((sm)&BTM_SM4_TRUE)))
@@ -889,6 +910,12 @@ typedef struct
     UINT8                    disc_reason;   /* for legacy devices */
     tBTM_SEC_SERV_REC        sec_serv_rec[BTM_SEC_MAX_SERVICE_RECORDS];
     tBTM_SEC_DEV_REC         sec_dev_rec[BTM_SEC_MAX_DEVICE_RECORDS];
+#if (BTM_SEC_DEV_REC_MAX_BLOCKS > 1)
+    tBTM_SEC_DEV_REC        *p_sec_dev_blk[BTM_SEC_DEV_REC_MAX_BLOCKS - 1]; /* records past sec_dev_rec */
+#endif
+    UINT8                    sec_dev_num_blk;   /* blocks in p_sec_dev_blk */
+    tBTM_SEC_DEV_REC        *p_sec_addr_hash[BTM_SEC_DEV_HASH_SIZE];   /* records by bd_addr */
+    tBTM_SEC_DEV_REC        *p_sec_handle_hash[BTM_SEC_DEV_HASH_SIZE]; /* records by hci_handle */
     tBTM_SEC_SERV_REC       *p_out_serv;
     tBTM_MKEY_CALLBACK      *mkey_cback;
 
@@ -965,6 +992,8 @@ extern void         btm_event_filter_complete (UINT8 *p);
 extern void         btm_inq_stop_on_ssp(void);
 extern void         btm_inq_clear_ssp(void);
 extern tINQ_DB_ENT *btm_inq_db_find (BD_ADDR p_bda);
+extern void         btm_inq_db_touch (tINQ_DB_ENT *p_ent);
+extern void         btm_inq_db_free (void);
 extern BOOLEAN      btm_inq_find_bdaddr (BD_ADDR p_bda);
 
 #if (BTM_EIR_CLIENT_INCLUDED == TRUE)
@@ -1116,6 +1145,10 @@ extern void               btm_sec_free_dev (tBTM_SEC_DEV_REC *p_dev_rec);
 extern tBTM_SEC_DEV_REC  *btm_find_dev (BD_ADDR bd_addr);
 extern tBTM_SEC_DEV_REC  *btm_find_or_alloc_dev (BD_ADDR bd_addr);
 extern tBTM_SEC_DEV_REC  *btm_find_dev_by_handle (UINT16 handle);
+extern tBTM_SEC_DEV_REC  *btm_sec_alloc_free_dev (BD_ADDR bd_addr);
+extern void               btm_sec_set_dev_handle (tBTM_SEC_DEV_REC *p_dev_rec, UINT16 handle);
+extern tBTM_SEC_DEV_REC  *btm_sec_dev_rec_at (UINT16 index);
+extern void               btm_sec_dev_rec_free_blocks (void);
 
 /* Internal functions provided by btm_sec.c
 **********************************************
@@ -50,6 +50,11 @@ void btm_init (void)
 {
     UINT8 i;
     /* All fields are cleared; nonzero fields are reinitialized in appropriate function */
+    btm_sec_dev_rec_free_blocks();
+    btm_inq_db_free();
+#if (BLE_INCLUDED == TRUE && SMP_INCLUDED == TRUE)
+    btm_ble_irk_list_free();
+#endif
     memset(&btm_cb, 0, sizeof(tBTM_CB));
 
 #if defined(BTM_INITIAL_TRACE_LEVEL)
@@ -2068,7 +2068,7 @@ tBTM_STATUS btm_sec_l2cap_access_req (BD_ADDR bd_addr, UINT16 psm, UINT16 handle
     /* Find or get oldest record */
     p_dev_rec = btm_find_or_alloc_dev (bd_addr);
 
-    p_dev_rec->hci_handle = handle;
+    btm_sec_set_dev_handle (p_dev_rec, handle);
 
     /* Find the service record for the PSM */
     p_serv_rec = btm_sec_find_first_serv (conn_type, psm);
@@ -2881,9 +2881,7 @@ void btm_sec_rmt_name_request_complete (UINT8 *p_bd_addr, UINT8 *p_bd_name, UINT
         p_dev_rec = btm_find_dev (p_bd_addr);
     else
     {
-        p_dev_rec = &btm_cb.sec_dev_rec[0];
-
-        for (i = 0; i < BTM_SEC_MAX_DEVICE_RECORDS; i++, p_dev_rec++)
+        for (i = 0; (p_dev_rec = btm_sec_dev_rec_at(i)) != NULL; i++)
         {
             if ((p_dev_rec->sec_flags & BTM_SEC_IN_USE)
                 && (p_dev_rec->sec_state == BTM_SEC_STATE_GETTING_NAME))
@@ -2892,9 +2890,6 @@ void btm_sec_rmt_name_request_complete (UINT8 *p_bd_addr, UINT8 *p_bd_name, UINT
                 break;
             }
         }
-
-        if (i == BTM_SEC_MAX_DEVICE_RECORDS)
-            p_dev_rec = NULL;
     }
 
 
@@ -4340,7 +4335,7 @@ void btm_sec_connected (UINT8 *bda, UINT16 handle, UINT8 status, UINT8 enc_mode)
         return;
     }
 
-    p_dev_rec->hci_handle = handle;
+    btm_sec_set_dev_handle (p_dev_rec, handle);
 
     /* role may not be correct here, it will be updated by l2cap, but we need to */
     /* notify btm_acl that link is up, so starting of rmt name request will not */
@@ -4523,7 +4518,7 @@ void btm_sec_disconnected (UINT16 handle, UINT8 reason)
         }
     }
 
-    p_dev_rec->hci_handle = BTM_SEC_INVALID_HANDLE;
+    btm_sec_set_dev_handle (p_dev_rec, BTM_SEC_INVALID_HANDLE);
     p_dev_rec->sec_state  = BTM_SEC_STATE_IDLE;
 
 #if BLE_INCLUDED == TRUE && SMP_INCLUDED == TRUE
@@ -5563,10 +5558,10 @@ static void btm_restore_mode(void)
 *******************************************************************************/
 tBTM_SEC_DEV_REC *btm_sec_find_dev_by_sec_state (UINT8 state)
 {
-    tBTM_SEC_DEV_REC *p_dev_rec = &btm_cb.sec_dev_rec[0];
-    int i;
+    tBTM_SEC_DEV_REC *p_dev_rec;
+    UINT16 i;
 
-    for (i = 0; i < BTM_SEC_MAX_DEVICE_RECORDS; i++, p_dev_rec++)
+    for (i = 0; (p_dev_rec = btm_sec_dev_rec_at(i)) != NULL; i++)
     {
         if ((p_dev_rec->sec_flags & BTM_SEC_IN_USE)
             && (p_dev_rec->sec_state == state))
@@ -5816,6 +5811,8 @@ void btm_sec_clear_ble_keys (tBTM_SEC_DEV_REC  *p_dev_rec)
 
     BTM_TRACE_DEBUG0 ("btm_sec_clear_ble_keys: Clearing BLE Keys");
 #if (SMP_INCLUDED== TRUE)
+    if (p_dev_rec->ble.key_type & BTM_LE_KEY_PID)
+        btm_ble_irk_list_changed();
     p_dev_rec->ble.key_type = 0;
     memset (&p_dev_rec->ble.keys, 0, sizeof(tBTM_SEC_BLE_KEYS));
 #endif
@@ -5888,14 +5885,13 @@ BOOLEAN btm_sec_find_bonded_dev (UINT8 start_idx, UINT8 *p_found_idx, tBTM_SEC_D
 #if (SMP_INCLUDED== TRUE)
     tBTM_SEC_DEV_REC *p_dev_rec;
     int i;
-    if (start_idx >= BTM_SEC_MAX_DEVICE_RECORDS)
+    if (btm_sec_dev_rec_at(start_idx) == NULL)
     {
         BTM_TRACE_DEBUG0 ("LE bonded device not found");
         return found;
     }
 
-    p_dev_rec = &btm_cb.sec_dev_rec[start_idx];
-    for (i = start_idx; i < BTM_SEC_MAX_DEVICE_RECORDS; i++, p_dev_rec++)
+    for (i = start_idx; (i <= 0xFF) && ((p_dev_rec = btm_sec_dev_rec_at((UINT16)i)) != NULL); i++)
     {
         if (p_dev_rec->ble.key_type || (p_dev_rec->sec_flags & BTM_SEC_LINK_KEY_KNOWN))
         {
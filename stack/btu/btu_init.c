@@ -29,6 +29,7 @@
 
 #include "btu.h"
 #include "btm_int.h"
+#include "crc_api.h"
 #include "sdpint.h"
 #include "l2c_int.h"
 
@@ -64,6 +65,8 @@ void btu_init_core(void)
     /* Initialize the mandatory core stack components */
     btm_init();
 
+    CRC_Init();
+
     l2c_init();
 
     sdp_init();
@@ -0,0 +1,361 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 1999-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the checksum functions shared by the protocol layers.
+ *
+ *  The L2CAP CRC-16 is computed eight bytes per step from eight tables
+ *  (slicing-by-8), or on x86 CPUs that have it by folding 16 bytes per step
+ *  with the carry-less multiply instruction. Both give the same result as the
+ *  byte per byte table code.
+ *
+ ******************************************************************************/
+#include <string.h>
+
+#include "bt_target.h"
+#include "crc_api.h"
+
+#if (CRC_PCLMUL_OPT == TRUE) && defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define CRC_PCLMUL_X86 TRUE
+#include <immintrin.h>
+#else
+#define CRC_PCLMUL_X86 FALSE
+#endif
+
+/* CRC-16 polynomial x^16 + x^15 + x^2 + 1 */
+#define CRC16_POLY          0x18005
+
+/* frames shorter than this are not worth the folding setup */
+#define CRC16_PCLMUL_MIN    32
+
+/* Look-up table for the CRC-16 calculation, least significant bit first */
+static const UINT16 crc16_table[256] = {
+    0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241,
+    0xc601, 0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440,
+    0xcc01, 0x0cc0, 0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40,
+    0x0a00, 0xcac1, 0xcb81, 0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841,
+    0xd801, 0x18c0, 0x1980, 0xd941, 0x1b00, 0xdbc1, 0xda81, 0x1a40,
+    0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01, 0x1dc0, 0x1c80, 0xdc41,
+    0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0, 0x1680, 0xd641,
+    0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081, 0x1040,
+    0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240,
+    0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441,
+    0x3c00, 0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41,
+    0xfa01, 0x3ac0, 0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840,
+    0x2800, 0xe8c1, 0xe981, 0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41,
+    0xee01, 0x2ec0, 0x2f80, 0xef41, 0x2d00, 0xedc1, 0xec81, 0x2c40,
+    0xe401, 0x24c0, 0x2580, 0xe541, 0x2700, 0xe7c1, 0xe681, 0x2640,
+    0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0, 0x2080, 0xe041,
+    0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281, 0x6240,
+    0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
+    0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41,
+    0xaa01, 0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840,
+    0x7800, 0xb8c1, 0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41,
+    0xbe01, 0x7ec0, 0x7f80, 0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40,
+    0xb401, 0x74c0, 0x7580, 0xb541, 0x7700, 0xb7c1, 0xb681, 0x7640,
+    0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101, 0x71c0, 0x7080, 0xb041,
+    0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0, 0x5280, 0x9241,
+    0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481, 0x5440,
+    0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40,
+    0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841,
+    0x8801, 0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40,
+    0x4e00, 0x8ec1, 0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41,
+    0x4400, 0x84c1, 0x8581, 0x4540, 0x8701, 0x47c0, 0x4680, 0x8641,
+    0x8201, 0x42c0, 0x4380, 0x8341, 0x4100, 0x81c1, 0x8081, 0x4040,
+};
+
+/* Reversed CRC Table , 8-bit, poly=0x07 (GSM 07.10 TS 101 369 V6.3.0) */
+static const UINT8 crc8_table[256] =
+{
+    0x00, 0x91, 0xE3, 0x72, 0x07, 0x96, 0xE4, 0x75,  0x0E, 0x9F, 0xED, 0x7C, 0x09, 0x98, 0xEA, 0x7B,
+    0x1C, 0x8D, 0xFF, 0x6E, 0x1B, 0x8A, 0xF8, 0x69,  0x12, 0x83, 0xF1, 0x60, 0x15, 0x84, 0xF6, 0x67,
+    0x38, 0xA9, 0xDB, 0x4A, 0x3F, 0xAE, 0xDC, 0x4D,  0x36, 0xA7, 0xD5, 0x44, 0x31, 0xA0, 0xD2, 0x43,
+    0x24, 0xB5, 0xC7, 0x56, 0x23, 0xB2, 0xC0, 0x51,  0x2A, 0xBB, 0xC9, 0x58, 0x2D, 0xBC, 0xCE, 0x5F,
+
+    0x70, 0xE1, 0x93, 0x02, 0x77, 0xE6, 0x94, 0x05,  0x7E, 0xEF, 0x9D, 0x0C, 0x79, 0xE8, 0x9A, 0x0B,
+    0x6C, 0xFD, 0x8F, 0x1E, 0x6B, 0xFA, 0x88, 0x19,  0x62, 0xF3, 0x81, 0x10, 0x65, 0xF4, 0x86, 0x17,
+    0x48, 0xD9, 0xAB, 0x3A, 0x4F, 0xDE, 0xAC, 0x3D,  0x46, 0xD7, 0xA5, 0x34, 0x41, 0xD0, 0xA2, 0x33,
+    0x54, 0xC5, 0xB7, 0x26, 0x53, 0xC2, 0xB0, 0x21,  0x5A, 0xCB, 0xB9, 0x28, 0x5D, 0xCC, 0xBE, 0x2F,
+
+    0xE0, 0x71, 0x03, 0x92, 0xE7, 0x76, 0x04, 0x95,  0xEE, 0x7F, 0x0D, 0x9C, 0xE9, 0x78, 0x0A, 0x9B,
+    0xFC, 0x6D, 0x1F, 0x8E, 0xFB, 0x6A, 0x18, 0x89,  0xF2, 0x63, 0x11, 0x80, 0xF5, 0x64, 0x16, 0x87,
+    0xD8, 0x49, 0x3B, 0xAA, 0xDF, 0x4E, 0x3C, 0xAD,  0xD6, 0x47, 0x35, 0xA4, 0xD1, 0x40, 0x32, 0xA3,
+    0xC4, 0x55, 0x27, 0xB6, 0xC3, 0x52, 0x20, 0xB1,  0xCA, 0x5B, 0x29, 0xB8, 0xCD, 0x5C, 0x2E, 0xBF,
+
+    0x90, 0x01, 0x73, 0xE2, 0x97, 0x06, 0x74, 0xE5,  0x9E, 0x0F, 0x7D, 0xEC, 0x99, 0x08, 0x7A, 0xEB,
+    0x8C, 0x1D, 0x6F, 0xFE, 0x8B, 0x1A, 0x68, 0xF9,  0x82, 0x13, 0x61, 0xF0, 0x85, 0x14, 0x66, 0xF7,
+    0xA8, 0x39, 0x4B, 0xDA, 0xAF, 0x3E, 0x4C, 0xDD,  0xA6, 0x37, 0x45, 0xD4, 0xA1, 0x30, 0x42, 0xD3,
+    0xB4, 0x25, 0x57, 0xC6, 0xB3, 0x22, 0x50, 0xC1,  0xBA, 0x2B, 0x59, 0xC8, 0xBD, 0x2C, 0x5E, 0xCF
+};
+
+typedef UINT16 (tCRC16_FN) (UINT16 crc, const UINT8 *p, UINT32 len);
+
+/* crc16_slice[k][b] is the CRC of byte b followed by k zero bytes */
+static UINT16 crc16_slice[8][256];
+static BOOLEAN crc16_slice_ready = FALSE;
+
+#if (CRC_PCLMUL_X86 == TRUE)
+/* x^191 and x^127 mod P, bit reflected in 64 bits for the folding */
+static UINT64 crc16_fold_k1;
+static UINT64 crc16_fold_k2;
+#endif
+
+static UINT16 crc16_byte (UINT16 crc, const UINT8 *p, UINT32 len);
+static tCRC16_FN *crc16_fn = crc16_byte;
+
+/*******************************************************************************
+**
+** Function         crc16_byte
+**
+** Description      CRC-16 one byte per step
+**
+** Returns          CRC
+**
+*******************************************************************************/
+static UINT16 crc16_byte (UINT16 crc, const UINT8 *p, UINT32 len)
+{
+    while (len--)
+        crc = (crc >> 8) ^ crc16_table[(crc ^ *p++) & 0xff];
+
+    return (crc);
+}
+
+/*******************************************************************************
+**
+** Function         crc16_slice8
+**
+** Description      CRC-16 eight bytes per step. The CRC register only
+**                  overlaps the first two bytes of each step, the six others
+**                  are looked up on their own.
+**
+** Returns          CRC
+**
+*******************************************************************************/
+static UINT16 crc16_slice8 (UINT16 crc, const UINT8 *p, UINT32 len)
+{
+    while (len >= 8)
+    {
+        crc ^= (UINT16)(p[0] | (p[1] << 8));
+        crc = crc16_slice[7][crc & 0xff] ^ crc16_slice[6][crc >> 8]
+            ^ crc16_slice[5][p[2]] ^ crc16_slice[4][p[3]]
+            ^ crc16_slice[3][p[4]] ^ crc16_slice[2][p[5]]
+            ^ crc16_slice[1][p[6]] ^ crc16_slice[0][p[7]];
+        p   += 8;
+        len -= 8;
+    }
+
+    while (len--)
+        crc = (crc >> 8) ^ crc16_slice[0][(crc ^ *p++) & 0xff];
+
+    return (crc);
+}
+
+#if (CRC_PCLMUL_X86 == TRUE)
+/*******************************************************************************
+**
+** Function         crc16_pclmul
+**
+** Description      CRC-16 16 bytes per step. The data is folded into a 128
+**                  bit remainder congruent to it modulo P, whose CRC is then
+**                  taken with the tail of the data.
+**
+**                  In the bit reflected order of the CRC, the low 64 bits of
+**                  the remainder weigh x^64 more than the high ones. A 64 by
+**                  64 carry-less multiply gives its product times x, hence
+**                  the constants x^191 and x^127 rather than x^192 and x^128.
+**
+** Returns          CRC
+**
+*******************************************************************************/
+__attribute__((target("pclmul,sse2")))
+static UINT16 crc16_pclmul (UINT16 crc, const UINT8 *p, UINT32 len)
+{
+    __m128i k, a, b;
+    UINT8   rem[16];
+
+    if (len < CRC16_PCLMUL_MIN)
+        return (crc16_slice8 (crc, p, len));
+
+    k = _mm_set_epi64x ((long long)crc16_fold_k2, (long long)crc16_fold_k1);
+
+    /* the CRC register is added to the first two bytes */
+    a = _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *)p), _mm_cvtsi32_si128 (crc));
+    p   += 16;
+    len -= 16;
+
+    while (len >= 16)
+    {
+        b = _mm_loadu_si128 ((const __m128i *)p);
+        a = _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (a, k, 0x00),
+                                          _mm_clmulepi64_si128 (a, k, 0x11)), b);
+        p   += 16;
+        len -= 16;
+    }
+
+    _mm_storeu_si128 ((__m128i *)rem, a);
+    crc = crc16_slice8 (0, rem, sizeof (rem));
+
+    return (crc16_slice8 (crc, p, len));
+}
+
+/*******************************************************************************
+**
+** Function         crc16_xpow_refl
+**
+** Description      x^n mod P, bit reflected in 64 bits (x^0 in bit 63)
+**
+** Returns          the reflected remainder
+**
+*******************************************************************************/
+static UINT64 crc16_xpow_refl (int n)
+{
+    UINT32  r = 1;
+    UINT64  v = 0;
+    int     i;
+
+    while (n--)
+    {
+        r <<= 1;
+        if (r & 0x10000)
+            r ^= CRC16_POLY;
+    }
+
+    for (i = 0; i < 16; i++)
+        if (r & (1 << i))
+            v |= (UINT64)1 << (63 - i);
+
+    return (v);
+}
+#endif
+
+/*******************************************************************************
+**
+** Function         crc_build_tables
+**
+** Description      Builds the slicing tables and the folding constants
+**
+** Returns          void
+**
+*******************************************************************************/
+static void crc_build_tables (void)
+{
+    int     k, b;
+
+    if (crc16_slice_ready)
+        return;
+
+    memcpy (crc16_slice[0], crc16_table, sizeof (crc16_table));
+
+    for (k = 1; k < 8; k++)
+        for (b = 0; b < 256; b++)
+            crc16_slice[k][b] = (crc16_slice[k - 1][b] >> 8) ^ crc16_table[crc16_slice[k - 1][b] & 0xff];
+
+#if (CRC_PCLMUL_X86 == TRUE)
+    crc16_fold_k1 = crc16_xpow_refl (191);
+    crc16_fold_k2 = crc16_xpow_refl (127);
+#endif
+
+    crc16_slice_ready = TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         CRC_Select16
+**
+** Description      Forces the CRC-16 implementation (CRC_IMPL_xxx)
+**
+** Returns          TRUE if the implementation can be used on this CPU
+**
+*******************************************************************************/
+BOOLEAN CRC_Select16 (UINT8 impl)
+{
+    switch (impl)
+    {
+    case CRC_IMPL_BYTE:
+        crc16_fn = crc16_byte;
+        return (TRUE);
+
+    case CRC_IMPL_SLICE8:
+        crc_build_tables ();
+        crc16_fn = crc16_slice8;
+        return (TRUE);
+
+#if (CRC_PCLMUL_X86 == TRUE)
+    case CRC_IMPL_PCLMUL:
+        if (!__builtin_cpu_supports ("pclmul") || !__builtin_cpu_supports ("sse2"))
+            break;
+        crc_build_tables ();
+        crc16_fn = crc16_pclmul;
+        return (TRUE);
+#endif
+
+    default:
+        break;
+    }
+    return (FALSE);
+}
+
+/*******************************************************************************
+**
+** Function         CRC_Init
+**
+** Description      Builds the CRC tables and selects the fastest CRC-16
+**                  implementation the CPU supports
+**
+** Returns          void
+**
+*******************************************************************************/
+void CRC_Init (void)
+{
+    if (!CRC_Select16 (CRC_IMPL_PCLMUL))
+        CRC_Select16 (CRC_IMPL_SLICE8);
+}
+
+/*******************************************************************************
+**
+** Function         CRC_Update16
+**
+** Description      Runs len bytes through the CRC-16 of L2CAP
+**
+** Returns          the new CRC register
+**
+*******************************************************************************/
+UINT16 CRC_Update16 (UINT16 crc, const UINT8 *p, UINT32 len)
+{
+    return ((*crc16_fn) (crc, p, len));
+}
+
+/*******************************************************************************
+**
+** Function         CRC_Update8
+**
+** Description      Runs len bytes through the CRC-8 of GSM 07.10. The RFCOMM
+**                  FCS only covers the 2 or 3 bytes of the frame header, one
+**                  table is all it needs.
+**
+** Returns          the new CRC register
+**
+*******************************************************************************/
+UINT8 CRC_Update8 (UINT8 fcs, const UINT8 *p, UINT32 len)
+{
+    while (len--)
+        fcs = crc8_table[fcs ^ *p++];
+
+    return (fcs);
+}
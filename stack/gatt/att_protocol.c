@@ -436,6 +436,33 @@ BT_HDR *attp_build_sr_msg(tGATT_TCB *p_tcb, UINT8 op_code, tGATT_SR_MSG *p_msg)
     return p_cmd;
 }
 
+/*******************************************************************************
+**
+** Function         attp_copy_sr_msg
+**
+** Description      Copy a server PDU built once for several links into a buffer
+**                  of its own for one link. The lower layers write the L2CAP
+**                  and HCI headers in place, so a buffer cannot be shared
+**                  between links. A PDU longer than the payload size of the
+**                  link is truncated.
+**
+** Returns          the copy, NULL if no resources.
+**
+*******************************************************************************/
+BT_HDR *attp_copy_sr_msg (BT_HDR *p_src, UINT16 payload_size)
+{
+    BT_HDR      *p_buf;
+    UINT16      len = (p_src->len > payload_size) ? payload_size : p_src->len;
+
+    if ((p_buf = (BT_HDR *)GKI_getbuf((UINT16)(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + len))) != NULL)
+    {
+        p_buf->offset = L2CAP_MIN_OFFSET;
+        p_buf->len    = len;
+        memcpy((UINT8 *)(p_buf + 1) + L2CAP_MIN_OFFSET, (UINT8 *)(p_src + 1) + p_src->offset, len);
+    }
+    return p_buf;
+}
+
 /*******************************************************************************
 **
 ** Function         attp_send_sr_msg
@@ -486,7 +513,12 @@ UINT8 attp_cl_send_cmd(tGATT_TCB *p_tcb, UINT16 clcb_idx, UINT8 cmd_code, BT_HDR
     {
         cmd_code &= ~GATT_AUTH_SIGN_MASK;
 
-        if (p_tcb->pending_cl_req == p_tcb->next_slot_inq ||
+        /* write commands get no response, they do not wait for the pending request */
+        if (cmd_code == GATT_CMD_WRITE)
+        {
+            att_ret = gatt_cl_send_write_cmd(p_tcb, clcb_idx, p_cmd);
+        }
+        else if (p_tcb->pending_cl_req == p_tcb->next_slot_inq ||
             cmd_code == GATT_HANDLE_VALUE_CONF)
         {
             /* no penindg request or value confirmation */
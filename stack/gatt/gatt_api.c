@@ -726,6 +726,108 @@ tGATT_STATUS GATTS_HandleValueNotification (UINT16 conn_id, UINT16 attr_handle,
     return cmd_sent;
 }
 
+/*******************************************************************************
+**
+** Function         GATTS_HandleValueMultiNotify
+**
+** Description      This function sends the same handle value notification or
+**                  indication to a number of clients. The PDU is built once
+**                  and copied for each link, cut to the MTU of that link.
+**                  The caller passes the connections whose client
+**                  characteristic configuration enables the update.
+**
+** Parameter        attr_handle: Attribute handle of this handle value.
+**                  val_len: Length of the attribute value.
+**                  p_val: Pointer to the attribute value data.
+**                  need_confirm: TRUE to send indications.
+**                  num_conn: number of connections in p_conn_id.
+**                  p_conn_id: connection identifiers.
+**                  p_status: if not NULL, the status of each connection.
+**
+** Returns          GATT_SUCCESS if sent or queued on every connection;
+**                  otherwise the last error.
+**
+*******************************************************************************/
+tGATT_STATUS GATTS_HandleValueMultiNotify (UINT16 attr_handle, UINT16 val_len,
+                                           UINT8 *p_val, BOOLEAN need_confirm,
+                                           UINT8 num_conn, UINT16 *p_conn_id,
+                                           tGATT_STATUS *p_status)
+{
+    tGATT_STATUS    status, cmd_status = GATT_SUCCESS;
+    UINT8           op_code = need_confirm ? GATT_HANDLE_VALUE_IND : GATT_HANDLE_VALUE_NOTIF;
+    BT_HDR          *p_pdu, *p_msg;
+    tGATT_VALUE     indication;
+    tGATT_TCB       *p_tcb;
+    UINT8           i;
+
+    GATT_TRACE_API3 ("GATTS_HandleValueMultiNotify handle=0x%04x num_conn=%d confirm=%d",
+                     attr_handle, num_conn, need_confirm);
+
+    if (!GATT_HANDLE_IS_VALID(attr_handle) || val_len > GATT_MAX_ATTR_LEN ||
+        p_conn_id == NULL || (val_len > 0 && p_val == NULL))
+        return GATT_ILLEGAL_PARAMETER;
+
+    /* build the PDU once, each link gets a copy cut to its own MTU */
+    if ((p_pdu = attp_build_value_cmd((UINT16)(GATT_HDR_SIZE + val_len), op_code,
+                                      attr_handle, 0, val_len, p_val)) == NULL)
+        return GATT_NO_RESOURCES;
+
+    if (need_confirm)
+    {
+        /* for the links with an indication outstanding */
+        indication.handle   = attr_handle;
+        indication.len      = val_len;
+        indication.offset   = 0;
+        memcpy (indication.value, p_val, val_len);
+        indication.auth_req = GATT_AUTH_REQ_NONE;
+    }
+
+    for (i = 0; i < num_conn; i ++)
+    {
+        p_tcb = gatt_get_tcb_by_idx(GATT_GET_TCB_IDX(p_conn_id[i]));
+
+        if (gatt_get_regcb(GATT_GET_GATT_IF(p_conn_id[i])) == NULL || p_tcb == NULL)
+        {
+            GATT_TRACE_ERROR1 ("GATTS_HandleValueMultiNotify Unknown conn_id: %u ", p_conn_id[i]);
+            status = GATT_INVALID_CONN_ID;
+        }
+        else if (need_confirm && GATT_HANDLE_IS_VALID(p_tcb->indicate_handle))
+        {
+            indication.conn_id = p_conn_id[i];
+            status = (gatt_add_pending_ind(p_tcb, &indication) != NULL) ? GATT_SUCCESS : GATT_NO_RESOURCES;
+        }
+        else
+        {
+            /* the last link takes the PDU itself when it fits */
+            if (i == num_conn - 1 && p_pdu->len <= p_tcb->payload_size)
+            {
+                p_msg = p_pdu;
+                p_pdu = NULL;
+            }
+            else
+                p_msg = attp_copy_sr_msg(p_pdu, p_tcb->payload_size);
+
+            if (p_msg == NULL)
+                status = GATT_NO_RESOURCES;
+            else if ((status = attp_send_sr_msg (p_tcb, p_msg)) == GATT_SUCCESS && need_confirm)
+            {
+                p_tcb->indicate_handle = attr_handle;
+                gatt_start_conf_timer(p_tcb);
+            }
+        }
+
+        if (p_status)
+            p_status[i] = status;
+        if (status != GATT_SUCCESS)
+            cmd_status = status;
+    }
+
+    if (p_pdu)
+        GKI_freebuf(p_pdu);
+
+    return cmd_status;
+}
+
 /*******************************************************************************
 **
 ** Function         GATTS_SendRsp
@@ -992,7 +1094,10 @@ tGATT_STATUS GATTC_Read (UINT16 conn_id, tGATT_READ_TYPE type, tGATT_READ_PARAM
 ** Function         GATTC_Write
 **
 ** Description      This function is called to write the value of an attribute to
-**                  the server.
+**                  the server. With GATT_WRITE_NO_RSP_BULK the value is sent as
+**                  a stream of unsigned write commands, each filled up to the
+**                  MTU, and the operation completes once the last one is
+**                  passed to L2CAP.
 **
 ** Parameters       conn_id: connection identifier.
 **                  type    - attribute write type.
@@ -1012,7 +1117,8 @@ tGATT_STATUS GATTC_Write (UINT16 conn_id, tGATT_WRITE_TYPE type, tGATT_VALUE *p_
     tGATT_REG       *p_reg = gatt_get_regcb(gatt_if);
 
     if ( (p_tcb == NULL) || (p_reg==NULL) || (p_write == NULL) ||
-         ((type != GATT_WRITE) && (type != GATT_WRITE_PREPARE) && (type != GATT_WRITE_NO_RSP)) )
+         ((type != GATT_WRITE) && (type != GATT_WRITE_PREPARE) && (type != GATT_WRITE_NO_RSP) &&
+          (type != GATT_WRITE_NO_RSP_BULK)) )
     {
         GATT_TRACE_ERROR2("GATT_Write Illegal param: conn_id %d, type 0%d,", conn_id, type);
         return GATT_ILLEGAL_PARAMETER;
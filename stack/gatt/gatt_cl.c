@@ -29,6 +29,7 @@
 #include <string.h>
 #include "gki.h"
 #include "gatt_int.h"
+#include "l2c_api.h"
 
 #define GATT_WRITE_LONG_HDR_SIZE    5 /* 1 opcode + 2 handle + 2 offset */
 #define GATT_READ_CHAR_VALUE_HDL    (GATT_READ_CHAR_VALUE | 0x80)
@@ -204,6 +205,43 @@ void gatt_act_read (tGATT_CLCB *p_clcb, UINT16 offset)
     }
 }
 
+/*******************************************************************************
+**
+** Function         gatt_send_bulk_write
+**
+** Description      Send the rest of a bulk write as write commands, each one
+**                  carrying as much of the value as the MTU allows.
+**
+** Returns          GATT_SUCCESS if all sent, GATT_CMD_STARTED if held for L2CAP
+**                  room, otherwise error code.
+**
+*******************************************************************************/
+static UINT8 gatt_send_bulk_write (tGATT_TCB *p_tcb, tGATT_CLCB *p_clcb)
+{
+    tGATT_VALUE     *p_attr = (tGATT_VALUE *)p_clcb->p_attr_buf;
+    BT_HDR          *p_cmd;
+    UINT16          len;
+    UINT8           rt = GATT_SUCCESS;
+
+    /* counter is the number of bytes already passed on */
+    while (rt == GATT_SUCCESS && p_clcb->counter < p_attr->len)
+    {
+        len = p_attr->len - p_clcb->counter;
+        if (len > p_tcb->payload_size - GATT_HDR_SIZE)
+            len = p_tcb->payload_size - GATT_HDR_SIZE;
+
+        if ((p_cmd = attp_build_value_cmd(p_tcb->payload_size, GATT_CMD_WRITE, p_attr->handle, 0,
+                                          len, p_attr->value + p_clcb->counter)) == NULL)
+            return GATT_NO_RESOURCES;
+
+        rt = attp_cl_send_cmd(p_tcb, p_clcb->clcb_idx, GATT_CMD_WRITE, p_cmd);
+
+        if (rt == GATT_SUCCESS || rt == GATT_CMD_STARTED)
+            p_clcb->counter += len;
+    }
+    return rt;
+}
+
 /*******************************************************************************
 **
 ** Function         gatt_act_write
@@ -235,6 +273,11 @@ void gatt_act_write (tGATT_CLCB *p_clcb, UINT8 sec_act)
                                          p_attr->value);
                 break;
 
+            case GATT_WRITE_NO_RSP_BULK:
+                p_clcb->s_handle = p_attr->handle;
+                rt = gatt_send_bulk_write(p_tcb, p_clcb);
+                break;
+
             case GATT_WRITE:
                 if (p_attr->len <= (p_tcb->payload_size - GATT_HDR_SIZE))
                 {
@@ -268,7 +311,8 @@ void gatt_act_write (tGATT_CLCB *p_clcb, UINT8 sec_act)
         rt = GATT_INTERNAL_ERROR;
 
     if ((rt != GATT_SUCCESS  && rt != GATT_CMD_STARTED)
-        || (rt != GATT_CMD_STARTED && p_clcb->op_subtype == GATT_WRITE_NO_RSP))
+        || (rt != GATT_CMD_STARTED && (p_clcb->op_subtype == GATT_WRITE_NO_RSP ||
+                                       p_clcb->op_subtype == GATT_WRITE_NO_RSP_BULK)))
     {
         if (rt != GATT_SUCCESS)
         {
@@ -1059,6 +1103,117 @@ UINT8 gatt_cmd_to_rsp_code (UINT8 cmd_code)
     }
     return rsp_code;
 }
+/*******************************************************************************
+**
+** Function         gatt_cl_write_cmd_window_open
+**
+** Description      Check whether another write command may be passed to L2CAP.
+**                  Only the LE fixed channel is limited, a BR/EDR channel is
+**                  flow controlled by L2CAP itself.
+**
+** Returns          TRUE if a write command can be sent now.
+**
+*******************************************************************************/
+static BOOLEAN gatt_cl_write_cmd_window_open (tGATT_TCB *p_tcb)
+{
+    if (p_tcb->att_lcid != L2CAP_ATT_CID)
+        return TRUE;
+
+    return (L2CA_GetFixedChnlQueuedBufs(L2CAP_ATT_CID, p_tcb->peer_bda) < GATT_WRITE_CMD_WINDOW);
+}
+
+/*******************************************************************************
+**
+** Function         gatt_cl_nocp_cback
+**
+** Description      Number of completed packets callback from L2CAP, registered
+**                  while write commands are held for the link.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gatt_cl_nocp_cback (BD_ADDR bd_addr)
+{
+    tGATT_TCB   *p_tcb;
+
+    if ((p_tcb = gatt_find_tcb_by_addr(bd_addr)) != NULL)
+        gatt_cl_send_next_write_cmd(p_tcb);
+}
+
+/*******************************************************************************
+**
+** Function         gatt_cl_send_write_cmd
+**
+** Description      Send a write command or signed write command. Write commands
+**                  do not wait behind the outstanding request of the link, they
+**                  stream to L2CAP until GATT_WRITE_CMD_WINDOW buffers are
+**                  queued there and are held in order after that.
+**
+** Returns          GATT_SUCCESS if sent, GATT_CMD_STARTED if held, otherwise
+**                  error code.
+**
+*******************************************************************************/
+UINT8 gatt_cl_send_write_cmd (tGATT_TCB *p_tcb, UINT16 clcb_idx, BT_HDR *p_cmd)
+{
+    if (GKI_queue_is_empty(&p_tcb->wcmd_q) && gatt_cl_write_cmd_window_open(p_tcb))
+    {
+        if (attp_send_msg_to_L2CAP(p_tcb, p_cmd))
+            return GATT_SUCCESS;
+        else
+            return GATT_INTERNAL_ERROR;
+    }
+
+    GATT_TRACE_DEBUG2("gatt_cl_send_write_cmd: hold clcb_idx=%d, %d held", clcb_idx, p_tcb->wcmd_q.count);
+
+    /* sent when the controller completes packets of the link */
+    p_cmd->layer_specific = clcb_idx;
+    GKI_enqueue(&p_tcb->wcmd_q, p_cmd);
+    L2CA_RegForNoCPEvt(gatt_cl_nocp_cback, p_tcb->peer_bda);
+
+    return GATT_CMD_STARTED;
+}
+
+/*******************************************************************************
+**
+** Function         gatt_cl_send_next_write_cmd
+**
+** Description      Pass the held write commands to L2CAP while it has room, and
+**                  complete or continue their operations.
+**
+** Returns          void
+**
+*******************************************************************************/
+void gatt_cl_send_next_write_cmd (tGATT_TCB *p_tcb)
+{
+    BT_HDR          *p_cmd;
+    tGATT_CLCB      *p_clcb;
+    tGATT_STATUS    status;
+
+    while (!GKI_queue_is_empty(&p_tcb->wcmd_q) && gatt_cl_write_cmd_window_open(p_tcb))
+    {
+        p_cmd  = (BT_HDR *)GKI_dequeue(&p_tcb->wcmd_q);
+        p_clcb = &gatt_cb.clcb[p_cmd->layer_specific];
+
+        if (attp_send_msg_to_L2CAP(p_tcb, p_cmd))
+            status = GATT_SUCCESS;
+        else
+            status = GATT_INTERNAL_ERROR;
+
+        if (!p_clcb->in_use || p_clcb->p_tcb != p_tcb || p_clcb->operation != GATTC_OPTYPE_WRITE)
+            continue;
+
+        /* a bulk write goes on with its next write command */
+        if (status == GATT_SUCCESS && p_clcb->op_subtype == GATT_WRITE_NO_RSP_BULK &&
+            p_clcb->counter < ((tGATT_VALUE *)p_clcb->p_attr_buf)->len)
+            gatt_act_write(p_clcb, GATT_SEC_OK);
+        else
+            gatt_end_operation(p_clcb, status, NULL);
+    }
+
+    if (GKI_queue_is_empty(&p_tcb->wcmd_q))
+        L2CA_RegForNoCPEvt(NULL, p_tcb->peer_bda);
+}
+
 /*******************************************************************************
 **
 ** Function         gatt_cl_send_next_cmd_inq
@@ -69,7 +69,16 @@ BOOLEAN gatts_init_service_db (tGATT_SVC_DB *p_db, tBT_UUID service,  BOOLEAN is
     GATT_TRACE_DEBUG0("gatts_init_service_db");
     GATT_TRACE_DEBUG2("s_hdl = %d num_handle = %d", s_hdl, num_handle );
 
+    /* handles are given out in sequence, index the attributes by handle */
+    if ((p_db->p_attr_tbl = (void **)GKI_os_malloc(num_handle * sizeof(void *))) == NULL)
+    {
+        GATT_TRACE_ERROR0("gatts_init_service_db failed, no attribute table");
+        return FALSE;
+    }
+    memset(p_db->p_attr_tbl, 0, num_handle * sizeof(void *));
+
     /* update service database information */
+    p_db->s_handle      = s_hdl;
     p_db->next_handle   = s_hdl;
     p_db->end_handle    = s_hdl + num_handle;
 
@@ -104,6 +113,43 @@ tBT_UUID * gatts_get_service_uuid (tGATT_SVC_DB *p_db)
     }
 }
 
+/*******************************************************************************
+**
+** Function         gatts_db_find_attr
+**
+** Description      Look up an attribute of the service database by handle.
+**
+** Returns          the attribute (tGATT_ATTR16 or tGATT_ATTR128), NULL if the
+**                  handle is not in use.
+**
+*******************************************************************************/
+void *gatts_db_find_attr (tGATT_SVC_DB *p_db, UINT16 handle)
+{
+    if (!p_db || !p_db->p_attr_tbl ||
+        handle < p_db->s_handle || handle >= p_db->next_handle)
+        return NULL;
+
+    return p_db->p_attr_tbl[handle - p_db->s_handle];
+}
+
+/*******************************************************************************
+**
+** Function         gatts_free_attr_tbl
+**
+** Description      Free the handle index of a service database.
+**
+** Returns          void
+**
+*******************************************************************************/
+void gatts_free_attr_tbl (tGATT_SVC_DB *p_db)
+{
+    if (p_db->p_attr_tbl)
+    {
+        GKI_os_free(p_db->p_attr_tbl);
+        p_db->p_attr_tbl = NULL;
+    }
+}
+
 /*******************************************************************************
 **
 ** Function         gatts_check_attr_readability
@@ -330,13 +376,18 @@ tGATT_STATUS gatts_db_read_attr_value_by_type (tGATT_TCB   *p_tcb,
     UINT16      len = 0;
     UINT8       *p = (UINT8 *)(p_rsp + 1) + p_rsp->len + L2CAP_MIN_OFFSET;
     tBT_UUID    attr_uuid;
+    UINT16      handle;
 
-    if (p_db && p_db->p_attr_list)
+    if (p_db && p_db->p_attr_tbl)
     {
-        p_attr = (tGATT_ATTR16 *)p_db->p_attr_list;
+        /* only visit the handles of the range */
+        handle = (s_handle > p_db->s_handle) ? s_handle : p_db->s_handle;
 
-        while (p_attr && p_attr->handle <= e_handle)
+        for ( ; handle <= e_handle && handle < p_db->next_handle; handle++)
         {
+            if ((p_attr = (tGATT_ATTR16 *)p_db->p_attr_tbl[handle - p_db->s_handle]) == NULL)
+                continue;
+
             if (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16)
             {
                 attr_uuid.len = LEN_UUID_16;
@@ -348,7 +399,7 @@ tGATT_STATUS gatts_db_read_attr_value_by_type (tGATT_TCB   *p_tcb,
                 memcpy(attr_uuid.uu.uuid128, ((tGATT_ATTR128 *)p_attr)->uuid, LEN_UUID_128);
             }
 
-            if (p_attr->handle >= s_handle && gatt_uuid_compare(type, attr_uuid))
+            if (gatt_uuid_compare(type, attr_uuid))
             {
                 if (*p_len <= 2)
                 {
@@ -390,7 +441,6 @@ tGATT_STATUS gatts_db_read_attr_value_by_type (tGATT_TCB   *p_tcb,
                     break;
                 }
             }
-            p_attr = (tGATT_ATTR16 *)p_attr->p_next;
         }
     }
 
@@ -611,25 +661,15 @@ tGATT_STATUS gatts_read_attr_value_by_handle(tGATT_TCB *p_tcb,
     tGATT_ATTR16  *p_attr;
     UINT8       *pp = p_value;
 
-    if (p_db && p_db->p_attr_list)
+    if ((p_attr = (tGATT_ATTR16 *)gatts_db_find_attr(p_db, handle)) != NULL)
     {
-        p_attr = (tGATT_ATTR16 *)p_db->p_attr_list;
+        status = read_attr_value (p_attr, offset, &pp,
+                                  (BOOLEAN)(op_code == GATT_REQ_READ_BLOB),
+                                  mtu, p_len, sec_flag, key_size);
 
-        while (p_attr && handle >= p_attr->handle)
+        if (status == GATT_PENDING)
         {
-            if (p_attr->handle == handle)
-            {
-                status = read_attr_value (p_attr, offset, &pp,
-                                          (BOOLEAN)(op_code == GATT_REQ_READ_BLOB),
-                                          mtu, p_len, sec_flag, key_size);
-
-                if (status == GATT_PENDING)
-                {
-                    status = gatts_send_app_read_request(p_tcb, op_code, p_attr->handle, offset, trans_id);
-                }
-                break;
-            }
-            p_attr = (tGATT_ATTR16 *)p_attr->p_next;
+            status = gatts_send_app_read_request(p_tcb, op_code, p_attr->handle, offset, trans_id);
         }
     }
 
@@ -664,21 +704,11 @@ tGATT_STATUS gatts_read_attr_perm_check(tGATT_SVC_DB *p_db,
     tGATT_STATUS status = GATT_NOT_FOUND;
     tGATT_ATTR16  *p_attr;
 
-    if (p_db && p_db->p_attr_list)
+    if ((p_attr = (tGATT_ATTR16 *)gatts_db_find_attr(p_db, handle)) != NULL)
     {
-        p_attr = (tGATT_ATTR16 *)p_db->p_attr_list;
-
-        while (p_attr && handle >= p_attr->handle)
-        {
-            if (p_attr->handle == handle)
-            {
-                status = gatts_check_attr_readability (p_attr, 0,
-                                                       is_long,
-                                                       sec_flag, key_size);
-                break;
-            }
-            p_attr = (tGATT_ATTR16 *) p_attr->p_next;
-        }
+        status = gatts_check_attr_readability (p_attr, 0,
+                                               is_long,
+                                               sec_flag, key_size);
     }
 
     return status;
@@ -714,151 +744,140 @@ tGATT_STATUS gatts_write_attr_perm_check (tGATT_SVC_DB *p_db, UINT8 op_code,
     GATT_TRACE_DEBUG6( "gatts_write_attr_perm_check op_code=0x%0x handle=0x%04x offset=%d len=%d sec_flag=0x%0x key_size=%d",
                        op_code, handle, offset, len, sec_flag, key_size);
 
-    if (p_db != NULL)
+    if ((p_attr = (tGATT_ATTR16 *)gatts_db_find_attr(p_db, handle)) != NULL)
     {
-        p_attr = (tGATT_ATTR16 *) p_db->p_attr_list;
+        perm = p_attr->permission;
+        min_key_size = (((perm & GATT_ENCRYPT_KEY_SIZE_MASK) >> 12));
+        if (min_key_size != 0 )
+        {
+            min_key_size +=6;
+        }
+        GATT_TRACE_DEBUG2( "gatts_write_attr_perm_check p_attr->permission =0x%04x min_key_size==0x%04x",
+                           p_attr->permission,
+                           min_key_size);
 
-        while (p_attr != NULL)
+        if ((op_code == GATT_CMD_WRITE || op_code == GATT_REQ_WRITE)
+            && (perm & GATT_WRITE_SIGNED_PERM))
         {
-            if (p_attr->handle == handle)
+            /* use the rules for the mixed security see section 10.2.3*/
+            /* use security mode 1 level 2 when the following condition follows */
+            /* LE security mode 2 level 1 and LE security mode 1 level 2 */
+            if ((perm & GATT_PERM_WRITE_SIGNED) && (perm & GATT_PERM_WRITE_ENCRYPTED))
             {
-                perm = p_attr->permission;
-                min_key_size = (((perm & GATT_ENCRYPT_KEY_SIZE_MASK) >> 12));
-                if (min_key_size != 0 )
-                {
-                    min_key_size +=6;
-                }
-                GATT_TRACE_DEBUG2( "gatts_write_attr_perm_check p_attr->permission =0x%04x min_key_size==0x%04x",
-                                   p_attr->permission,
-                                   min_key_size);
-
-                if ((op_code == GATT_CMD_WRITE || op_code == GATT_REQ_WRITE)
-                    && (perm & GATT_WRITE_SIGNED_PERM))
-                {
-                    /* use the rules for the mixed security see section 10.2.3*/
-                    /* use security mode 1 level 2 when the following condition follows */
-                    /* LE security mode 2 level 1 and LE security mode 1 level 2 */
-                    if ((perm & GATT_PERM_WRITE_SIGNED) && (perm & GATT_PERM_WRITE_ENCRYPTED))
-                    {
-                        perm = GATT_PERM_WRITE_ENCRYPTED;
-                    }
-                    /* use security mode 1 level 3 when the following condition follows */
-                    /* LE security mode 2 level 2 and security mode 1 and LE */
-                    else if (((perm & GATT_PERM_WRITE_SIGNED_MITM) && (perm & GATT_PERM_WRITE_ENCRYPTED)) ||
-                              /* LE security mode 2 and security mode 1 level 3 */
-                             ((perm & GATT_WRITE_SIGNED_PERM) && (perm & GATT_PERM_WRITE_ENC_MITM)))
-                    {
-                        perm = GATT_PERM_WRITE_ENC_MITM;
-                    }
-                }
+                perm = GATT_PERM_WRITE_ENCRYPTED;
+            }
+            /* use security mode 1 level 3 when the following condition follows */
+            /* LE security mode 2 level 2 and security mode 1 and LE */
+            else if (((perm & GATT_PERM_WRITE_SIGNED_MITM) && (perm & GATT_PERM_WRITE_ENCRYPTED)) ||
+                      /* LE security mode 2 and security mode 1 level 3 */
+                     ((perm & GATT_WRITE_SIGNED_PERM) && (perm & GATT_PERM_WRITE_ENC_MITM)))
+            {
+                perm = GATT_PERM_WRITE_ENC_MITM;
+            }
+        }
 
-                if ((op_code == GATT_SIGN_CMD_WRITE) && !(perm & GATT_WRITE_SIGNED_PERM))
-                {
-                    status = GATT_WRITE_NOT_PERMIT;
-                    GATT_TRACE_DEBUG0( "gatts_write_attr_perm_check - sign cmd write not allowed");
-                }
-                 if ((op_code == GATT_SIGN_CMD_WRITE) && (sec_flag & GATT_SEC_FLAG_ENCRYPTED))
-                {
-                    status = GATT_INVALID_PDU;
-                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - Error!! sign cmd write sent on a encypted link");
-                }
-                else if (!(perm & GATT_WRITE_ALLOWED))
-                {
+        if ((op_code == GATT_SIGN_CMD_WRITE) && !(perm & GATT_WRITE_SIGNED_PERM))
+        {
+            status = GATT_WRITE_NOT_PERMIT;
+            GATT_TRACE_DEBUG0( "gatts_write_attr_perm_check - sign cmd write not allowed");
+        }
+         if ((op_code == GATT_SIGN_CMD_WRITE) && (sec_flag & GATT_SEC_FLAG_ENCRYPTED))
+        {
+            status = GATT_INVALID_PDU;
+            GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - Error!! sign cmd write sent on a encypted link");
+        }
+        else if (!(perm & GATT_WRITE_ALLOWED))
+        {
+            status = GATT_WRITE_NOT_PERMIT;
+            GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_WRITE_NOT_PERMIT");
+        }
+        /* require authentication, but not been authenticated */
+        else if ((perm & GATT_WRITE_AUTH_REQUIRED ) && !(sec_flag & GATT_SEC_FLAG_LKEY_UNAUTHED))
+        {
+            status = GATT_INSUF_AUTHENTICATION;
+            GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_AUTHENTICATION");
+        }
+        else if ((perm & GATT_WRITE_MITM_REQUIRED ) && !(sec_flag & GATT_SEC_FLAG_LKEY_AUTHED))
+        {
+            status = GATT_INSUF_AUTHENTICATION;
+            GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_AUTHENTICATION: MITM required");
+        }
+        else if ((perm & GATT_WRITE_ENCRYPTED_PERM ) && !(sec_flag & GATT_SEC_FLAG_ENCRYPTED))
+        {
+            status = GATT_INSUF_ENCRYPTION;
+            GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_ENCRYPTION");
+        }
+        else if ((perm & GATT_WRITE_ENCRYPTED_PERM ) && (sec_flag & GATT_SEC_FLAG_ENCRYPTED) && (key_size < min_key_size))
+        {
+            status = GATT_INSUF_KEY_SIZE;
+            GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_KEY_SIZE");
+        }
+        /* LE security mode 2 attribute  */
+        else if (perm & GATT_WRITE_SIGNED_PERM && op_code != GATT_SIGN_CMD_WRITE && !(sec_flag & GATT_SEC_FLAG_ENCRYPTED))
+        {
+            status = GATT_INSUF_AUTHENTICATION;
+            GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_AUTHENTICATION: LE security mode 2 required");
+        }
+        else /* writable: must be char value declaration or char descritpors */
+        {
+            if(p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16)
+            {
+            switch (p_attr->uuid)
+            {
+                case GATT_UUID_CHAR_PRESENT_FORMAT:/* should be readable only */
+                case GATT_UUID_CHAR_EXT_PROP:/* should be readable only */
+                case GATT_UUID_CHAR_AGG_FORMAT: /* should be readable only */
+                    case GATT_UUID_CHAR_VALID_RANGE:
                     status = GATT_WRITE_NOT_PERMIT;
-                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_WRITE_NOT_PERMIT");
-                }
-                /* require authentication, but not been authenticated */
-                else if ((perm & GATT_WRITE_AUTH_REQUIRED ) && !(sec_flag & GATT_SEC_FLAG_LKEY_UNAUTHED))
-                {
-                    status = GATT_INSUF_AUTHENTICATION;
-                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_AUTHENTICATION");
-                }
-                else if ((perm & GATT_WRITE_MITM_REQUIRED ) && !(sec_flag & GATT_SEC_FLAG_LKEY_AUTHED))
-                {
-                    status = GATT_INSUF_AUTHENTICATION;
-                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_AUTHENTICATION: MITM required");
-                }
-                else if ((perm & GATT_WRITE_ENCRYPTED_PERM ) && !(sec_flag & GATT_SEC_FLAG_ENCRYPTED))
-                {
-                    status = GATT_INSUF_ENCRYPTION;
-                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_ENCRYPTION");
+                    break;
+
+                case GATT_UUID_CHAR_CLIENT_CONFIG:
+/* coverity[MISSING_BREAK] */
+/* intnended fall through, ignored */
+                    /* fall through */
+                case GATT_UUID_CHAR_SRVR_CONFIG:
+                    max_size = 2;
+                case GATT_UUID_CHAR_DESCRIPTION:
+                default: /* any other must be character value declaration */
+                    status = GATT_SUCCESS;
+                    break;
                 }
-                else if ((perm & GATT_WRITE_ENCRYPTED_PERM ) && (sec_flag & GATT_SEC_FLAG_ENCRYPTED) && (key_size < min_key_size))
+            }
+            else if (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_128)
+            {
+                 status = GATT_SUCCESS;
+            }
+            else
+            {
+                status = GATT_INVALID_PDU;
+            }
+
+            if (p_data == NULL && len  > 0)
+            {
+                status = GATT_INVALID_PDU;
+            }
+            /* these attribute does not allow write blob */
+// btla-specific ++
+            else if ( (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16) &&
+                      (p_attr->uuid == GATT_UUID_CHAR_CLIENT_CONFIG ||
+                       p_attr->uuid == GATT_UUID_CHAR_SRVR_CONFIG) )
+// btla-specific --
+            {
+                if (op_code == GATT_REQ_PREPARE_WRITE && offset != 0) /* does not allow write blob */
                 {
-                    status = GATT_INSUF_KEY_SIZE;
-                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_KEY_SIZE");
+                    status = GATT_NOT_LONG;
+                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_NOT_LONG");
                 }
-                /* LE security mode 2 attribute  */
-                else if (perm & GATT_WRITE_SIGNED_PERM && op_code != GATT_SIGN_CMD_WRITE && !(sec_flag & GATT_SEC_FLAG_ENCRYPTED))
+                else if (len != max_size)    /* data does not match the required format */
                 {
-                    status = GATT_INSUF_AUTHENTICATION;
-                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_AUTHENTICATION: LE security mode 2 required");
+                    status = GATT_INVALID_ATTR_LEN;
+                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INVALID_PDU");
                 }
-                else /* writable: must be char value declaration or char descritpors */
+                else
                 {
-                    if(p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16)
-                    {
-                    switch (p_attr->uuid)
-                    {
-                        case GATT_UUID_CHAR_PRESENT_FORMAT:/* should be readable only */
-                        case GATT_UUID_CHAR_EXT_PROP:/* should be readable only */
-                        case GATT_UUID_CHAR_AGG_FORMAT: /* should be readable only */
-                            case GATT_UUID_CHAR_VALID_RANGE:
-                            status = GATT_WRITE_NOT_PERMIT;
-                            break;
-
-                        case GATT_UUID_CHAR_CLIENT_CONFIG:
-/* coverity[MISSING_BREAK] */
-/* intnended fall through, ignored */
-                            /* fall through */
-                        case GATT_UUID_CHAR_SRVR_CONFIG:
-                            max_size = 2;
-                        case GATT_UUID_CHAR_DESCRIPTION:
-                        default: /* any other must be character value declaration */
-                            status = GATT_SUCCESS;
-                            break;
-                        }
-                    }
-                    else if (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_128)
-                    {
-                         status = GATT_SUCCESS;
-                    }
-                    else
-                    {
-                        status = GATT_INVALID_PDU;
-                    }
-
-                    if (p_data == NULL && len  > 0)
-                    {
-                        status = GATT_INVALID_PDU;
-                    }
-                    /* these attribute does not allow write blob */
-// btla-specific ++
-                    else if ( (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16) &&
-                              (p_attr->uuid == GATT_UUID_CHAR_CLIENT_CONFIG ||
-                               p_attr->uuid == GATT_UUID_CHAR_SRVR_CONFIG) )
-// btla-specific --
-                    {
-                        if (op_code == GATT_REQ_PREPARE_WRITE && offset != 0) /* does not allow write blob */
-                        {
-                            status = GATT_NOT_LONG;
-                            GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_NOT_LONG");
-                        }
-                        else if (len != max_size)    /* data does not match the required format */
-                        {
-                            status = GATT_INVALID_ATTR_LEN;
-                            GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INVALID_PDU");
-                        }
-                        else
-                        {
-                            status = GATT_SUCCESS;
-                        }
-                    }
+                    status = GATT_SUCCESS;
                 }
-                break;
             }
-            else
-                p_attr = (tGATT_ATTR16 *)p_attr->p_next;
         }
     }
 
@@ -883,6 +902,7 @@ static void *allocate_attr_in_db(tGATT_SVC_DB *p_db, UINT16 uuid16, UINT8 *uuid1
 {
     tGATT_ATTR16    *p_attr16 = NULL, *p_last;
     tGATT_ATTR128   *p_attr128 = NULL;
+    UINT16      idx;
     UINT16      len = (uuid16 == 0) ? sizeof(tGATT_ATTR128): sizeof(tGATT_ATTR16);
 
     GATT_TRACE_DEBUG1("allocate attr %d bytes ",len);
@@ -932,18 +952,15 @@ static void *allocate_attr_in_db(tGATT_SVC_DB *p_db, UINT16 uuid16, UINT8 *uuid1
     p_attr16->permission = perm;
     p_attr16->p_next = NULL;
 
+    /* handles are allocated in sequence, the tail of DB is the previous handle */
+    idx = p_attr16->handle - p_db->s_handle;
+    p_db->p_attr_tbl[idx] = p_attr16;
+
     /* link the attribute record into the end of DB */
-    if (p_db->p_attr_list == NULL)
+    if (idx == 0 || (p_last = (tGATT_ATTR16 *)p_db->p_attr_tbl[idx - 1]) == NULL)
         p_db->p_attr_list = p_attr16;
     else
-    {
-        p_last = (tGATT_ATTR16 *)p_db->p_attr_list;
-
-        while (p_last != NULL && p_last->p_next != NULL)
-            p_last = (tGATT_ATTR16 *)p_last->p_next;
-
         p_last->p_next = p_attr16;
-    }
 
     if (p_attr16->uuid_type == GATT_ATTR_UUID_TYPE_16)
     {
@@ -998,7 +1015,10 @@ static BOOLEAN deallocate_attr_in_db(tGATT_SVC_DB *p_db, void *p_attr)
     }
     /* else attr not found */
     if ( found)
+    {
+        p_db->p_attr_tbl[((tGATT_ATTR16 *)p_attr)->handle - p_db->s_handle] = NULL;
         p_db->next_handle --;
+    }
 
     return found;
 }
@@ -204,6 +204,8 @@ typedef struct
     UINT8           *p_free_mem;                /* Pointer to free memory       */
     BUFFER_Q        svc_buffer;                 /* buffer queue used for service database */
     UINT32          mem_free;                   /* Memory still available       */
+    void            **p_attr_tbl;               /* attributes indexed by handle - s_handle */
+    UINT16          s_handle;                   /* First handle number          */
     UINT16          end_handle;                 /* Last handle number           */
     UINT16          next_handle;                /* Next usable handle value     */
 } tGATT_SVC_DB;
@@ -364,6 +366,7 @@ typedef struct
     TIMER_LIST_ENT    ind_ack_timer_ent;    /* local app confirm to indication timer */
     UINT8             pending_cl_req;
     UINT8             next_slot_inq;    /* index of next available slot in queue */
+    BUFFER_Q          wcmd_q;           /* write commands held until L2CAP has room */
 
     BOOLEAN         in_use;
     UINT8           tcb_idx;
@@ -466,6 +469,8 @@ typedef struct
     tGATT_HDL_LIST_ELEM hdl_list[GATT_MAX_SR_PROFILES];
     tGATT_SRV_LIST_INFO srv_list_info;
     tGATT_SRV_LIST_ELEM srv_list[GATT_MAX_SR_PROFILES];
+    UINT8               sr_hdl_index[GATT_MAX_SR_PROFILES]; /* started services in ascending handle order */
+    UINT8               sr_hdl_count;
 
     BUFFER_Q            srv_chg_clt_q;   /* service change clients queue */
     BUFFER_Q            pending_new_srv_start_q; /* pending new service start queue */
@@ -546,8 +551,12 @@ extern tGATT_PROFILE_CLCB *gatt_profile_clcb_alloc (UINT16 conn_id, BD_ADDR bda)
 /* Functions provided by att_protocol.c */
 extern tGATT_STATUS attp_send_cl_msg (tGATT_TCB *p_tcb, UINT16 clcb_idx, UINT8 op_code, tGATT_CL_MSG *p_msg);
 extern BT_HDR *attp_build_sr_msg(tGATT_TCB *p_tcb, UINT8 op_code, tGATT_SR_MSG *p_msg);
+extern BT_HDR *attp_build_value_cmd (UINT16 payload_size, UINT8 op_code, UINT16 handle,
+                                     UINT16 offset, UINT16 len, UINT8 *p_data);
+extern BT_HDR *attp_copy_sr_msg (BT_HDR *p_src, UINT16 payload_size);
 extern tGATT_STATUS attp_send_sr_msg (tGATT_TCB *p_tcb, BT_HDR *p_msg);
 extern BOOLEAN  attp_send_msg_to_L2CAP(tGATT_TCB *p_tcb, BT_HDR *p_toL2CAP);
+extern UINT8 attp_cl_send_cmd(tGATT_TCB *p_tcb, UINT16 clcb_idx, UINT8 cmd_code, BT_HDR *p_cmd);
 
 /* utility functions */
 extern UINT8 * gatt_dbg_op_name(UINT8 op_code);
@@ -603,6 +612,7 @@ extern void gatt_reset_bgdev_list(void);
 
 /* server function */
 extern UINT8 gatt_sr_find_i_rcb_by_handle(UINT16 handle);
+extern void gatt_sr_update_hdl_index(void);
 extern UINT8 gatt_sr_find_i_rcb_by_app_id(tBT_UUID *p_app_uuid128, tBT_UUID *p_svc_uuid, UINT16 svc_inst);
 extern UINT8 gatt_sr_alloc_rcb(tGATT_HDL_LIST_ELEM *p_list);
 extern tGATT_STATUS gatt_sr_process_app_rsp (tGATT_TCB *p_tcb, tGATT_IF gatt_if, UINT32 trans_id, UINT8 op_code, tGATT_STATUS status, tGATTS_RSP *p_msg);
@@ -654,6 +664,9 @@ extern BOOLEAN gatt_cmd_enq(tGATT_TCB *p_tcb, UINT16 clcb_idx, BOOLEAN to_send,
 extern void gatt_client_handle_server_rsp (tGATT_TCB *p_tcb, UINT8 op_code,
                                            UINT16 len, UINT8 *p_data);
 extern void gatt_send_queue_write_cancel (tGATT_TCB *p_tcb, tGATT_CLCB *p_clcb, tGATT_EXEC_FLAG flag);
+extern UINT8 gatt_cl_send_write_cmd (tGATT_TCB *p_tcb, UINT16 clcb_idx, BT_HDR *p_cmd);
+extern void gatt_cl_send_next_write_cmd (tGATT_TCB *p_tcb);
+extern void gatt_free_pending_write_cmd (tGATT_TCB *p_tcb);
 
 /* gatt_auth.c */
 extern BOOLEAN gatt_security_check_start(tGATT_CLCB *p_clcb);
@@ -677,6 +690,8 @@ extern tGATT_STATUS gatts_write_attr_perm_check (tGATT_SVC_DB *p_db, UINT8 op_co
 extern tGATT_STATUS gatts_read_attr_perm_check(tGATT_SVC_DB *p_db, BOOLEAN is_long, UINT16 handle, tGATT_SEC_FLAG sec_flag,UINT8 key_size);
 extern void gatts_update_srv_list_elem(UINT8 i_sreg, UINT16 handle, BOOLEAN is_primary);
 extern tBT_UUID * gatts_get_service_uuid (tGATT_SVC_DB *p_db);
+extern void *gatts_db_find_attr (tGATT_SVC_DB *p_db, UINT16 handle);
+extern void gatts_free_attr_tbl (tGATT_SVC_DB *p_db);
 
 extern void gatt_reset_bgdev_list(void);
 #endif
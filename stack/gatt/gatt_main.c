@@ -86,9 +86,14 @@ tGATT_CB  gatt_cb;
 void gatt_init (void)
 {
     tL2CAP_FIXED_CHNL_REG  fixed_reg;
+    UINT8                  i;
 
     GATT_TRACE_DEBUG0("gatt_init()");
 
+    /* release the attribute tables left over from a previous start */
+    for (i = 0; i < GATT_MAX_SR_PROFILES; i++)
+        gatts_free_attr_tbl(&gatt_cb.hdl_list[i].svc_db);
+
     memset (&gatt_cb, 0, sizeof(tGATT_CB));
 
 #if defined(GATT_INITIAL_TRACE_LEVEL)
@@ -621,60 +621,56 @@ static tGATT_STATUS gatt_build_find_info_rsp(tGATT_SR_REG *p_rcb, BT_HDR *p_msg,
     UINT8               *p;
     UINT16              len = *p_len;
     tGATT_ATTR16        *p_attr = NULL;
+    tGATT_SVC_DB        *p_db = p_rcb->p_db;
     UINT8               info_pair_len[2] = {4, 18};
+    UINT16              handle;
 
-    if (!p_rcb->p_db || !p_rcb->p_db->p_attr_list)
+    if (!p_db || !p_db->p_attr_tbl)
         return status;
 
-    /* check the attribute database */
-    p_attr = (tGATT_ATTR16 *) p_rcb->p_db->p_attr_list;
-
     p = (UINT8 *)(p_msg + 1) + L2CAP_MIN_OFFSET + p_msg->len;
 
-    while (p_attr)
+    /* check the attribute database, only the handles of the range */
+    handle = (s_hdl > p_db->s_handle) ? s_hdl : p_db->s_handle;
+
+    for ( ; handle <= e_hdl && handle < p_db->next_handle; handle++)
     {
-        if (p_attr->handle > e_hdl)
-        {
-            break;
-        }
+        if ((p_attr = (tGATT_ATTR16 *)p_db->p_attr_tbl[handle - p_db->s_handle]) == NULL)
+            continue;
 
-        if (p_attr->handle >= s_hdl)
-        {
-            if (p_msg->offset == 0)
-                p_msg->offset = (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_128) ? GATT_INFO_TYPE_PAIR_128 : GATT_INFO_TYPE_PAIR_16;
+        if (p_msg->offset == 0)
+            p_msg->offset = (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_128) ? GATT_INFO_TYPE_PAIR_128 : GATT_INFO_TYPE_PAIR_16;
 
-            if (len >= info_pair_len[p_msg->offset - 1])
+        if (len >= info_pair_len[p_msg->offset - 1])
+        {
+            if (p_msg->offset == GATT_INFO_TYPE_PAIR_16 && p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16)
             {
-                if (p_msg->offset == GATT_INFO_TYPE_PAIR_16 && p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16)
-                {
-                    UINT16_TO_STREAM(p, p_attr->handle);
-                    UINT16_TO_STREAM(p, p_attr->uuid);
-                }
-                else if (p_msg->offset == GATT_INFO_TYPE_PAIR_128 &&
-                         p_attr->uuid_type == GATT_ATTR_UUID_TYPE_128  )
-                {
-                    UINT16_TO_STREAM(p, p_attr->handle);
-                    ARRAY_TO_STREAM (p, ((tGATT_ATTR128 *) p_attr)->uuid, LEN_UUID_128);
-                }
-                else
-                {
-                    GATT_TRACE_ERROR0("format mismatch");
-                    status = GATT_NO_RESOURCES;
-                    break;
-                    /* format mismatch */
-                }
-                p_msg->len += info_pair_len[p_msg->offset - 1];
-                len -= info_pair_len[p_msg->offset - 1];
-                status = GATT_SUCCESS;
-
+                UINT16_TO_STREAM(p, p_attr->handle);
+                UINT16_TO_STREAM(p, p_attr->uuid);
+            }
+            else if (p_msg->offset == GATT_INFO_TYPE_PAIR_128 &&
+                     p_attr->uuid_type == GATT_ATTR_UUID_TYPE_128  )
+            {
+                UINT16_TO_STREAM(p, p_attr->handle);
+                ARRAY_TO_STREAM (p, ((tGATT_ATTR128 *) p_attr)->uuid, LEN_UUID_128);
             }
             else
             {
+                GATT_TRACE_ERROR0("format mismatch");
                 status = GATT_NO_RESOURCES;
                 break;
+                /* format mismatch */
             }
+            p_msg->len += info_pair_len[p_msg->offset - 1];
+            len -= info_pair_len[p_msg->offset - 1];
+            status = GATT_SUCCESS;
+
+        }
+        else
+        {
+            status = GATT_NO_RESOURCES;
+            break;
         }
-        p_attr = (tGATT_ATTR16 *)p_attr->p_next;
     }
 
     *p_len = len;
@@ -858,6 +854,10 @@ static void gatts_process_find_info(tGATT_TCB *p_tcb, UINT8 op_code, UINT16 len,
 
             while (p_srv)
             {
+                /* the list is sorted by start handle, nothing further in range */
+                if (p_srv->s_hdl > e_hdl)
+                    break;
+
                 p_rcb = GATT_GET_SR_REG_PTR(p_srv->i_sreg);
 
                 if (p_rcb->in_use &&
@@ -1014,6 +1014,10 @@ void gatts_process_read_by_type_req(tGATT_TCB *p_tcb, UINT8 op_code, UINT16 len,
 
             while (p_srv)
             {
+                /* the list is sorted by start handle, nothing further in range */
+                if (p_srv->s_hdl > e_hdl)
+                    break;
+
                 p_rcb = GATT_GET_SR_REG_PTR(p_srv->i_sreg);
 
                 if (p_rcb->in_use &&
@@ -1242,9 +1246,8 @@ void gatts_process_attribute_req (tGATT_TCB *p_tcb, UINT8 op_code,
 {
     UINT16          handle = 0;
     UINT8           *p = p_data, i;
-    tGATT_SR_REG    *p_rcb = gatt_cb.sr_reg;
+    tGATT_SR_REG    *p_rcb;
     tGATT_STATUS    status = GATT_INVALID_HANDLE;
-    tGATT_ATTR16    *p_attr;
 
     if (len < 2)
     {
@@ -1269,41 +1272,30 @@ void gatts_process_attribute_req (tGATT_TCB *p_tcb, UINT8 op_code,
     }
 #endif
 
-    if (GATT_HANDLE_IS_VALID(handle))
+    if (GATT_HANDLE_IS_VALID(handle) &&
+        (i = gatt_sr_find_i_rcb_by_handle(handle)) < GATT_MAX_SR_PROFILES)
     {
-        for (i = 0; i < GATT_MAX_SR_PROFILES; i ++, p_rcb ++)
+        p_rcb = &gatt_cb.sr_reg[i];
+
+        if (gatts_db_find_attr(p_rcb->p_db, handle) != NULL)
         {
-            if (p_rcb->in_use && p_rcb->s_hdl <= handle && p_rcb->e_hdl >= handle)
+            switch (op_code)
             {
-                p_attr = (tGATT_ATTR16 *)p_rcb->p_db->p_attr_list;
+                case GATT_REQ_READ: /* read char/char descriptor value */
+                case GATT_REQ_READ_BLOB:
+                    gatts_process_read_req(p_tcb, p_rcb, op_code, handle, len, p);
+                    break;
 
-                while (p_attr)
-                {
-                    if (p_attr->handle == handle)
-                    {
-                        switch (op_code)
-                        {
-                            case GATT_REQ_READ: /* read char/char descriptor value */
-                            case GATT_REQ_READ_BLOB:
-                                gatts_process_read_req(p_tcb, p_rcb, op_code, handle, len, p);
-                                break;
-
-                            case GATT_REQ_WRITE: /* write char/char descriptor value */
-                            case GATT_CMD_WRITE:
-                            case GATT_SIGN_CMD_WRITE:
-                            case GATT_REQ_PREPARE_WRITE:
-                                gatts_process_write_req(p_tcb, i, handle, op_code, len, p);
-                                break;
-                            default:
-                                break;
-                        }
-                        status = GATT_SUCCESS;
-                        break;
-                    }
-                    p_attr = (tGATT_ATTR16 *)p_attr->p_next;
-                }
-                break;
+                case GATT_REQ_WRITE: /* write char/char descriptor value */
+                case GATT_CMD_WRITE:
+                case GATT_SIGN_CMD_WRITE:
+                case GATT_REQ_PREPARE_WRITE:
+                    gatts_process_write_req(p_tcb, i, handle, op_code, len, p);
+                    break;
+                default:
+                    break;
             }
+            status = GATT_SUCCESS;
         }
     }
 
@@ -113,6 +113,23 @@ void gatt_free_pending_enc_queue(tGATT_TCB *p_tcb)
         GKI_freebuf (GKI_dequeue (&p_tcb->pending_enc_clcb));
 }
 
+/*******************************************************************************
+**
+** Function         gatt_free_pending_write_cmd
+**
+** Description      Free all write commands held for the link
+**
+** Returns       None
+**
+*******************************************************************************/
+void gatt_free_pending_write_cmd(tGATT_TCB *p_tcb)
+{
+    GATT_TRACE_DEBUG0("gatt_free_pending_write_cmd");
+    /* release all held write commands */
+    while (p_tcb->wcmd_q.p_first)
+        GKI_freebuf (GKI_dequeue (&p_tcb->wcmd_q));
+}
+
 /*******************************************************************************
 **
 ** Function         gatt_delete_dev_from_srv_chg_clt_list
@@ -374,6 +391,7 @@ void gatt_free_hdl_buffer(tGATT_HDL_LIST_ELEM *p)
     {
         while (p->svc_db.svc_buffer.p_first)
             GKI_freebuf (GKI_dequeue (&p->svc_db.svc_buffer));
+        gatts_free_attr_tbl(&p->svc_db);
         memset(p, 0, sizeof(tGATT_HDL_LIST_ELEM));
     }
 }
@@ -398,6 +416,7 @@ void gatt_free_srvc_db_buffer_app_id(tBT_UUID *p_app_id)
         {
             while (p_elem->svc_db.svc_buffer.p_first)
                 GKI_freebuf (GKI_dequeue (&p_elem->svc_db.svc_buffer));
+            gatts_free_attr_tbl(&p_elem->svc_db);
 
             p_elem->svc_db.mem_free = 0;
             p_elem->svc_db.p_attr_list = p_elem->svc_db.p_free_mem = NULL;
@@ -547,6 +566,7 @@ BOOLEAN gatt_add_a_srv_to_list(tGATT_SRV_LIST_INFO *p_list, tGATT_SRV_LIST_ELEM
     p_list->count++;
 
     gatt_update_last_pri_srv_info(p_list);
+    gatt_sr_update_hdl_index();
     return TRUE;
 
 }
@@ -586,6 +606,7 @@ BOOLEAN gatt_remove_a_srv_from_list(tGATT_SRV_LIST_INFO *p_list, tGATT_SRV_LIST_
     }
     p_list->count--;
     gatt_update_last_pri_srv_info(p_list);
+    gatt_sr_update_hdl_index();
     return TRUE;
 
 }
@@ -1206,18 +1227,53 @@ void gatt_ind_ack_timeout(TIMER_LIST_ENT *p_tle)
 *******************************************************************************/
 UINT8 gatt_sr_find_i_rcb_by_handle(UINT16 handle)
 {
-    UINT8  i_rcb = 0;
+    UINT8  lo = 0, hi = gatt_cb.sr_hdl_count, mid;
+    tGATT_SR_REG *p_sreg;
 
-    for ( ; i_rcb < GATT_MAX_SR_PROFILES; i_rcb++)
+    /* find the last started service starting at or below the handle */
+    while (lo < hi)
     {
-        if (gatt_cb.sr_reg[i_rcb].in_use &&
-            gatt_cb.sr_reg[i_rcb].s_hdl <= handle &&
-            gatt_cb.sr_reg[i_rcb].e_hdl >= handle )
-        {
-            break;
-        }
+        mid = (UINT8)((lo + hi) / 2);
+
+        if (gatt_cb.sr_reg[gatt_cb.sr_hdl_index[mid]].s_hdl <= handle)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
-    return i_rcb;
+
+    if (lo > 0)
+    {
+        p_sreg = &gatt_cb.sr_reg[gatt_cb.sr_hdl_index[lo - 1]];
+
+        if (p_sreg->in_use && p_sreg->e_hdl >= handle)
+            return gatt_cb.sr_hdl_index[lo - 1];
+    }
+    return GATT_MAX_SR_PROFILES;
+}
+
+/*******************************************************************************
+**
+** Function         gatt_sr_update_hdl_index
+**
+** Description      Rebuild the handle ordered index of the started services
+**                  used by gatt_sr_find_i_rcb_by_handle. Called whenever the
+**                  service list changes.
+**
+** Returns          void
+**
+*******************************************************************************/
+void gatt_sr_update_hdl_index(void)
+{
+    tGATT_SRV_LIST_ELEM *p_srv = gatt_cb.srv_list_info.p_first;
+    UINT8               count = 0;
+
+    /* the service list is kept sorted by start handle */
+    while (p_srv != NULL && count < GATT_MAX_SR_PROFILES)
+    {
+        gatt_cb.sr_hdl_index[count++] = p_srv->i_sreg;
+        p_srv = p_srv->p_next;
+    }
+    gatt_cb.sr_hdl_count = count;
 }
 
 /*******************************************************************************
@@ -2134,6 +2190,7 @@ void gatt_cleanup_upon_disc(BD_ADDR bda, UINT16 reason)
         btu_stop_timer (&p_tcb->conf_timer_ent);
         gatt_free_pending_ind(p_tcb);
         gatt_free_pending_enc_queue(p_tcb);
+        gatt_free_pending_write_cmd(p_tcb);
 
         for (i = 0; i < GATT_MAX_APPS; i ++)
         {
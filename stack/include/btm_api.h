@@ -2928,6 +2928,24 @@ BTM_API extern BOOLEAN BTM_TryAllocateSCN(UINT8 scn);
     BTM_API extern UINT8 BTM_ReadNumInqDbEntries (void);
 
 
+/*******************************************************************************
+**
+** Function         BTM_SetInqDbSize
+**
+** Description      This function is called to change the number of entries of
+**                  the inquiry database. The new size takes effect the next
+**                  time the stack is started; the current database is left in
+**                  place since BTA may hold pointers into it.
+**
+** Parameter        num_entries - (input) 1 to BTM_INQ_DB_MAX_SIZE
+**
+** Returns          BTM_ILLEGAL_VALUE if the size is out of range
+**                  otherwise BTM_SUCCESS
+**
+*******************************************************************************/
+    BTM_API extern tBTM_STATUS BTM_SetInqDbSize (UINT16 num_entries);
+
+
 /*******************************************************************************
 **
 ** Function         BTM_InquiryRegisterForChanges
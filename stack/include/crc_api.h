@@ -0,0 +1,98 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 1999-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the checksum functions shared by the protocol layers:
+ *  the CRC-16 of the L2CAP enhanced retransmission and streaming mode FCS,
+ *  and the CRC-8 of the RFCOMM (GSM 07.10) FCS.
+ *
+ ******************************************************************************/
+#ifndef CRC_API_H
+#define CRC_API_H
+
+#include "bt_target.h"
+
+/* CRC-16 implementations, for CRC_Select16() */
+#define CRC_IMPL_BYTE       0       /* one byte per step from a 256 entry table */
+#define CRC_IMPL_SLICE8     1       /* eight bytes per step from 8 tables */
+#define CRC_IMPL_PCLMUL     2       /* 16 bytes per step with carry-less multiply (x86) */
+#define CRC_IMPL_MAX        3
+
+/*****************************************************************************
+**  External Function Declarations
+*****************************************************************************/
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*******************************************************************************
+**
+** Function         CRC_Init
+**
+** Description      Builds the CRC tables and selects the fastest CRC-16
+**                  implementation the CPU supports. It is called once when
+**                  the stack starts, before any other CRC function.
+**
+** Returns          void
+**
+*******************************************************************************/
+extern void CRC_Init (void);
+
+/*******************************************************************************
+**
+** Function         CRC_Select16
+**
+** Description      Forces the CRC-16 implementation (CRC_IMPL_xxx). Used by
+**                  the tests and benchmarks.
+**
+** Returns          TRUE if the implementation can be used on this CPU
+**
+*******************************************************************************/
+extern BOOLEAN CRC_Select16 (UINT8 impl);
+
+/*******************************************************************************
+**
+** Function         CRC_Update16
+**
+** Description      Runs len bytes through the CRC-16 of L2CAP (polynomial
+**                  x^16 + x^15 + x^2 + 1, least significant bit first).
+**
+** Returns          the new CRC register
+**
+*******************************************************************************/
+extern UINT16 CRC_Update16 (UINT16 crc, const UINT8 *p, UINT32 len);
+
+/*******************************************************************************
+**
+** Function         CRC_Update8
+**
+** Description      Runs len bytes through the CRC-8 of GSM 07.10 (polynomial
+**                  x^8 + x^2 + x + 1, least significant bit first).
+**
+** Returns          the new CRC register
+**
+*******************************************************************************/
+extern UINT8 CRC_Update8 (UINT8 fcs, const UINT8 *p, UINT32 len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC_API_H */
@@ -474,7 +474,8 @@ enum
 {
     GATT_WRITE_NO_RSP = 1,
     GATT_WRITE ,
-    GATT_WRITE_PREPARE
+    GATT_WRITE_PREPARE,
+    GATT_WRITE_NO_RSP_BULK  /* value streamed as MTU sized write commands */
 };
 typedef UINT8 tGATT_WRITE_TYPE;
 
@@ -874,6 +875,33 @@ extern "C"
     GATT_API extern  tGATT_STATUS GATTS_HandleValueNotification (UINT16 conn_id, UINT16 attr_handle,
                                                                  UINT16 val_len, UINT8 *p_val);
 
+/*******************************************************************************
+**
+** Function         GATTS_HandleValueMultiNotify
+**
+** Description      This function sends the same handle value notification or
+**                  indication to a number of clients. The PDU is built once
+**                  and copied for each link, cut to the MTU of that link.
+**                  The caller passes the connections whose client
+**                  characteristic configuration enables the update.
+**
+** Parameter        attr_handle: Attribute handle of this handle value.
+**                  val_len: Length of the attribute value.
+**                  p_val: Pointer to the attribute value data.
+**                  need_confirm: TRUE to send indications.
+**                  num_conn: number of connections in p_conn_id.
+**                  p_conn_id: connection identifiers.
+**                  p_status: if not NULL, the status of each connection.
+**
+** Returns          GATT_SUCCESS if sent or queued on every connection;
+**                  otherwise the last error.
+**
+*******************************************************************************/
+    GATT_API extern  tGATT_STATUS GATTS_HandleValueMultiNotify (UINT16 attr_handle, UINT16 val_len,
+                                                                UINT8 *p_val, BOOLEAN need_confirm,
+                                                                UINT8 num_conn, UINT16 *p_conn_id,
+                                                                tGATT_STATUS *p_status);
+
 
 /*******************************************************************************
 **
@@ -949,8 +977,11 @@ extern "C"
 **
 ** Function         GATTC_Write
 **
-** Description      This function is called to read the value of an attribute from
-**                  the server.
+** Description      This function is called to write the value of an attribute to
+**                  the server. With GATT_WRITE_NO_RSP_BULK the value is sent as
+**                  a stream of unsigned write commands, each filled up to the
+**                  MTU, and the operation completes once the last one is
+**                  passed to L2CAP.
 **
 ** Parameters       conn_id: connection identifier.
 **                  type    - attribute write type.
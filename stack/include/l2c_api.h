@@ -661,6 +661,20 @@ L2C_API extern BOOLEAN L2CA_SendTestSFrame (UINT16 cid, BOOLEAN rr_or_rej,
 *******************************************************************************/
 L2C_API extern BOOLEAN L2CA_SetTxPriority (UINT16 cid, tL2CAP_CHNL_PRIORITY priority);
 
+/*******************************************************************************
+**
+** Function         L2CA_SetTxWeight
+**
+** Description      Sets the round robin weight of the channels of a registered
+**                  PSM against the other channels of the same priority on a
+**                  link. A channel of weight n may send n * L2CAP_DRR_QUANTUM
+**                  bytes in its turn.
+**
+** Returns          TRUE if the PSM is registered and weight is not 0, else FALSE
+**
+*******************************************************************************/
+L2C_API extern BOOLEAN L2CA_SetTxWeight (UINT16 psm, UINT8 weight);
+
 /*******************************************************************************
 **
 ** Function         L2CA_RegForNoCPEvt
@@ -985,6 +999,21 @@ L2C_API extern BOOLEAN L2CA_ConnectFixedChnl (UINT16 fixed_cid, BD_ADDR bd_addr)
 *******************************************************************************/
 L2C_API extern UINT16 L2CA_SendFixedChnlData (UINT16 fixed_cid, BD_ADDR rem_bda, BT_HDR *p_buf);
 
+/*******************************************************************************
+**
+**  Function        L2CA_GetFixedChnlQueuedBufs
+**
+**  Description     Get the number of buffers of a fixed channel waiting in
+**                  L2CAP for room in the controller.
+**
+**  Parameters:     Fixed CID
+**                  BD Address of remote
+**
+**  Return value:   number of buffers queued, 0 if no link or channel
+**
+*******************************************************************************/
+L2C_API extern UINT16 L2CA_GetFixedChnlQueuedBufs (UINT16 fixed_cid, BD_ADDR rem_bda);
+
 /*******************************************************************************
 **
 **  Function        L2CA_RemoveFixedChnl
@@ -101,8 +101,19 @@ typedef int  (tPORT_DATA_CALLBACK) (UINT16 port_handle, void *p_data, UINT16 len
 #define DATA_CO_CALLBACK_TYPE_INCOMING          1
 #define DATA_CO_CALLBACK_TYPE_OUTGOING_SIZE     2
 #define DATA_CO_CALLBACK_TYPE_OUTGOING          3
+#define DATA_CO_CALLBACK_TYPE_OUTGOING_SEGS     4
 typedef int  (tPORT_DATA_CO_CALLBACK) (UINT16 port_handle, UINT8* p_buf, UINT16 len, int type);
 
+/* One buffer to fill in a DATA_CO_CALLBACK_TYPE_OUTGOING_SEGS callout. p_buf
+** points to an array of them and len is their count; the callout returns TRUE
+** only when every segment has been filled.
+*/
+typedef struct
+{
+    UINT8   *p_data;
+    UINT16  len;
+} tPORT_DATA_SEG;
+
 typedef void (tPORT_CALLBACK) (UINT32 code, UINT16 port_handle);
 
 /*
@@ -159,6 +159,13 @@ typedef struct
     UINT8   param_buf[BT_OCTET16_LEN];
 } tSMP_ENC;
 
+/* AES-128 key schedule of a key that encrypts over and over, see SMP_ExpandKey */
+#define SMP_AES_KS_LEN      (11 * BT_OCTET16_LEN)   /* 10 rounds and the key */
+typedef struct
+{
+    UINT8   ksch[SMP_AES_KS_LEN];
+} tSMP_AES_KS;
+
 /* Simple Pairing Events.  Called by the stack when Simple Pairing related
 ** events occur.
 */
@@ -297,6 +304,45 @@ extern "C"
                                         UINT8 *plain_text, UINT8 pt_len,
                                         tSMP_ENC *p_out);
 
+/*******************************************************************************
+**
+** Function         SMP_ExpandKey
+**
+** Description      This function computes the AES key schedule of a key, for
+**                  SMP_EncryptMatch to use it without expanding it again
+**
+** Parameters:      key                 - Pointer to key key[0] conatins the MSB
+**                  key_len             - key length
+**                  p_ks                - key schedule of the key
+**
+**  Returns         Boolean - TRUE: the key is expanded
+*******************************************************************************/
+    SMP_API extern BOOLEAN SMP_ExpandKey (UINT8 *key, UINT8 key_len, tSMP_AES_KS *p_ks);
+
+/*******************************************************************************
+**
+** Function         SMP_EncryptMatch
+**
+** Description      This function encrypts one plain text with a list of
+**                  expanded keys, in turn, until the output starts with the
+**                  given bytes. It is what SMP_Encrypt would do for each key,
+**                  without its buffer and byte order work per key.
+**
+** Parameters:      p_ks                - expanded keys
+**                  num_ks              - number of keys in p_ks
+**                  plain_text          - Pointer to data to be encrypted
+**                                        plain_text[0] conatins the MSB
+**                  pt_len              - plain text length
+**                  p_match             - bytes to find at the start of the output,
+**                                        in the order of tSMP_ENC param_buf
+**                  match_len           - number of bytes in p_match
+**
+**  Returns         index of the first key that matches, num_ks if none does
+*******************************************************************************/
+    SMP_API extern UINT16 SMP_EncryptMatch (tSMP_AES_KS *p_ks, UINT16 num_ks,
+                                            UINT8 *plain_text, UINT8 pt_len,
+                                            UINT8 *p_match, UINT8 match_len);
+
 #ifdef __cplusplus
 }
 #endif
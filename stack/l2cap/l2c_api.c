@@ -1033,6 +1033,39 @@ BOOLEAN L2CA_SetTxPriority (UINT16 cid, tL2CAP_CHNL_PRIORITY priority)
     return (TRUE);
 }
 
+/*******************************************************************************
+**
+** Function         L2CA_SetTxWeight
+**
+** Description      Sets the round robin weight of the channels of a registered
+**                  PSM. It applies from the next turn of each channel.
+**
+** Returns          TRUE if the PSM is registered and weight is not 0, else FALSE
+**
+*******************************************************************************/
+BOOLEAN L2CA_SetTxWeight (UINT16 psm, UINT8 weight)
+{
+    tL2C_RCB        *p_rcb;
+
+    L2CAP_TRACE_API2 ("L2CA_SetTxWeight()  PSM: 0x%04x, weight:%d", psm, weight);
+
+    if ((p_rcb = l2cu_find_rcb_by_psm (psm)) == NULL)
+    {
+        L2CAP_TRACE_WARNING1 ("L2CAP - no RCB for L2CA_SetTxWeight, PSM: 0x%04x", psm);
+        return (FALSE);
+    }
+
+    if (weight == 0)
+    {
+        L2CAP_TRACE_WARNING1 ("L2CAP - invalid weight for L2CA_SetTxWeight, PSM: 0x%04x", psm);
+        return (FALSE);
+    }
+
+    p_rcb->tx_weight = weight;
+
+    return (TRUE);
+}
+
 /*******************************************************************************
 **
 ** Function         L2CA_SetChnlDataRate
@@ -1446,6 +1479,36 @@ UINT16 L2CA_SendFixedChnlData (UINT16 fixed_cid, BD_ADDR rem_bda, BT_HDR *p_buf)
     return (L2CAP_DW_SUCCESS);
 }
 
+/*******************************************************************************
+**
+**  Function        L2CA_GetFixedChnlQueuedBufs
+**
+**  Description     Get the number of buffers of a fixed channel waiting in
+**                  L2CAP for room in the controller.
+**
+**  Parameters:     Fixed CID
+**                  BD Address of remote
+**
+**  Return value:   number of buffers queued, 0 if no link or channel
+**
+*******************************************************************************/
+UINT16 L2CA_GetFixedChnlQueuedBufs (UINT16 fixed_cid, BD_ADDR rem_bda)
+{
+    tL2C_LCB        *p_lcb;
+    tL2C_CCB        *p_ccb;
+
+    if ((fixed_cid < L2CAP_FIRST_FIXED_CHNL) || (fixed_cid > L2CAP_LAST_FIXED_CHNL))
+        return (0);
+
+    if ((p_lcb = l2cu_find_lcb_by_bd_addr (rem_bda)) == NULL)
+        return (0);
+
+    if ((p_ccb = p_lcb->p_fixed_ccbs[fixed_cid - L2CAP_FIRST_FIXED_CHNL]) == NULL)
+        return (0);
+
+    return (p_ccb->xmit_hold_q.count);
+}
+
 /*******************************************************************************
 **
 **  Function        L2CA_RemoveFixedChnl
@@ -1318,7 +1318,7 @@ void l2c_enqueue_peer_data (tL2C_CCB *p_ccb, BT_HDR *p_buf)
 #if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
     /* if new packet is higher priority than serving ccb and it is not overrun */
     if (( p_ccb->p_lcb->rr_pri > p_ccb->ccb_priority )
-      &&( p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].quota > 0))
+      &&( p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].deficit > 0))
     {
         /* send out higher priority packet */
         p_ccb->p_lcb->rr_pri = p_ccb->ccb_priority;
@@ -276,6 +276,7 @@ typedef struct
 #endif
 
     tL2CAP_APPL_INFO        api;
+    UINT8                   tx_weight;              /* Round robin weight of the PSM channels */
 } tL2C_RCB;
 
 
@@ -323,6 +324,9 @@ typedef struct t_l2c_ccb
     UINT16              buff_quota;             /* Buffer quota before sending congestion   */
 
     tL2CAP_CHNL_PRIORITY ccb_priority;          /* Channel priority                 */
+#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+    INT32               drr_deficit;            /* Bytes left to the channel in its turn */
+#endif
     tL2CAP_CHNL_DATA_RATE tx_data_rate;         /* Channel Tx data rate             */
     tL2CAP_CHNL_DATA_RATE rx_data_rate;         /* Channel Rx data rate             */
 
@@ -363,20 +367,21 @@ typedef struct
 
 /* Round-Robin service for the same priority channels */
 #define L2CAP_NUM_CHNL_PRIORITY     3           /* Total number of priority group (high, medium, low)*/
-#define L2CAP_CHNL_PRIORITY_WEIGHT  5           /* weight per priority for burst transmission quota */
-#define L2CAP_GET_PRIORITY_QUOTA(pri) ((L2CAP_NUM_CHNL_PRIORITY - (pri)) * L2CAP_CHNL_PRIORITY_WEIGHT)
+#define L2CAP_GET_PRIORITY_QUANTUM(pri) ((L2CAP_NUM_CHNL_PRIORITY - (pri)) * L2CAP_DRR_QUANTUM)
 
-/* CCBs within the same LCB are served in round robin with priority                       */
-/* It will make sure that low priority channel (for example, HF signaling on RFCOMM)      */
-/* can be sent to headset even if higher priority channel (for example, AV media channel) */
-/* is congested.                                                                          */
+/* CCBs within the same LCB are served in deficit round robin with priority.              */
+/* Each priority group in turn, then each channel of the group in turn, may send as many  */
+/* bytes as its quantum; what it sends over is taken from its next turn. It will make     */
+/* sure that low priority channel (for example, HF signaling on RFCOMM) can be sent to    */
+/* headset even if higher priority channel (for example, AV media channel) is congested,  */
+/* and that large PDUs of a bulk channel cost it their full size.                         */
 
 typedef struct
 {
     tL2C_CCB        *p_serve_ccb;               /* current serving ccb within priority group */
     tL2C_CCB        *p_first_ccb;               /* first ccb of priority group */
     UINT8           num_ccb;                    /* number of channels in priority group */
-    UINT8           quota;                      /* burst transmission quota */
+    INT32           deficit;                    /* bytes left to the group in its turn */
 } tL2C_RR_SERV;
 
 #endif /* (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE) */
@@ -1243,11 +1243,12 @@ void l2cu_enqueue_ccb (tL2C_CCB *p_ccb)
             p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = p_ccb;
         	/* Set the next serving channel in this group to this CCB */
             p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = p_ccb;
-        	/* Initialize quota of this priority group based on its priority */
-            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].quota = L2CAP_GET_PRIORITY_QUOTA(p_ccb->ccb_priority);
+        	/* Initialize quantum of this priority group based on its priority */
+            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].deficit = L2CAP_GET_PRIORITY_QUANTUM(p_ccb->ccb_priority);
         }
         /* increase number of channels in this group */
         p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb++;
+        p_ccb->drr_deficit = 0;
     }
 #endif
 
@@ -1374,8 +1375,9 @@ void l2cu_change_pri_ccb (tL2C_CCB *p_ccb, tL2CAP_CHNL_PRIORITY priority)
 
             p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = p_ccb;
             p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = p_ccb;
-            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].quota = L2CAP_GET_PRIORITY_QUOTA(p_ccb->ccb_priority);
+            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].deficit = L2CAP_GET_PRIORITY_QUANTUM(p_ccb->ccb_priority);
             p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb = 1;
+            p_ccb->drr_deficit = 0;
         }
 #endif
     }
@@ -1723,6 +1725,7 @@ tL2C_RCB *l2cu_allocate_rcb (UINT16 psm)
         {
             p_rcb->in_use = TRUE;
             p_rcb->psm    = psm;
+            p_rcb->tx_weight = L2CAP_DEFAULT_TX_WEIGHT;
 #if (L2CAP_UCD_INCLUDED == TRUE)
             p_rcb->ucd.state = L2C_UCD_STATE_UNUSED;
 #endif
@@ -2954,109 +2957,204 @@ tL2C_CCB *l2cu_find_ccb_by_cid (tL2C_LCB *p_lcb, UINT16 local_cid)
 
 #if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
 
+/******************************************************************************
+**
+** Function         l2cu_is_ccb_ready_to_send
+**
+** Description      check if a channel has data and may send it now
+**
+** Returns          TRUE if the channel can be served
+**
+*******************************************************************************/
+static BOOLEAN l2cu_is_ccb_ready_to_send (tL2C_CCB *p_ccb)
+{
+    if (p_ccb->chnl_state != CST_OPEN)
+        return (FALSE);
+
+    /* eL2CAP option in use */
+    if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE)
+    {
+        if (p_ccb->fcrb.wait_ack || p_ccb->fcrb.remote_busy)
+            return (FALSE);
+
+        if ( p_ccb->fcrb.retrans_q.count == 0 )
+        {
+            if ( p_ccb->xmit_hold_q.count == 0 )
+                return (FALSE);
+
+            /* If using the common pool, should be at least 10% free. */
+            if ( (p_ccb->ertm_info.fcr_tx_pool_id == HCI_ACL_POOL_ID) && (GKI_poolutilization (HCI_ACL_POOL_ID) > 90) )
+                return (FALSE);
+
+            /* If in eRTM mode, check for window closure */
+            if ( (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) && (l2c_fcr_is_flow_controlled (p_ccb)) )
+                return (FALSE);
+        }
+    }
+    else
+    {
+        if (p_ccb->xmit_hold_q.count == 0)
+            return (FALSE);
+    }
+    return (TRUE);
+}
+
+/******************************************************************************
+**
+** Function         l2cu_rr_next_ccb
+**
+** Description      pass the turn of a priority group to its channel after
+**                  p_ccb, and give that channel its quantum. Debt left from
+**                  its previous turn is paid first, unused bytes are not kept.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void l2cu_rr_next_ccb (tL2C_RR_SERV *p_serv, tL2C_CCB *p_ccb)
+{
+    UINT8   weight;
+
+    /* this channel is the last channel of its priority group */
+    if (( p_ccb->p_next_ccb == NULL )
+      ||( p_ccb->p_next_ccb->ccb_priority != p_ccb->ccb_priority ))
+    {
+        /* next serving channel is set to the first channel in the group */
+        p_serv->p_serve_ccb = p_serv->p_first_ccb;
+    }
+    else
+    {
+        /* next serving channel is set to the next channel in the group */
+        p_serv->p_serve_ccb = p_ccb->p_next_ccb;
+    }
+
+    p_ccb  = p_serv->p_serve_ccb;
+    weight = (p_ccb->p_rcb) ? p_ccb->p_rcb->tx_weight : L2CAP_DEFAULT_TX_WEIGHT;
+
+    if (p_ccb->drr_deficit > 0)
+        p_ccb->drr_deficit = 0;
+    p_ccb->drr_deficit += (INT32)weight * L2CAP_DRR_QUANTUM;
+}
+
+/******************************************************************************
+**
+** Function         l2cu_rr_next_group
+**
+** Description      pass the turn to the next priority group and give it its
+**                  quantum
+**
+** Returns          void
+**
+*******************************************************************************/
+static void l2cu_rr_next_group (tL2C_LCB *p_lcb)
+{
+    tL2C_RR_SERV    *p_serv;
+
+    p_lcb->rr_pri = (p_lcb->rr_pri + 1) % L2CAP_NUM_CHNL_PRIORITY;
+    p_serv = &p_lcb->rr_serv[p_lcb->rr_pri];
+
+    if (p_serv->deficit > 0)
+        p_serv->deficit = 0;
+    p_serv->deficit += L2CAP_GET_PRIORITY_QUANTUM(p_lcb->rr_pri);
+}
+
+/******************************************************************************
+**
+** Function         l2cu_rr_charge
+**
+** Description      take the bytes of a PDU sent on a channel from the channel
+**                  and from its priority group, and end their turn when they
+**                  have used up their quantum
+**
+** Returns          void
+**
+*******************************************************************************/
+static void l2cu_rr_charge (tL2C_LCB *p_lcb, tL2C_CCB *p_ccb, UINT16 len)
+{
+    tL2C_RR_SERV    *p_serv = &p_lcb->rr_serv[p_ccb->ccb_priority];
+
+    p_ccb->drr_deficit -= len;
+    p_serv->deficit    -= len;
+
+    if ((p_ccb->drr_deficit <= 0) && (p_serv->p_serve_ccb == p_ccb))
+        l2cu_rr_next_ccb (p_serv, p_ccb);
+
+    if ((p_serv->deficit <= 0) && (p_lcb->rr_pri == p_ccb->ccb_priority))
+        l2cu_rr_next_group (p_lcb);
+
+    L2CAP_TRACE_DEBUG4("RR charge pri=%d, lcid=0x%04x, len=%d, group deficit=%d",
+                        p_ccb->ccb_priority, p_ccb->local_cid, len, p_serv->deficit);
+}
+
 /******************************************************************************
 **
 ** Function         l2cu_get_next_channel_in_rr
 **
-** Description      get the next channel to send on a link. It also adjusts the
-**                  CCB queue to do a basic priority and round-robin scheduling.
+** Description      get the next channel to send on a link. The priority groups
+**                  and the channels within a group are served in deficit round
+**                  robin, see l2cu_rr_charge().
 **
 ** Returns          pointer to CCB or NULL
 **
 *******************************************************************************/
 static tL2C_CCB *l2cu_get_next_channel_in_rr(tL2C_LCB *p_lcb)
 {
-    tL2C_CCB    *p_serve_ccb = NULL;
-    tL2C_CCB    *p_ccb;
-
+    tL2C_RR_SERV    *p_serv;
+    tL2C_CCB        *p_ccb;
+    BOOLEAN         ready = TRUE;
     int i, j;
 
-    /* scan all of priority until finding a channel to serve */
-    for ( i = 0; (i < L2CAP_NUM_CHNL_PRIORITY)&&(!p_serve_ccb); i++ )
+    /* Every turn passed on adds a quantum, so keep going round while some channel has */
+    /* data: one that went far over its quantum with a large PDU gets there in the end. */
+    while (ready)
     {
-        /* scan all channel within serving priority group until finding a channel to serve */
-        for ( j = 0; (j < p_lcb->rr_serv[p_lcb->rr_pri].num_ccb)&&(!p_serve_ccb); j++)
-        {
-            /* scaning from next serving channel */
-            p_ccb = p_lcb->rr_serv[p_lcb->rr_pri].p_serve_ccb;
+        ready = FALSE;
 
-            if (!p_ccb)
-            {
-                L2CAP_TRACE_ERROR1("p_serve_ccb is NULL, rr_pri=%d", p_lcb->rr_pri);
-                return NULL;
-            }
-
-            L2CAP_TRACE_DEBUG3("RR scan pri=%d, lcid=0x%04x, q_cout=%d",
-                                p_ccb->ccb_priority, p_ccb->local_cid, p_ccb->xmit_hold_q.count );
+        /* scan all of priority until finding a channel to serve */
+        for ( i = 0; i < L2CAP_NUM_CHNL_PRIORITY; i++ )
+        {
+            p_serv = &p_lcb->rr_serv[p_lcb->rr_pri];
 
-            /* store the next serving channel */
-            /* this channel is the last channel of its priority group */
-            if (( p_ccb->p_next_ccb == NULL )
-              ||( p_ccb->p_next_ccb->ccb_priority != p_ccb->ccb_priority ))
-            {
-                /* next serving channel is set to the first channel in the group */
-                p_lcb->rr_serv[p_lcb->rr_pri].p_serve_ccb = p_lcb->rr_serv[p_lcb->rr_pri].p_first_ccb;
-            }
-            else
+            /* scan all channel within serving priority group until finding a channel to serve */
+            for ( j = 0; j < p_serv->num_ccb; j++ )
             {
-                /* next serving channel is set to the next channel in the group */
-                p_lcb->rr_serv[p_lcb->rr_pri].p_serve_ccb = p_ccb->p_next_ccb;
-            }
-
-            if (p_ccb->chnl_state != CST_OPEN)
-                continue;
+                /* scaning from next serving channel */
+                if ((p_ccb = p_serv->p_serve_ccb) == NULL)
+                {
+                    L2CAP_TRACE_ERROR1("p_serve_ccb is NULL, rr_pri=%d", p_lcb->rr_pri);
+                    return NULL;
+                }
 
-            /* eL2CAP option in use */
-            if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE)
-            {
-                if (p_ccb->fcrb.wait_ack || p_ccb->fcrb.remote_busy)
-                    continue;
+                L2CAP_TRACE_DEBUG4("RR scan pri=%d, lcid=0x%04x, q_cout=%d, deficit=%d",
+                                    p_ccb->ccb_priority, p_ccb->local_cid, p_ccb->xmit_hold_q.count,
+                                    p_ccb->drr_deficit );
 
-                if ( p_ccb->fcrb.retrans_q.count == 0 )
+                if (l2cu_is_ccb_ready_to_send (p_ccb))
                 {
-                    if ( p_ccb->xmit_hold_q.count == 0 )
-                        continue;
+                    ready = TRUE;
 
-                    /* If using the common pool, should be at least 10% free. */
-                    if ( (p_ccb->ertm_info.fcr_tx_pool_id == HCI_ACL_POOL_ID) && (GKI_poolutilization (HCI_ACL_POOL_ID) > 90) )
-                        continue;
+                    /* the group has used up its turn, the channel keeps its own */
+                    if (p_serv->deficit <= 0)
+                        break;
 
-                    /* If in eRTM mode, check for window closure */
-                    if ( (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) && (l2c_fcr_is_flow_controlled (p_ccb)) )
-                        continue;
+                    /* found a channel to serve */
+                    if (p_ccb->drr_deficit > 0)
+                        return p_ccb;
+                }
+                else
+                {
+                    /* an idle channel does not save up for later */
+                    p_ccb->drr_deficit = 0;
                 }
-            }
-            else
-            {
-                if (p_ccb->xmit_hold_q.count == 0)
-                    continue;
-            }
 
-            /* found a channel to serve */
-            p_serve_ccb = p_ccb;
-            /* decrease quota of its priority group */
-            p_lcb->rr_serv[p_lcb->rr_pri].quota--;
-        }
+                l2cu_rr_next_ccb (p_serv, p_ccb);
+            }
 
-        /* if there is no more quota of the priority group or no channel to have data to send */
-        if ((p_lcb->rr_serv[p_lcb->rr_pri].quota == 0)||(!p_serve_ccb))
-        {
             /* serve next priority group */
-            p_lcb->rr_pri = (p_lcb->rr_pri + 1) % L2CAP_NUM_CHNL_PRIORITY;
-            /* initialize its quota */
-            p_lcb->rr_serv[p_lcb->rr_pri].quota = L2CAP_GET_PRIORITY_QUOTA(p_lcb->rr_pri);
+            l2cu_rr_next_group (p_lcb);
         }
     }
 
-    if (p_serve_ccb)
-    {
-        L2CAP_TRACE_DEBUG3("RR service pri=%d, quota=%d, lcid=0x%04x",
-                            p_serve_ccb->ccb_priority,
-                            p_lcb->rr_serv[p_serve_ccb->ccb_priority].quota,
-                            p_serve_ccb->local_cid );
-    }
-
-    return p_serve_ccb;
+    return NULL;
 }
 
 #else /* (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE) */
@@ -3201,6 +3299,10 @@ BT_HDR *l2cu_get_next_buffer_to_send (tL2C_LCB *p_lcb)
         }
     }
 
+#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+    l2cu_rr_charge (p_lcb, p_ccb, p_buf->len);
+#endif
+
     if ( p_ccb->p_rcb && p_ccb->p_rcb->api.pL2CA_TxComplete_Cb && (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_ERTM_MODE) )
         (*p_ccb->p_rcb->api.pL2CA_TxComplete_Cb)(p_ccb->local_cid, 1);
 
@@ -1552,62 +1552,86 @@ int PORT_WriteDataCO (UINT16 handle, int* p_len)
 
     PORT_SCHEDULE_UNLOCK;
 
-    //int max_read = length < p_port->peer_mtu ? length : p_port->peer_mtu;
-
-    //max_read = available < max_read ? available : max_read;
+    if (p_port->peer_mtu < length)
+        length = p_port->peer_mtu;
 
     while (available)
     {
-        /* if we're over buffer high water mark, we're done */
-        if ((p_port->tx.queue_size  > PORT_TX_HIGH_WM)
-         || (p_port->tx.queue.count > PORT_TX_BUF_HIGH_WM))
+        BT_HDR         *p_bufs[PORT_TX_CO_MAX_SEGS];
+        tPORT_DATA_SEG segs[PORT_TX_CO_MAX_SEGS];
+        UINT16         num_segs = 0, seg_len, i;
+        int            batch = 0;
+
+        /* Take as many peer MTU sized buffers as the data and the high water */
+        /* marks allow, and have them all filled by a single call-out */
+        while ((num_segs < PORT_TX_CO_MAX_SEGS) && (batch < available))
         {
-            event |= PORT_EV_TXFULL;
-            RFCOMM_TRACE_DEBUG2("PORT_WriteDataCO(): Tx Queue is FULL size= %d, count= %d",
-                p_port->tx.queue_size, p_port->tx.queue.count);
-            break;
-	}
+            /* if we're over buffer high water mark, we're done */
+            if ((p_port->tx.queue_size + batch > PORT_TX_HIGH_WM)
+             || (p_port->tx.queue.count + num_segs > PORT_TX_BUF_HIGH_WM))
+            {
+                event |= PORT_EV_TXFULL;
+                RFCOMM_TRACE_DEBUG2("PORT_WriteDataCO(): Tx Queue is FULL size= %d, count= %d",
+                    p_port->tx.queue_size, p_port->tx.queue.count);
+                break;
+            }
 
-        /* continue with rfcomm data write */
-        p_buf = (BT_HDR *)GKI_getpoolbuf (RFCOMM_DATA_POOL_ID);
-        if (!p_buf)
-            break;
+            p_buf = (BT_HDR *)GKI_getpoolbuf (RFCOMM_DATA_POOL_ID);
+            if (!p_buf)
+                break;
 
-        p_buf->offset         = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
-        p_buf->layer_specific = handle;
+            p_buf->offset         = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
+            p_buf->layer_specific = handle;
+            p_buf->len            = (available - batch < (int)length) ? (UINT16)(available - batch) : length;
+            p_buf->event          = BT_EVT_TO_BTU_SP_DATA;
 
-        if (p_port->peer_mtu < length)
-            length = p_port->peer_mtu;
-        if (available < (int)length)
-            length = (UINT16)available;
-        p_buf->len = length;
-        p_buf->event          = BT_EVT_TO_BTU_SP_DATA;
+            p_bufs[num_segs]      = p_buf;
+            segs[num_segs].p_data = (UINT8 *)(p_buf + 1) + p_buf->offset;
+            segs[num_segs].len    = p_buf->len;
+            batch += p_buf->len;
+            num_segs++;
+        }
 
-        //memcpy ((UINT8 *)(p_buf + 1) + p_buf->offset, p_data, length);
-        //if(recv(fd, (UINT8 *)(p_buf + 1) + p_buf->offset, (int)length, 0) != (int)length)
-        if(p_port->p_data_co_callback(handle, (UINT8 *)(p_buf + 1) + p_buf->offset, length,
-                                      DATA_CO_CALLBACK_TYPE_OUTGOING) == FALSE)
+        if (num_segs == 0)
+            break;
+
+        if(p_port->p_data_co_callback(handle, (UINT8 *)segs, num_segs,
+                                      DATA_CO_CALLBACK_TYPE_OUTGOING_SEGS) == FALSE)
         {
-            error("p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING failed, length:%d", length);
+            error("p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING_SEGS failed, length:%d", batch);
+            for (i = 0; i < num_segs; i++)
+                GKI_freebuf (p_bufs[i]);
             return (PORT_UNKNOWN_ERROR);
         }
 
-
-        RFCOMM_TRACE_EVENT1 ("PORT_WriteData %d bytes", length);
+        RFCOMM_TRACE_EVENT2 ("PORT_WriteData %d bytes in %d buffers", batch, num_segs);
         event &= ~PORT_EV_TXFULL;
-        rc = port_write (p_port, p_buf);
+        available -= batch;
 
-        /* If queue went below the threashold need to send flow control */
-        event |= port_flow_control_user (p_port);
+        for (i = 0; i < num_segs; i++)
+        {
+            seg_len = p_bufs[i]->len;
+            rc = port_write (p_port, p_bufs[i]);
 
-        if (rc == PORT_SUCCESS)
-            event |= PORT_EV_TXCHAR;
+            /* If queue went below the threashold need to send flow control */
+            event |= port_flow_control_user (p_port);
 
-        if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING))
-            break;
+            if (rc == PORT_SUCCESS)
+                event |= PORT_EV_TXCHAR;
 
-        *p_len  += length;
-        available -= (int)length;
+            if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING))
+                break;
+
+            *p_len += seg_len;
+        }
+
+        /* The port refused the data, what is left of it has nowhere to go */
+        if (i < num_segs)
+        {
+            while (++i < num_segs)
+                GKI_freebuf (p_bufs[i]);
+            break;
+        }
     }
     if (!available && (rc != PORT_CMD_PENDING) && (rc != PORT_TX_QUEUE_DISABLED))
         event |= PORT_EV_TXEMPTY;
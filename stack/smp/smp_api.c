@@ -32,6 +32,7 @@
     #include "l2c_int.h"
     #include "btm_int.h"
     #include "hcimsgs.h"
+    #include "aes.h"
 
     #include "btu.h"
 
@@ -332,6 +333,86 @@ BOOLEAN SMP_Encrypt (UINT8 *key, UINT8 key_len,
     status = smp_encrypt_data(key, key_len, plain_text, pt_len, p_out);
     return status;
 }
+
+/*******************************************************************************
+**
+** Function         SMP_ExpandKey
+**
+** Description      This function computes the AES key schedule of a key, for
+**                  SMP_EncryptMatch to use it without expanding it again
+**
+** Parameters:      key                 - Pointer to key key[0] conatins the MSB
+**                  key_len             - key length
+**                  p_ks                - key schedule of the key
+**
+**  Returns         Boolean - TRUE: the key is expanded
+*******************************************************************************/
+BOOLEAN SMP_ExpandKey (UINT8 *key, UINT8 key_len, tSMP_AES_KS *p_ks)
+{
+    aes_context ctx;
+    UINT8       rev_key[SMP_ENCRYT_KEY_SIZE];
+    int         i;
+
+    if ((p_ks == NULL) || (key_len != SMP_ENCRYT_KEY_SIZE))
+        return(FALSE);
+
+    /* the AES code takes the key in big endian format */
+    for (i = 0; i < SMP_ENCRYT_KEY_SIZE; i++)
+        rev_key[i] = key[SMP_ENCRYT_KEY_SIZE - 1 - i];
+
+    if (aes_set_key(rev_key, SMP_ENCRYT_KEY_SIZE, &ctx) != 0)
+        return(FALSE);
+
+    memcpy(p_ks->ksch, ctx.ksch, SMP_AES_KS_LEN);
+    return(TRUE);
+}
+
+/*******************************************************************************
+**
+** Function         SMP_EncryptMatch
+**
+** Description      This function encrypts one plain text with a list of
+**                  expanded keys, in turn, until the output starts with the
+**                  given bytes.
+**
+**  Returns         index of the first key that matches, num_ks if none does
+*******************************************************************************/
+UINT16 SMP_EncryptMatch (tSMP_AES_KS *p_ks, UINT16 num_ks,
+                         UINT8 *plain_text, UINT8 pt_len,
+                         UINT8 *p_match, UINT8 match_len)
+{
+    aes_context ctx;
+    UINT8       rev_data[SMP_ENCRYT_DATA_SIZE];
+    UINT8       rev_output[SMP_ENCRYT_DATA_SIZE];
+    UINT16      k;
+    int         i;
+
+    if (pt_len > SMP_ENCRYT_DATA_SIZE)
+        pt_len = SMP_ENCRYT_DATA_SIZE;
+    if (match_len > SMP_ENCRYT_DATA_SIZE)
+        match_len = SMP_ENCRYT_DATA_SIZE;
+
+    /* zero padded plain text in big endian format, as smp_encrypt_data() does */
+    memset(rev_data, 0, SMP_ENCRYT_DATA_SIZE);
+    for (i = 0; i < pt_len; i++)
+        rev_data[SMP_ENCRYT_DATA_SIZE - 1 - i] = plain_text[i];
+
+    ctx.rnd = 10;
+    for (k = 0; k < num_ks; k++, p_ks++)
+    {
+        memcpy(ctx.ksch, p_ks->ksch, SMP_AES_KS_LEN);
+        aes_encrypt(rev_data, rev_output, &ctx);
+
+        for (i = 0; i < match_len; i++)
+        {
+            if (rev_output[SMP_ENCRYT_DATA_SIZE - 1 - i] != p_match[i])
+                break;
+        }
+        if (i == match_len)
+            break;
+    }
+    return(k);
+}
 #endif /* SMP_INCLUDED */
 
 
@@ -0,0 +1,59 @@
+LOCAL_PATH:= $(call my-dir)
+
+crc_test_SRC_FILES := ../../stack/crc/crc.c
+
+crc_test_C_INCLUDES := . \
+        $(LOCAL_PATH)/../../include \
+        $(LOCAL_PATH)/../../stack/include \
+        $(LOCAL_PATH)/../../gki/common \
+        $(LOCAL_PATH)/../../gki/ulinux \
+        $(bdroid_C_INCLUDES)
+
+# CRC-16 implementations against the byte code
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= crc_test.c $(crc_test_SRC_FILES)
+LOCAL_C_INCLUDES += $(crc_test_C_INCLUDES)
+
+LOCAL_CFLAGS += -DBUILDCFG $(bdroid_CFLAGS)
+LOCAL_MODULE_PATH := $(TARGET_OUT_EXECUTABLES)
+LOCAL_MODULE_TAGS := debug optional
+
+LOCAL_MODULE:= crc_test
+
+include $(BUILD_EXECUTABLE)
+
+# CRC-16 throughput, on the device
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= crc_bench.c $(crc_test_SRC_FILES)
+LOCAL_C_INCLUDES += $(crc_test_C_INCLUDES)
+
+LOCAL_CFLAGS += -DBUILDCFG $(bdroid_CFLAGS)
+LOCAL_MODULE_PATH := $(TARGET_OUT_EXECUTABLES)
+LOCAL_MODULE_TAGS := debug optional
+
+LOCAL_MODULE:= crc_bench
+
+include $(BUILD_EXECUTABLE)
+
+# CRC-16 throughput, on the build host
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= crc_bench.c $(crc_test_SRC_FILES)
+LOCAL_C_INCLUDES += $(crc_test_C_INCLUDES)
+
+LOCAL_CFLAGS += -O2 -DBUILDCFG $(bdroid_CFLAGS)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_MODULE:= crc_bench
+
+LOCAL_LDLIBS += -lrt
+
+include $(BUILD_HOST_EXECUTABLE)
+
+crc_test_SRC_FILES :=
+crc_test_C_INCLUDES :=
@@ -0,0 +1,199 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      crc_bench.c
+ *
+ *  Description:   Throughput benchmark of the CRC-16 implementations used for
+ *                 the L2CAP FCS
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "bt_target.h"
+#include "crc_api.h"
+
+/************************************************************************************
+**  Constants & Macros
+************************************************************************************/
+
+#define BENCH_DEFAULT_MS        100     /* minimum measured time per configuration */
+#define BENCH_MAX_LEN           4096
+#define BENCH_BATCH             64      /* frames between two clock reads */
+
+/* output formats */
+#define BENCH_OUT_TEXT          0
+#define BENCH_OUT_CSV           1
+
+/************************************************************************************
+**  Static variables
+************************************************************************************/
+
+static const char *bench_impl_name[CRC_IMPL_MAX] = { "byte", "slice8", "pclmul" };
+
+/* S-frame, small SDUs, default MTU, 3-DH5 payload, large SDU */
+static const int bench_len[] = { 6, 64, 256, 672, 1021, BENCH_MAX_LEN };
+
+static UINT8 bench_data[BENCH_MAX_LEN];
+static volatile UINT16 bench_sink;
+
+/************************************************************************************
+**  Timing
+************************************************************************************/
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static unsigned long long now_cycles(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* runs CRC_Update16() on len bytes for at least ms milliseconds */
+static void bench_run(int len, int ms, double *p_ns, double *p_cycles)
+{
+    double start, end, limit = ms * 1e6;
+    unsigned long long c0, c1;
+    long frames = 0;
+    int i;
+    UINT16 crc = 0;
+
+    /* warm up the tables */
+    for (i = 0; i < BENCH_BATCH; i++)
+        crc ^= CRC_Update16(0, bench_data, len);
+
+    c0 = now_cycles();
+    start = end = now_ns();
+    while (end - start < limit)
+    {
+        for (i = 0; i < BENCH_BATCH; i++)
+            crc ^= CRC_Update16(crc, bench_data, len);
+        frames += BENCH_BATCH;
+        end = now_ns();
+    }
+    c1 = now_cycles();
+
+    bench_sink = crc;
+    *p_ns = (end - start) / frames;
+    *p_cycles = (double)(c1 - c0) / frames / len;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: crc_bench [-l byte|slice8|pclmul|all] [-n len] [-t ms] [-o text|csv]\n");
+    exit(1);
+}
+
+/************************************************************************************
+**  Main
+************************************************************************************/
+
+int main(int argc, char **argv)
+{
+    int impl_first = CRC_IMPL_BYTE, impl_last = CRC_IMPL_MAX - 1;
+    int ms = BENCH_DEFAULT_MS, out = BENCH_OUT_TEXT, one_len = 0;
+    int c, impl, i;
+    double ns, cycles;
+
+    while ((c = getopt(argc, argv, "l:n:t:o:")) != -1)
+    {
+        switch (c)
+        {
+        case 'l':
+            if (strcmp(optarg, "all") == 0)
+                break;
+            for (impl = 0; impl < CRC_IMPL_MAX; impl++)
+                if (strcmp(optarg, bench_impl_name[impl]) == 0)
+                    impl_first = impl_last = impl;
+            if (impl_first != impl_last)
+                usage();
+            break;
+        case 'n':
+            one_len = atoi(optarg);
+            if (one_len <= 0 || one_len > BENCH_MAX_LEN)
+                usage();
+            break;
+        case 't':
+            ms = atoi(optarg);
+            if (ms <= 0)
+                usage();
+            break;
+        case 'o':
+            if (strcmp(optarg, "text") == 0)
+                out = BENCH_OUT_TEXT;
+            else if (strcmp(optarg, "csv") == 0)
+                out = BENCH_OUT_CSV;
+            else
+                usage();
+            break;
+        default:
+            usage();
+        }
+    }
+
+    for (i = 0; i < BENCH_MAX_LEN; i++)
+        bench_data[i] = (UINT8)rand();
+
+    CRC_Init();
+
+    if (out == BENCH_OUT_CSV)
+        printf("impl,len,ns_per_frame,mb_per_sec,cycles_per_byte\n");
+    else
+        printf("impl     len   ns/frame       MB/s  cyc/byte\n");
+
+    for (impl = impl_first; impl <= impl_last; impl++)
+    {
+        if (!CRC_Select16((UINT8)impl))
+        {
+            fprintf(stderr, "%-6s not available\n", bench_impl_name[impl]);
+            continue;
+        }
+        for (i = 0; i < (int)(sizeof(bench_len) / sizeof(bench_len[0])); i++)
+        {
+            int len = one_len ? one_len : bench_len[i];
+
+            bench_run(len, ms, &ns, &cycles);
+            if (out == BENCH_OUT_CSV)
+                printf("%s,%d,%.1f,%.1f,%.3f\n", bench_impl_name[impl], len, ns, len * 1e3 / ns, cycles);
+            else
+                printf("%-6s %5d %10.1f %10.1f %9.3f\n", bench_impl_name[impl], len, ns, len * 1e3 / ns, cycles);
+            if (one_len)
+                break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,227 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      crc_test.c
+ *
+ *  Description:   Checks every CRC-16 implementation of the stack against the
+ *                 FCS that l2c_fcr_tx_get_fcs() and l2c_fcr_rx_get_fcs() used
+ *                 to compute one byte at a time, and the CRC-8 against the
+ *                 RFCOMM FCS
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bt_target.h"
+#include "bt_types.h"
+#include "l2cdefs.h"
+#include "crc_api.h"
+
+/************************************************************************************
+**  Constants & Macros
+************************************************************************************/
+
+#define TEST_MAX_LEN        2100    /* more than the largest ERTM PDU on a 1021 byte MPS */
+#define TEST_MAX_ALIGN      16
+#define TEST_FRAMES         20000
+#define TEST_MAX_OFFSET     13      /* L2CAP_MIN_OFFSET, room for the HCI and L2CAP headers */
+
+/************************************************************************************
+**  Static variables
+************************************************************************************/
+
+static const char *test_impl_name[CRC_IMPL_MAX] = { "byte", "slice8", "pclmul" };
+
+static UINT16 ref_table[256];
+static UINT8  test_data[TEST_MAX_LEN + TEST_MAX_ALIGN];
+static UINT8  test_buf[sizeof(BT_HDR) + TEST_MAX_OFFSET + TEST_MAX_LEN + L2CAP_FCS_LEN];
+
+/************************************************************************************
+**  Reference
+************************************************************************************/
+
+/* the table the byte code used, built bit by bit from the polynomial */
+static void ref_init(void)
+{
+    int b, i;
+    UINT16 crc;
+
+    for (b = 0; b < 256; b++)
+    {
+        crc = (UINT16)b;
+        for (i = 0; i < 8; i++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+        ref_table[b] = crc;
+    }
+}
+
+/* l2c_fcr_updcrc() as l2c_fcr_tx_get_fcs() and l2c_fcr_rx_get_fcs() called it */
+static UINT16 ref_updcrc(UINT16 crc, const UINT8 *p, int cnt)
+{
+    while (cnt--)
+        crc = ((crc >> 8) & 0xff) ^ ref_table[(crc & 0xff) ^ *p++];
+    return crc;
+}
+
+/* rfc_calc_fcs() */
+static UINT8 ref_fcs8(const UINT8 *p, int len)
+{
+    UINT8 fcs = 0xFF;
+    int i;
+
+    while (len--)
+    {
+        fcs ^= *p++;
+        for (i = 0; i < 8; i++)
+            fcs = (fcs & 1) ? (fcs >> 1) ^ 0xE0 : (fcs >> 1);
+    }
+    return (UINT8)(0xFF - fcs);
+}
+
+/************************************************************************************
+**  Checks
+************************************************************************************/
+
+/* every length and alignment, from any register value, and split in two calls */
+static int check_lengths(UINT8 impl)
+{
+    int len, align, cut, bad = 0;
+    UINT16 init, ref, crc;
+
+    for (len = 0; len <= TEST_MAX_LEN; len++)
+    {
+        for (align = 0; align < TEST_MAX_ALIGN; align++)
+        {
+            const UINT8 *p = test_data + align;
+
+            init = (UINT16)rand();
+            ref = ref_updcrc(init, p, len);
+            crc = CRC_Update16(init, p, len);
+            cut = len ? rand() % len : 0;
+            if ((crc != ref) || (CRC_Update16(CRC_Update16(init, p, cut), p + cut, len - cut) != ref))
+            {
+                if (bad++ < 10)
+                    printf("%-6s MISMATCH len %d, align %d, init 0x%04x: 0x%04x instead of 0x%04x\n",
+                           test_impl_name[impl], len, align, init, crc, ref);
+            }
+        }
+    }
+    return bad;
+}
+
+/* I-frames laid out as L2CAP builds and receives them */
+static int check_frames(UINT8 impl)
+{
+    BT_HDR *p_buf = (BT_HDR *)test_buf;
+    int n, i, bad = 0;
+    UINT8 *p, *p_fcs;
+    UINT16 len, ref_tx, ref_rx, tx, rx;
+
+    for (n = 0; n < TEST_FRAMES; n++)
+    {
+        /* header, control word, SDU length of a start segment, payload */
+        len = (UINT16)(rand() % (TEST_MAX_LEN - L2CAP_PKT_OVERHEAD));
+        p_buf->offset = (UINT16)(rand() % (TEST_MAX_OFFSET - L2CAP_PKT_OVERHEAD + 1));
+        p_buf->len = (UINT16)(L2CAP_PKT_OVERHEAD + len);
+        p = (UINT8 *)(p_buf + 1) + p_buf->offset;
+        UINT16_TO_STREAM(p, len + L2CAP_FCS_LEN);
+        UINT16_TO_STREAM(p, 0x0040 + (n & 0x3f));
+        for (i = 0; i < len; i++)
+            *p++ = (UINT8)rand();
+
+        /* what l2c_fcr_tx_get_fcs() computes */
+        p = (UINT8 *)(p_buf + 1) + p_buf->offset;
+        ref_tx = ref_updcrc(L2CAP_FCR_INIT_CRC, p, p_buf->len);
+        tx = CRC_Update16(L2CAP_FCR_INIT_CRC, p, p_buf->len);
+        p_fcs = p + p_buf->len;
+        UINT16_TO_STREAM(p_fcs, tx);
+
+        /* what l2c_fcr_rx_get_fcs() computes: offset past the header, FCS stripped */
+        p_buf->offset += L2CAP_PKT_OVERHEAD;
+        p_buf->len    -= L2CAP_PKT_OVERHEAD;
+        p = (UINT8 *)(p_buf + 1) + p_buf->offset - L2CAP_PKT_OVERHEAD;
+        ref_rx = ref_updcrc(L2CAP_FCR_INIT_CRC, p, p_buf->len + L2CAP_PKT_OVERHEAD);
+        rx = CRC_Update16(L2CAP_FCR_INIT_CRC, p, p_buf->len + L2CAP_PKT_OVERHEAD);
+
+        /* the CRC of a frame followed by its FCS is 0 */
+        if ((tx != ref_tx) || (rx != ref_rx) || (rx != tx) ||
+            (CRC_Update16(L2CAP_FCR_INIT_CRC, p, p_buf->len + L2CAP_PKT_OVERHEAD + L2CAP_FCS_LEN) != 0))
+        {
+            if (bad++ < 10)
+                printf("%-6s MISMATCH frame of %d bytes: tx 0x%04x/0x%04x, rx 0x%04x/0x%04x\n",
+                       test_impl_name[impl], p_buf->len + L2CAP_PKT_OVERHEAD, tx, ref_tx, rx, ref_rx);
+        }
+    }
+    return bad;
+}
+
+/* the RFCOMM FCS covers the address, control and, for UIH frames, no length */
+static int check_fcs8(void)
+{
+    int len, n, bad = 0;
+    UINT8 fcs, res;
+
+    for (n = 0; n < TEST_FRAMES; n++)
+    {
+        len = 2 + (n & 1);
+        fcs = (UINT8)(0xFF - CRC_Update8(0xFF, test_data + (n % TEST_MAX_LEN), len));
+        res = CRC_Update8(CRC_Update8(0xFF, test_data + (n % TEST_MAX_LEN), len), &fcs, 1);
+        if ((fcs != ref_fcs8(test_data + (n % TEST_MAX_LEN), len)) || (res != 0xCF))
+            bad++;
+    }
+    printf("fcs8   %d frames, %d mismatches\n", TEST_FRAMES, bad);
+    return bad;
+}
+
+/************************************************************************************
+**  Main
+************************************************************************************/
+
+int main(int argc, char **argv)
+{
+    int i, bad, failures = 0;
+    UINT8 impl;
+
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+    ref_init();
+    for (i = 0; i < (int)sizeof(test_data); i++)
+        test_data[i] = (UINT8)rand();
+
+    CRC_Init();
+
+    for (impl = CRC_IMPL_BYTE; impl < CRC_IMPL_MAX; impl++)
+    {
+        if (!CRC_Select16(impl))
+        {
+            printf("%-6s not available\n", test_impl_name[impl]);
+            continue;
+        }
+        bad = check_lengths(impl) + check_frames(impl);
+        printf("%-6s %d lengths, %d frames, %d mismatches\n",
+               test_impl_name[impl], TEST_MAX_LEN + 1, TEST_FRAMES, bad);
+        failures += bad;
+    }
+    failures += check_fcs8();
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,52 @@
+LOCAL_PATH:= $(call my-dir)
+
+gattc_disc_test_SRC_FILES := ../../bta/gatt/bta_gattc_cache.c \
+        ../../bta/gatt/bta_gattc_utils.c \
+        ../../bta/sys/bd.c
+
+gattc_disc_test_C_INCLUDES := . \
+        $(LOCAL_PATH)/../../include \
+        $(LOCAL_PATH)/../../stack/include \
+        $(LOCAL_PATH)/../../bta/include \
+        $(LOCAL_PATH)/../../bta/sys \
+        $(LOCAL_PATH)/../../bta/gatt \
+        $(LOCAL_PATH)/../../gki/common \
+        $(LOCAL_PATH)/../../gki/ulinux \
+        $(bdroid_C_INCLUDES)
+
+# the GKI, GATT and SDP calls are stubbed in the test
+gattc_disc_test_CFLAGS := -DBUILDCFG $(bdroid_CFLAGS) -DBT_USE_TRACES=FALSE \
+        -DBLE_INCLUDED=TRUE -DBTA_GATT_INCLUDED=TRUE
+
+# Discovery cache and round trips, on the device
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= gattc_disc_test.c $(gattc_disc_test_SRC_FILES)
+LOCAL_C_INCLUDES += $(gattc_disc_test_C_INCLUDES)
+
+LOCAL_CFLAGS += $(gattc_disc_test_CFLAGS)
+LOCAL_MODULE_PATH := $(TARGET_OUT_EXECUTABLES)
+LOCAL_MODULE_TAGS := debug optional
+
+LOCAL_MODULE:= gattc_disc_test
+
+include $(BUILD_EXECUTABLE)
+
+# Discovery cache and round trips, on the build host
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= gattc_disc_test.c $(gattc_disc_test_SRC_FILES)
+LOCAL_C_INCLUDES += $(gattc_disc_test_C_INCLUDES)
+
+LOCAL_CFLAGS += -O2 $(gattc_disc_test_CFLAGS)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_MODULE:= gattc_disc_test
+
+include $(BUILD_HOST_EXECUTABLE)
+
+gattc_disc_test_SRC_FILES :=
+gattc_disc_test_C_INCLUDES :=
+gattc_disc_test_CFLAGS :=
@@ -0,0 +1,523 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      gattc_disc_test.c
+ *
+ *  Description:   Runs the GATT client discovery of bta_gattc_cache.c against
+ *                 random server databases, checks the cache it builds and
+ *                 counts the ATT request/response round trips it takes
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bt_target.h"
+#include "bt_types.h"
+#include "gki.h"
+#include "gatt_api.h"
+#include "sdp_api.h"
+#include "bta_gattc_int.h"
+
+/************************************************************************************
+**  Constants & Macros
+************************************************************************************/
+
+#define TEST_MAX_ATTR       2000
+#define TEST_DATABASES      300
+#define TEST_CONN_ID        1
+
+/* server attribute types */
+#define TEST_ATTR_SRVC      0
+#define TEST_ATTR_CHAR      1   /* characteristic declaration */
+#define TEST_ATTR_VALUE     2   /* characteristic value */
+#define TEST_ATTR_DESCR     3
+#define TEST_ATTR_INCL      4   /* include declaration */
+
+/************************************************************************************
+**  Local type definitions
+************************************************************************************/
+
+typedef struct
+{
+    UINT8   type;
+    UINT16  uuid;
+    UINT16  e_handle;   /* service end, or end of the included service */
+    UINT16  val_handle; /* characteristic value, or start of the included service */
+} tTEST_ATTR;
+
+/* GKI buffer stand-in */
+typedef struct test_buf
+{
+    struct test_buf *p_next;
+    UINT16          size;
+} tTEST_BUF;
+
+/************************************************************************************
+**  Static variables
+************************************************************************************/
+
+static tTEST_ATTR test_db[TEST_MAX_ATTR + 1];
+static int test_num_attr;
+static int test_mtu;
+
+static BOOLEAN test_pending;
+static tGATT_DISC_TYPE test_disc_type;
+static tGATT_DISC_PARAM test_disc_param;
+static int test_round_trips;
+static int test_done;           /* 1 discovery complete, 2 aborted */
+
+static tBTA_GATTC_SERV test_srvc;
+
+/************************************************************************************
+**  Stack stubs
+************************************************************************************/
+
+tBTA_GATTC_CB bta_gattc_cb;
+
+void *GKI_getbuf(UINT16 size)
+{
+    tTEST_BUF *p = (tTEST_BUF *)calloc(1, sizeof(tTEST_BUF) + size);
+
+    if (p == NULL)
+        return NULL;
+    p->size = size;
+    return p + 1;
+}
+
+void *GKI_getpoolbuf(UINT8 pool_id)
+{
+    return GKI_getbuf(GKI_BUF3_SIZE);
+}
+
+void GKI_freebuf(void *p_buf)
+{
+    if (p_buf)
+        free((tTEST_BUF *)p_buf - 1);
+}
+
+UINT16 GKI_get_buf_size(void *p_buf)
+{
+    return ((tTEST_BUF *)p_buf - 1)->size;
+}
+
+void GKI_enqueue(BUFFER_Q *p_q, void *p_buf)
+{
+    ((tTEST_BUF *)p_buf - 1)->p_next = NULL;
+    if (p_q->p_last)
+        ((tTEST_BUF *)p_q->p_last - 1)->p_next = p_buf;
+    else
+        p_q->p_first = p_buf;
+    p_q->p_last = p_buf;
+    p_q->count++;
+}
+
+void *GKI_dequeue(BUFFER_Q *p_q)
+{
+    tTEST_BUF *p_hdr;
+    void *p_buf = p_q->p_first;
+
+    if (p_buf == NULL)
+        return NULL;
+    p_hdr = (tTEST_BUF *)p_buf - 1;
+    p_q->p_first = p_hdr->p_next ? p_hdr->p_next + 1 : NULL;
+    if (p_q->p_first == NULL)
+        p_q->p_last = NULL;
+    p_q->count--;
+    return p_buf;
+}
+
+void *GKI_os_malloc(UINT32 size)
+{
+    return malloc(size);
+}
+
+void GKI_os_free(void *p_mem)
+{
+    free(p_mem);
+}
+
+void GKI_sched_lock(void)
+{
+}
+
+void GKI_sched_unlock(void)
+{
+}
+
+void utl_freebuf(void **p)
+{
+    if (*p != NULL)
+    {
+        GKI_freebuf(*p);
+        *p = NULL;
+    }
+}
+
+BOOLEAN BTM_IsBleLink(BD_ADDR bd_addr)
+{
+    return TRUE;
+}
+
+BOOLEAN GATT_GetConnectionInfor(UINT16 conn_id, tGATT_IF *p_gatt_if, BD_ADDR bd_addr)
+{
+    return FALSE;
+}
+
+/* discovery over BR/EDR is not exercised */
+BOOLEAN SDP_InitDiscoveryDb(tSDP_DISCOVERY_DB *p_db, UINT32 len, UINT16 num_uuid,
+                            tSDP_UUID *p_uuid_list, UINT16 num_attr, UINT16 *p_attr_list)
+{
+    return FALSE;
+}
+
+BOOLEAN SDP_ServiceSearchAttributeRequest(UINT8 *p_bd_addr, tSDP_DISCOVERY_DB *p_db,
+                                          tSDP_DISC_CMPL_CB *p_cb)
+{
+    return FALSE;
+}
+
+tSDP_DISC_REC *SDP_FindServiceInDb(tSDP_DISCOVERY_DB *p_db, UINT16 service_uuid,
+                                   tSDP_DISC_REC *p_start_rec)
+{
+    return NULL;
+}
+
+BOOLEAN SDP_FindServiceUUIDInRec(tSDP_DISC_REC *p_rec, tBT_UUID *p_uuid)
+{
+    return FALSE;
+}
+
+BOOLEAN SDP_FindProtocolListElemInRec(tSDP_DISC_REC *p_rec, UINT16 layer_uuid,
+                                      tSDP_PROTOCOL_ELEM *p_elem)
+{
+    return FALSE;
+}
+
+void bta_gattc_co_cache_open(BD_ADDR server_bda, UINT16 evt, UINT16 conn_id, BOOLEAN to_save)
+{
+    test_done = 1;
+}
+
+void bta_gattc_co_cache_save(BD_ADDR server_bda, UINT16 evt, UINT16 num_attr,
+                             tBTA_GATTC_NV_ATTR *p_attr_list, UINT16 attr_index, UINT16 conn_id)
+{
+}
+
+void bta_gattc_sm_execute(tBTA_GATTC_CLCB *p_clcb, UINT16 event, tBTA_GATTC_DATA *p_data)
+{
+    test_done = 2;
+}
+
+/************************************************************************************
+**  Server
+************************************************************************************/
+
+tGATT_STATUS GATTC_Discover(UINT16 conn_id, tGATT_DISC_TYPE disc_type, tGATT_DISC_PARAM *p_param)
+{
+    test_pending = TRUE;
+    test_disc_type = disc_type;
+    test_disc_param = *p_param;
+    return GATT_SUCCESS;
+}
+
+static tBT_UUID test_uuid16(UINT16 uuid)
+{
+    tBT_UUID u;
+
+    memset(&u, 0, sizeof(u));
+    u.len = LEN_UUID_16;
+    u.uu.uuid16 = uuid;
+    return u;
+}
+
+/* answer the pending request, one response per MTU worth of 16 bit UUID entries */
+static void test_serve(void)
+{
+    tGATT_DISC_RES res;
+    tTEST_ATTR *p_a;
+    int h, n = 0, per_rsp;
+
+    switch (test_disc_type)
+    {
+    case GATT_DISC_CHAR_DSCPT:  per_rsp = (test_mtu - 2) / 4; break;   /* Find Information */
+    case GATT_DISC_CHAR:        per_rsp = (test_mtu - 2) / 7; break;   /* Read By Type */
+    default:                    per_rsp = (test_mtu - 2) / 6; break;   /* Read By Group Type */
+    }
+
+    test_pending = FALSE;
+    for (h = test_disc_param.s_handle; h <= test_disc_param.e_handle && h <= test_num_attr; h++)
+    {
+        p_a = &test_db[h];
+        memset(&res, 0, sizeof(res));
+        res.handle = h;
+
+        if (test_disc_type == GATT_DISC_SRVC_ALL && p_a->type == TEST_ATTR_SRVC)
+        {
+            res.value.group_value.e_handle = p_a->e_handle;
+            res.value.group_value.service_type = test_uuid16(p_a->uuid);
+        }
+        else if (test_disc_type == GATT_DISC_CHAR && p_a->type == TEST_ATTR_CHAR)
+        {
+            res.value.dclr_value.val_handle = p_a->val_handle;
+            res.value.dclr_value.char_uuid = test_uuid16(p_a->uuid);
+            res.value.dclr_value.char_prop = GATT_CHAR_PROP_BIT_READ;
+        }
+        else if (test_disc_type == GATT_DISC_INC_SRVC && p_a->type == TEST_ATTR_INCL)
+        {
+            res.value.incl_service.s_handle = p_a->val_handle;
+            res.value.incl_service.e_handle = p_a->e_handle;
+            res.value.incl_service.service_type = test_uuid16(p_a->uuid);
+        }
+        else if (test_disc_type == GATT_DISC_CHAR_DSCPT)
+        {
+            switch (p_a->type)
+            {
+            case TEST_ATTR_SRVC:    res.type = test_uuid16(GATT_UUID_PRI_SERVICE); break;
+            case TEST_ATTR_CHAR:    res.type = test_uuid16(GATT_UUID_CHAR_DECLARE); break;
+            case TEST_ATTR_INCL:    res.type = test_uuid16(GATT_UUID_INCLUDE_SERVICE); break;
+            default:                res.type = test_uuid16(p_a->uuid); break;
+            }
+        }
+        else
+            continue;
+
+        if (n++ % per_rsp == 0)
+            test_round_trips++;
+        bta_gattc_disc_res_cback(TEST_CONN_ID, test_disc_type, &res);
+    }
+    /* Attribute Not Found, or the request that finds the end of the range */
+    if (n == 0 || h <= test_disc_param.e_handle)
+        test_round_trips++;
+
+    bta_gattc_disc_cmpl_cback(TEST_CONN_ID, test_disc_type, GATT_SUCCESS);
+}
+
+/* up to 8 primary services, some including the one before, with up to 6
+** characteristics of up to 2 descriptors each. The bounds are drawn again on
+** every pass, which favours small services and short characteristics.
+*/
+static void test_build_db(void)
+{
+    int s, c, d, sh, ch, k;
+
+    test_num_attr = 0;
+    for (s = 0; s < 1 + rand() % 8; s++)
+    {
+        sh = ++test_num_attr;
+        test_db[sh].type = TEST_ATTR_SRVC;
+        test_db[sh].uuid = 0x1800 + rand() % 4;
+
+        if (s > 0 && rand() % 4 == 0)
+        {
+            for (k = sh - 1; test_db[k].type != TEST_ATTR_SRVC; k--)
+                ;
+            ++test_num_attr;
+            test_db[test_num_attr].type = TEST_ATTR_INCL;
+            test_db[test_num_attr].val_handle = k;
+            test_db[test_num_attr].e_handle = test_db[k].e_handle;
+            test_db[test_num_attr].uuid = test_db[k].uuid;
+        }
+
+        for (c = 0; c < rand() % 7; c++)
+        {
+            ch = ++test_num_attr;
+            test_db[ch].type = TEST_ATTR_CHAR;
+            test_db[ch].uuid = 0x2a00 + rand() % 5;
+            test_db[ch].val_handle = ch + 1;
+
+            ++test_num_attr;
+            test_db[test_num_attr].type = TEST_ATTR_VALUE;
+            test_db[test_num_attr].uuid = test_db[ch].uuid;
+
+            for (d = 0; d < rand() % 3; d++)
+            {
+                ++test_num_attr;
+                test_db[test_num_attr].type = TEST_ATTR_DESCR;
+                test_db[test_num_attr].uuid = 0x2900 + rand() % 3;
+            }
+        }
+        test_db[sh].e_handle = test_num_attr;
+    }
+}
+
+/************************************************************************************
+**  Checks
+************************************************************************************/
+
+/* the cache holds every service, include, characteristic and descriptor of the
+** database in handle order, with its UUID and instance id
+*/
+static int test_check_cache(void)
+{
+    tBTA_GATTC_CACHE *p_cache = test_srvc.p_srvc_cache;
+    tBTA_GATTC_CACHE_ATTR *p_attr = NULL;
+    tBT_UUID uuid;
+    int h, k, inst;
+    UINT16 handle;
+    UINT8 attr_type;
+
+    for (h = 1; h <= test_num_attr; h++)
+    {
+        tTEST_ATTR *p_a = &test_db[h];
+
+        if (p_a->type == TEST_ATTR_SRVC)
+        {
+            for (k = 1, inst = 0; k < h; k++)
+                if (test_db[k].type == TEST_ATTR_SRVC && test_db[k].uuid == p_a->uuid)
+                    inst++;
+
+            if (p_attr != NULL || p_cache == NULL ||
+                p_cache->s_handle != h || p_cache->e_handle != p_a->e_handle ||
+                p_cache->service_uuid.id.uuid.len != LEN_UUID_16 ||
+                p_cache->service_uuid.id.uuid.uu.uuid16 != p_a->uuid ||
+                p_cache->service_uuid.id.inst_id != inst ||
+                !p_cache->service_uuid.is_primary)
+                return 0;
+
+            p_attr = p_cache->p_attr;
+            p_cache = p_cache->p_next;
+            continue;
+        }
+
+        switch (p_a->type)
+        {
+        case TEST_ATTR_INCL:  attr_type = BTA_GATTC_ATTR_TYPE_INCL_SRVC; handle = h; break;
+        case TEST_ATTR_CHAR:  attr_type = BTA_GATTC_ATTR_TYPE_CHAR; handle = p_a->val_handle; break;
+        case TEST_ATTR_DESCR: attr_type = BTA_GATTC_ATTR_TYPE_CHAR_DESCR; handle = h; break;
+        default:              continue;
+        }
+
+        if (p_attr == NULL || p_attr->attr_type != attr_type || p_attr->attr_handle != handle)
+            return 0;
+
+        bta_gattc_pack_attr_uuid(p_attr, &uuid);
+        if (uuid.len != LEN_UUID_16 || uuid.uu.uuid16 != p_a->uuid)
+            return 0;
+
+        if (p_a->type == TEST_ATTR_CHAR)
+        {
+            /* counted within the service */
+            for (k = h - 1, inst = 0; test_db[k].type != TEST_ATTR_SRVC; k--)
+                if (test_db[k].type == TEST_ATTR_CHAR && test_db[k].uuid == p_a->uuid)
+                    inst++;
+            if (p_attr->inst_id != inst)
+                return 0;
+        }
+        p_attr = p_attr->p_next;
+    }
+    return p_attr == NULL && p_cache == NULL;
+}
+
+static void test_init_srvc(void)
+{
+    tBTA_GATTC_CLCB *p_clcb = &bta_gattc_cb.clcb[0];
+
+    while (test_srvc.cache_buffer.p_first)
+        GKI_freebuf(GKI_dequeue(&test_srvc.cache_buffer));
+    utl_freebuf((void **)&test_srvc.p_srvc_list);
+
+    memset(&test_srvc, 0, sizeof(test_srvc));
+    test_srvc.in_use = TRUE;
+
+    memset(p_clcb, 0, sizeof(*p_clcb));
+    p_clcb->in_use = TRUE;
+    p_clcb->bta_conn_id = TEST_CONN_ID;
+    p_clcb->p_srcb = &test_srvc;
+    p_clcb->state = BTA_GATTC_DISCOVER_ST;
+}
+
+/* discover every database once, returns the number of bad caches */
+static int test_run(int seed, int num_db, int *p_attrs)
+{
+    int i, bad = 0;
+
+    test_round_trips = 0;
+    *p_attrs = 0;
+    for (i = 0; i < num_db; i++)
+    {
+        srand(seed + i);
+        test_build_db();
+        *p_attrs += test_num_attr;
+
+        test_init_srvc();
+        test_done = 0;
+        test_pending = FALSE;
+        if (bta_gattc_init_cache(&test_srvc) != BTA_GATT_OK ||
+            bta_gattc_discover_pri_service(TEST_CONN_ID, &test_srvc, GATT_DISC_SRVC_ALL) != BTA_GATT_OK)
+        {
+            bad++;
+            continue;
+        }
+        while (test_pending && !test_done)
+            test_serve();
+
+        if (test_done != 1 || !test_check_cache())
+        {
+            printf("database %d: bad cache\n", seed + i);
+            bad++;
+        }
+    }
+    return bad;
+}
+
+/************************************************************************************
+**  Main
+************************************************************************************/
+
+int main(int argc, char **argv)
+{
+    static const int mtus[] = { GATT_DEF_BLE_MTU_SIZE, 185 };
+    int seed = 1, num_db = TEST_DATABASES, mtu = 0;
+    int i, c, bad = 0, attrs;
+
+    while ((c = getopt(argc, argv, "m:n:s:")) != -1)
+    {
+        switch (c)
+        {
+        case 'm': mtu = atoi(optarg); break;
+        case 'n': num_db = atoi(optarg); break;
+        case 's': seed = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-m mtu] [-n databases] [-s seed]\n", argv[0]);
+            return 2;
+        }
+    }
+    if ((mtu != 0 && mtu < GATT_DEF_BLE_MTU_SIZE) || num_db <= 0)
+    {
+        fprintf(stderr, "%s: bad MTU or number of databases\n", argv[0]);
+        return 2;
+    }
+
+    for (i = 0; i < (int)(sizeof(mtus) / sizeof(mtus[0])); i++)
+    {
+        test_mtu = mtu ? mtu : mtus[i];
+        bad += test_run(seed, num_db, &attrs);
+        printf("mtu %3d  %d databases, %d attributes, %d round trips\n",
+               test_mtu, num_db, attrs, test_round_trips);
+        if (mtu)
+            break;
+    }
+
+    printf("%s\n", bad ? "FAIL" : "PASS");
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+LOCAL_PATH:= $(call my-dir)
+
+sbcenc_test_SRC_FILES := sbcenc_common.c \
+        ../../embdrv/sbc/encoder/srce/sbc_analysis.c \
+        ../../embdrv/sbc/encoder/srce/sbc_dct.c \
+        ../../embdrv/sbc/encoder/srce/sbc_dct_coeffs.c \
+        ../../embdrv/sbc/encoder/srce/sbc_enc_bit_alloc_mono.c \
+        ../../embdrv/sbc/encoder/srce/sbc_enc_bit_alloc_ste.c \
+        ../../embdrv/sbc/encoder/srce/sbc_enc_coeffs.c \
+        ../../embdrv/sbc/encoder/srce/sbc_enc_simd.c \
+        ../../embdrv/sbc/encoder/srce/sbc_encoder.c \
+        ../../embdrv/sbc/encoder/srce/sbc_packing.c
+
+sbcenc_test_C_INCLUDES := . \
+        $(LOCAL_PATH)/../../embdrv/sbc/encoder/include \
+        $(LOCAL_PATH)/../../include \
+        $(LOCAL_PATH)/../../stack/include \
+        $(LOCAL_PATH)/../../gki/common \
+        $(LOCAL_PATH)/../../gki/ulinux \
+        $(bdroid_C_INCLUDES)
+
+# SIMD kernels against the C implementation
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= sbcenc_simd_test.c $(sbcenc_test_SRC_FILES)
+LOCAL_C_INCLUDES += $(sbcenc_test_C_INCLUDES)
+
+# the NEON kernels are off in the stack until this test passes on the target
+LOCAL_CFLAGS += -DBUILDCFG $(bdroid_CFLAGS) -DSBC_SIMD_NEON_OPT=TRUE
+LOCAL_MODULE_PATH := $(TARGET_OUT_EXECUTABLES)
+LOCAL_MODULE_TAGS := debug optional
+
+LOCAL_MODULE:= sbcenc_simd_test
+
+LOCAL_LDLIBS += -lm
+
+include $(BUILD_EXECUTABLE)
+
+# Encoder throughput, on the device
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= sbcenc_bench.c $(sbcenc_test_SRC_FILES)
+LOCAL_C_INCLUDES += $(sbcenc_test_C_INCLUDES)
+
+LOCAL_CFLAGS += -DBUILDCFG $(bdroid_CFLAGS) -DSBC_SIMD_NEON_OPT=TRUE
+LOCAL_MODULE_PATH := $(TARGET_OUT_EXECUTABLES)
+LOCAL_MODULE_TAGS := debug optional
+
+LOCAL_MODULE:= sbcenc_bench
+
+LOCAL_LDLIBS += -lm
+
+include $(BUILD_EXECUTABLE)
+
+# Encoder throughput, on the build host
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= sbcenc_bench.c $(sbcenc_test_SRC_FILES)
+LOCAL_C_INCLUDES += $(sbcenc_test_C_INCLUDES)
+
+LOCAL_CFLAGS += -O2 -DBUILDCFG $(bdroid_CFLAGS)
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_MODULE:= sbcenc_bench
+
+LOCAL_LDLIBS += -lm -lrt
+
+include $(BUILD_HOST_EXECUTABLE)
+
+sbcenc_test_SRC_FILES :=
+sbcenc_test_C_INCLUDES :=
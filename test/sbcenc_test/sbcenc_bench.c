@@ -0,0 +1,466 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      sbcenc_bench.c
+ *
+ *  Description:   Throughput benchmark of the SBC encoder on its own, outside of
+ *                 the media task
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "sbc_encoder.h"
+#include "sbc_enc_func_declare.h"
+#include "sbcenc_common.h"
+
+/************************************************************************************
+**  Constants & Macros
+************************************************************************************/
+
+#define BENCH_MAX_PACKET_LEN    1024
+#define BENCH_DEFAULT_MS        100     /* minimum measured time per configuration */
+#define BENCH_WARMUP_FRAMES     64
+#define BENCH_MAX_BATCH         15      /* frames per SBC_Encoder() call, as in one AVDTP packet */
+
+#define BENCH_LEVEL_C           0
+#define BENCH_LEVEL_NUM         4       /* C, SSE2, AVX2, NEON */
+
+/* output formats */
+#define BENCH_OUT_TEXT          0
+#define BENCH_OUT_CSV           1
+#define BENCH_OUT_JSON          2
+
+/* sources of the cycle count */
+#define BENCH_CYCLES_NONE       0
+#define BENCH_CYCLES_PERF       1       /* core cycles of this thread */
+#define BENCH_CYCLES_TSC        2       /* time stamp counter, reference cycles */
+
+typedef struct
+{
+    SINT16  sub_bands;
+    SINT16  blocks;
+    SINT16  mode;
+    SINT16  alloc;
+    SINT16  bitpool;
+} tBENCH_CFG;
+
+typedef struct
+{
+    UINT32  frames;             /* frames encoded in the measured passes */
+    UINT32  samples_per_frame;  /* PCM samples of all channels in one frame */
+    UINT16  packet_len;
+    double  ns;                 /* measured time */
+    double  best_ns_per_frame;  /* fastest pass */
+    double  cycles;
+} tBENCH_RESULT;
+
+/************************************************************************************
+**  Static variables
+************************************************************************************/
+
+static const char *bench_level_name[BENCH_LEVEL_NUM] = { "C", "SSE2", "AVX2", "NEON" };
+static const char *bench_mode_name[] = { "mono", "dual", "stereo", "joint" };
+static const char *bench_cycles_name[] = { "none", "perf", "tsc" };
+
+static int bench_cycles_src = BENCH_CYCLES_NONE;
+static int bench_perf_fd = -1;
+static int bench_out = BENCH_OUT_TEXT;
+static int bench_batch = 0;             /* 0: copy each frame into as16PcmBuffer */
+
+/************************************************************************************
+**  Clocks
+************************************************************************************/
+
+static UINT64 now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000000000ULL + (UINT64)ts.tv_nsec;
+}
+
+/* Prefers the core cycle counter of the kernel, which follows frequency scaling. The
+** TSC ticks at a fixed rate and is only used when perf events are not permitted. */
+static void cycles_init(void)
+{
+#if defined(__linux__) && defined(__NR_perf_event_open)
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    bench_perf_fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (bench_perf_fd >= 0)
+    {
+        ioctl(bench_perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+        bench_cycles_src = BENCH_CYCLES_PERF;
+        return;
+    }
+#endif
+#if defined(__i386__) || defined(__x86_64__)
+    bench_cycles_src = BENCH_CYCLES_TSC;
+#endif
+}
+
+static UINT64 cycles_read(void)
+{
+#if defined(__linux__)
+    UINT64 count;
+
+    if (bench_cycles_src == BENCH_CYCLES_PERF)
+        return (read(bench_perf_fd, &count, sizeof(count)) == sizeof(count)) ? count : 0;
+#endif
+#if defined(__i386__) || defined(__x86_64__)
+    if (bench_cycles_src == BENCH_CYCLES_TSC)
+        return __rdtsc();
+#endif
+    return 0;
+}
+
+/************************************************************************************
+**  Benchmark
+************************************************************************************/
+
+static BOOLEAN level_select(int level)
+{
+#if (SBC_SIMD_OPT == TRUE)
+    return SbcEncSimdSelect((UINT8)level);
+#else
+    return (level == BENCH_LEVEL_C);
+#endif
+}
+
+/* encodes frame f of the corpus, or bench_batch frames from f on */
+static void bench_encode(SBC_ENC_PARAMS *p_enc, UINT8 *p_packet, int f, int n)
+{
+    p_enc->pu8Packet = p_packet;
+    if (bench_batch)
+    {
+        p_enc->ps16PcmBuffer = sbcenc_pcm + f * n;
+        p_enc->u8NumPacketToEncode = (UINT8)bench_batch;
+    }
+    else
+    {
+        memcpy(p_enc->as16PcmBuffer, sbcenc_pcm + f * n, n * sizeof(SINT16));
+    }
+    SBC_Encoder(p_enc);
+}
+
+/*******************************************************************************
+**
+** Function         bench_run
+**
+** Description      Encodes the whole corpus with one configuration over and over
+**                  until min_ns have been measured. By default each frame is
+**                  copied into as16PcmBuffer and the copy is timed with the
+**                  encoder; with bench_batch frames are encoded bench_batch at
+**                  a time straight from the corpus through ps16PcmBuffer, as
+**                  the media task does.
+**
+** Returns          void, p_res->frames is 0 if the input is shorter than a frame
+**
+*******************************************************************************/
+static void bench_run(const tBENCH_CFG *p_cfg, UINT64 min_ns, tBENCH_RESULT *p_res)
+{
+    static SBC_ENC_PARAMS enc;
+    static UINT8 packet[BENCH_MAX_BATCH * BENCH_MAX_PACKET_LEN];
+    UINT64 t0, c0, dt;
+    int n, f, frames, batch;
+
+    memset(&enc, 0, sizeof(enc));
+    enc.s16SamplingFreq     = SBC_sf44100;
+    enc.s16ChannelMode      = p_cfg->mode;
+    enc.s16NumOfSubBands    = p_cfg->sub_bands;
+    enc.s16NumOfBlocks      = p_cfg->blocks;
+    enc.s16AllocationMethod = p_cfg->alloc;
+    enc.u16BitRate          = 328;
+    SBC_Encoder_Init(&enc);
+    enc.s16BitPool = p_cfg->bitpool;
+
+    n = enc.s16NumOfChannels * enc.s16NumOfSubBands * enc.s16NumOfBlocks;
+    batch = bench_batch ? bench_batch : 1;
+    /* whole batches only, so that every pass encodes the same frames */
+    frames = (sbcenc_pcm_len / n / batch) * batch;
+
+    memset(p_res, 0, sizeof(*p_res));
+    p_res->samples_per_frame = n;
+    p_res->best_ns_per_frame = HUGE_VAL;
+    if (frames == 0)
+        return;
+
+    for (f = 0; (f < frames) && (f < BENCH_WARMUP_FRAMES); f += batch)
+        bench_encode(&enc, packet, f, n);
+
+    do
+    {
+        t0 = now_ns();
+        c0 = cycles_read();
+        for (f = 0; f < frames; f += batch)
+            bench_encode(&enc, packet, f, n);
+        p_res->cycles += (double)(cycles_read() - c0);
+        dt = now_ns() - t0;
+
+        p_res->ns += (double)dt;
+        p_res->frames += frames;
+        if ((double)dt / frames < p_res->best_ns_per_frame)
+            p_res->best_ns_per_frame = (double)dt / frames;
+    } while (p_res->ns < (double)min_ns);
+
+    p_res->packet_len = enc.u16PacketLength;
+}
+
+/************************************************************************************
+**  Report
+************************************************************************************/
+
+static void report_header(void)
+{
+    if (bench_out == BENCH_OUT_CSV)
+    {
+        printf("level,subbands,blocks,mode,alloc,bitpool,packet_len,frames,ns_per_frame,"
+               "best_ns_per_frame,frames_per_sec,cycles_per_sample,cycles_src,realtime_44k\n");
+    }
+    else if (bench_out == BENCH_OUT_TEXT)
+    {
+        printf("%-5s %2s %2s %-6s %-8s %3s %4s %9s %10s %10s %12s %9s %9s\n",
+               "level", "sb", "bl", "mode", "alloc", "bp", "len", "frames", "ns/frame",
+               "best ns", "frames/s", "cyc/smp", "realtime");
+    }
+}
+
+static void report(int level, const tBENCH_CFG *p_cfg, const tBENCH_RESULT *p_res)
+{
+    double ns_per_frame = p_res->ns / p_res->frames;
+    double fps = 1e9 / ns_per_frame;
+    double cps = p_res->cycles / ((double)p_res->frames * p_res->samples_per_frame);
+    double realtime = fps * p_cfg->blocks * p_cfg->sub_bands / SBCENC_SAMPLE_RATE;
+    const char *alloc = (p_cfg->alloc == SBC_SNR) ? "snr" : "loudness";
+
+    switch (bench_out)
+    {
+    case BENCH_OUT_CSV:
+        printf("%s,%d,%d,%s,%s,%d,%u,%u,%.1f,%.1f,%.0f,%.2f,%s,%.1f\n",
+               bench_level_name[level], p_cfg->sub_bands, p_cfg->blocks, bench_mode_name[p_cfg->mode],
+               alloc, p_cfg->bitpool, p_res->packet_len, (unsigned int)p_res->frames, ns_per_frame,
+               p_res->best_ns_per_frame, fps, cps, bench_cycles_name[bench_cycles_src], realtime);
+        break;
+
+    case BENCH_OUT_JSON:
+        printf("{\"level\":\"%s\",\"subbands\":%d,\"blocks\":%d,\"mode\":\"%s\",\"alloc\":\"%s\","
+               "\"bitpool\":%d,\"packet_len\":%u,\"frames\":%u,\"ns_per_frame\":%.1f,"
+               "\"best_ns_per_frame\":%.1f,\"frames_per_sec\":%.0f,",
+               bench_level_name[level], p_cfg->sub_bands, p_cfg->blocks, bench_mode_name[p_cfg->mode],
+               alloc, p_cfg->bitpool, p_res->packet_len, (unsigned int)p_res->frames, ns_per_frame,
+               p_res->best_ns_per_frame, fps);
+        if (bench_cycles_src == BENCH_CYCLES_NONE)
+            printf("\"cycles_per_sample\":null,");
+        else
+            printf("\"cycles_per_sample\":%.2f,", cps);
+        printf("\"cycles_src\":\"%s\",\"realtime_44k\":%.1f}\n", bench_cycles_name[bench_cycles_src], realtime);
+        break;
+
+    default:
+        printf("%-5s %2d %2d %-6s %-8s %3d %4u %9u %10.1f %10.1f %12.0f %9.2f %8.1fx\n",
+               bench_level_name[level], p_cfg->sub_bands, p_cfg->blocks, bench_mode_name[p_cfg->mode],
+               alloc, p_cfg->bitpool, p_res->packet_len, (unsigned int)p_res->frames, ns_per_frame,
+               p_res->best_ns_per_frame, fps, cps, realtime);
+        break;
+    }
+}
+
+/* one line per level; the geometric mean weighs every configuration the same */
+static void report_summary(int level, int configs, double log_sum)
+{
+    double geomean = exp(log_sum / configs);
+
+    if (bench_out == BENCH_OUT_JSON)
+        printf("{\"level\":\"%s\",\"summary\":true,\"configs\":%d,\"geomean_ns_per_frame\":%.1f}\n",
+               bench_level_name[level], configs, geomean);
+    else
+        fprintf(bench_out == BENCH_OUT_CSV ? stderr : stdout,
+                "%-5s %d configurations, geometric mean %.1f ns/frame\n",
+                bench_level_name[level], configs, geomean);
+}
+
+/************************************************************************************
+**  Main
+************************************************************************************/
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-l c|sse2|avx2|neon|all] [-s 4|8] [-b 4|8|12|16] [-m mono|dual|stereo|joint]\n"
+            "          [-a loudness|snr] [-t ms] [-o text|csv|json] [-f 1-15] [-n] [file.wav|file.raw ...]\n", name);
+}
+
+static int lookup(const char *arg, const char **names, int num)
+{
+    int i;
+
+    for (i = 0; i < num; i++)
+    {
+        if (!strcasecmp(arg, names[i]))
+            return i;
+    }
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    static const SINT16 blocks[] = { SBC_BLOCK_0, SBC_BLOCK_1, SBC_BLOCK_2, SBC_BLOCK_3 };
+    static const char *out_name[] = { "text", "csv", "json" };
+    static const char *alloc_name[] = { "loudness", "snr" };
+    tBENCH_CFG cfg;
+    tBENCH_RESULT res;
+    UINT64 min_ns = BENCH_DEFAULT_MS * 1000000ULL;
+    int level_sel = -1, sb_sel = 0, blocks_sel = 0, mode_sel = -1, alloc = SBC_LOUDNESS, synthetic = 1;
+    int opt, level, sb, b, mode, bp, configs;
+    double log_sum;
+
+    while ((opt = getopt(argc, argv, "l:s:b:m:a:t:o:f:nh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'l':
+            if (strcasecmp(optarg, "all") && (level_sel = lookup(optarg, bench_level_name, BENCH_LEVEL_NUM)) < 0)
+                goto bad_arg;
+            break;
+        case 's':
+            sb_sel = atoi(optarg);
+            if (sb_sel != SUB_BANDS_4 && sb_sel != SUB_BANDS_8)
+                goto bad_arg;
+            break;
+        case 'b':
+            blocks_sel = atoi(optarg);
+            if (blocks_sel < SBC_BLOCK_0 || blocks_sel > SBC_BLOCK_3 || (blocks_sel % 4))
+                goto bad_arg;
+            break;
+        case 'm':
+            if ((mode_sel = lookup(optarg, bench_mode_name, 4)) < 0)
+                goto bad_arg;
+            break;
+        case 'a':
+            if ((alloc = lookup(optarg, alloc_name, 2)) < 0)
+                goto bad_arg;
+            break;
+        case 't':
+            min_ns = (UINT64)atoi(optarg) * 1000000ULL;
+            break;
+        case 'o':
+            if ((bench_out = lookup(optarg, out_name, 3)) < 0)
+                goto bad_arg;
+            break;
+        case 'f':
+            bench_batch = atoi(optarg);
+            if (bench_batch < 1 || bench_batch > BENCH_MAX_BATCH)
+                goto bad_arg;
+            break;
+        case 'n':
+            synthetic = 0;
+            break;
+        default:
+            goto bad_arg;
+        }
+    }
+
+    if (sbcenc_corpus_init(synthetic, argc - optind, argv + optind) < 0)
+    {
+        fprintf(stderr, "no input\n");
+        return 1;
+    }
+    cycles_init();
+
+    fprintf(bench_out == BENCH_OUT_TEXT ? stdout : stderr,
+            "sbcenc_bench: %d samples of input, %.0f ms per configuration, cycles from %s, %s\n",
+            sbcenc_pcm_len, min_ns / 1e6, bench_cycles_name[bench_cycles_src],
+            bench_batch ? "frames encoded in place" : "frames copied");
+    if (bench_batch)
+        fprintf(bench_out == BENCH_OUT_TEXT ? stdout : stderr, "sbcenc_bench: %d frames per call\n", bench_batch);
+    report_header();
+
+    for (level = BENCH_LEVEL_C; level < BENCH_LEVEL_NUM; level++)
+    {
+        if ((level_sel >= 0) && (level != level_sel))
+            continue;
+        if (!level_select(level))
+        {
+            fprintf(bench_out == BENCH_OUT_TEXT ? stdout : stderr, "%-5s not available\n", bench_level_name[level]);
+            continue;
+        }
+        configs = 0;
+        log_sum = 0;
+
+        for (sb = SUB_BANDS_4; sb <= SUB_BANDS_8; sb += 4)
+        for (b = 0; b < 4; b++)
+        for (mode = SBC_MONO; mode <= SBC_JOINT_STEREO; mode++)
+        for (bp = 0; bp < 3; bp++)
+        {
+            int max_bp = ((mode == SBC_MONO || mode == SBC_DUAL) ? 16 : 32) * sb;
+
+            if ((sb_sel && sb != sb_sel) || (blocks_sel && blocks[b] != blocks_sel) ||
+                (mode_sel >= 0 && mode != mode_sel))
+                continue;
+
+            /* the smallest bitpool, the A2DP high quality one and the largest */
+            if (max_bp > 250)
+                max_bp = 250;
+            cfg.sub_bands = (SINT16)sb;
+            cfg.blocks    = blocks[b];
+            cfg.mode      = (SINT16)mode;
+            cfg.alloc     = (SINT16)alloc;
+            cfg.bitpool   = (SINT16)((bp == 0) ? 2 : (bp == 1) ? 53 : max_bp);
+
+            bench_run(&cfg, min_ns, &res);
+            if (res.frames == 0)
+                continue;
+            report(level, &cfg, &res);
+            configs++;
+            log_sum += log(res.ns / res.frames);
+        }
+        if (configs)
+            report_summary(level, configs, log_sum);
+    }
+
+    sbcenc_corpus_free();
+    return 0;
+
+bad_arg:
+    usage(argv[0]);
+    return 1;
+}
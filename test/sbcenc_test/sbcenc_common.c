@@ -0,0 +1,158 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      sbcenc_common.c
+ *
+ *  Description:   PCM corpus and stack stubs shared by the SBC encoder test tools
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sbcenc_common.h"
+
+#define SBCENC_MAX_SAMPLES      (SBCENC_MAX_FILE_SAMPLES + 2 * SBCENC_SIGNALS * SBCENC_SIGNAL_SAMPLES)
+
+/************************************************************************************
+**  Static variables
+************************************************************************************/
+
+SINT16 *sbcenc_pcm;
+int sbcenc_pcm_len;
+
+/************************************************************************************
+**  Stack stubs: the encoder traces through the stack's logging
+************************************************************************************/
+
+UINT8 appl_trace_level = 0;
+
+void LogMsg_2(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2)
+{
+    (void)trace_set_mask; (void)fmt_str; (void)p1; (void)p2;
+}
+
+/************************************************************************************
+**  Input corpus
+************************************************************************************/
+
+static SINT16 clip16(double v)
+{
+    if (v > 32767.0)
+        return 32767;
+    if (v < -32768.0)
+        return -32768;
+    return (SINT16)lrint(v);
+}
+
+static void append(SINT16 l, SINT16 r)
+{
+    sbcenc_pcm[sbcenc_pcm_len++] = l;
+    sbcenc_pcm[sbcenc_pcm_len++] = r;
+}
+
+/* SBCENC_SIGNALS stereo signals, each SBCENC_SIGNAL_SAMPLES long */
+static void build_synthetic(void)
+{
+    UINT32 seed = 0x12345678;
+    double phase = 0;
+    int i;
+
+    for (i = 0; i < SBCENC_SIGNAL_SAMPLES; i++)
+        append(clip16(29000.0 * sin(2 * M_PI * 1000.0 * i / SBCENC_SAMPLE_RATE)),
+               clip16(16000.0 * sin(2 * M_PI * 5000.0 * i / SBCENC_SAMPLE_RATE)));
+
+    for (i = 0; i < SBCENC_SIGNAL_SAMPLES; i++)
+    {
+        phase += 2 * M_PI * 20.0 * pow(1000.0, (double)i / SBCENC_SIGNAL_SAMPLES) / SBCENC_SAMPLE_RATE;
+        append(clip16(32767.0 * sin(phase)), clip16(-32768.0 * cos(phase)));
+    }
+
+    for (i = 0; i < SBCENC_SIGNAL_SAMPLES; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        append((SINT16)(seed >> 16), (SINT16)seed);
+    }
+
+    for (i = 0; i < SBCENC_SIGNAL_SAMPLES; i++)
+        append(((i / 7) & 1) ? 32767 : -32768, ((i / 50) & 1) ? -32768 : 32767);
+
+    for (i = 0; i < SBCENC_SIGNAL_SAMPLES; i++)
+        append((i % 331) == 0 ? 32767 : 0, (i % 97) == 0 ? -32768 : 0);
+
+    for (i = 0; i < SBCENC_SIGNAL_SAMPLES; i++)
+        append(-32768, 32767);
+
+    for (i = 0; i < SBCENC_SIGNAL_SAMPLES; i++)
+        append(0, 0);
+}
+
+static int load_file(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    unsigned char buf[4096];
+    size_t n, i;
+    int skip = 0;
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        return -1;
+    }
+    if ((fread(buf, 1, 12, fp) == 12) && !memcmp(buf, "RIFF", 4) && !memcmp(buf + 8, "WAVE", 4))
+        skip = 44;
+    fseek(fp, skip, SEEK_SET);
+
+    while ((n = fread(buf, 1, sizeof(buf), fp)) >= 2)
+    {
+        for (i = 0; (i + 1 < n) && (sbcenc_pcm_len < SBCENC_MAX_SAMPLES); i += 2)
+            sbcenc_pcm[sbcenc_pcm_len++] = (SINT16)(buf[i] | (buf[i + 1] << 8));
+    }
+    fclose(fp);
+    return 0;
+}
+
+int sbcenc_corpus_init(int synthetic, int num_files, char **files)
+{
+    int i;
+
+    sbcenc_pcm = malloc(SBCENC_MAX_SAMPLES * sizeof(SINT16));
+    sbcenc_pcm_len = 0;
+    if (sbcenc_pcm == NULL)
+        return -1;
+
+    if (synthetic)
+        build_synthetic();
+    for (i = 0; i < num_files; i++)
+    {
+        if (load_file(files[i]) < 0)
+            return -1;
+    }
+    return (sbcenc_pcm_len > 0) ? 0 : -1;
+}
+
+void sbcenc_corpus_free(void)
+{
+    free(sbcenc_pcm);
+    sbcenc_pcm = NULL;
+    sbcenc_pcm_len = 0;
+}
@@ -0,0 +1,57 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      sbcenc_common.h
+ *
+ *  Description:   PCM corpus and stack stubs shared by the SBC encoder test tools
+ *
+ ***********************************************************************************/
+
+#ifndef SBCENC_COMMON_H
+#define SBCENC_COMMON_H
+
+#include "sbc_encoder.h"
+
+#define SBCENC_SAMPLE_RATE      44100
+#define SBCENC_SIGNAL_SAMPLES   (SBCENC_SAMPLE_RATE / 4)        /* per channel and signal */
+#define SBCENC_SIGNALS          7
+#define SBCENC_MAX_FILE_SAMPLES (SBCENC_SAMPLE_RATE * 2 * 30)   /* 30 s of stereo */
+
+/* interleaved stereo input, used as a single channel by the mono configurations */
+extern SINT16 *sbcenc_pcm;
+extern int sbcenc_pcm_len;
+
+/*******************************************************************************
+**
+** Function         sbcenc_corpus_init
+**
+** Description      Builds the input: the synthetic signals (tones, a sweep, full
+**                  scale noise and square waves, impulses, DC at both rails and
+**                  silence) if synthetic is non zero, followed by the 16 bit
+**                  little endian PCM files (raw, or WAV whose header is skipped).
+**
+** Returns          0 on success, -1 if a file cannot be read or the input is empty
+**
+*******************************************************************************/
+extern int sbcenc_corpus_init(int synthetic, int num_files, char **files);
+
+extern void sbcenc_corpus_free(void);
+
+#endif
@@ -0,0 +1,230 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      sbcenc_simd_test.c
+ *
+ *  Description:   Checks that the SIMD kernels of the SBC encoder are bit-exact
+ *                 with the C implementation
+ *
+ ***********************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sbc_encoder.h"
+#include "sbc_enc_func_declare.h"
+#include "sbcenc_common.h"
+
+/************************************************************************************
+**  Constants & Macros
+************************************************************************************/
+
+#define TEST_MAX_PACKET_LEN     1024
+#define TEST_FRAME_SAMPLES      (SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS * SBC_MAX_NUM_OF_SUBBANDS)
+#define TEST_SCF_NUM            (SBC_MAX_NUM_OF_CHANNELS * SBC_MAX_NUM_OF_SUBBANDS)
+
+typedef struct
+{
+    SINT16  sub_bands;
+    SINT16  blocks;
+    SINT16  mode;
+    SINT16  alloc;
+    SINT16  bitpool;
+} tTEST_CFG;
+
+/* everything an encoder run produces */
+typedef struct
+{
+    int     frames;
+    UINT16  *p_len;
+    UINT8   *p_packets;
+    SINT32  *p_sb;
+    SINT16  *p_scf;
+} tTEST_OUT;
+
+/************************************************************************************
+**  Static variables
+************************************************************************************/
+
+static const char *test_level_name[] = { "C", "SSE2", "AVX2", "NEON" };
+static const char *test_mode_name[] = { "mono", "dual", "stereo", "joint" };
+
+/************************************************************************************
+**  Encoding
+************************************************************************************/
+
+static int encode(UINT8 level, const tTEST_CFG *p_cfg, tTEST_OUT *p_out)
+{
+    static SBC_ENC_PARAMS enc;
+    int f, n, cols;
+
+    if (!SbcEncSimdSelect(level))
+        return -1;
+
+    memset(&enc, 0, sizeof(enc));
+    enc.s16SamplingFreq     = SBC_sf44100;
+    enc.s16ChannelMode      = p_cfg->mode;
+    enc.s16NumOfSubBands    = p_cfg->sub_bands;
+    enc.s16NumOfBlocks      = p_cfg->blocks;
+    enc.s16AllocationMethod = p_cfg->alloc;
+    enc.u16BitRate          = 328;
+    SBC_Encoder_Init(&enc);
+    enc.s16BitPool = p_cfg->bitpool;
+
+    n = enc.s16NumOfChannels * enc.s16NumOfSubBands * enc.s16NumOfBlocks;
+    cols = enc.s16NumOfChannels * enc.s16NumOfSubBands;
+    p_out->frames = sbcenc_pcm_len / n;
+
+    for (f = 0; f < p_out->frames; f++)
+    {
+        memcpy(enc.as16PcmBuffer, sbcenc_pcm + f * n, n * sizeof(SINT16));
+        enc.pu8Packet = p_out->p_packets + f * TEST_MAX_PACKET_LEN;
+        SBC_Encoder(&enc);
+        p_out->p_len[f] = enc.u16PacketLength;
+        memcpy(p_out->p_sb + f * TEST_FRAME_SAMPLES, enc.s32SbBuffer, n * sizeof(SINT32));
+        memcpy(p_out->p_scf + f * TEST_SCF_NUM, enc.as16ScaleFactor, cols * sizeof(SINT16));
+    }
+    return 0;
+}
+
+static int out_alloc(tTEST_OUT *p_out, int max_frames)
+{
+    p_out->p_len     = calloc(max_frames, sizeof(UINT16));
+    p_out->p_packets = calloc(max_frames, TEST_MAX_PACKET_LEN);
+    p_out->p_sb      = calloc(max_frames, TEST_FRAME_SAMPLES * sizeof(SINT32));
+    p_out->p_scf     = calloc(max_frames, TEST_SCF_NUM * sizeof(SINT16));
+    return (p_out->p_len && p_out->p_packets && p_out->p_sb && p_out->p_scf) ? 0 : -1;
+}
+
+static void out_free(tTEST_OUT *p_out)
+{
+    free(p_out->p_len);
+    free(p_out->p_packets);
+    free(p_out->p_sb);
+    free(p_out->p_scf);
+}
+
+/* returns the first frame that differs, -1 if none */
+static int compare(const tTEST_CFG *p_cfg, const tTEST_OUT *p_ref, const tTEST_OUT *p_out, const char **pp_what)
+{
+    int n = (p_cfg->mode == SBC_MONO ? 1 : 2) * p_cfg->sub_bands;
+    int f;
+
+    for (f = 0; f < p_ref->frames; f++)
+    {
+        if (memcmp(p_ref->p_sb + f * TEST_FRAME_SAMPLES, p_out->p_sb + f * TEST_FRAME_SAMPLES,
+                   n * p_cfg->blocks * sizeof(SINT32)))
+        {
+            *pp_what = "subband samples";
+            return f;
+        }
+        if (memcmp(p_ref->p_scf + f * TEST_SCF_NUM, p_out->p_scf + f * TEST_SCF_NUM, n * sizeof(SINT16)))
+        {
+            *pp_what = "scale factors";
+            return f;
+        }
+        if ((p_ref->p_len[f] != p_out->p_len[f]) ||
+            memcmp(p_ref->p_packets + f * TEST_MAX_PACKET_LEN, p_out->p_packets + f * TEST_MAX_PACKET_LEN,
+                   p_ref->p_len[f]))
+        {
+            *pp_what = "packet";
+            return f;
+        }
+    }
+    return -1;
+}
+
+/************************************************************************************
+**  Main
+************************************************************************************/
+
+int main(int argc, char **argv)
+{
+    static const SINT16 blocks[] = { SBC_BLOCK_0, SBC_BLOCK_1, SBC_BLOCK_2, SBC_BLOCK_3 };
+    tTEST_OUT ref, out;
+    tTEST_CFG cfg;
+    int max_frames, i, sb, b, mode, alloc, bp, level, bad;
+    int configs = 0, failures = 0, tested = 0;
+    long frames = 0;
+    const char *what;
+
+    if (sbcenc_corpus_init(1, argc - 1, argv + 1) < 0)
+        return 1;
+
+    /* the smallest frame is 4 blocks of 4 mono subbands */
+    max_frames = sbcenc_pcm_len / 16 + 1;
+    if (out_alloc(&ref, max_frames) < 0 || out_alloc(&out, max_frames) < 0)
+        return 1;
+
+    printf("sbcenc_simd_test: %d samples of input\n", sbcenc_pcm_len);
+
+    for (level = SBC_SIMD_SSE2; level <= SBC_SIMD_NEON; level++)
+    {
+        if (!SbcEncSimdSelect((UINT8)level))
+        {
+            printf("%-5s not available\n", test_level_name[level]);
+            continue;
+        }
+        tested++;
+        configs = 0;
+        frames = 0;
+        bad = 0;
+
+        for (sb = SUB_BANDS_4; sb <= SUB_BANDS_8; sb += 4)
+        for (b = 0; b < 4; b++)
+        for (mode = SBC_MONO; mode <= SBC_JOINT_STEREO; mode++)
+        for (alloc = SBC_LOUDNESS; alloc <= SBC_SNR; alloc++)
+        for (bp = 0; bp < 3; bp++)
+        {
+            int max_bp = ((mode == SBC_MONO || mode == SBC_DUAL) ? 16 : 32) * sb;
+
+            cfg.sub_bands = (SINT16)sb;
+            cfg.blocks    = blocks[b];
+            cfg.mode      = (SINT16)mode;
+            cfg.alloc     = (SINT16)alloc;
+            cfg.bitpool   = (SINT16)((bp == 0) ? 2 : (bp == 1) ? 35 : (max_bp > 250 ? 250 : max_bp));
+
+            encode(SBC_SIMD_NONE, &cfg, &ref);
+            encode((UINT8)level, &cfg, &out);
+            configs++;
+            frames += ref.frames;
+
+            if ((i = compare(&cfg, &ref, &out, &what)) >= 0)
+            {
+                printf("%-5s MISMATCH %d subbands, %d blocks, %s, %s, bitpool %d: %s of frame %d\n",
+                       test_level_name[level], sb, cfg.blocks, test_mode_name[mode],
+                       alloc == SBC_SNR ? "snr" : "loudness", cfg.bitpool, what, i);
+                bad++;
+            }
+        }
+        printf("%-5s %d configurations, %ld frames, %d mismatches\n", test_level_name[level], configs, frames, bad);
+        failures += bad;
+    }
+
+    out_free(&ref);
+    out_free(&out);
+    sbcenc_corpus_free();
+
+    if (tested == 0)
+        printf("no SIMD kernels on this CPU or build, nothing compared\n");
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
@@ -49,6 +49,8 @@ typedef enum {
 #define UIPC_REG_CBACK                  2
 #define UIPC_REG_REMOVE_ACTIVE_READSET  3
 #define UIPC_SET_READ_POLL_TMO          4
+#define UIPC_REQ_GET_RX_FD              5   /* param: int *, takes the fd */
+#define UIPC_REQ_SET_PCM_RING           6   /* param: ring fd, always consumed */
 
 typedef void (tUIPC_RCV_CBACK)(tUIPC_CH_ID ch_id, tUIPC_EVENT event); /* points to BT_HDR which describes event type and length of data; len contains the number of bytes of entire message (sizeof(BT_HDR) + offset + size of data) */
 
@@ -100,7 +102,7 @@ UDRV_API extern void UIPC_Close(tUIPC_CH_ID ch_id);
 ** Description      Called to transmit a message over UIPC.
 **                  Message buffer will be freed by UIPC_SendBuf.
 **
-** Returns          void
+** Returns          TRUE if all the data was sent
 **
 *******************************************************************************/
 UDRV_API extern BOOLEAN UIPC_SendBuf(tUIPC_CH_ID ch_id, BT_HDR *p_msg);
@@ -127,13 +129,27 @@ UDRV_API extern BOOLEAN UIPC_Send(tUIPC_CH_ID ch_id, UINT16 msg_evt, UINT8 *p_bu
 *******************************************************************************/
 UDRV_API extern UINT32 UIPC_Read(tUIPC_CH_ID ch_id, UINT16 *p_msg_evt, UINT8 *p_buf, UINT32 len);
 
+/*******************************************************************************
+**
+** Function         UIPC_ReadBuf
+**
+** Description      Called to read a message from UIPC into a GKI buffer.
+**                  The data is appended at p_msg->offset + p_msg->len, up to
+**                  the end of the buffer, and p_msg->len is updated.
+**
+** Returns          number of bytes read
+**
+*******************************************************************************/
+UDRV_API extern UINT32 UIPC_ReadBuf(tUIPC_CH_ID ch_id, BT_HDR *p_msg);
+
 /*******************************************************************************
 **
 ** Function         UIPC_Ioctl
 **
 ** Description      Called to control UIPC.
 **
-** Returns          void
+** Returns          TRUE if UIPC_REQ_GET_RX_FD returned an fd or
+**                  UIPC_REQ_SET_PCM_RING attached the ring, FALSE otherwise
 **
 *******************************************************************************/
 UDRV_API extern BOOLEAN UIPC_Ioctl(tUIPC_CH_ID ch_id, UINT32 request, void *param);
@@ -37,7 +37,7 @@
 #include <signal.h>
 #include <errno.h>
 #include <pthread.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/poll.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -63,6 +63,13 @@
 
 #define UIPC_DISCONNECTED (-1)
 
+/* epoll user data: the channel id, with UIPC_EP_SRV for its server socket */
+#define UIPC_EP_CH_MASK   0xFF
+#define UIPC_EP_SRV       0x100
+#define UIPC_EP_SIGNAL    0xFFFF
+
+#define UIPC_MAX_EVENTS   (2 * UIPC_CH_NUM + 1)
+
 #define UIPC_LOCK() /*BTIF_TRACE_EVENT1(" %s lock", __FUNCTION__);*/ pthread_mutex_lock(&uipc_main.mutex);
 #define UIPC_UNLOCK() /*BTIF_TRACE_EVENT1("%s unlock", __FUNCTION__);*/ pthread_mutex_unlock(&uipc_main.mutex);
 
@@ -77,6 +84,9 @@ typedef enum {
 typedef struct {
     int srvfd;
     int fd;
+    int fd_polled;        /* fd is watched by the read task */
+    int rx_fd;            /* last fd received with SCM_RIGHTS, until taken */
+    tA2DP_PCM_RING *p_ring; /* data comes through this ring, not the socket */
     int read_poll_tmo_ms;
     int task_evt_flags;   /* event flags pending to be processed in read task */
     tUIPC_EVENT cond_flags;
@@ -90,9 +100,7 @@ typedef struct {
     int running;
     pthread_mutex_t mutex;
 
-    fd_set active_set;
-    fd_set read_set;
-    int max_fd;
+    int epfd;
     int signal_fds[2];
 
     tUIPC_CHAN ch[UIPC_CH_NUM];
@@ -244,6 +252,38 @@ static int accept_server_socket(int sfd)
 **
 *****************************************************************************/
 
+/* fds are added and removed while the read task waits, no wake up needed */
+static int uipc_poll_add(int fd, UINT32 tag)
+{
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = tag;
+
+    if (epoll_ctl(uipc_main.epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        BTIF_TRACE_ERROR2("epoll_ctl add fd %d failed (%s)", fd, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static void uipc_poll_del(int fd)
+{
+    epoll_ctl(uipc_main.epfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+/* wakeups and channel closes first, then the audio channel */
+static int uipc_event_prio(UINT32 tag)
+{
+    if (tag == UIPC_EP_SIGNAL)
+        return 0;
+    if ((tag & UIPC_EP_CH_MASK) == UIPC_CH_ID_AV_AUDIO)
+        return 1;
+    return 2;
+}
+
 static int uipc_main_init(void)
 {
     int i;
@@ -252,20 +292,28 @@ static int uipc_main_init(void)
 
     BTIF_TRACE_EVENT0("### uipc_main_init ###");
 
+    if ((uipc_main.epfd = epoll_create(UIPC_MAX_EVENTS)) < 0)
+    {
+        BTIF_TRACE_ERROR1("epoll_create failed (%s)", strerror(errno));
+        return -1;
+    }
+
     /* setup interrupt socket pair */
     if (socketpair(AF_UNIX, SOCK_STREAM, 0, uipc_main.signal_fds) < 0)
     {
         return -1;
     }
 
-    FD_SET(uipc_main.signal_fds[0], &uipc_main.active_set);
-    uipc_main.max_fd = MAX(uipc_main.max_fd, uipc_main.signal_fds[0]);
+    uipc_poll_add(uipc_main.signal_fds[0], UIPC_EP_SIGNAL);
 
     for (i=0; i< UIPC_CH_NUM; i++)
     {
         tUIPC_CHAN *p = &uipc_main.ch[i];
         p->srvfd = UIPC_DISCONNECTED;
         p->fd = UIPC_DISCONNECTED;
+        p->fd_polled = 0;
+        p->rx_fd = UIPC_DISCONNECTED;
+        p->p_ring = NULL;
         p->task_evt_flags = 0;
         pthread_cond_init(&p->cond, NULL);
         pthread_mutex_init(&p->cond_mutex, NULL);
@@ -281,12 +329,13 @@ void uipc_main_cleanup(void)
 
     BTIF_TRACE_EVENT0("uipc_main_cleanup");
 
-    close(uipc_main.signal_fds[0]);
-    close(uipc_main.signal_fds[1]);
-
     /* close any open channels */
     for (i=0; i<UIPC_CH_NUM; i++)
         uipc_close_ch_locked(i);
+
+    close(uipc_main.signal_fds[0]);
+    close(uipc_main.signal_fds[1]);
+    close(uipc_main.epfd);
 }
 
 
@@ -311,60 +360,72 @@ static void uipc_check_task_flags_locked(void)
 }
 
 
-static int uipc_check_fd_locked(tUIPC_CH_ID ch_id)
+static void uipc_check_fd_locked(UINT32 tag)
 {
-    if (ch_id >= UIPC_CH_NUM)
-        return -1;
+    tUIPC_CH_ID ch_id = (tUIPC_CH_ID)(tag & UIPC_EP_CH_MASK);
+    tUIPC_CHAN *p = &uipc_main.ch[ch_id];
 
-    //BTIF_TRACE_EVENT2("CHECK SRVFD %d (ch %d)", uipc_main.ch[ch_id].srvfd, ch_id);
+    if (ch_id >= UIPC_CH_NUM)
+        return;
 
-    if (FD_ISSET(uipc_main.ch[ch_id].srvfd, &uipc_main.read_set))
+    if (tag & UIPC_EP_SRV)
     {
+        /* the channel may have been closed since the event was reported */
+        if (p->srvfd == UIPC_DISCONNECTED)
+            return;
+
         BTIF_TRACE_EVENT1("INCOMING CONNECTION ON CH %d", ch_id);
 
-        uipc_main.ch[ch_id].fd = accept_server_socket(uipc_main.ch[ch_id].srvfd);
+        p->fd = accept_server_socket(p->srvfd);
 
-        BTIF_TRACE_EVENT1("NEW FD %d", uipc_main.ch[ch_id].fd);
+        BTIF_TRACE_EVENT1("NEW FD %d", p->fd);
 
-        if ((uipc_main.ch[ch_id].fd > 0) && uipc_main.ch[ch_id].cback)
+        if ((p->fd > 0) && p->cback)
         {
-            /*  if we have a callback we should add this fd to the active set
+            /*  if we have a callback we should watch this fd
                 and notify user with callback event */
-            BTIF_TRACE_EVENT1("ADD FD %d TO ACTIVE SET", uipc_main.ch[ch_id].fd);
-            FD_SET(uipc_main.ch[ch_id].fd, &uipc_main.active_set);
-            uipc_main.max_fd = MAX(uipc_main.max_fd, uipc_main.ch[ch_id].fd);
+            BTIF_TRACE_EVENT1("ADD FD %d TO ACTIVE SET", p->fd);
+            if (uipc_poll_add(p->fd, ch_id) == 0)
+                p->fd_polled = 1;
         }
 
-        if (uipc_main.ch[ch_id].fd < 0)
+        if (p->fd < 0)
         {
             BTIF_TRACE_ERROR2("FAILED TO ACCEPT CH %d (%s)", ch_id, strerror(errno));
-            return -1;
+            return;
         }
 
-        if (uipc_main.ch[ch_id].cback)
-            uipc_main.ch[ch_id].cback(ch_id, UIPC_OPEN_EVT);
+        if (p->cback)
+            p->cback(ch_id, UIPC_OPEN_EVT);
+        return;
     }
 
-    //BTIF_TRACE_EVENT2("CHECK FD %d (ch %d)", uipc_main.ch[ch_id].fd, ch_id);
-
-    if (FD_ISSET(uipc_main.ch[ch_id].fd, &uipc_main.read_set))
+    if (p->p_ring)
     {
-        //BTIF_TRACE_EVENT1("INCOMING DATA ON CH %d", ch_id);
+        /* the data is in the ring, the socket only tells when the peer goes away */
+        char buf[64];
+        int n = recv(p->fd, buf, sizeof(buf), MSG_DONTWAIT);
 
-        if (uipc_main.ch[ch_id].cback)
-            uipc_main.ch[ch_id].cback(ch_id, UIPC_RX_DATA_READY_EVT);
+        if ((n == 0) || ((n < 0) && (errno != EAGAIN) && (errno != EINTR)))
+        {
+            BTIF_TRACE_EVENT1("CH %d : ring peer detached", ch_id);
+            uipc_close_ch_locked(ch_id);
+        }
+        return;
     }
-    return 0;
+
+    /* the reader may have taken the fd over since the event was reported */
+    if (p->fd_polled && p->cback)
+        p->cback(ch_id, UIPC_RX_DATA_READY_EVT);
 }
 
 static void uipc_check_interrupt_locked(void)
 {
-    if (FD_ISSET(uipc_main.signal_fds[0], &uipc_main.read_set))
-    {
-        char sig_recv = 0;
-        //BTIF_TRACE_EVENT0("UIPC INTERRUPT");
-        recv(uipc_main.signal_fds[0], &sig_recv, sizeof(sig_recv), MSG_WAITALL);
-    }
+    char sig_recv[8];
+
+    //BTIF_TRACE_EVENT0("UIPC INTERRUPT");
+    while (recv(uipc_main.signal_fds[0], sig_recv, sizeof(sig_recv), MSG_DONTWAIT) == sizeof(sig_recv))
+        ;
 }
 
 static inline void uipc_wakeup_locked(void)
@@ -394,16 +455,12 @@ static int uipc_setup_server_locked(tUIPC_CH_ID ch_id, char *name, tUIPC_RCV_CBA
          return -1;
     }
 
-    BTIF_TRACE_EVENT1("ADD SERVER FD TO ACTIVE SET %d", fd);
-    FD_SET(fd, &uipc_main.active_set);
-    uipc_main.max_fd = MAX(uipc_main.max_fd, fd);
-
     uipc_main.ch[ch_id].srvfd = fd;
     uipc_main.ch[ch_id].cback = cback;
     uipc_main.ch[ch_id].read_poll_tmo_ms = DEFAULT_READ_POLL_TMO_MS;
 
-    /* trigger main thread to update read set */
-    uipc_wakeup_locked();
+    BTIF_TRACE_EVENT1("ADD SERVER FD TO ACTIVE SET %d", fd);
+    uipc_poll_add(fd, ch_id | UIPC_EP_SRV);
 
     UIPC_UNLOCK();
 
@@ -440,11 +497,123 @@ static void uipc_flush_ch_locked(tUIPC_CH_ID ch_id)
 }
 
 
+/* a ring read position may only be moved by its reader, which holds the lock.
+   Reads all of len or nothing: the asynchronous feeding pads a short read with
+   silence, while a read of 0 just skips the tick until the HAL caught up. */
+static UINT32 uipc_ring_read_locked(tA2DP_PCM_RING *p_ring, UINT8 *p_buf, UINT32 len)
+{
+    uint32_t rd = p_ring->read_pos;
+    uint32_t avail = p_ring->write_pos - rd;
+    uint32_t ofs, n;
+
+    /* read the pcm only after the position that covers it */
+    __sync_synchronize();
+
+    if (avail > A2DP_PCM_RING_SZ)
+    {
+        BTIF_TRACE_ERROR2("ring positions corrupted (rd %u, avail %u)", rd, avail);
+        return 0;
+    }
+
+    if (len > avail)
+    {
+        /* a read larger than the ring takes it once it is full */
+        if (avail < A2DP_PCM_RING_SZ)
+            return 0;
+        len = avail;
+    }
+
+    ofs = rd & (A2DP_PCM_RING_SZ - 1);
+    n = A2DP_PCM_RING_SZ - ofs;
+    if (n > len)
+        n = len;
+
+    memcpy(p_buf, &p_ring->data[ofs], n);
+    memcpy(p_buf + n, p_ring->data, len - n);
+
+    /* done with the pcm before the writer may reuse its room */
+    __sync_synchronize();
+    p_ring->read_pos = rd + len;
+
+    return len;
+}
+
+static void uipc_ring_detach_locked(tUIPC_CH_ID ch_id)
+{
+    tUIPC_CHAN *p = &uipc_main.ch[ch_id];
+
+    if (p->p_ring == NULL)
+        return;
+
+    BTIF_TRACE_EVENT1("CH %d : DETACH RING", ch_id);
+
+    munmap(p->p_ring, sizeof(tA2DP_PCM_RING));
+    p->p_ring = NULL;
+}
+
+/* takes ownership of fd */
+static BOOLEAN uipc_ring_attach_locked(tUIPC_CH_ID ch_id, int fd)
+{
+    tUIPC_CHAN *p = &uipc_main.ch[ch_id];
+    tA2DP_PCM_RING *p_ring;
+    struct stat st;
+
+    if (p->fd == UIPC_DISCONNECTED)
+    {
+        BTIF_TRACE_ERROR1("CH %d : ring offered without a connection", ch_id);
+        close(fd);
+        return FALSE;
+    }
+
+    /* ashmem reports no size, anything else must be large enough to map */
+    if ((fstat(fd, &st) < 0) || ((st.st_size != 0) && (st.st_size < (off_t)sizeof(tA2DP_PCM_RING))))
+    {
+        BTIF_TRACE_ERROR1("CH %d : ring region too small", ch_id);
+        close(fd);
+        return FALSE;
+    }
+
+    p_ring = mmap(NULL, sizeof(tA2DP_PCM_RING), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (p_ring == MAP_FAILED)
+    {
+        BTIF_TRACE_ERROR2("CH %d : ring mmap failed (%s)", ch_id, strerror(errno));
+        return FALSE;
+    }
+
+    if ((p_ring->magic != A2DP_PCM_RING_MAGIC) || (p_ring->size != A2DP_PCM_RING_SZ))
+    {
+        BTIF_TRACE_ERROR3("CH %d : bad ring header (magic %x, size %d)", ch_id,
+                          p_ring->magic, p_ring->size);
+        munmap(p_ring, sizeof(tA2DP_PCM_RING));
+        return FALSE;
+    }
+
+    uipc_ring_detach_locked(ch_id);
+    p->p_ring = p_ring;
+
+    /* nobody reads the socket any more, watch it for the peer going away */
+    if (!p->fd_polled && (uipc_poll_add(p->fd, ch_id) == 0))
+        p->fd_polled = 1;
+
+    BTIF_TRACE_EVENT1("CH %d : RING ATTACHED", ch_id);
+
+    return TRUE;
+}
+
 static void uipc_flush_locked(tUIPC_CH_ID ch_id)
 {
     if (ch_id >= UIPC_CH_NUM)
         return;
 
+    if (uipc_main.ch[ch_id].p_ring)
+    {
+        tA2DP_PCM_RING *p_ring = uipc_main.ch[ch_id].p_ring;
+
+        p_ring->read_pos = p_ring->write_pos;
+    }
+
     switch(ch_id)
     {
         case UIPC_CH_ID_AV_CTRL:
@@ -460,8 +629,6 @@ static void uipc_flush_locked(tUIPC_CH_ID ch_id)
 
 static int uipc_close_ch_locked(tUIPC_CH_ID ch_id)
 {
-    int wakeup = 0;
-
     BTIF_TRACE_EVENT1("CLOSE CHANNEL %d", ch_id);
 
     if (ch_id >= UIPC_CH_NUM)
@@ -470,29 +637,33 @@ static int uipc_close_ch_locked(tUIPC_CH_ID ch_id)
     if (uipc_main.ch[ch_id].srvfd != UIPC_DISCONNECTED)
     {
         BTIF_TRACE_EVENT1("CLOSE SERVER (FD %d)", uipc_main.ch[ch_id].srvfd);
+        uipc_poll_del(uipc_main.ch[ch_id].srvfd);
         close(uipc_main.ch[ch_id].srvfd);
-        FD_CLR(uipc_main.ch[ch_id].srvfd, &uipc_main.active_set);
         uipc_main.ch[ch_id].srvfd = UIPC_DISCONNECTED;
-        wakeup = 1;
     }
 
     if (uipc_main.ch[ch_id].fd != UIPC_DISCONNECTED)
     {
         BTIF_TRACE_EVENT1("CLOSE CONNECTION (FD %d)", uipc_main.ch[ch_id].fd);
+        if (uipc_main.ch[ch_id].fd_polled)
+            uipc_poll_del(uipc_main.ch[ch_id].fd);
         close(uipc_main.ch[ch_id].fd);
-        FD_CLR(uipc_main.ch[ch_id].fd, &uipc_main.active_set);
         uipc_main.ch[ch_id].fd = UIPC_DISCONNECTED;
-        wakeup = 1;
+        uipc_main.ch[ch_id].fd_polled = 0;
+    }
+
+    uipc_ring_detach_locked(ch_id);
+
+    if (uipc_main.ch[ch_id].rx_fd != UIPC_DISCONNECTED)
+    {
+        close(uipc_main.ch[ch_id].rx_fd);
+        uipc_main.ch[ch_id].rx_fd = UIPC_DISCONNECTED;
     }
 
     /* notify this connection is closed */
     if (uipc_main.ch[ch_id].cback)
         uipc_main.ch[ch_id].cback(ch_id, UIPC_CLOSE_EVT);
 
-    /* trigger main thread update if something was updated */
-    if (wakeup)
-        uipc_wakeup_locked();
-
     return 0;
 }
 
@@ -513,47 +684,58 @@ void uipc_close_locked(tUIPC_CH_ID ch_id)
 
 static void uipc_read_task(void *arg)
 {
-    int ch_id;
+    struct epoll_event events[UIPC_MAX_EVENTS];
+    struct epoll_event ev;
+    int i, j;
     int result;
 
     prctl(PR_SET_NAME, (unsigned long)"uipc-main", 0, 0, 0);
 
     while (uipc_main.running)
     {
-        uipc_main.read_set = uipc_main.active_set;
-
-        result = select(uipc_main.max_fd+1, &uipc_main.read_set, NULL, NULL, NULL);
+        result = epoll_wait(uipc_main.epfd, events, UIPC_MAX_EVENTS, -1);
 
         if (result == 0)
         {
-            BTIF_TRACE_EVENT0("select timeout");
+            BTIF_TRACE_EVENT0("epoll timeout");
             continue;
         }
         else if (result < 0)
         {
-            BTIF_TRACE_EVENT1("select failed %s", strerror(errno));
+            BTIF_TRACE_EVENT1("epoll_wait failed %s", strerror(errno));
             continue;
         }
 
-        UIPC_LOCK();
+        /* order the few events: wakeup first, then make sure we service
+           audio channel before the others */
+        for (i = 1; i < result; i++)
+        {
+            ev = events[i];
+            for (j = i; j > 0 && uipc_event_prio(events[j-1].data.u32) > uipc_event_prio(ev.data.u32); j--)
+                events[j] = events[j-1];
+            events[j] = ev;
+        }
 
-        /* clear any wakeup interrupt */
-        uipc_check_interrupt_locked();
+        /* only the channels with an event are checked, each one locked on its own */
+        for (i = 0; i < result; i++)
+        {
+            UIPC_LOCK();
 
-        /* check pending task events */
-        uipc_check_task_flags_locked();
+            if (events[i].data.u32 == UIPC_EP_SIGNAL)
+            {
+                /* clear any wakeup interrupt */
+                uipc_check_interrupt_locked();
 
-        /* make sure we service audio channel first */
-        uipc_check_fd_locked(UIPC_CH_ID_AV_AUDIO);
+                /* check pending task events */
+                uipc_check_task_flags_locked();
+            }
+            else
+            {
+                uipc_check_fd_locked(events[i].data.u32);
+            }
 
-        /* check for other connections */
-        for (ch_id = 0; ch_id < UIPC_CH_NUM; ch_id++)
-        {
-            if (ch_id != UIPC_CH_ID_AV_AUDIO)
-                uipc_check_fd_locked(ch_id);
+            UIPC_UNLOCK();
         }
-
-        UIPC_UNLOCK();
     }
 
     BTIF_TRACE_EVENT0("UIPC READ THREAD EXITING");
@@ -699,15 +881,40 @@ UDRV_API void UIPC_Close(tUIPC_CH_ID ch_id)
  *******************************************************************************/
 UDRV_API BOOLEAN UIPC_SendBuf(tUIPC_CH_ID ch_id, BT_HDR *p_msg)
 {
-    BTIF_TRACE_DEBUG1("UIPC_SendBuf : ch_id %d NOT IMPLEMENTED", ch_id);
+    UINT8 *p_data = (UINT8 *)(p_msg + 1) + p_msg->offset;
+    UINT16 len = p_msg->len;
+    int n;
+
+    BTIF_TRACE_DEBUG2("UIPC_SendBuf : ch_id:%d %d bytes", ch_id, len);
+
+    if (ch_id >= UIPC_CH_NUM)
+    {
+        GKI_freebuf(p_msg);
+        return FALSE;
+    }
 
     UIPC_LOCK();
 
-    /* currently not used */
+    /* straight from the buffer, no staging copy */
+    while (len && uipc_main.ch[ch_id].fd != UIPC_DISCONNECTED)
+    {
+        n = send(uipc_main.ch[ch_id].fd, p_data, len, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            BTIF_TRACE_ERROR1("failed to write (%s)", strerror(errno));
+            break;
+        }
+        p_data += n;
+        len -= n;
+    }
 
     UIPC_UNLOCK();
 
-    return FALSE;
+    GKI_freebuf(p_msg);
+
+    return (len == 0);
 }
 
 /*******************************************************************************
@@ -742,17 +949,26 @@ UDRV_API BOOLEAN UIPC_Send(tUIPC_CH_ID ch_id, UINT16 msg_evt, UINT8 *p_buf,
  **
  ** Function         UIPC_ReadBuf
  **
- ** Description      Called to read a message from UIPC.
+ ** Description      Called to read a message from UIPC into a GKI buffer.
+ **                  The data is appended at p_msg->offset + p_msg->len, up to
+ **                  the end of the buffer, and p_msg->len is updated.
  **
- ** Returns          void
+ ** Returns          return the number of bytes read.
  **
  *******************************************************************************/
-UDRV_API void UIPC_ReadBuf(tUIPC_CH_ID ch_id, BT_HDR *p_msg)
+UDRV_API UINT32 UIPC_ReadBuf(tUIPC_CH_ID ch_id, BT_HDR *p_msg)
 {
-    BTIF_TRACE_DEBUG1("UIPC_ReadBuf : ch_id:%d NOT IMPLEMENTED", ch_id);
+    UINT32 used = sizeof(BT_HDR) + p_msg->offset + p_msg->len;
+    UINT32 size = GKI_get_buf_size(p_msg);
+    UINT32 n;
 
-    UIPC_LOCK();
-    UIPC_UNLOCK();
+    if (size <= used)
+        return 0;
+
+    n = UIPC_Read(ch_id, NULL, (UINT8 *)(p_msg + 1) + p_msg->offset + p_msg->len, size - used);
+    p_msg->len += (UINT16)n;
+
+    return n;
 }
 
 /*******************************************************************************
@@ -771,6 +987,10 @@ UDRV_API UINT32 UIPC_Read(tUIPC_CH_ID ch_id, UINT16 *p_msg_evt, UINT8 *p_buf, UI
     int n_read = 0;
     int fd = uipc_main.ch[ch_id].fd;
     struct pollfd pfd;
+    struct msghdr msg;
+    struct iovec iv;
+    struct cmsghdr *cmsg;
+    char cmsg_buf[CMSG_SPACE(sizeof(int))];
 
     if (ch_id >= UIPC_CH_NUM)
     {
@@ -778,6 +998,16 @@ UDRV_API UINT32 UIPC_Read(tUIPC_CH_ID ch_id, UINT16 *p_msg_evt, UINT8 *p_buf, UI
         return 0;
     }
 
+    if (uipc_main.ch[ch_id].p_ring)
+    {
+        /* never blocks, returns 0 until len bytes are queued */
+        UIPC_LOCK();
+        if (uipc_main.ch[ch_id].p_ring)
+            n_read = uipc_ring_read_locked(uipc_main.ch[ch_id].p_ring, p_buf, len);
+        UIPC_UNLOCK();
+        return n_read;
+    }
+
     if (fd == UIPC_DISCONNECTED)
     {
         BTIF_TRACE_ERROR1("UIPC_Read : channel %d closed", ch_id);
@@ -797,7 +1027,8 @@ UDRV_API UINT32 UIPC_Read(tUIPC_CH_ID ch_id, UINT16 *p_msg_evt, UINT8 *p_buf, UI
         if (poll(&pfd, 1, uipc_main.ch[ch_id].read_poll_tmo_ms) == 0)
         {
             BTIF_TRACE_EVENT1("poll timeout (%d ms)", uipc_main.ch[ch_id].read_poll_tmo_ms);
-            return 0;
+            /* what was read so far is in p_buf, let the caller keep it */
+            return n_read;
         }
 
         //BTIF_TRACE_EVENT1("poll revents %x", pfd.revents);
@@ -811,7 +1042,28 @@ UDRV_API UINT32 UIPC_Read(tUIPC_CH_ID ch_id, UINT16 *p_msg_evt, UINT8 *p_buf, UI
             return 0;
         }
 
-        n = recv(fd, p_buf+n_read, len-n_read, 0);
+        memset(&msg, 0, sizeof(msg));
+        iv.iov_base = p_buf + n_read;
+        iv.iov_len = len - n_read;
+        msg.msg_iov = &iv;
+        msg.msg_iovlen = 1;
+        msg.msg_control = cmsg_buf;
+        msg.msg_controllen = sizeof(cmsg_buf);
+
+        n = recvmsg(fd, &msg, MSG_NOSIGNAL);
+
+        /* keep a passed fd for UIPC_REQ_GET_RX_FD */
+        for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS))
+            {
+                UIPC_LOCK();
+                if (uipc_main.ch[ch_id].rx_fd != UIPC_DISCONNECTED)
+                    close(uipc_main.ch[ch_id].rx_fd);
+                memcpy(&uipc_main.ch[ch_id].rx_fd, CMSG_DATA(cmsg), sizeof(int));
+                UIPC_UNLOCK();
+            }
+        }
 
         //BTIF_TRACE_EVENT1("read %d bytes", n);
 
@@ -843,14 +1095,25 @@ UDRV_API UINT32 UIPC_Read(tUIPC_CH_ID ch_id, UINT16 *p_msg_evt, UINT8 *p_buf, UI
 **
 ** Description      Called to control UIPC.
 **
-** Returns          void
+** Returns          TRUE if UIPC_REQ_GET_RX_FD returned an fd or
+**                  UIPC_REQ_SET_PCM_RING attached the ring, FALSE otherwise
 **
 *******************************************************************************/
 
 UDRV_API extern BOOLEAN UIPC_Ioctl(tUIPC_CH_ID ch_id, UINT32 request, void *param)
 {
+    BOOLEAN status = FALSE;
+
     BTIF_TRACE_DEBUG2("#### UIPC_Ioctl : ch_id %d, request %d ####", ch_id, request);
 
+    if (ch_id >= UIPC_CH_NUM)
+    {
+        /* the ring fd is consumed even when the request fails */
+        if (request == UIPC_REQ_SET_PCM_RING)
+            close((int)(long)param);
+        return FALSE;
+    }
+
     UIPC_LOCK();
 
     switch(request)
@@ -866,14 +1129,11 @@ UDRV_API extern BOOLEAN UIPC_Ioctl(tUIPC_CH_ID ch_id, UINT32 request, void *para
 
         case UIPC_REG_REMOVE_ACTIVE_READSET:
 
-            /* user will read data directly and not use select loop */
-            if (uipc_main.ch[ch_id].fd != UIPC_DISCONNECTED)
+            /* user will read data directly and not use the read task */
+            if (uipc_main.ch[ch_id].fd_polled)
             {
-                /* remove this channel from active set */
-                FD_CLR(uipc_main.ch[ch_id].fd, &uipc_main.active_set);
-
-                /* refresh active set */
-                uipc_wakeup_locked();
+                uipc_poll_del(uipc_main.ch[ch_id].fd);
+                uipc_main.ch[ch_id].fd_polled = 0;
             }
             break;
 
@@ -882,6 +1142,16 @@ UDRV_API extern BOOLEAN UIPC_Ioctl(tUIPC_CH_ID ch_id, UINT32 request, void *para
             BTIF_TRACE_EVENT2("UIPC_SET_READ_POLL_TMO : CH %d, TMO %d ms", ch_id, uipc_main.ch[ch_id].read_poll_tmo_ms );
             break;
 
+        case UIPC_REQ_GET_RX_FD:
+            *(int *)param = uipc_main.ch[ch_id].rx_fd;
+            uipc_main.ch[ch_id].rx_fd = UIPC_DISCONNECTED;
+            status = (*(int *)param != UIPC_DISCONNECTED);
+            break;
+
+        case UIPC_REQ_SET_PCM_RING:
+            status = uipc_ring_attach_locked(ch_id, (int)(long)param);
+            break;
+
         default:
             BTIF_TRACE_EVENT1("UIPC_Ioctl : request not handled (%d)", request);
             break;
@@ -889,6 +1159,6 @@ UDRV_API extern BOOLEAN UIPC_Ioctl(tUIPC_CH_ID ch_id, UINT32 request, void *para
 
     UIPC_UNLOCK();
 
-    return FALSE;
+    return status;
 }
 
@@ -29,6 +29,7 @@ typedef enum {
     TASK_HIGH_BTU,
     TASK_HIGH_HCI_WORKER,
     TASK_HIGH_USERIAL_READ,
+    TASK_HIGH_MEDIA_CLOCK,
     TASK_HIGH_MAX
 } tHIGH_PRIORITY_TASK;
 